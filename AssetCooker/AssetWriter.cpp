@@ -0,0 +1,402 @@
+#include "AssetWriter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+	uint64_t alignUp(uint64_t value, uint64_t alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	template <typename T>
+	std::vector<char> toBytes(const std::vector<T>& values) {
+		std::vector<char> bytes(values.size() * sizeof(T));
+		if (!bytes.empty()) {
+			std::memcpy(bytes.data(), values.data(), bytes.size());
+		}
+		return bytes;
+	}
+
+	/// <summary>
+	/// Round to nearest even float to half conversion. Values too large for a half become infinity, tiny ones denormals.
+	/// </summary>
+	uint16_t toHalf(float value) {
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+
+		const uint32_t sign = (bits >> 16) & 0x8000;
+		const int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xFF) - 127 + 15;
+		uint32_t mantissa = bits & 0x7FFFFF;
+
+		if (((bits >> 23) & 0xFF) == 0xFF) {
+			return static_cast<uint16_t>(sign | 0x7C00 | (mantissa ? 0x200 : 0)); // Inf or NaN
+		}
+		if (exponent >= 31) {
+			return static_cast<uint16_t>(sign | 0x7C00);
+		}
+		if (exponent <= 0) {
+			if (exponent < -10) {
+				return static_cast<uint16_t>(sign);
+			}
+			mantissa |= 0x800000;
+			const uint32_t shift = static_cast<uint32_t>(14 - exponent);
+			uint32_t half = mantissa >> shift;
+			const uint32_t remainder = mantissa & ((1u << shift) - 1);
+			const uint32_t halfway = 1u << (shift - 1);
+			if (remainder > halfway || (remainder == halfway && (half & 1))) {
+				half++;
+			}
+			return static_cast<uint16_t>(sign | half);
+		}
+
+		uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+		const uint32_t remainder = mantissa & 0x1FFF;
+		if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+			half++; // May carry into the exponent, which correctly rounds up to the next power of two or infinity
+		}
+		return static_cast<uint16_t>(sign | half);
+	}
+
+	uint32_t toSnorm10(float value) {
+		const float clamped = std::min(std::max(value, -1.0f), 1.0f);
+		return static_cast<uint32_t>(static_cast<int32_t>(std::lround(clamped * 511.0f))) & 0x3FF;
+	}
+
+	/// <summary>
+	/// A2B10G10R10_SNORM_PACK32: x in the low bits, w left at zero.
+	/// </summary>
+	uint32_t packNormal(const glm::vec3& normal) {
+		return toSnorm10(normal.x) | (toSnorm10(normal.y) << 10) | (toSnorm10(normal.z) << 20);
+	}
+
+	/// <summary>
+	/// Sphere around the centre of the bounding box. Not minimal, but cheap and never more than sqrt(3) times too big.
+	/// </summary>
+	void computeBounds(const std::vector<glm::vec3>& positions, const uint32_t* indices, size_t count, float (&bounds)[4]) {
+		if (count == 0) {
+			bounds[0] = bounds[1] = bounds[2] = bounds[3] = 0.0f;
+			return;
+		}
+
+		glm::vec3 lower = positions[indices[0]];
+		glm::vec3 upper = lower;
+		for (size_t i = 1; i < count; i++) {
+			lower = glm::min(lower, positions[indices[i]]);
+			upper = glm::max(upper, positions[indices[i]]);
+		}
+
+		const glm::vec3 centre = (lower + upper) * 0.5f;
+		float radius = 0.0f;
+		for (size_t i = 0; i < count; i++) {
+			radius = std::max(radius, glm::distance(centre, positions[indices[i]]));
+		}
+
+		bounds[0] = centre.x;
+		bounds[1] = centre.y;
+		bounds[2] = centre.z;
+		bounds[3] = radius;
+	}
+
+	/// <summary>
+	/// Normal cone of a meshlet, see AssetMeshlet. The axis is the area weighted mean normal; the cutoff is the sine of the
+	/// widest angle between it and any triangle's normal, since a view direction within 90 degrees minus that angle of the
+	/// axis is within 90 degrees of every normal. Degenerate triangles have no facing and are left out.
+	/// </summary>
+	void computeNormalCone(const std::vector<glm::vec3>& positions, const uint32_t* vertices, const uint8_t* triangles, uint32_t triangleCount,
+		float (&cone)[4]) {
+		std::vector<glm::vec3> normals;
+		normals.reserve(triangleCount);
+		glm::vec3 sum(0.0f);
+		for (uint32_t i = 0; i < triangleCount; i++) {
+			const glm::vec3& a = positions[vertices[triangles[i * 3]]];
+			const glm::vec3& b = positions[vertices[triangles[i * 3 + 1]]];
+			const glm::vec3& c = positions[vertices[triangles[i * 3 + 2]]];
+			const glm::vec3 face = glm::cross(b - a, c - a);
+			const float length = glm::length(face);
+			if (length > 0.0f) {
+				normals.push_back(face / length);
+				sum += face;
+			}
+		}
+
+		const float sumLength = glm::length(sum);
+		const glm::vec3 axis = sumLength > 0.0f ? sum / sumLength : glm::vec3(0.0f, 0.0f, 1.0f);
+		float minDot = normals.empty() ? -1.0f : 1.0f;
+		for (const glm::vec3& normal : normals) {
+			minDot = std::min(minDot, glm::dot(axis, normal));
+		}
+
+		cone[0] = axis.x;
+		cone[1] = axis.y;
+		cone[2] = axis.z;
+		// Normals 90 degrees or more off the axis leave no direction that all of them face away from
+		cone[3] = minDot <= 0.0f ? 2.0f : std::sqrt(std::max(0.0f, 1.0f - minDot * minDot));
+	}
+
+	float srgbToLinear(float value) {
+		return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float linearToSrgb(float value) {
+		return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+	}
+}
+
+SourceTexture buildMipChain(uint32_t width, uint32_t height, std::vector<char> pixels, bool srgb) {
+	if (width == 0 || height == 0 || pixels.size() != size_t(width) * height * 4) {
+		throw std::runtime_error("RGBA8 image data doesn't match its size!");
+	}
+
+	float toLinear[256];
+	for (int i = 0; i < 256; i++) {
+		toLinear[i] = srgb ? srgbToLinear(i / 255.0f) : i / 255.0f;
+	}
+
+	SourceTexture texture;
+	texture.format = srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+	texture.width = width;
+	texture.height = height;
+	texture.mips.push_back(std::move(pixels));
+
+	uint32_t levelWidth = width;
+	uint32_t levelHeight = height;
+	while (levelWidth > 1 || levelHeight > 1) {
+		const std::vector<char>& source = texture.mips.back();
+		const uint32_t nextWidth = std::max(levelWidth / 2, 1u);
+		const uint32_t nextHeight = std::max(levelHeight / 2, 1u);
+		std::vector<char> next(size_t(nextWidth) * nextHeight * 4);
+
+		for (uint32_t y = 0; y < nextHeight; y++) {
+			for (uint32_t x = 0; x < nextWidth; x++) {
+				// 2x2 box, clamped so odd sizes and 1 pixel wide levels still work
+				const uint32_t x0 = std::min(x * 2, levelWidth - 1);
+				const uint32_t x1 = std::min(x * 2 + 1, levelWidth - 1);
+				const uint32_t y0 = std::min(y * 2, levelHeight - 1);
+				const uint32_t y1 = std::min(y * 2 + 1, levelHeight - 1);
+				const uint8_t* texels[4] = {
+					reinterpret_cast<const uint8_t*>(&source[(size_t(y0) * levelWidth + x0) * 4]),
+					reinterpret_cast<const uint8_t*>(&source[(size_t(y0) * levelWidth + x1) * 4]),
+					reinterpret_cast<const uint8_t*>(&source[(size_t(y1) * levelWidth + x0) * 4]),
+					reinterpret_cast<const uint8_t*>(&source[(size_t(y1) * levelWidth + x1) * 4]),
+				};
+
+				uint8_t* out = reinterpret_cast<uint8_t*>(&next[(size_t(y) * nextWidth + x) * 4]);
+				for (int channel = 0; channel < 4; channel++) {
+					float sum = 0.0f;
+					for (const uint8_t* texel : texels) {
+						sum += channel == 3 ? texel[channel] / 255.0f : toLinear[texel[channel]]; // Alpha is always linear
+					}
+					float value = sum * 0.25f;
+					if (srgb && channel != 3) {
+						value = linearToSrgb(value);
+					}
+					out[channel] = static_cast<uint8_t>(std::lround(std::min(std::max(value, 0.0f), 1.0f) * 255.0f));
+				}
+			}
+		}
+
+		texture.mips.push_back(std::move(next));
+		levelWidth = nextWidth;
+		levelHeight = nextHeight;
+	}
+
+	return texture;
+}
+
+uint32_t AssetWriter::addMesh(const SourceMesh& mesh) {
+	const size_t vertexCount = mesh.positions.size();
+	if (mesh.indices.size() % 3 != 0) {
+		throw std::runtime_error("Mesh index count is not a multiple of three!");
+	}
+	if ((!mesh.normals.empty() && mesh.normals.size() != vertexCount) || (!mesh.uvs.empty() && mesh.uvs.size() != vertexCount)) {
+		throw std::runtime_error("Mesh attribute streams have different lengths!");
+	}
+	for (uint32_t index : mesh.indices) {
+		if (index >= vertexCount) {
+			throw std::runtime_error("Mesh index out of range!");
+		}
+	}
+
+	std::vector<glm::vec3> normals = mesh.normals;
+	if (normals.empty()) {
+		// Area weighted face normals summed per vertex
+		normals.assign(vertexCount, glm::vec3(0.0f));
+		for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+			const glm::vec3& a = mesh.positions[mesh.indices[i]];
+			const glm::vec3& b = mesh.positions[mesh.indices[i + 1]];
+			const glm::vec3& c = mesh.positions[mesh.indices[i + 2]];
+			const glm::vec3 face = glm::cross(b - a, c - a);
+			for (size_t corner = 0; corner < 3; corner++) {
+				normals[mesh.indices[i + corner]] += face;
+			}
+		}
+	}
+
+	std::vector<AssetVertex> vertices(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++) {
+		AssetVertex& vertex = vertices[i];
+		vertex.position[0] = mesh.positions[i].x;
+		vertex.position[1] = mesh.positions[i].y;
+		vertex.position[2] = mesh.positions[i].z;
+
+		const float length = glm::length(normals[i]);
+		vertex.normal = packNormal(length > 0.0f ? normals[i] / length : glm::vec3(0.0f, 0.0f, 1.0f));
+
+		const glm::vec2 uv = mesh.uvs.empty() ? glm::vec2(0.0f) : mesh.uvs[i];
+		vertex.uv[0] = toHalf(uv.x);
+		vertex.uv[1] = toHalf(uv.y);
+	}
+
+	// Greedy meshlets in index order: keep adding triangles until either limit would be crossed. Cooked meshes are
+	// expected to be vertex cache optimised already, which keeps neighbouring triangles in the same meshlet.
+	std::vector<AssetMeshlet> meshlets;
+	std::vector<uint32_t> meshletVertices;
+	std::vector<uint8_t> meshletTriangles;
+	std::vector<uint32_t> localIndex(vertexCount, UINT32_MAX);
+
+	AssetMeshlet current{};
+	auto closeMeshlet = [&]() {
+		if (current.triangleCount == 0) {
+			return;
+		}
+		computeBounds(mesh.positions, meshletVertices.data() + current.vertexOffset, current.vertexCount, current.bounds);
+		computeNormalCone(mesh.positions, meshletVertices.data() + current.vertexOffset, meshletTriangles.data() + size_t(current.triangleOffset) * 3,
+			current.triangleCount, current.cone);
+		for (uint32_t i = 0; i < current.vertexCount; i++) {
+			localIndex[meshletVertices[current.vertexOffset + i]] = UINT32_MAX;
+		}
+		meshlets.push_back(current);
+
+		current = AssetMeshlet{};
+		current.vertexOffset = static_cast<uint32_t>(meshletVertices.size());
+		current.triangleOffset = static_cast<uint32_t>(meshletTriangles.size() / 3);
+	};
+
+	for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+		uint32_t newVertices = 0;
+		for (size_t corner = 0; corner < 3; corner++) {
+			if (localIndex[mesh.indices[i + corner]] == UINT32_MAX) {
+				newVertices++;
+			}
+		}
+		if (current.vertexCount + newVertices > MESHLET_MAX_VERTICES || current.triangleCount + 1 > MESHLET_MAX_TRIANGLES) {
+			closeMeshlet();
+		}
+
+		for (size_t corner = 0; corner < 3; corner++) {
+			const uint32_t vertex = mesh.indices[i + corner];
+			if (localIndex[vertex] == UINT32_MAX) {
+				localIndex[vertex] = current.vertexCount++;
+				meshletVertices.push_back(vertex);
+			}
+			meshletTriangles.push_back(static_cast<uint8_t>(localIndex[vertex]));
+		}
+		current.triangleCount++;
+	}
+	closeMeshlet();
+
+	AssetMeshEntry entry{};
+	entry.vertexCount = static_cast<uint32_t>(vertexCount);
+	entry.indexCount = static_cast<uint32_t>(mesh.indices.size());
+	entry.meshletCount = static_cast<uint32_t>(meshlets.size());
+	computeBounds(mesh.positions, mesh.indices.data(), mesh.indices.size(), entry.bounds);
+
+	entry.vertexSection = addSection(toBytes(vertices));
+	entry.indexSection = addSection(toBytes(mesh.indices));
+	entry.meshletSection = addSection(toBytes(meshlets));
+	entry.meshletVertexSection = addSection(toBytes(meshletVertices));
+	entry.meshletTriangleSection = addSection(toBytes(meshletTriangles));
+
+	meshes.push_back(entry);
+	return static_cast<uint32_t>(meshes.size() - 1);
+}
+
+uint32_t AssetWriter::addTexture(SourceTexture texture) {
+	TexelBlock block;
+	if (!getTexelBlock(texture.format, block)) {
+		throw std::runtime_error("Texture format is not supported by the asset format!");
+	}
+	if (texture.width == 0 || texture.height == 0 || texture.mips.empty()) {
+		throw std::runtime_error("Texture has no image data!");
+	}
+
+	for (uint32_t level = 0; level < texture.mips.size(); level++) {
+		if (level >= 32 || std::max(texture.width >> level, texture.height >> level) == 0) {
+			throw std::runtime_error("Texture has more mips than its size allows!");
+		}
+		if (texture.mips[level].size() != getMipSize(block, texture.width, texture.height, level)) {
+			throw std::runtime_error("Texture mip " + std::to_string(level) + " has the wrong size for its format!");
+		}
+	}
+
+	AssetTextureEntry entry{};
+	entry.format = static_cast<uint32_t>(texture.format);
+	entry.width = texture.width;
+	entry.height = texture.height;
+	entry.mipCount = static_cast<uint32_t>(texture.mips.size());
+	entry.firstSection = static_cast<uint32_t>(sections.size());
+
+	for (auto& mip : texture.mips) {
+		addSection(std::move(mip));
+	}
+
+	textures.push_back(entry);
+	return static_cast<uint32_t>(textures.size() - 1);
+}
+
+uint64_t AssetWriter::write(const std::string& path) const {
+	AssetFileHeader header{};
+	header.magic = ASSET_FILE_MAGIC;
+	header.version = ASSET_FILE_VERSION;
+	header.meshCount = static_cast<uint32_t>(meshes.size());
+	header.textureCount = static_cast<uint32_t>(textures.size());
+	header.sectionCount = static_cast<uint32_t>(sections.size());
+	header.sectionAlignment = ASSET_SECTION_ALIGNMENT;
+
+	std::vector<AssetSection> table(sections.size());
+	uint64_t offset = getAssetTablesSize(header.meshCount, header.textureCount, header.sectionCount);
+	for (size_t i = 0; i < sections.size(); i++) {
+		offset = alignUp(offset, ASSET_SECTION_ALIGNMENT);
+		table[i].offset = offset;
+		table[i].size = sections[i].size();
+		offset += sections[i].size();
+	}
+	header.fileSize = offset;
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file) {
+		throw std::runtime_error("Failed to open " + path + " for writing!");
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(meshes.data()), meshes.size() * sizeof(AssetMeshEntry));
+	file.write(reinterpret_cast<const char*>(textures.data()), textures.size() * sizeof(AssetTextureEntry));
+	file.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(AssetSection));
+
+	const char padding[ASSET_SECTION_ALIGNMENT] = {};
+	uint64_t written = getAssetTablesSize(header.meshCount, header.textureCount, header.sectionCount);
+	for (size_t i = 0; i < sections.size(); i++) {
+		file.write(padding, static_cast<std::streamsize>(table[i].offset - written));
+		file.write(sections[i].data(), static_cast<std::streamsize>(sections[i].size()));
+		written = table[i].offset + table[i].size;
+	}
+
+	if (!file) {
+		throw std::runtime_error("Failed to write " + path + "!");
+	}
+	return header.fileSize;
+}
+
+void AssetWriter::clear() {
+	meshes.clear();
+	textures.clear();
+	sections.clear();
+}
+
+uint32_t AssetWriter::addSection(std::vector<char> data) {
+	sections.push_back(std::move(data));
+	return static_cast<uint32_t>(sections.size() - 1);
+}
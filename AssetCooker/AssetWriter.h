@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include "AssetFormat.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// A mesh as it comes out of a source file. normals may be empty, in which case smooth normals are generated; uvs may be
+/// empty, in which case they are all zero. Otherwise all three have one entry per vertex.
+/// </summary>
+struct SourceMesh {
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> uvs; // Top left origin, as Vulkan samples them
+	std::vector<uint32_t> indices;
+};
+
+/// <summary>
+/// A texture with its whole mip chain already in its final format, largest level first.
+/// </summary>
+struct SourceTexture {
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<std::vector<char>> mips;
+};
+
+/// <summary>
+/// Build the full mip chain of an RGBA8 image with a box filter. sRGB images are filtered in linear space.
+/// </summary>
+SourceTexture buildMipChain(uint32_t width, uint32_t height, std::vector<char> pixels, bool srgb);
+
+/// <summary>
+/// Collects meshes and textures, converts them to the layouts in AssetFormat.h and writes them out as one asset file.
+/// </summary>
+class AssetWriter {
+public:
+	/// <summary>
+	/// Pack the vertices, split the mesh into meshlets and compute its bounds. Returns the mesh's index in the file.
+	/// </summary>
+	uint32_t addMesh(const SourceMesh& mesh);
+
+	uint32_t getMeshletCount(uint32_t mesh) const {
+		return meshes.at(mesh).meshletCount;
+	}
+
+	/// <summary>
+	/// Throws if the format isn't one the runtime can load or a mip has the wrong size. Returns the texture's index.
+	/// </summary>
+	uint32_t addTexture(SourceTexture texture);
+
+	/// <summary>
+	/// Returns the size of the file written.
+	/// </summary>
+	uint64_t write(const std::string& path) const;
+
+	void clear();
+
+private:
+	uint32_t addSection(std::vector<char> data);
+
+	std::vector<AssetMeshEntry> meshes;
+	std::vector<AssetTextureEntry> textures;
+	std::vector<std::vector<char>> sections;
+};
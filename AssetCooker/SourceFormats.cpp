@@ -0,0 +1,290 @@
+#include "SourceFormats.h"
+
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+	std::vector<char> readFile(const std::string& path) {
+		std::ifstream file(path, std::ios::binary);
+		if (!file) {
+			throw std::runtime_error("Failed to open " + path + "!");
+		}
+		return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	struct ObjCorner {
+		int position;
+		int uv;
+		int normal;
+
+		bool operator==(const ObjCorner& other) const {
+			return position == other.position && uv == other.uv && normal == other.normal;
+		}
+	};
+
+	struct ObjCornerHash {
+		size_t operator()(const ObjCorner& corner) const {
+			size_t hash = std::hash<int>()(corner.position);
+			hash = hash * 31 + std::hash<int>()(corner.uv);
+			return hash * 31 + std::hash<int>()(corner.normal);
+		}
+	};
+
+	/// <summary>
+	/// OBJ indices are 1 based and negative ones count back from the last element read so far. Returns -1 for absent.
+	/// </summary>
+	int resolveObjIndex(const std::string& text, size_t count, const std::string& path) {
+		if (text.empty()) {
+			return -1;
+		}
+
+		const long index = std::stol(text);
+		const long resolved = index < 0 ? static_cast<long>(count) + index : index - 1;
+		if (index == 0 || resolved < 0 || resolved >= static_cast<long>(count)) {
+			throw std::runtime_error(path + " has a face index out of range!");
+		}
+		return static_cast<int>(resolved);
+	}
+
+	uint32_t readLittleEndian(const std::vector<char>& data, size_t offset, size_t bytes) {
+		uint32_t value = 0;
+		for (size_t i = 0; i < bytes; i++) {
+			value |= static_cast<uint32_t>(static_cast<uint8_t>(data[offset + i])) << (8 * i);
+		}
+		return value;
+	}
+
+	/// <summary>
+	/// glInternalFormat values of the block compressed formats we accept from KTX files.
+	/// </summary>
+	VkFormat formatFromGl(uint32_t glInternalFormat) {
+		switch (glInternalFormat) {
+		case 0x83F0: return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+		case 0x83F1: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+		case 0x8C4C: return VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+		case 0x8C4D: return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+		case 0x83F3: return VK_FORMAT_BC3_UNORM_BLOCK;
+		case 0x8C4F: return VK_FORMAT_BC3_SRGB_BLOCK;
+		case 0x8DBD: return VK_FORMAT_BC5_UNORM_BLOCK;
+		case 0x8E8C: return VK_FORMAT_BC7_UNORM_BLOCK;
+		case 0x8E8D: return VK_FORMAT_BC7_SRGB_BLOCK;
+		case 0x93B0: return VK_FORMAT_ASTC_4x4_UNORM_BLOCK;
+		case 0x93D0: return VK_FORMAT_ASTC_4x4_SRGB_BLOCK;
+		case 0x93B4: return VK_FORMAT_ASTC_6x6_UNORM_BLOCK;
+		case 0x93D4: return VK_FORMAT_ASTC_6x6_SRGB_BLOCK;
+		case 0x93B7: return VK_FORMAT_ASTC_8x8_UNORM_BLOCK;
+		case 0x93D7: return VK_FORMAT_ASTC_8x8_SRGB_BLOCK;
+		default: return VK_FORMAT_UNDEFINED;
+		}
+	}
+}
+
+SourceMesh loadObj(const std::string& path) {
+	std::ifstream file(path);
+	if (!file) {
+		throw std::runtime_error("Failed to open " + path + "!");
+	}
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec2> uvs;
+	std::vector<glm::vec3> normals;
+	bool anyMissingNormal = false;
+
+	SourceMesh mesh;
+	std::vector<ObjCorner> corners;
+	std::unordered_map<ObjCorner, uint32_t, ObjCornerHash> vertexIndices;
+
+	std::string line;
+	while (std::getline(file, line)) {
+		std::istringstream stream(line);
+		std::string keyword;
+		stream >> keyword;
+
+		if (keyword == "v") {
+			glm::vec3 position;
+			stream >> position.x >> position.y >> position.z;
+			positions.push_back(position);
+		} else if (keyword == "vt") {
+			glm::vec2 uv;
+			stream >> uv.x >> uv.y;
+			uvs.push_back(glm::vec2(uv.x, 1.0f - uv.y)); // OBJ puts the origin bottom left
+		} else if (keyword == "vn") {
+			glm::vec3 normal;
+			stream >> normal.x >> normal.y >> normal.z;
+			normals.push_back(normal);
+		} else if (keyword == "f") {
+			corners.clear();
+			std::string token;
+			while (stream >> token) {
+				// v, v/vt, v//vn or v/vt/vn
+				const size_t firstSlash = token.find('/');
+				const size_t secondSlash = firstSlash == std::string::npos ? std::string::npos : token.find('/', firstSlash + 1);
+
+				ObjCorner corner;
+				corner.position = resolveObjIndex(token.substr(0, firstSlash), positions.size(), path);
+				corner.uv = firstSlash == std::string::npos ? -1 :
+					resolveObjIndex(token.substr(firstSlash + 1, secondSlash - firstSlash - 1), uvs.size(), path);
+				corner.normal = secondSlash == std::string::npos ? -1 : resolveObjIndex(token.substr(secondSlash + 1), normals.size(), path);
+				if (corner.position < 0) {
+					throw std::runtime_error(path + " has a face corner without a position!");
+				}
+				corners.push_back(corner);
+			}
+
+			for (size_t i = 2; i < corners.size(); i++) {
+				for (const ObjCorner& corner : { corners[0], corners[i - 1], corners[i] }) {
+					auto found = vertexIndices.find(corner);
+					if (found == vertexIndices.end()) {
+						found = vertexIndices.emplace(corner, static_cast<uint32_t>(mesh.positions.size())).first;
+						mesh.positions.push_back(positions[corner.position]);
+						mesh.uvs.push_back(corner.uv >= 0 ? uvs[corner.uv] : glm::vec2(0.0f));
+						mesh.normals.push_back(corner.normal >= 0 ? normals[corner.normal] : glm::vec3(0.0f));
+						anyMissingNormal |= corner.normal < 0;
+					}
+					mesh.indices.push_back(found->second);
+				}
+			}
+		}
+	}
+
+	if (mesh.indices.empty()) {
+		throw std::runtime_error(path + " has no faces!");
+	}
+	if (anyMissingNormal) {
+		mesh.normals.clear(); // Have them all generated rather than mixing authored and made up ones
+	}
+	if (uvs.empty()) {
+		mesh.uvs.clear();
+	}
+	return mesh;
+}
+
+SourceTexture loadTga(const std::string& path, bool srgb) {
+	const std::vector<char> data = readFile(path);
+	if (data.size() < 18) {
+		throw std::runtime_error(path + " is too small to be a TGA file!");
+	}
+
+	const uint32_t idLength = readLittleEndian(data, 0, 1);
+	const uint32_t colorMapType = readLittleEndian(data, 1, 1);
+	const uint32_t imageType = readLittleEndian(data, 2, 1);
+	const uint32_t colorMapLength = readLittleEndian(data, 5, 2);
+	const uint32_t colorMapEntryBits = readLittleEndian(data, 7, 1);
+	const uint32_t width = readLittleEndian(data, 12, 2);
+	const uint32_t height = readLittleEndian(data, 14, 2);
+	const uint32_t bitsPerPixel = readLittleEndian(data, 16, 1);
+	const uint32_t descriptor = readLittleEndian(data, 17, 1);
+
+	if ((imageType != 2 && imageType != 10) || (bitsPerPixel != 24 && bitsPerPixel != 32)) {
+		throw std::runtime_error(path + " is not a 24 or 32 bit true colour TGA!");
+	}
+	if (width == 0 || height == 0) {
+		throw std::runtime_error(path + " is empty!");
+	}
+
+	const size_t bytesPerPixel = bitsPerPixel / 8;
+	size_t offset = 18 + idLength + (colorMapType == 1 ? colorMapLength * ((colorMapEntryBits + 7) / 8) : 0);
+	const bool topDown = (descriptor & 0x20) != 0;
+
+	std::vector<char> pixels(size_t(width) * height * 4);
+	auto writePixel = [&](size_t index, size_t source) {
+		const size_t x = index % width;
+		const size_t y = topDown ? index / width : height - 1 - index / width;
+		char* out = &pixels[(y * width + x) * 4];
+		out[0] = data[source + 2]; // Stored as BGR(A)
+		out[1] = data[source + 1];
+		out[2] = data[source];
+		out[3] = bytesPerPixel == 4 ? data[source + 3] : static_cast<char>(0xFF);
+	};
+
+	const size_t pixelCount = size_t(width) * height;
+	for (size_t index = 0; index < pixelCount;) {
+		size_t run = 1;
+		bool repeat = false;
+		if (imageType == 10) {
+			if (offset >= data.size()) {
+				throw std::runtime_error(path + " is truncated!");
+			}
+			const uint8_t packet = static_cast<uint8_t>(data[offset++]);
+			run = (packet & 0x7F) + 1u;
+			repeat = (packet & 0x80) != 0;
+		}
+
+		const size_t needed = repeat ? bytesPerPixel : run * bytesPerPixel;
+		if (offset + needed > data.size() || index + run > pixelCount) {
+			throw std::runtime_error(path + " is truncated!");
+		}
+
+		for (size_t i = 0; i < run; i++) {
+			writePixel(index + i, repeat ? offset : offset + i * bytesPerPixel);
+		}
+		index += run;
+		offset += needed;
+	}
+
+	return buildMipChain(width, height, std::move(pixels), srgb);
+}
+
+SourceTexture loadKtx(const std::string& path) {
+	static const unsigned char identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+	const std::vector<char> data = readFile(path);
+	const size_t headerSize = sizeof(identifier) + 13 * sizeof(uint32_t);
+	if (data.size() < headerSize || std::memcmp(data.data(), identifier, sizeof(identifier)) != 0) {
+		throw std::runtime_error(path + " is not a KTX 1.1 file!");
+	}
+
+	auto field = [&](size_t index) {
+		return readLittleEndian(data, sizeof(identifier) + index * sizeof(uint32_t), sizeof(uint32_t));
+	};
+
+	if (field(0) != 0x04030201) {
+		throw std::runtime_error(path + " is a big endian KTX file!");
+	}
+
+	const uint32_t glInternalFormat = field(4);
+	const uint32_t width = field(6);
+	const uint32_t height = field(7);
+	const uint32_t depth = field(8);
+	const uint32_t arrayElements = field(9);
+	const uint32_t faces = field(10);
+	const uint32_t mipCount = field(11);
+	const uint32_t keyValueBytes = field(12);
+
+	SourceTexture texture;
+	texture.format = formatFromGl(glInternalFormat);
+	texture.width = width;
+	texture.height = height;
+
+	if (texture.format == VK_FORMAT_UNDEFINED) {
+		throw std::runtime_error(path + " is not in a BC1/3/5/7 or ASTC format!");
+	}
+	if (width == 0 || height == 0 || depth > 1 || arrayElements > 1 || faces != 1) {
+		throw std::runtime_error(path + " is not a plain 2D texture!");
+	}
+	if (mipCount == 0) {
+		throw std::runtime_error(path + " asks for mips to be generated at load time; cook it with its mip chain!");
+	}
+
+	size_t offset = headerSize + keyValueBytes;
+	for (uint32_t level = 0; level < mipCount; level++) {
+		if (offset + sizeof(uint32_t) > data.size()) {
+			throw std::runtime_error(path + " is truncated!");
+		}
+		const uint32_t imageSize = readLittleEndian(data, offset, sizeof(uint32_t));
+		offset += sizeof(uint32_t);
+		if (offset + imageSize > data.size()) {
+			throw std::runtime_error(path + " is truncated!");
+		}
+
+		texture.mips.emplace_back(data.begin() + offset, data.begin() + offset + imageSize);
+		offset += (imageSize + 3) / 4 * 4; // Levels are padded to four bytes
+	}
+
+	return texture; // AssetWriter::addTexture checks every level's size against the format
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "AssetWriter.h"
+
+#include <string>
+
+/// <summary>
+/// Wavefront OBJ: v, vt, vn and f records, polygons fanned into triangles, negative indices allowed. Each distinct
+/// position/uv/normal combination becomes one vertex. Everything else in the file is ignored.
+/// </summary>
+SourceMesh loadObj(const std::string& path);
+
+/// <summary>
+/// Uncompressed or RLE true colour TGA, 24 or 32 bits per pixel, expanded to RGBA8 with a generated mip chain.
+/// </summary>
+SourceTexture loadTga(const std::string& path, bool srgb);
+
+/// <summary>
+/// KTX 1.1 holding a 2D texture that has already been block compressed (BC1/3/5/7 or ASTC) by an external encoder.
+/// The mip levels are taken as stored, so the file has to carry its full mip chain.
+/// </summary>
+SourceTexture loadKtx(const std::string& path);
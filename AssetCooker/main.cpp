@@ -0,0 +1,72 @@
+#include "AssetWriter.h"
+#include "SourceFormats.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+	std::string extensionOf(const std::string& path) {
+		const size_t dot = path.find_last_of('.');
+		std::string extension = dot == std::string::npos ? "" : path.substr(dot + 1);
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return extension;
+	}
+}
+
+/// <summary>
+/// Offline cooker for the engine's asset format. Usage: AssetCooker [--linear] OUTPUT.vea INPUT...
+/// Inputs are .obj meshes, .tga images (mipmapped as RGBA8, sRGB unless --linear) and .ktx textures that were block
+/// compressed by an external BC7/ASTC encoder. Meshes and textures get indices in the order they are listed.
+/// </summary>
+int main(int argc, char** argv) {
+	try {
+		bool srgb = true;
+		std::string output;
+		AssetWriter writer;
+
+		for (int i = 1; i < argc; i++) {
+			const std::string arg = argv[i];
+			if (arg == "--linear") {
+				srgb = false;
+				continue;
+			}
+			if (output.empty()) {
+				output = arg;
+				continue;
+			}
+
+			const std::string extension = extensionOf(arg);
+			if (extension == "obj") {
+				const SourceMesh mesh = loadObj(arg);
+				const uint32_t index = writer.addMesh(mesh);
+				std::cout << "Mesh " << index << ": " << arg << ", " << mesh.positions.size() << " vertices, " << mesh.indices.size() / 3 << " triangles, "
+					<< writer.getMeshletCount(index) << " meshlets\n";
+			} else if (extension == "tga" || extension == "ktx") {
+				SourceTexture texture = extension == "tga" ? loadTga(arg, srgb) : loadKtx(arg);
+				const uint32_t width = texture.width;
+				const uint32_t height = texture.height;
+				const size_t mipCount = texture.mips.size();
+				const uint32_t index = writer.addTexture(std::move(texture));
+				std::cout << "Texture " << index << ": " << arg << ", " << width << "x" << height << ", " << mipCount << " mips\n";
+			} else {
+				throw std::runtime_error("Don't know how to cook " + arg + " (expected .obj, .tga or .ktx)");
+			}
+		}
+
+		if (output.empty()) {
+			throw std::runtime_error("Usage: AssetCooker [--linear] OUTPUT.vea INPUT...");
+		}
+
+		const uint64_t size = writer.write(output);
+		std::cout << "Wrote " << output << " (" << size << " bytes)\n";
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
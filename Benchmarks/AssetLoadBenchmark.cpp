@@ -0,0 +1,178 @@
+#include "Benchmarks.h"
+
+#include "AssetFile.h"
+#include "AssetWriter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+	const uint32_t GRID_SIZE = 512; // Quads per side of the test mesh
+	const uint32_t TEXTURE_SIZE = 2048;
+	const uint32_t COMPRESSED_TEXTURE_SIZE = 4096;
+	const int REPEATS = 5;
+
+	using Clock = std::chrono::steady_clock;
+
+	double millisecondsSince(Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	template <typename Function>
+	double bestOf(Function&& function) {
+		double best = 0.0;
+		for (int i = 0; i < REPEATS; i++) {
+			const double elapsed = function();
+			best = (i == 0) ? elapsed : std::min(best, elapsed);
+		}
+		return best;
+	}
+
+	SourceMesh makeGrid() {
+		SourceMesh mesh;
+		for (uint32_t y = 0; y <= GRID_SIZE; y++) {
+			for (uint32_t x = 0; x <= GRID_SIZE; x++) {
+				const float u = float(x) / GRID_SIZE;
+				const float v = float(y) / GRID_SIZE;
+				mesh.positions.push_back(glm::vec3(u, v, 0.1f * std::sin(u * 20.0f) * std::cos(v * 20.0f)));
+				mesh.uvs.push_back(glm::vec2(u, v));
+			}
+		}
+
+		const uint32_t row = GRID_SIZE + 1;
+		for (uint32_t y = 0; y < GRID_SIZE; y++) {
+			for (uint32_t x = 0; x < GRID_SIZE; x++) {
+				const uint32_t corner = y * row + x;
+				for (uint32_t index : { corner, corner + 1, corner + row, corner + 1, corner + row + 1, corner + row }) {
+					mesh.indices.push_back(index);
+				}
+			}
+		}
+		return mesh;
+	}
+
+	/// <summary>
+	/// A mesh, an RGBA8 texture and a BC7 sized one filled with noise: the loader never looks inside blocks, only sizes.
+	/// </summary>
+	uint64_t cookTestAsset(const std::string& path) {
+		std::mt19937 random(1234);
+		AssetWriter writer;
+		writer.addMesh(makeGrid());
+
+		std::vector<char> pixels(size_t(TEXTURE_SIZE) * TEXTURE_SIZE * 4);
+		for (auto& pixel : pixels) {
+			pixel = static_cast<char>(random());
+		}
+		writer.addTexture(buildMipChain(TEXTURE_SIZE, TEXTURE_SIZE, std::move(pixels), false));
+
+		SourceTexture compressed;
+		compressed.format = VK_FORMAT_BC7_UNORM_BLOCK;
+		compressed.width = COMPRESSED_TEXTURE_SIZE;
+		compressed.height = COMPRESSED_TEXTURE_SIZE;
+		TexelBlock block;
+		getTexelBlock(compressed.format, block);
+		for (uint32_t level = 0; (COMPRESSED_TEXTURE_SIZE >> level) != 0; level++) {
+			compressed.mips.emplace_back(getMipSize(block, COMPRESSED_TEXTURE_SIZE, COMPRESSED_TEXTURE_SIZE, level));
+			for (auto& byte : compressed.mips.back()) {
+				byte = static_cast<char>(random());
+			}
+		}
+		writer.addTexture(std::move(compressed));
+
+		return writer.write(path);
+	}
+
+	/// <summary>
+	/// What a loader without the mapping does: stream the tables in, then read every section into a vector of its own
+	/// before copying it into the staging memory. Counts the heap allocations that takes in allocations.
+	/// </summary>
+	double loadWithStream(const std::string& path, std::vector<char>& staging, uint32_t& allocations) {
+		const auto start = Clock::now();
+		allocations = 0;
+
+		std::ifstream file(path, std::ios::binary);
+		if (!file) {
+			throw std::runtime_error("Failed to open " + path + "!");
+		}
+
+		AssetFileHeader header;
+		file.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (header.magic != ASSET_FILE_MAGIC || header.version != ASSET_FILE_VERSION) {
+			throw std::runtime_error(path + " is not an asset file!");
+		}
+
+		std::vector<AssetMeshEntry> meshes(header.meshCount);
+		std::vector<AssetTextureEntry> textures(header.textureCount);
+		std::vector<AssetSection> sections(header.sectionCount);
+		file.read(reinterpret_cast<char*>(meshes.data()), meshes.size() * sizeof(AssetMeshEntry));
+		file.read(reinterpret_cast<char*>(textures.data()), textures.size() * sizeof(AssetTextureEntry));
+		file.read(reinterpret_cast<char*>(sections.data()), sections.size() * sizeof(AssetSection));
+		allocations += 3;
+
+		for (const AssetSection& section : sections) {
+			std::vector<char> data(section.size);
+			file.seekg(static_cast<std::streamoff>(section.offset));
+			file.read(data.data(), static_cast<std::streamsize>(section.size));
+			std::memcpy(staging.data() + section.offset, data.data(), data.size());
+			allocations++;
+		}
+
+		if (!file) {
+			throw std::runtime_error("Failed to read " + path + "!");
+		}
+		return millisecondsSince(start);
+	}
+
+	/// <summary>
+	/// The runtime path: map, validate the tables, copy each section once from the mapping into the staging memory.
+	/// </summary>
+	double loadMapped(const std::string& path, std::vector<char>& staging) {
+		const auto start = Clock::now();
+
+		AssetFile asset;
+		asset.open(path);
+		asset.prefetch();
+
+		for (uint32_t i = 0; i < asset.getSectionCount(); i++) {
+			const AssetSection& section = asset.getSection(i);
+			std::memcpy(staging.data() + section.offset, asset.getSectionData(i), section.size);
+		}
+
+		return millisecondsSince(start);
+	}
+}
+
+void runAssetLoadBenchmark(std::ostream& out) {
+	const std::string path = (std::filesystem::temp_directory_path() / "asset_load_benchmark.vea").string();
+	const uint64_t fileSize = cookTestAsset(path);
+	const double megabytes = fileSize / (1024.0 * 1024.0);
+
+	const auto flags = out.flags();
+	out << std::fixed << std::setprecision(2);
+	out << "Asset loading, " << megabytes << " MiB file, best of " << REPEATS << " (page cache warm for both)\n";
+
+	// Stands in for the staging ring; allocated once so neither path pays for it
+	std::vector<char> staging(fileSize);
+
+	uint32_t allocations = 0;
+	const double streamed = bestOf([&] { return loadWithStream(path, staging, allocations); });
+	const double mapped = bestOf([&] { return loadMapped(path, staging); });
+
+	out << "  ifstream + per-section vectors: " << std::setw(8) << streamed << " ms, " << std::setw(8) << megabytes / (streamed / 1000.0)
+		<< " MiB/s, " << allocations << " heap allocations\n";
+	out << "  memory mapped:                  " << std::setw(8) << mapped << " ms, " << std::setw(8) << megabytes / (mapped / 1000.0)
+		<< " MiB/s, 0 heap allocations\n";
+	out << "  speedup: " << streamed / mapped << "x\n";
+	out.flags(flags);
+
+	std::error_code error;
+	std::filesystem::remove(path, error);
+}
@@ -0,0 +1,119 @@
+#include "Benchmarks.h"
+
+#include "DrawBatcher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+	const uint32_t DRAW_COUNTS[] = { 1000, 10000, 100000, 1000000 };
+	const uint32_t PIPELINE_COUNT = 4;
+	const uint32_t MATERIAL_COUNT = 256;
+	const uint32_t MESH_COUNT = 16;
+	const int REPEATS = 5;
+
+	using Clock = std::chrono::steady_clock;
+
+	double millisecondsSince(Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	template <typename Function>
+	double bestOf(Function&& function) {
+		double best = 0.0;
+		for (int i = 0; i < REPEATS; i++) {
+			const double elapsed = function();
+			best = (i == 0) ? elapsed : std::min(best, elapsed);
+		}
+		return best;
+	}
+
+	/// <summary>
+	/// Draws in submission order with their state picked at random, the worst case for anything that hopes to find runs
+	/// already in place.
+	/// </summary>
+	std::vector<uint64_t> makeKeys(uint32_t drawCount) {
+		std::mt19937 random(drawCount);
+		std::uniform_int_distribution<uint32_t> pipeline(0, PIPELINE_COUNT - 1);
+		std::uniform_int_distribution<uint32_t> material(0, MATERIAL_COUNT - 1);
+		std::uniform_int_distribution<uint32_t> mesh(0, MESH_COUNT - 1);
+		std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+
+		std::vector<uint64_t> keys(drawCount);
+		for (uint64_t& key : keys) {
+			key = DrawBatcher::makeKey(pipeline(random), material(random), mesh(random), depth(random));
+		}
+		return keys;
+	}
+}
+
+void runBatchingBenchmark(std::ostream& out) {
+	out << "Draw batching: " << PIPELINE_COUNT << " pipelines, " << MATERIAL_COUNT << " materials and " << MESH_COUNT
+		<< " meshes picked at random per draw\n";
+	out << std::setw(10) << "draws"
+		<< std::setw(10) << "batches"
+		<< std::setw(10) << "states"
+		<< std::setw(12) << "radix ms"
+		<< std::setw(12) << "sort ms"
+		<< std::setw(12) << "build ms" << "\n";
+
+	for (uint32_t drawCount : DRAW_COUNTS) {
+		const std::vector<uint64_t> keys = makeKeys(drawCount);
+
+		std::vector<uint64_t> radixKeys;
+		std::vector<uint32_t> radixValues;
+		std::vector<uint64_t> keyScratch;
+		std::vector<uint32_t> valueScratch;
+		const double radix = bestOf([&] {
+			radixKeys = keys;
+			radixValues.resize(drawCount);
+			std::iota(radixValues.begin(), radixValues.end(), 0u);
+			const auto start = Clock::now();
+			DrawBatcher::radixSort(radixKeys, radixValues, keyScratch, valueScratch);
+			return millisecondsSince(start);
+		});
+
+		// The same pairs through a comparison sort, stable so the two orders have to match exactly
+		std::vector<std::pair<uint64_t, uint32_t>> pairs;
+		const double comparison = bestOf([&] {
+			pairs.resize(drawCount);
+			for (uint32_t i = 0; i < drawCount; i++) {
+				pairs[i] = { keys[i], i };
+			}
+			const auto start = Clock::now();
+			std::stable_sort(pairs.begin(), pairs.end(),
+				[](const std::pair<uint64_t, uint32_t>& a, const std::pair<uint64_t, uint32_t>& b) { return a.first < b.first; });
+			return millisecondsSince(start);
+		});
+
+		for (uint32_t i = 0; i < drawCount; i++) {
+			if (pairs[i].first != radixKeys[i] || pairs[i].second != radixValues[i]) {
+				throw std::runtime_error("Radix sort disagrees with std::stable_sort!");
+			}
+		}
+
+		DrawBatcher batcher;
+		batcher.reserve(drawCount);
+		const double build = bestOf([&] {
+			batcher.clear();
+			for (uint32_t i = 0; i < drawCount; i++) {
+				batcher.add(keys[i], i);
+			}
+			batcher.build();
+			return batcher.getStats().lastBuildMilliseconds;
+		});
+
+		out << std::fixed << std::setprecision(3)
+			<< std::setw(10) << drawCount
+			<< std::setw(10) << batcher.getStats().lastDrawCalls
+			<< std::setw(10) << batcher.getStats().lastStateChanges
+			<< std::setw(12) << radix
+			<< std::setw(12) << comparison
+			<< std::setw(12) << build << "\n";
+	}
+}
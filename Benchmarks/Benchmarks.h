@@ -0,0 +1,34 @@
+#pragma once
+
+#include <ostream>
+
+/// <summary>
+/// Scheduling overhead per job and throughput scaling of the JobSystem from one thread up to every hardware thread.
+/// </summary>
+void runJobSystemBenchmark(std::ostream& out);
+
+/// <summary>
+/// Loading a cooked asset through a memory mapping versus reading it with std::ifstream into per-section buffers.
+/// </summary>
+void runAssetLoadBenchmark(std::ostream& out);
+
+/// <summary>
+/// SceneStore::update() over a million entity hierarchy, on the calling thread and through the JobSystem.
+/// </summary>
+void runSceneBenchmark(std::ostream& out);
+
+/// <summary>
+/// Frustum culling across scene sizes: one box at a time, SIMD over every box, and through the BVH.
+/// </summary>
+void runCullingBenchmark(std::ostream& out);
+
+/// <summary>
+/// Sorting a frame's draw keys by radix against std::stable_sort, and how few batches DrawBatcher merges them into.
+/// </summary>
+void runBatchingBenchmark(std::ostream& out);
+
+/// <summary>
+/// Commands from 1 to 32 producer threads into one consumer through MpscQueue against a mutex guarded vector, and the
+/// cost of a TripleBuffer publish.
+/// </summary>
+void runHandoffBenchmark(std::ostream& out);
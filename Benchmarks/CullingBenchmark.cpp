@@ -0,0 +1,141 @@
+#include "Benchmarks.h"
+
+#include "BoundingVolumeHierarchy.h"
+#include "FrustumCulling.h"
+#include "SceneStore.h"
+#include "SimdFloat.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+	const uint32_t SCENE_SIZES[] = { 1000, 10000, 100000, 1000000 };
+	const float WORLD_EXTENT = 200.0f; // Boxes are scattered over [-WORLD_EXTENT, WORLD_EXTENT] on every axis
+	const int REPEATS = 5;
+
+	using Clock = std::chrono::steady_clock;
+
+	double millisecondsSince(Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	template <typename Function>
+	double bestOf(Function&& function) {
+		double best = 0.0;
+		for (int i = 0; i < REPEATS; i++) {
+			const double elapsed = function();
+			best = (i == 0) ? elapsed : std::min(best, elapsed);
+		}
+		return best;
+	}
+
+	/// <summary>
+	/// A 90 degree camera at the origin looking down +z with the far plane at WORLD_EXTENT, which sees about a sixth of
+	/// the world.
+	/// </summary>
+	Frustum makeCamera() {
+		const float side = std::sqrt(0.5f);
+		return { {
+			glm::vec4(side, 0.0f, side, 0.0f),
+			glm::vec4(-side, 0.0f, side, 0.0f),
+			glm::vec4(0.0f, side, side, 0.0f),
+			glm::vec4(0.0f, -side, side, 0.0f),
+			glm::vec4(0.0f, 0.0f, 1.0f, -0.1f),
+			glm::vec4(0.0f, 0.0f, -1.0f, WORLD_EXTENT)
+		} };
+	}
+
+	void buildScene(SceneStore& scene, uint32_t entityCount) {
+		std::mt19937 random(entityCount);
+		std::uniform_real_distribution<float> position(-WORLD_EXTENT, WORLD_EXTENT);
+		std::uniform_real_distribution<float> extent(0.25f, 2.0f);
+
+		scene.reserve(entityCount);
+		for (uint32_t i = 0; i < entityCount; i++) {
+			SceneTransform transform;
+			transform.position = glm::vec3(position(random), position(random), position(random));
+			scene.createEntity(SceneStore::NO_PARENT, transform, glm::vec3(0.0f), glm::vec3(extent(random), extent(random), extent(random)));
+		}
+		scene.update();
+	}
+}
+
+void runCullingBenchmark(std::ostream& out) {
+	const Frustum camera = makeCamera();
+
+	out << "Frustum culling: brute force, " << SimdFloat::NAME << " brute force and BVH traversal against a 90 degree camera\n";
+	out << std::setw(10) << "boxes"
+		<< std::setw(10) << "visible"
+		<< std::setw(12) << "brute ms"
+		<< std::setw(12) << "SIMD ms"
+		<< std::setw(12) << "BVH ms"
+		<< std::setw(12) << "build ms"
+		<< std::setw(12) << "refit ms" << "\n";
+
+	for (uint32_t entityCount : SCENE_SIZES) {
+		SceneStore scene;
+		buildScene(scene, entityCount);
+		const SceneStore::BoundsColumns boxes = scene.getWorldBoundsColumns();
+
+		std::vector<SceneStore::EntityId> visible;
+		visible.reserve(entityCount);
+
+		size_t bruteForceCount = 0;
+		const double bruteForce = bestOf([&] {
+			visible.clear();
+			const auto start = Clock::now();
+			cullBruteForce(boxes, camera, visible);
+			const double elapsed = millisecondsSince(start);
+			bruteForceCount = visible.size();
+			return elapsed;
+		});
+
+		size_t simdCount = 0;
+		const double simd = bestOf([&] {
+			visible.clear();
+			const auto start = Clock::now();
+			cullSimd(boxes, camera, visible);
+			const double elapsed = millisecondsSince(start);
+			simdCount = visible.size();
+			return elapsed;
+		});
+
+		BoundingVolumeHierarchy bvh;
+		const double build = bestOf([&] {
+			bvh.build(scene);
+			return bvh.getStats().lastBuildMilliseconds;
+		});
+		const double refit = bestOf([&] {
+			bvh.refit(scene);
+			return bvh.getStats().lastRefitMilliseconds;
+		});
+
+		size_t bvhCount = 0;
+		const double traversal = bestOf([&] {
+			visible.clear();
+			const auto start = Clock::now();
+			bvh.cull(camera, visible);
+			const double elapsed = millisecondsSince(start);
+			bvhCount = visible.size();
+			return elapsed;
+		});
+
+		if (simdCount != bruteForceCount || bvhCount != bruteForceCount) {
+			throw std::runtime_error("Culling paths disagree on what is visible!");
+		}
+
+		out << std::fixed << std::setprecision(3)
+			<< std::setw(10) << entityCount
+			<< std::setw(10) << bruteForceCount
+			<< std::setw(12) << bruteForce
+			<< std::setw(12) << simd
+			<< std::setw(12) << traversal
+			<< std::setw(12) << build
+			<< std::setw(12) << refit << "\n";
+	}
+}
@@ -0,0 +1,231 @@
+#include "Benchmarks.h"
+
+#include "MpscQueue.h"
+#include "TripleBuffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+	const uint32_t COMMAND_COUNT = 1 << 21; // Split between the producers
+	const uint32_t QUEUE_CAPACITY = 4096;
+	const uint32_t PRODUCER_COUNTS[] = { 1, 2, 4, 8, 16, 32 };
+	const uint32_t PUBLISH_COUNT = 200000;
+	const uint32_t STATE_SIZE = 1024; // Floats per published state
+	const int REPEATS = 3;
+
+	using Clock = std::chrono::steady_clock;
+
+	double millisecondsSince(Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	/// <summary>
+	/// Best of REPEATS, since with this many threads on the machine a single run is mostly scheduler noise.
+	/// </summary>
+	template <typename Function>
+	double bestOf(Function&& function) {
+		double best = 0.0;
+		for (int i = 0; i < REPEATS; i++) {
+			const double elapsed = function();
+			best = (i == 0) ? elapsed : std::min(best, elapsed);
+		}
+		return best;
+	}
+
+	/// <summary>
+	/// The size of a RenderCommand.
+	/// </summary>
+	struct Command {
+		uint32_t type = 0;
+		uint32_t draw = 0;
+		uint32_t value = 0;
+	};
+
+	/// <summary>
+	/// Start producerCount threads together, have each call produce(thread, count) for its share of COMMAND_COUNT while
+	/// the calling thread runs consume() until it returns false, and time all of it. consume() yields when it finds
+	/// nothing, the render thread would get on with its frame, so producers aren't starved when threads outnumber cores.
+	/// </summary>
+	template <typename Produce, typename Consume>
+	double runProducers(uint32_t producerCount, Produce&& produce, Consume&& consume) {
+		std::atomic<bool> go(false);
+		std::vector<std::thread> producers;
+		producers.reserve(producerCount);
+		for (uint32_t i = 0; i < producerCount; i++) {
+			producers.emplace_back([&, i] {
+				while (!go.load(std::memory_order_acquire)) {
+					std::this_thread::yield();
+				}
+				const uint32_t begin = static_cast<uint32_t>(uint64_t(COMMAND_COUNT) * i / producerCount);
+				const uint32_t end = static_cast<uint32_t>(uint64_t(COMMAND_COUNT) * (i + 1) / producerCount);
+				produce(i, end - begin);
+			});
+		}
+
+		const auto start = Clock::now();
+		go.store(true, std::memory_order_release);
+		while (consume()) {
+		}
+		const double elapsed = millisecondsSince(start);
+
+		for (auto& producer : producers) {
+			producer.join();
+		}
+		return elapsed;
+	}
+
+	/// <summary>
+	/// Every producer pushes through the lock-free queue, yielding when it finds it full; the consumer drains whatever
+	/// is there, the way mainLoop() does once per iteration.
+	/// </summary>
+	double lockFreeQueue(uint32_t producerCount, uint64_t& fullRetries) {
+		MpscQueue<Command> queue;
+		queue.init(QUEUE_CAPACITY);
+		std::atomic<uint64_t> retries(0);
+		uint32_t received = 0;
+		uint64_t checksum = 0;
+
+		const double elapsed = runProducers(producerCount,
+			[&](uint32_t thread, uint32_t count) {
+				uint64_t localRetries = 0;
+				for (uint32_t i = 0; i < count; i++) {
+					Command command;
+					command.draw = thread;
+					command.value = i;
+					while (!queue.tryPush(command)) {
+						localRetries++;
+						std::this_thread::yield();
+					}
+				}
+				retries.fetch_add(localRetries, std::memory_order_relaxed);
+			},
+			[&] {
+				const uint32_t count = queue.drain([&](const Command& command) { checksum += command.value; });
+				if (count == 0) {
+					std::this_thread::yield();
+				}
+				received += count;
+				return received < COMMAND_COUNT;
+			});
+
+		fullRetries = retries.load();
+		return elapsed;
+	}
+
+	/// <summary>
+	/// The obvious alternative: producers append to a vector under a mutex and the consumer swaps it out under the same
+	/// mutex. Unbounded, so it never has to retry, but every push contends for the lock.
+	/// </summary>
+	double mutexQueue(uint32_t producerCount) {
+		std::mutex mutex;
+		std::vector<Command> pending;
+		std::vector<Command> drained;
+		pending.reserve(QUEUE_CAPACITY);
+		drained.reserve(QUEUE_CAPACITY);
+		uint32_t received = 0;
+		uint64_t checksum = 0;
+
+		return runProducers(producerCount,
+			[&](uint32_t thread, uint32_t count) {
+				for (uint32_t i = 0; i < count; i++) {
+					Command command;
+					command.draw = thread;
+					command.value = i;
+					std::lock_guard<std::mutex> lock(mutex);
+					pending.push_back(command);
+				}
+			},
+			[&] {
+				drained.clear();
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					pending.swap(drained);
+				}
+				if (drained.empty()) {
+					std::this_thread::yield();
+				}
+				for (const Command& command : drained) {
+					checksum += command.value;
+				}
+				received += static_cast<uint32_t>(drained.size());
+				return received < COMMAND_COUNT;
+			});
+	}
+
+	/// <summary>
+	/// One producer fills and publishes PUBLISH_COUNT states as fast as it can while the consumer acquires and reads
+	/// them. Neither side waits, so what matters is the cost per publish and how often the consumer was overtaken.
+	/// </summary>
+	double tripleBuffer(uint64_t& acquired) {
+		TripleBuffer<std::vector<float>> states;
+		for (uint32_t i = 0; i < 3; i++) {
+			states.getBuffer(i).assign(STATE_SIZE, 0.0f);
+		}
+		std::atomic<bool> done(false);
+		uint64_t acquires = 0;
+		float checksum = 0.0f;
+
+		const auto start = Clock::now();
+		std::thread producer([&] {
+			for (uint32_t frame = 1; frame <= PUBLISH_COUNT; frame++) {
+				std::vector<float>& state = states.getWriteBuffer();
+				std::fill(state.begin(), state.end(), static_cast<float>(frame));
+				states.publish();
+			}
+			done.store(true, std::memory_order_release);
+		});
+		while (!done.load(std::memory_order_acquire)) {
+			if (states.acquire()) {
+				acquires++;
+				checksum += states.getReadBuffer()[STATE_SIZE / 2];
+			} else {
+				std::this_thread::yield();
+			}
+		}
+		producer.join();
+		const double elapsed = millisecondsSince(start);
+
+		acquired = acquires;
+		return elapsed;
+	}
+}
+
+void runHandoffBenchmark(std::ostream& out) {
+	out << "Handoff: " << COMMAND_COUNT << " commands from every producer count to one consumer, queue capacity "
+		<< QUEUE_CAPACITY << ", " << std::thread::hardware_concurrency() << " hardware threads\n";
+	out << std::setw(10) << "producers"
+		<< std::setw(14) << "mpsc ms"
+		<< std::setw(14) << "Mcmd/s"
+		<< std::setw(16) << "full retries"
+		<< std::setw(14) << "mutex ms"
+		<< std::setw(14) << "Mcmd/s"
+		<< std::setw(10) << "speedup" << "\n";
+
+	for (uint32_t producerCount : PRODUCER_COUNTS) {
+		uint64_t fullRetries = 0;
+		const double lockFree = bestOf([&] { return lockFreeQueue(producerCount, fullRetries); });
+		const double locked = bestOf([&] { return mutexQueue(producerCount); });
+
+		out << std::fixed << std::setprecision(2)
+			<< std::setw(10) << producerCount
+			<< std::setw(14) << lockFree
+			<< std::setw(14) << COMMAND_COUNT / (lockFree * 1000.0)
+			<< std::setw(16) << fullRetries
+			<< std::setw(14) << locked
+			<< std::setw(14) << COMMAND_COUNT / (locked * 1000.0)
+			<< std::setw(9) << locked / lockFree << "x\n";
+	}
+
+	uint64_t acquired = 0;
+	const double published = bestOf([&] { return tripleBuffer(acquired); });
+	out << std::fixed << std::setprecision(2) << "TripleBuffer: " << PUBLISH_COUNT << " states of " << STATE_SIZE
+		<< " floats in " << published << " ms, " << published * 1e6 / PUBLISH_COUNT << " ns per publish, consumer picked up "
+		<< acquired << " of them\n";
+}
@@ -0,0 +1,133 @@
+#include "Benchmarks.h"
+
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <thread>
+#include <vector>
+
+namespace {
+	const uint32_t EMPTY_JOB_COUNT = 200000;
+	const uint32_t WORK_ITEM_COUNT = 1 << 22;
+	const uint32_t WORK_BATCH_SIZE = 1024;
+	const uint32_t TREE_DEPTH = 16;
+	const int REPEATS = 5;
+
+	using Clock = std::chrono::steady_clock;
+
+	double millisecondsSince(Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	/// <summary>
+	/// Best of REPEATS, since we care about the scheduler and not whatever else the machine happened to be doing.
+	/// </summary>
+	template <typename Function>
+	double bestOf(Function&& function) {
+		double best = 0.0;
+		for (int i = 0; i < REPEATS; i++) {
+			const double elapsed = function();
+			best = (i == 0) ? elapsed : std::min(best, elapsed);
+		}
+		return best;
+	}
+
+	/// <summary>
+	/// Schedule a batch of jobs that do nothing from the main thread, so the time is all queueing, stealing and counters.
+	/// </summary>
+	double emptyJobs(JobSystem& jobs) {
+		std::atomic<uint32_t> ran(0);
+		const auto start = Clock::now();
+
+		JobCounter counter;
+		for (uint32_t i = 0; i < EMPTY_JOB_COUNT; i++) {
+			jobs.schedule([&ran] { ran.fetch_add(1, std::memory_order_relaxed); }, &counter);
+		}
+		jobs.wait(counter);
+
+		return millisecondsSince(start);
+	}
+
+	/// <summary>
+	/// Binary tree of jobs where every node spawns its children and waits on them, the pattern that only scales if idle
+	/// threads steal and waiting threads help.
+	/// </summary>
+	void spawnTree(JobSystem& jobs, uint32_t depth, std::atomic<uint32_t>& leaves) {
+		if (depth == 0) {
+			leaves.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		JobCounter children;
+		jobs.schedule([&jobs, depth, &leaves] { spawnTree(jobs, depth - 1, leaves); }, &children);
+		jobs.schedule([&jobs, depth, &leaves] { spawnTree(jobs, depth - 1, leaves); }, &children);
+		jobs.wait(children);
+	}
+
+	double jobTree(JobSystem& jobs) {
+		std::atomic<uint32_t> leaves(0);
+		const auto start = Clock::now();
+		spawnTree(jobs, TREE_DEPTH, leaves);
+		return millisecondsSince(start);
+	}
+
+	/// <summary>
+	/// Enough arithmetic per batch that the scheduler should vanish into the noise; this is the ideal scaling line.
+	/// </summary>
+	double computeLoop(JobSystem& jobs, std::vector<float>& output) {
+		const auto start = Clock::now();
+		jobs.parallelFor(WORK_ITEM_COUNT, WORK_BATCH_SIZE, [&output](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				float x = static_cast<float>(i);
+				for (int k = 0; k < 16; k++) {
+					x = std::sqrt(x * 1.0001f + 1.0f);
+				}
+				output[i] = x;
+			}
+		});
+		return millisecondsSince(start);
+	}
+}
+
+void runJobSystemBenchmark(std::ostream& out) {
+	const uint32_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<float> output(WORK_ITEM_COUNT);
+
+	out << "JobSystem: " << EMPTY_JOB_COUNT << " empty jobs, a depth " << TREE_DEPTH << " job tree, "
+		<< WORK_ITEM_COUNT << " work items in batches of " << WORK_BATCH_SIZE << "\n";
+	out << std::setw(8) << "threads"
+		<< std::setw(16) << "ns/empty job"
+		<< std::setw(14) << "tree ms"
+		<< std::setw(14) << "compute ms"
+		<< std::setw(10) << "speedup" << "\n";
+
+	// Powers of two, plus the full machine when that isn't one
+	std::vector<uint32_t> threadCounts;
+	for (uint32_t threadCount = 1; threadCount < maxThreads; threadCount *= 2) {
+		threadCounts.push_back(threadCount);
+	}
+	threadCounts.push_back(maxThreads);
+
+	double singleThreadCompute = 0.0;
+	for (uint32_t threadCount : threadCounts) {
+		JobSystem jobs(threadCount);
+
+		const double empty = bestOf([&] { return emptyJobs(jobs); });
+		const double tree = bestOf([&] { return jobTree(jobs); });
+		const double compute = bestOf([&] { return computeLoop(jobs, output); });
+		if (threadCount == 1) {
+			singleThreadCompute = compute;
+		}
+
+		out << std::fixed << std::setprecision(2)
+			<< std::setw(8) << threadCount
+			<< std::setw(16) << empty * 1e6 / EMPTY_JOB_COUNT
+			<< std::setw(14) << tree
+			<< std::setw(14) << compute
+			<< std::setw(9) << singleThreadCompute / compute << "x\n";
+	}
+}
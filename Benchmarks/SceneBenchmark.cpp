@@ -0,0 +1,127 @@
+#include "Benchmarks.h"
+
+#include "JobSystem.h"
+#include "SceneStore.h"
+#include "SimdFloat.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+	const uint32_t ENTITY_COUNT = 1000000;
+	const uint32_t ROOT_COUNT = 1000; // Each with CHILDREN_PER_ROOT children, everything else below those
+	const uint32_t CHILDREN_PER_ROOT = 9;
+	const int REPEATS = 5;
+
+	using Clock = std::chrono::steady_clock;
+
+	double millisecondsSince(Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	template <typename Function>
+	double bestOf(Function&& function) {
+		double best = 0.0;
+		for (int i = 0; i < REPEATS; i++) {
+			const double elapsed = function();
+			best = (i == 0) ? elapsed : std::min(best, elapsed);
+		}
+		return best;
+	}
+
+	SceneTransform turnedAboutZ(const glm::vec3& position, float angle, float scale) {
+		SceneTransform transform;
+		transform.position = position;
+		transform.rotation = glm::vec4(0.0f, 0.0f, std::sin(angle * 0.5f), std::cos(angle * 0.5f));
+		transform.scale = glm::vec3(scale);
+		return transform;
+	}
+
+	/// <summary>
+	/// Three levels, with the grandchildren created interleaved under every child rather than sibling after sibling, so
+	/// parent reads jump around the way they would in a real scene.
+	/// </summary>
+	void buildScene(SceneStore& scene, std::vector<glm::vec3>& rootPositions) {
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+		std::uniform_real_distribution<float> angle(0.0f, 6.2832f);
+		std::uniform_real_distribution<float> scale(0.9f, 1.1f);
+
+		const uint32_t children = ROOT_COUNT * CHILDREN_PER_ROOT;
+		scene.reserve(ENTITY_COUNT);
+		for (uint32_t i = 0; i < ENTITY_COUNT; i++) {
+			const glm::vec3 offset(position(random), position(random), position(random));
+
+			SceneStore::EntityId parent = SceneStore::NO_PARENT;
+			if (i >= ROOT_COUNT + children) {
+				parent = ROOT_COUNT + (i - ROOT_COUNT - children) % children;
+			} else if (i >= ROOT_COUNT) {
+				parent = (i - ROOT_COUNT) % ROOT_COUNT;
+			} else {
+				rootPositions.push_back(offset);
+			}
+
+			const SceneTransform transform = turnedAboutZ(parent == SceneStore::NO_PARENT ? offset : offset * 0.05f, angle(random), scale(random));
+			scene.createEntity(parent, transform, glm::vec3(0.0f), glm::vec3(0.5f));
+		}
+	}
+
+	/// <summary>
+	/// One frame's worth: turn every root, which drags everything below it along, and propagate.
+	/// </summary>
+	double updateFrame(SceneStore& scene, const std::vector<glm::vec3>& rootPositions, JobSystem* jobs, uint32_t frame) {
+		const auto start = Clock::now();
+		for (uint32_t root = 0; root < ROOT_COUNT; root++) {
+			scene.setLocalTransform(root, turnedAboutZ(rootPositions[root], frame * 0.01f + root, 1.0f));
+		}
+		scene.update(jobs);
+		return millisecondsSince(start);
+	}
+}
+
+void runSceneBenchmark(std::ostream& out) {
+	SceneStore scene;
+	std::vector<glm::vec3> rootPositions;
+	buildScene(scene, rootPositions);
+
+	// The first update also lays out the depth levels, which is a one-off
+	const auto sortStart = Clock::now();
+	scene.update();
+	const double firstUpdate = millisecondsSince(sortStart);
+
+	out << "SceneStore: " << ENTITY_COUNT << " entities over " << scene.getStats().levels << " levels, " << SimdFloat::NAME
+		<< " kernels, first update " << std::fixed << std::setprecision(2) << firstUpdate << " ms\n";
+	out << std::setw(8) << "threads"
+		<< std::setw(14) << "update ms"
+		<< std::setw(16) << "M entities/s"
+		<< std::setw(10) << "speedup" << "\n";
+
+	uint32_t frame = 0;
+	const double singleThread = bestOf([&] { return updateFrame(scene, rootPositions, nullptr, frame++); });
+	out << std::setw(8) << "no jobs"
+		<< std::setw(14) << singleThread
+		<< std::setw(16) << ENTITY_COUNT / (singleThread * 1000.0)
+		<< std::setw(9) << 1.0 << "x\n";
+
+	const uint32_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<uint32_t> threadCounts;
+	for (uint32_t threadCount = 1; threadCount < maxThreads; threadCount *= 2) {
+		threadCounts.push_back(threadCount);
+	}
+	threadCounts.push_back(maxThreads);
+
+	for (uint32_t threadCount : threadCounts) {
+		JobSystem jobs(threadCount);
+		const double elapsed = bestOf([&] { return updateFrame(scene, rootPositions, &jobs, frame++); });
+
+		out << std::setw(8) << threadCount
+			<< std::setw(14) << elapsed
+			<< std::setw(16) << ENTITY_COUNT / (elapsed * 1000.0)
+			<< std::setw(9) << singleThread / elapsed << "x\n";
+	}
+}
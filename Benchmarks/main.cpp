@@ -0,0 +1,50 @@
+#include "Benchmarks.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+/// <summary>
+/// Micro-benchmarks for engine subsystems that don't need a window or a GPU. Pass a benchmark name to run just that one.
+/// </summary>
+int main(int argc, char** argv) {
+	const std::string which = argc > 1 ? argv[1] : "all";
+
+	try {
+		bool ran = false;
+		if (which == "all" || which == "jobs") {
+			runJobSystemBenchmark(std::cout);
+			ran = true;
+		}
+		if (which == "all" || which == "assets") {
+			runAssetLoadBenchmark(std::cout);
+			ran = true;
+		}
+		if (which == "all" || which == "scene") {
+			runSceneBenchmark(std::cout);
+			ran = true;
+		}
+		if (which == "all" || which == "culling") {
+			runCullingBenchmark(std::cout);
+			ran = true;
+		}
+		if (which == "all" || which == "batching") {
+			runBatchingBenchmark(std::cout);
+			ran = true;
+		}
+		if (which == "all" || which == "handoff") {
+			runHandoffBenchmark(std::cout);
+			ran = true;
+		}
+
+		if (!ran) {
+			throw std::runtime_error("Unknown benchmark: " + which + " (expected all, jobs, assets, scene, culling, batching or handoff)");
+		}
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
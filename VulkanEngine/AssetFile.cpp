@@ -0,0 +1,154 @@
+#include "AssetFile.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+void AssetFile::open(const std::string& path) {
+	close();
+	file.open(path);
+
+	try {
+		validate(path);
+	} catch (...) {
+		close();
+		throw;
+	}
+}
+
+void AssetFile::close() {
+	file.close();
+	header = nullptr;
+	meshes = nullptr;
+	textures = nullptr;
+	sections = nullptr;
+}
+
+const AssetMeshEntry& AssetFile::getMesh(uint32_t index) const {
+	if (index >= header->meshCount) {
+		throw std::runtime_error("Asset mesh index out of range!");
+	}
+	return meshes[index];
+}
+
+const AssetTextureEntry& AssetFile::getTexture(uint32_t index) const {
+	if (index >= header->textureCount) {
+		throw std::runtime_error("Asset texture index out of range!");
+	}
+	return textures[index];
+}
+
+const AssetSection& AssetFile::getSection(uint32_t index) const {
+	if (index >= header->sectionCount) {
+		throw std::runtime_error("Asset section index out of range!");
+	}
+	return sections[index];
+}
+
+const void* AssetFile::getSectionData(uint32_t index) const {
+	return file.data() + getSection(index).offset;
+}
+
+uint64_t AssetFile::uploadSection(StagingRing& stagingRing, uint32_t index, VkBuffer dst, VkDeviceSize dstOffset) const {
+	const AssetSection& section = getSection(index);
+	return stagingRing.uploadBuffer(dst, dstOffset, file.data() + section.offset, section.size);
+}
+
+uint64_t AssetFile::uploadTexture(StagingRing& stagingRing, uint32_t index, VkImage image) const {
+	const AssetTextureEntry& texture = getTexture(index);
+
+	TexelBlock block;
+	getTexelBlock(static_cast<VkFormat>(texture.format), block); // Checked in validate()
+
+	uint64_t value = 0;
+	for (uint32_t level = 0; level < texture.mipCount; level++) {
+		const VkExtent2D extent = { std::max(texture.width >> level, 1u), std::max(texture.height >> level, 1u) };
+		value = stagingRing.uploadImage(image, level, extent, { block.width, block.height }, block.bytes,
+			getSectionData(texture.firstSection + level));
+	}
+	return value;
+}
+
+void AssetFile::validate(const std::string& path) {
+	// Only the header and tables are looked at, the payloads stay untouched until they are uploaded
+	const uint64_t fileSize = file.size();
+	if (fileSize < sizeof(AssetFileHeader)) {
+		throw std::runtime_error(path + " is too small to be an asset file!");
+	}
+
+	header = reinterpret_cast<const AssetFileHeader*>(file.data());
+
+	if (header->magic != ASSET_FILE_MAGIC) {
+		throw std::runtime_error(path + " is not an asset file!");
+	}
+	if (header->version != ASSET_FILE_VERSION) {
+		throw std::runtime_error(path + " was cooked for asset format version " + std::to_string(header->version) + ", expected " +
+			std::to_string(ASSET_FILE_VERSION) + "!");
+	}
+	if (header->fileSize != fileSize) {
+		throw std::runtime_error(path + " is truncated!");
+	}
+
+	const uint32_t alignment = header->sectionAlignment;
+	if (alignment < 16 || (alignment & (alignment - 1)) != 0) {
+		throw std::runtime_error(path + " has an invalid section alignment!");
+	}
+
+	const uint64_t tablesSize = getAssetTablesSize(header->meshCount, header->textureCount, header->sectionCount);
+	if (tablesSize > fileSize) {
+		throw std::runtime_error(path + " is truncated!");
+	}
+
+	meshes = reinterpret_cast<const AssetMeshEntry*>(file.data() + sizeof(AssetFileHeader));
+	textures = reinterpret_cast<const AssetTextureEntry*>(meshes + header->meshCount);
+	sections = reinterpret_cast<const AssetSection*>(textures + header->textureCount);
+
+	for (uint32_t i = 0; i < header->sectionCount; i++) {
+		const AssetSection& section = sections[i];
+		if (section.offset < tablesSize || section.offset % alignment != 0 || section.offset > fileSize || section.size > fileSize - section.offset) {
+			throw std::runtime_error(path + " has a section outside the file!");
+		}
+	}
+
+	auto checkSection = [&](uint32_t index, uint64_t expectedSize) {
+		if (index >= header->sectionCount || sections[index].size != expectedSize) {
+			throw std::runtime_error(path + " has a section that doesn't match its table entry!");
+		}
+	};
+
+	for (uint32_t i = 0; i < header->meshCount; i++) {
+		const AssetMeshEntry& mesh = meshes[i];
+		if (mesh.indexCount % 3 != 0) {
+			throw std::runtime_error(path + " has a mesh with a partial triangle!");
+		}
+
+		checkSection(mesh.vertexSection, uint64_t(mesh.vertexCount) * sizeof(AssetVertex));
+		checkSection(mesh.indexSection, uint64_t(mesh.indexCount) * sizeof(uint32_t));
+		checkSection(mesh.meshletSection, uint64_t(mesh.meshletCount) * sizeof(AssetMeshlet));
+		if (mesh.meshletVertexSection >= header->sectionCount || mesh.meshletTriangleSection >= header->sectionCount) {
+			throw std::runtime_error(path + " has a mesh with a missing meshlet stream!");
+		}
+	}
+
+	for (uint32_t i = 0; i < header->textureCount; i++) {
+		const AssetTextureEntry& texture = textures[i];
+
+		TexelBlock block;
+		if (!getTexelBlock(static_cast<VkFormat>(texture.format), block)) {
+			throw std::runtime_error(path + " has a texture in an unsupported format!");
+		}
+
+		const uint32_t largest = std::max(texture.width, texture.height);
+		uint32_t fullMipCount = 1;
+		while (fullMipCount < 32 && (largest >> fullMipCount) != 0) {
+			fullMipCount++;
+		}
+		if (texture.width == 0 || texture.height == 0 || texture.mipCount == 0 || texture.mipCount > fullMipCount ||
+			uint64_t(texture.firstSection) + texture.mipCount > header->sectionCount) {
+			throw std::runtime_error(path + " has a texture with an invalid mip chain!");
+		}
+
+		for (uint32_t level = 0; level < texture.mipCount; level++) {
+			checkSection(texture.firstSection + level, getMipSize(block, texture.width, texture.height, level));
+		}
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "AssetFormat.h"
+#include "MappedFile.h"
+#include "StagingRing.h"
+
+#include <cstdint>
+#include <string>
+
+/// <summary>
+/// A cooked asset file opened for loading. The file is memory mapped and validated once in open(); after that the
+/// tables are read straight out of the mapping and uploads copy section payloads from the mapping into the staging
+/// ring, so loading makes no heap allocations and never copies a payload more than once on the CPU.
+///
+/// Sections are only ever read by the upload calls, so pages that are never uploaded are never read from disk.
+/// </summary>
+class AssetFile {
+public:
+	/// <summary>
+	/// Throws if the file can't be mapped or its header and tables don't describe a well formed asset of this version.
+	/// </summary>
+	void open(const std::string& path);
+	void close();
+
+	uint32_t getMeshCount() const {
+		return header->meshCount;
+	}
+
+	uint32_t getTextureCount() const {
+		return header->textureCount;
+	}
+
+	uint32_t getSectionCount() const {
+		return header->sectionCount;
+	}
+
+	const AssetMeshEntry& getMesh(uint32_t index) const;
+	const AssetTextureEntry& getTexture(uint32_t index) const;
+	const AssetSection& getSection(uint32_t index) const;
+
+	/// <summary>
+	/// Where section index lives in the mapping. Valid until close().
+	/// </summary>
+	const void* getSectionData(uint32_t index) const;
+
+	/// <summary>
+	/// Queue a copy of section index to dst at dstOffset. Returns the ring's timeline value for it.
+	/// </summary>
+	uint64_t uploadSection(StagingRing& stagingRing, uint32_t index, VkBuffer dst, VkDeviceSize dstOffset) const;
+
+	/// <summary>
+	/// Queue every mip level of texture index into image, which must have been created with the texture's format, extent and
+	/// mip count. Returns the ring's timeline value for the last level.
+	/// </summary>
+	uint64_t uploadTexture(StagingRing& stagingRing, uint32_t index, VkImage image) const;
+
+	/// <summary>
+	/// Ask the OS to read the whole file ahead, for when everything in it is about to be uploaded.
+	/// </summary>
+	void prefetch() const {
+		file.adviseSequential();
+	}
+
+	uint64_t getFileSize() const {
+		return file.size();
+	}
+
+private:
+	void validate(const std::string& path);
+
+	MappedFile file;
+	const AssetFileHeader* header = nullptr;
+	const AssetMeshEntry* meshes = nullptr;
+	const AssetTextureEntry* textures = nullptr;
+	const AssetSection* sections = nullptr;
+};
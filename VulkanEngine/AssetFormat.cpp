@@ -0,0 +1,50 @@
+#include "AssetFormat.h"
+
+#include <algorithm>
+
+bool getTexelBlock(VkFormat format, TexelBlock& block) {
+	switch (format) {
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+		block = { 1, 1, 4 };
+		return true;
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+		block = { 4, 4, 8 };
+		return true;
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+	case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+	case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+		block = { 4, 4, 16 };
+		return true;
+	case VK_FORMAT_ASTC_6x6_UNORM_BLOCK:
+	case VK_FORMAT_ASTC_6x6_SRGB_BLOCK:
+		block = { 6, 6, 16 };
+		return true;
+	case VK_FORMAT_ASTC_8x8_UNORM_BLOCK:
+	case VK_FORMAT_ASTC_8x8_SRGB_BLOCK:
+		block = { 8, 8, 16 };
+		return true;
+	default:
+		return false;
+	}
+}
+
+uint64_t getMipSize(const TexelBlock& block, uint32_t width, uint32_t height, uint32_t level) {
+	const uint32_t mipWidth = std::max(width >> level, 1u);
+	const uint32_t mipHeight = std::max(height >> level, 1u);
+	const uint64_t blocksWide = (mipWidth + block.width - 1) / block.width;
+	const uint64_t blocksHigh = (mipHeight + block.height - 1) / block.height;
+	return blocksWide * blocksHigh * block.bytes;
+}
+
+uint64_t getAssetTablesSize(uint32_t meshCount, uint32_t textureCount, uint32_t sectionCount) {
+	return sizeof(AssetFileHeader) + uint64_t(meshCount) * sizeof(AssetMeshEntry) + uint64_t(textureCount) * sizeof(AssetTextureEntry) +
+		uint64_t(sectionCount) * sizeof(AssetSection);
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+const uint32_t ASSET_FILE_MAGIC = 0x31414556; // "VEA1"
+const uint32_t ASSET_FILE_VERSION = 2; // 2 added the meshlet normal cones
+
+// Covers optimalBufferCopyOffsetAlignment and nonCoherentAtomSize on every device we know of, and every texel block size
+const uint32_t ASSET_SECTION_ALIGNMENT = 256;
+
+const uint32_t MESHLET_MAX_VERTICES = 64;
+const uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+/// <summary>
+/// On-disk layout of cooked asset files (.vea), shared by the AssetCooker tool and the runtime AssetFile loader.
+///
+/// A file is an AssetFileHeader, then meshCount AssetMeshEntry, textureCount AssetTextureEntry and sectionCount
+/// AssetSection records, then the section payloads. Every payload starts on an ASSET_SECTION_ALIGNMENT boundary and is
+/// already in the layout the GPU consumes, so loading is a map of the file plus one copy per section into the staging
+/// ring. Everything is little endian.
+/// </summary>
+struct AssetFileHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t meshCount;
+	uint32_t textureCount;
+	uint32_t sectionCount;
+	uint32_t sectionAlignment;
+	uint64_t fileSize; // Lets a truncated file be rejected before any section is touched
+};
+
+struct AssetSection {
+	uint64_t offset; // From the start of the file
+	uint64_t size;
+};
+
+/// <summary>
+/// Indices into the section table for each stream of one mesh. The meshlet streams are meshlets, then the uint32 mesh
+/// vertex index of every meshlet vertex, then three uint8 meshlet-local vertex indices per meshlet triangle.
+/// </summary>
+struct AssetMeshEntry {
+	uint32_t vertexCount;
+	uint32_t indexCount; // uint32 indices, three per triangle
+	uint32_t meshletCount;
+	uint32_t vertexSection;
+	uint32_t indexSection;
+	uint32_t meshletSection;
+	uint32_t meshletVertexSection;
+	uint32_t meshletTriangleSection;
+	float bounds[4]; // Bounding sphere, xyz centre and radius
+};
+
+/// <summary>
+/// mipCount consecutive sections starting at firstSection, largest mip first, each tightly packed in format's blocks.
+/// </summary>
+struct AssetTextureEntry {
+	uint32_t format; // VkFormat
+	uint32_t width;
+	uint32_t height;
+	uint32_t mipCount;
+	uint32_t firstSection;
+	uint32_t reserved[3];
+};
+
+/// <summary>
+/// Vertex stream layout, 20 bytes. Bound as R32G32B32_SFLOAT, A2B10G10R10_SNORM_PACK32 and R16G16_SFLOAT.
+/// </summary>
+struct AssetVertex {
+	float position[3];
+	uint32_t normal;
+	uint16_t uv[2];
+};
+
+/// <summary>
+/// std430 compatible, so the meshlet section can be bound as a storage buffer as it is.
+///
+/// The normal cone bounds the facing of every triangle in the meshlet: all their normals are within the cone around axis.
+/// Seen along a direction d, the whole meshlet faces away when dot(d, axis) > cutoff. A cutoff above 1 means the normals
+/// spread too far for that to ever be true.
+/// </summary>
+struct AssetMeshlet {
+	uint32_t vertexOffset; // Into the meshlet vertex stream
+	uint32_t triangleOffset; // Into the meshlet triangle stream, in triangles
+	uint32_t vertexCount;
+	uint32_t triangleCount;
+	float bounds[4];
+	float cone[4]; // xyz axis, w cutoff
+};
+
+static_assert(sizeof(AssetFileHeader) == 32, "AssetFileHeader layout is part of the file format");
+static_assert(sizeof(AssetSection) == 16, "AssetSection layout is part of the file format");
+static_assert(sizeof(AssetMeshEntry) == 48, "AssetMeshEntry layout is part of the file format");
+static_assert(sizeof(AssetTextureEntry) == 32, "AssetTextureEntry layout is part of the file format");
+static_assert(sizeof(AssetVertex) == 20, "AssetVertex layout is part of the file format");
+static_assert(sizeof(AssetMeshlet) == 48, "AssetMeshlet layout is part of the file format");
+
+/// <summary>
+/// Texel block of a texture format: 1x1 for uncompressed formats, 4x4 or larger for BC and ASTC.
+/// </summary>
+struct TexelBlock {
+	uint32_t width;
+	uint32_t height;
+	uint32_t bytes;
+};
+
+/// <summary>
+/// False for formats the asset pipeline doesn't carry.
+/// </summary>
+bool getTexelBlock(VkFormat format, TexelBlock& block);
+
+/// <summary>
+/// Bytes in mip level of a width x height texture in a format with the given block, rounded up to whole blocks.
+/// </summary>
+uint64_t getMipSize(const TexelBlock& block, uint32_t width, uint32_t height, uint32_t level);
+
+/// <summary>
+/// Bytes taken by the header and the three tables, i.e. where section payloads may start.
+/// </summary>
+uint64_t getAssetTablesSize(uint32_t meshCount, uint32_t textureCount, uint32_t sectionCount);
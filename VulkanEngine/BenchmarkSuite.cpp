@@ -0,0 +1,112 @@
+#include "BenchmarkSuite.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+namespace {
+	double percentile(const std::vector<double>& sorted, double fraction) {
+		const size_t rank = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+		return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+	}
+
+	void writeSummary(std::ostream& out, const char* name, const FrameTimeSummary& summary) {
+		out << "\"" << name << "\":{\"samples\":" << summary.samples << ",\"mean\":" << summary.mean << ",\"p50\":" << summary.p50
+			<< ",\"p95\":" << summary.p95 << ",\"p99\":" << summary.p99 << ",\"max\":" << summary.max << "}";
+	}
+
+	// Device names come from the driver; keep the JSON valid whatever they contain
+	std::string escape(const std::string& text) {
+		std::string escaped;
+		for (char c : text) {
+			if (c == '"' || c == '\\') {
+				escaped += '\\';
+				escaped += c;
+			} else if (static_cast<unsigned char>(c) >= 0x20) {
+				escaped += c;
+			}
+		}
+		return escaped;
+	}
+}
+
+const std::vector<BenchmarkScene>& getBenchmarkScenes() {
+	static const std::vector<BenchmarkScene> scenes = {
+		{ "single-draw", "One full screen triangle, the fixed cost of a frame", 1, 1.0f, false, false, CpuCulling::None, false, false, false },
+		{ "many-draws", "10k small triangles recorded on the CPU, all on screen", 10000, 1.0f, false, false, CpuCulling::None, false, false, false },
+		{ "many-draws-batched", "The same 10k draws sorted and merged into instanced draws", 10000, 1.0f, false, false, CpuCulling::None, true, false, false },
+		{ "many-draws-bindless", "The same 10k draws with bindless materials", 10000, 1.0f, true, false, CpuCulling::None, false, false, false },
+		{ "culled-cpu", "100k draws over 4x the screen, CPU recorded with no culling", 100000, 4.0f, false, false, CpuCulling::None, false, false, false },
+		{ "culled-cpu-bvh", "The same 100k draws culled through the scene BVH on the CPU", 100000, 4.0f, false, false, CpuCulling::Bvh, false, false, false },
+		{ "culled-gpu", "The same 100k draws culled on the GPU and drawn indirect", 100000, 4.0f, false, true, CpuCulling::None, false, false, false },
+		{ "mesh-indirect", "1k copies of the --mesh asset over 2x the screen, culled per object and drawn indirect", 1000, 2.0f, false, true,
+			CpuCulling::None, false, true, false },
+		{ "mesh-shader", "The same 1k meshes culled per meshlet in task shaders and drawn by mesh shaders", 1000, 2.0f, false, false,
+			CpuCulling::None, false, true, true },
+	};
+	return scenes;
+}
+
+void applyBenchmarkScene(const BenchmarkScene& scene, EngineConfig& config) {
+	config.headless = true;
+	config.drawCount = scene.drawCount;
+	config.sceneScale = scene.sceneScale;
+	config.bindless = scene.bindless;
+	config.gpuDriven = scene.gpuDriven;
+	config.cpuCulling = scene.cpuCulling;
+	config.drawBatching = scene.drawBatching;
+	config.meshShaders = scene.meshShaders;
+	if (!scene.mesh) {
+		config.meshPath.clear();
+	}
+}
+
+FrameTimeSummary summarizeFrameTimes(std::vector<double>& milliseconds) {
+	FrameTimeSummary summary;
+	if (milliseconds.empty()) {
+		return summary;
+	}
+
+	std::sort(milliseconds.begin(), milliseconds.end());
+
+	double total = 0.0;
+	for (double sample : milliseconds) {
+		total += sample;
+	}
+
+	summary.samples = static_cast<uint32_t>(milliseconds.size());
+	summary.mean = total / milliseconds.size();
+	summary.p50 = percentile(milliseconds, 0.50);
+	summary.p95 = percentile(milliseconds, 0.95);
+	summary.p99 = percentile(milliseconds, 0.99);
+	summary.max = milliseconds.back();
+	return summary;
+}
+
+void writeBenchmarkJson(std::ostream& out, const std::vector<BenchmarkResult>& results) {
+	const auto flags = out.flags();
+	out << std::fixed << std::setprecision(4);
+
+	out << "{\"results\":[\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		const BenchmarkResult& result = results[i];
+		out << "{\"scene\":\"" << escape(result.scene) << "\",\"device\":\"" << escape(result.deviceName) << "\",\"frames\":" << result.frames
+			<< ",\"devices\":" << result.devices << ",\"threads\":" << result.threads << ",\"bindless\":" << (result.bindless ? "true" : "false")
+			<< ",\"gpuDriven\":" << (result.gpuDriven ? "true" : "false") << ",\"drawBatching\":" << (result.drawBatching ? "true" : "false")
+			<< ",\"meshShaders\":" << (result.meshShaders ? "true" : "false") << ",\"drawCalls\":" << result.drawCalls
+			<< ",\"stateChanges\":" << result.stateChanges << ",\"triangles\":" << result.triangles << ",";
+		writeSummary(out, "cpuFrameMs", result.cpu);
+		out << ",";
+		writeSummary(out, "gpuFrameMs", result.gpu);
+		out << ",\"deviceMemoryBytes\":" << result.deviceMemoryBytes << ",\"deviceMemoryReserved\":" << result.deviceMemoryReserved
+			<< ",\"deviceMemoryAllocations\":" << result.deviceMemoryAllocations << ",\"pipelineHitchFrames\":" << result.pipelineHitchFrames
+			<< ",\"pipelineCompileHistogram\":[";
+		for (size_t bucket = 0; bucket < result.pipelineCompileHistogram.size(); bucket++) {
+			out << (bucket > 0 ? "," : "") << result.pipelineCompileHistogram[bucket];
+		}
+		out << "]}" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	out << "]}\n";
+
+	out.flags(flags);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "EngineConfig.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// One scripted scene of the headless benchmark suite. Everything that shapes the frame is fixed here, so runs on the
+/// same machine are comparable; only frame counts, threads and frames in flight come from the command line.
+/// </summary>
+struct BenchmarkScene {
+	const char* name;
+	const char* description;
+	uint32_t drawCount;
+	float sceneScale;
+	bool bindless;
+	bool gpuDriven;
+	CpuCulling cpuCulling;
+	bool drawBatching;
+	bool mesh; // Draws the --mesh asset instead of the triangle, so the suite skips it without one
+	bool meshShaders;
+};
+
+/// <summary>
+/// Every scene the suite knows, in the order it runs them.
+/// </summary>
+const std::vector<BenchmarkScene>& getBenchmarkScenes();
+
+/// <summary>
+/// Overwrite the scene's settings in config and switch it to headless. Scenes without a mesh drop config's meshPath.
+/// </summary>
+void applyBenchmarkScene(const BenchmarkScene& scene, EngineConfig& config);
+
+struct FrameTimeSummary {
+	uint32_t samples = 0;
+	double mean = 0.0;
+	double p50 = 0.0;
+	double p95 = 0.0;
+	double p99 = 0.0;
+	double max = 0.0;
+};
+
+/// <summary>
+/// Nearest rank percentiles of milliseconds, which gets sorted in the process.
+/// </summary>
+FrameTimeSummary summarizeFrameTimes(std::vector<double>& milliseconds);
+
+/// <summary>
+/// What one run measured. CPU frame time is start to start of consecutive frames, so it includes every wait and is what
+/// bounds throughput; GPU frame time spans the first to the last timestamp of the frame's profiler scopes.
+/// </summary>
+struct BenchmarkResult {
+	std::string scene;
+	std::string deviceName;
+	uint32_t devices = 1; // Physical devices the frames were spread over, more than one with --device-group
+	uint32_t frames = 0; // Measured, warm up excluded
+	uint32_t threads = 0;
+	bool bindless = false; // What actually ran, which may differ from what the scene asked for
+	bool gpuDriven = false;
+	bool drawBatching = false;
+	bool meshShaders = false;
+	uint32_t drawCalls = 0; // Recorded in the last frame
+	uint32_t stateChanges = 0; // Between the last frame's batches, only counted with draw batching
+	uint64_t triangles = 0; // Submitted per frame, before any culling on the GPU
+	FrameTimeSummary cpu;
+	FrameTimeSummary gpu;
+	uint64_t deviceMemoryBytes = 0; // Used out of pools plus dedicated allocations, at the end of the run
+	uint64_t deviceMemoryReserved = 0; // Pool blocks plus dedicated allocations
+	uint32_t deviceMemoryAllocations = 0;
+	uint64_t pipelineHitchFrames = 0; // Frames, warm up included, that drew with a fallback because a pipeline was compiling
+	std::vector<uint32_t> pipelineCompileHistogram; // PipelineCompilerStats::histogram, compiles by power of two milliseconds
+};
+
+/// <summary>
+/// The results as one JSON document: {"results": [...]} with times in milliseconds and memory in bytes.
+/// </summary>
+void writeBenchmarkJson(std::ostream& out, const std::vector<BenchmarkResult>& results);
@@ -0,0 +1,165 @@
+#include "BindlessDescriptors.h"
+
+#include <stdexcept>
+#include <string>
+
+uint32_t BindlessDescriptors::SlotAllocator::acquire(const char* kind) {
+	if (!freeSlots.empty()) {
+		const uint32_t index = freeSlots.back();
+		freeSlots.pop_back();
+		return index;
+	}
+
+	if (next == capacity) {
+		throw std::runtime_error(std::string("Out of bindless ") + kind + " slots!");
+	}
+	return next++;
+}
+
+void BindlessDescriptors::SlotAllocator::release(uint32_t index) {
+	freeSlots.push_back(index);
+}
+
+uint32_t BindlessDescriptors::SlotAllocator::liveCount() const {
+	return next - static_cast<uint32_t>(freeSlots.size());
+}
+
+void BindlessDescriptors::init(VkDevice device, uint32_t maxTextures, uint32_t maxStorageBuffers) {
+	this->device = device;
+	textures.capacity = maxTextures;
+	storageBuffers.capacity = maxStorageBuffers;
+
+	VkDescriptorSetLayoutBinding bindings[2]{};
+	bindings[TEXTURE_BINDING].binding = TEXTURE_BINDING;
+	bindings[TEXTURE_BINDING].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[TEXTURE_BINDING].descriptorCount = maxTextures;
+	bindings[TEXTURE_BINDING].stageFlags = VK_SHADER_STAGE_ALL;
+
+	bindings[STORAGE_BUFFER_BINDING].binding = STORAGE_BUFFER_BINDING;
+	bindings[STORAGE_BUFFER_BINDING].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	bindings[STORAGE_BUFFER_BINDING].descriptorCount = maxStorageBuffers;
+	bindings[STORAGE_BUFFER_BINDING].stageFlags = VK_SHADER_STAGE_ALL;
+
+	// Partially bound: unused slots may hold garbage as long as no shader reads them.
+	// Update after bind: registering a resource doesn't invalidate command buffers that already bound the set.
+	VkDescriptorBindingFlags bindingFlags[2] = {
+		VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT,
+		VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT
+	};
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+	bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsInfo.bindingCount = 2;
+	bindingFlagsInfo.pBindingFlags = bindingFlags;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.pNext = &bindingFlagsInfo;
+	layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	layoutInfo.bindingCount = 2;
+	layoutInfo.pBindings = bindings;
+
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create bindless descriptor set layout!");
+	}
+
+	VkDescriptorPoolSize poolSizes[2]{};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[0].descriptorCount = maxTextures;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[1].descriptorCount = maxStorageBuffers;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 2;
+	poolInfo.pPoolSizes = poolSizes;
+
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create bindless descriptor pool!");
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = pool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &setLayout;
+
+	if (vkAllocateDescriptorSets(device, &allocInfo, &set) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate bindless descriptor set!");
+	}
+}
+
+void BindlessDescriptors::cleanup() {
+	// Destroying the pool frees the set
+	vkDestroyDescriptorPool(device, pool, nullptr);
+	vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+	pool = VK_NULL_HANDLE;
+	setLayout = VK_NULL_HANDLE;
+	set = VK_NULL_HANDLE;
+}
+
+uint32_t BindlessDescriptors::addTexture(VkImageView imageView, VkSampler sampler, VkImageLayout imageLayout) {
+	std::lock_guard<std::mutex> lock(mutex);
+	const uint32_t index = textures.acquire("texture");
+
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.sampler = sampler;
+	imageInfo.imageView = imageView;
+	imageInfo.imageLayout = imageLayout;
+
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = set;
+	write.dstBinding = TEXTURE_BINDING;
+	write.dstArrayElement = index;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = &imageInfo;
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+
+	return index;
+}
+
+void BindlessDescriptors::removeTexture(uint32_t index) {
+	std::lock_guard<std::mutex> lock(mutex);
+	textures.release(index);
+}
+
+uint32_t BindlessDescriptors::addStorageBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+	std::lock_guard<std::mutex> lock(mutex);
+	const uint32_t index = storageBuffers.acquire("storage buffer");
+
+	VkDescriptorBufferInfo bufferInfo{};
+	bufferInfo.buffer = buffer;
+	bufferInfo.offset = offset;
+	bufferInfo.range = range;
+
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = set;
+	write.dstBinding = STORAGE_BUFFER_BINDING;
+	write.dstArrayElement = index;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	write.pBufferInfo = &bufferInfo;
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+
+	return index;
+}
+
+void BindlessDescriptors::removeStorageBuffer(uint32_t index) {
+	std::lock_guard<std::mutex> lock(mutex);
+	storageBuffers.release(index);
+}
+
+uint32_t BindlessDescriptors::getTextureCount() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return textures.liveCount();
+}
+
+uint32_t BindlessDescriptors::getStorageBufferCount() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return storageBuffers.liveCount();
+}
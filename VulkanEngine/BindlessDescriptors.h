@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/// <summary>
+/// One big update-after-bind descriptor set holding every texture and storage buffer the renderer knows about.
+/// It is bound once per command buffer; draws pick resources by pushing array indices, so adding a material never means
+/// another vkCmdBindDescriptorSets. Needs descriptor indexing (core in Vulkan 1.2, VK_EXT_descriptor_indexing before that).
+///
+/// Registration is thread safe. A slot handed back with remove*() may be reused straight away, so only remove a resource
+/// once no frame in flight can still be indexing it.
+/// </summary>
+class BindlessDescriptors {
+public:
+	static const uint32_t TEXTURE_BINDING = 0;
+	static const uint32_t STORAGE_BUFFER_BINDING = 1;
+
+	static const uint32_t DEFAULT_MAX_TEXTURES = 16384;
+	static const uint32_t DEFAULT_MAX_STORAGE_BUFFERS = 1024;
+
+	void init(VkDevice device, uint32_t maxTextures, uint32_t maxStorageBuffers);
+	void cleanup();
+
+	VkDescriptorSetLayout getSetLayout() const {
+		return setLayout;
+	}
+
+	VkDescriptorSet getSet() const {
+		return set;
+	}
+
+	/// <summary>
+	/// Returns the index shaders use to reach the texture in the TEXTURE_BINDING array.
+	/// </summary>
+	uint32_t addTexture(VkImageView imageView, VkSampler sampler, VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	void removeTexture(uint32_t index);
+
+	/// <summary>
+	/// Returns the index shaders use to reach the buffer in the STORAGE_BUFFER_BINDING array.
+	/// </summary>
+	uint32_t addStorageBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+	void removeStorageBuffer(uint32_t index);
+
+	uint32_t getTextureCount() const;
+	uint32_t getStorageBufferCount() const;
+
+private:
+	/// <summary>
+	/// Hands out array indices, reusing released ones first so the live range stays dense.
+	/// </summary>
+	struct SlotAllocator {
+		uint32_t capacity = 0;
+		uint32_t next = 0;
+		std::vector<uint32_t> freeSlots;
+
+		uint32_t acquire(const char* kind);
+		void release(uint32_t index);
+		uint32_t liveCount() const;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	VkDescriptorSet set = VK_NULL_HANDLE;
+
+	mutable std::mutex mutex; // vkUpdateDescriptorSets on one set needs external synchronization
+	SlotAllocator textures;
+	SlotAllocator storageBuffers;
+};
@@ -0,0 +1,438 @@
+#include "BlockSubAllocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+	uint64_t alignUp(uint64_t value, uint64_t alignment) {
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	/// <summary>
+	/// Index of the highest set bit. value must be non-zero.
+	/// </summary>
+	uint32_t highestBit(uint64_t value) {
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return static_cast<uint32_t>(index);
+#else
+		return 63u - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+	}
+
+	/// <summary>
+	/// Index of the lowest set bit. value must be non-zero.
+	/// </summary>
+	uint32_t lowestBit(uint64_t value) {
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return static_cast<uint32_t>(index);
+#else
+		return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+	}
+
+	uint64_t nextPowerOfTwo(uint64_t value) {
+		return value <= 1 ? 1 : 1ull << (highestBit(value - 1) + 1);
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Linear
+
+bool LinearSubAllocator::allocate(uint64_t size, uint64_t alignment, uint64_t& offset) {
+	size = std::max<uint64_t>(size, 1);
+
+	const uint64_t aligned = alignUp(head, alignment);
+	if (aligned + size > capacity) {
+		return false;
+	}
+
+	liveSizes[aligned] = size;
+	liveBytes += size;
+	head = aligned + size;
+
+	offset = aligned;
+	return true;
+}
+
+void LinearSubAllocator::free(uint64_t offset) {
+	auto it = liveSizes.find(offset);
+	if (it == liveSizes.end()) {
+		throw std::runtime_error("Freeing an offset the linear allocator never handed out!");
+	}
+
+	liveBytes -= it->second;
+	liveSizes.erase(it);
+
+	// Nothing alive means nothing can be overwritten, so the whole block is reusable again
+	if (liveSizes.empty()) {
+		head = 0;
+	}
+}
+
+SubAllocatorStats LinearSubAllocator::getStats() const {
+	SubAllocatorStats stats;
+	stats.capacity = capacity;
+	stats.bytesUsed = liveBytes;
+	stats.bytesWasted = head - liveBytes;
+	stats.largestFreeRange = capacity - head;
+	stats.allocationCount = static_cast<uint32_t>(liveSizes.size());
+	return stats;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Buddy
+
+BuddySubAllocator::BuddySubAllocator(uint64_t requestedCapacity) : BlockSubAllocator(0) {
+	if (requestedCapacity < MIN_BLOCK_SIZE) {
+		throw std::runtime_error("Buddy allocator capacity is smaller than its minimum block size!");
+	}
+
+	// Buddies only pair up cleanly over a power of two range, anything past that is simply not used
+	capacity = 1ull << highestBit(requestedCapacity);
+	orderCount = highestBit(capacity / MIN_BLOCK_SIZE) + 1;
+
+	freeLists.resize(orderCount);
+	freeLists[orderCount - 1].insert(0);
+}
+
+bool BuddySubAllocator::allocate(uint64_t size, uint64_t alignment, uint64_t& offset) {
+	// A block of size 2^n is always aligned to 2^n, so covering the alignment in the size covers it in the offset too
+	const uint64_t needed = nextPowerOfTwo(std::max({ size, alignment, MIN_BLOCK_SIZE }));
+	const uint32_t order = highestBit(needed / MIN_BLOCK_SIZE);
+	if (order >= orderCount) {
+		return false;
+	}
+
+	uint32_t current = order;
+	while (current < orderCount && freeLists[current].empty()) {
+		current++;
+	}
+	if (current == orderCount) {
+		return false;
+	}
+
+	uint64_t blockOffset = *freeLists[current].begin();
+	freeLists[current].erase(freeLists[current].begin());
+
+	// Split down to the requested order, keeping the lower half each time and freeing its buddy
+	while (current > order) {
+		current--;
+		freeLists[current].insert(blockOffset + blockSize(current));
+	}
+
+	live[blockOffset] = { order, size };
+	bytesUsed += size;
+	bytesReserved += blockSize(order);
+
+	offset = blockOffset;
+	return true;
+}
+
+void BuddySubAllocator::free(uint64_t offset) {
+	auto it = live.find(offset);
+	if (it == live.end()) {
+		throw std::runtime_error("Freeing an offset the buddy allocator never handed out!");
+	}
+
+	uint32_t order = it->second.order;
+	bytesUsed -= it->second.requestedSize;
+	bytesReserved -= blockSize(order);
+	live.erase(it);
+
+	// Merge with our buddy for as long as it's free too
+	while (order + 1 < orderCount) {
+		const uint64_t buddy = offset ^ blockSize(order);
+		if (freeLists[order].erase(buddy) == 0) {
+			break;
+		}
+		offset = std::min(offset, buddy);
+		order++;
+	}
+
+	freeLists[order].insert(offset);
+}
+
+SubAllocatorStats BuddySubAllocator::getStats() const {
+	SubAllocatorStats stats;
+	stats.capacity = capacity;
+	stats.bytesUsed = bytesUsed;
+	stats.bytesWasted = bytesReserved - bytesUsed;
+	stats.allocationCount = static_cast<uint32_t>(live.size());
+
+	for (uint32_t order = orderCount; order-- > 0;) {
+		if (!freeLists[order].empty()) {
+			stats.largestFreeRange = blockSize(order);
+			break;
+		}
+	}
+
+	return stats;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// TLSF
+
+TlsfSubAllocator::TlsfSubAllocator(uint64_t requestedCapacity) : BlockSubAllocator(requestedCapacity & ~(GRANULARITY - 1)) {
+	if (capacity == 0) {
+		throw std::runtime_error("TLSF allocator capacity is smaller than its granularity!");
+	}
+
+	for (auto& firstLevel : freeHeads) {
+		std::fill(std::begin(firstLevel), std::end(firstLevel), NONE);
+	}
+
+	insertFreeBlock(createBlock(0, capacity));
+}
+
+void TlsfSubAllocator::mappingInsert(uint64_t size, uint32_t& fl, uint32_t& sl) const {
+	if (size < SMALL_BLOCK_SIZE) {
+		// Small sizes get a linear class per granule so tiny allocations don't all collapse into one list
+		fl = 0;
+		sl = static_cast<uint32_t>(size / (SMALL_BLOCK_SIZE / SL_COUNT));
+	} else {
+		const uint32_t top = highestBit(size);
+		sl = static_cast<uint32_t>(size >> (top - SL_LOG2)) ^ SL_COUNT;
+		fl = top - (FL_SHIFT - 1);
+	}
+}
+
+void TlsfSubAllocator::mappingSearch(uint64_t size, uint32_t& fl, uint32_t& sl) const {
+	// Round up to the next list boundary so anything found in the list is guaranteed to be big enough
+	if (size >= SMALL_BLOCK_SIZE) {
+		size += (1ull << (highestBit(size) - SL_LOG2)) - 1;
+	}
+	mappingInsert(size, fl, sl);
+}
+
+uint32_t TlsfSubAllocator::findSuitableBlock(uint32_t& fl, uint32_t& sl) const {
+	if (fl >= FL_COUNT) {
+		return NONE;
+	}
+
+	uint32_t slMap = slBitmap[fl] & (~0u << sl);
+	if (slMap == 0) {
+		// Nothing left in this first level class, move to the smallest non-empty larger one
+		const uint64_t flMap = fl + 1 < 64 ? flBitmap & (~0ull << (fl + 1)) : 0;
+		if (flMap == 0) {
+			return NONE;
+		}
+		fl = lowestBit(flMap);
+		slMap = slBitmap[fl];
+	}
+
+	sl = lowestBit(slMap);
+	return freeHeads[fl][sl];
+}
+
+void TlsfSubAllocator::insertFreeBlock(uint32_t index) {
+	uint32_t fl, sl;
+	mappingInsert(blocks[index].size, fl, sl);
+
+	Block& block = blocks[index];
+	block.isFree = true;
+	block.prevFree = NONE;
+	block.nextFree = freeHeads[fl][sl];
+	if (block.nextFree != NONE) {
+		blocks[block.nextFree].prevFree = index;
+	}
+	freeHeads[fl][sl] = index;
+
+	flBitmap |= 1ull << fl;
+	slBitmap[fl] |= 1u << sl;
+}
+
+void TlsfSubAllocator::removeFreeBlock(uint32_t index) {
+	uint32_t fl, sl;
+	mappingInsert(blocks[index].size, fl, sl);
+
+	Block& block = blocks[index];
+	if (block.prevFree != NONE) {
+		blocks[block.prevFree].nextFree = block.nextFree;
+	}
+	if (block.nextFree != NONE) {
+		blocks[block.nextFree].prevFree = block.prevFree;
+	}
+
+	if (freeHeads[fl][sl] == index) {
+		freeHeads[fl][sl] = block.nextFree;
+		if (freeHeads[fl][sl] == NONE) {
+			slBitmap[fl] &= ~(1u << sl);
+			if (slBitmap[fl] == 0) {
+				flBitmap &= ~(1ull << fl);
+			}
+		}
+	}
+
+	block.isFree = false;
+	block.prevFree = NONE;
+	block.nextFree = NONE;
+}
+
+uint32_t TlsfSubAllocator::createBlock(uint64_t offset, uint64_t size) {
+	const Block block = { offset, size, NONE, NONE, NONE, NONE, false };
+
+	if (!unusedBlockSlots.empty()) {
+		const uint32_t index = unusedBlockSlots.back();
+		unusedBlockSlots.pop_back();
+		blocks[index] = block;
+		return index;
+	}
+
+	blocks.push_back(block);
+	return static_cast<uint32_t>(blocks.size() - 1);
+}
+
+void TlsfSubAllocator::releaseBlock(uint32_t index) {
+	unusedBlockSlots.push_back(index);
+}
+
+void TlsfSubAllocator::mergeInto(uint32_t target, uint32_t absorbed) {
+	// target must sit directly before absorbed in address order
+	blocks[target].size += blocks[absorbed].size;
+	blocks[target].nextPhysical = blocks[absorbed].nextPhysical;
+	if (blocks[absorbed].nextPhysical != NONE) {
+		blocks[blocks[absorbed].nextPhysical].prevPhysical = target;
+	}
+	releaseBlock(absorbed);
+}
+
+bool TlsfSubAllocator::allocate(uint64_t size, uint64_t alignment, uint64_t& offset) {
+	const uint64_t requestedSize = size;
+	alignment = std::max(alignment, GRANULARITY);
+	size = alignUp(std::max<uint64_t>(size, 1), GRANULARITY);
+
+	// Block offsets are always granule aligned, so this is the worst case padding we might need in front
+	const uint64_t searchSize = size + (alignment - GRANULARITY);
+	if (searchSize > capacity) {
+		return false;
+	}
+
+	uint32_t fl, sl;
+	mappingSearch(searchSize, fl, sl);
+	const uint32_t index = findSuitableBlock(fl, sl);
+	if (index == NONE) {
+		return false;
+	}
+	removeFreeBlock(index);
+
+	// Give the alignment padding back as its own free block. Its physical neighbour can't be free (it would have been
+	// merged with us), so no coalescing is needed. createBlock may grow the vector, hence the repeated indexing.
+	const uint64_t padding = alignUp(blocks[index].offset, alignment) - blocks[index].offset;
+	if (padding > 0) {
+		const uint32_t front = createBlock(blocks[index].offset, padding);
+		blocks[front].prevPhysical = blocks[index].prevPhysical;
+		blocks[front].nextPhysical = index;
+		if (blocks[index].prevPhysical != NONE) {
+			blocks[blocks[index].prevPhysical].nextPhysical = front;
+		}
+		blocks[index].prevPhysical = front;
+		blocks[index].offset += padding;
+		blocks[index].size -= padding;
+		insertFreeBlock(front);
+	}
+
+	// Same for whatever is left over at the end
+	if (blocks[index].size - size >= GRANULARITY) {
+		const uint32_t tail = createBlock(blocks[index].offset + size, blocks[index].size - size);
+		blocks[tail].prevPhysical = index;
+		blocks[tail].nextPhysical = blocks[index].nextPhysical;
+		if (blocks[index].nextPhysical != NONE) {
+			blocks[blocks[index].nextPhysical].prevPhysical = tail;
+		}
+		blocks[index].nextPhysical = tail;
+		blocks[index].size = size;
+		insertFreeBlock(tail);
+	}
+
+	offset = blocks[index].offset;
+	live[offset] = index;
+	requestedSizes[offset] = requestedSize;
+	bytesUsed += requestedSize;
+	bytesReserved += blocks[index].size;
+
+	return true;
+}
+
+void TlsfSubAllocator::free(uint64_t offset) {
+	auto it = live.find(offset);
+	if (it == live.end()) {
+		throw std::runtime_error("Freeing an offset the TLSF allocator never handed out!");
+	}
+
+	uint32_t index = it->second;
+	live.erase(it);
+
+	auto sizeIt = requestedSizes.find(offset);
+	bytesUsed -= sizeIt->second;
+	requestedSizes.erase(sizeIt);
+	bytesReserved -= blocks[index].size;
+
+	// Coalesce with free physical neighbours straight away so free space never sits in adjacent pieces
+	const uint32_t prev = blocks[index].prevPhysical;
+	if (prev != NONE && blocks[prev].isFree) {
+		removeFreeBlock(prev);
+		mergeInto(prev, index);
+		index = prev;
+	}
+
+	const uint32_t next = blocks[index].nextPhysical;
+	if (next != NONE && blocks[next].isFree) {
+		removeFreeBlock(next);
+		mergeInto(index, next);
+	}
+
+	insertFreeBlock(index);
+}
+
+SubAllocatorStats TlsfSubAllocator::getStats() const {
+	SubAllocatorStats stats;
+	stats.capacity = capacity;
+	stats.bytesUsed = bytesUsed;
+	stats.bytesWasted = bytesReserved - bytesUsed;
+	stats.allocationCount = static_cast<uint32_t>(live.size());
+
+	// The largest free block lives in the highest non-empty list, but sizes vary within a list so scan it
+	if (flBitmap != 0) {
+		const uint32_t fl = highestBit(flBitmap);
+		const uint32_t sl = highestBit(slBitmap[fl]);
+		for (uint32_t index = freeHeads[fl][sl]; index != NONE; index = blocks[index].nextFree) {
+			stats.largestFreeRange = std::max(stats.largestFreeRange, blocks[index].size);
+		}
+	}
+
+	return stats;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+const char* poolStrategyName(PoolStrategy strategy) {
+	switch (strategy) {
+	case PoolStrategy::Linear:
+		return "linear";
+	case PoolStrategy::Buddy:
+		return "buddy";
+	case PoolStrategy::Tlsf:
+		return "tlsf";
+	}
+	return "unknown";
+}
+
+std::unique_ptr<BlockSubAllocator> createSubAllocator(PoolStrategy strategy, uint64_t capacity) {
+	switch (strategy) {
+	case PoolStrategy::Linear:
+		return std::make_unique<LinearSubAllocator>(capacity);
+	case PoolStrategy::Buddy:
+		return std::make_unique<BuddySubAllocator>(capacity);
+	case PoolStrategy::Tlsf:
+		return std::make_unique<TlsfSubAllocator>(capacity);
+	}
+	throw std::runtime_error("Unknown pool strategy!");
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/// <summary>
+/// Point in time numbers for a single sub-allocated block. "Wasted" is space that is neither handed out nor reusable
+/// right now: alignment padding, buddy rounding, and bytes a linear allocator can't reclaim until it is reset.
+/// </summary>
+struct SubAllocatorStats {
+	uint64_t capacity = 0;
+	uint64_t bytesUsed = 0;
+	uint64_t bytesWasted = 0;
+	uint64_t largestFreeRange = 0;
+	uint32_t allocationCount = 0;
+
+	uint64_t bytesFree() const {
+		return capacity - bytesUsed - bytesWasted;
+	}
+
+	/// <summary>
+	/// 0 when all free space is one contiguous range, approaching 1 as it gets chopped up into pieces too small to use.
+	/// </summary>
+	double fragmentation() const {
+		const uint64_t free = bytesFree();
+		return free == 0 ? 0.0 : 1.0 - static_cast<double>(largestFreeRange) / static_cast<double>(free);
+	}
+};
+
+/// <summary>
+/// Hands out offsets inside a fixed size range. Knows nothing about Vulkan, DeviceMemoryAllocator maps one of these onto
+/// every VkDeviceMemory block it owns.
+/// </summary>
+class BlockSubAllocator {
+public:
+	explicit BlockSubAllocator(uint64_t capacity) : capacity(capacity) {}
+	virtual ~BlockSubAllocator() = default;
+
+	/// <summary>
+	/// Find room for size bytes at the given power of two alignment. Returns false when the block can't fit it.
+	/// </summary>
+	virtual bool allocate(uint64_t size, uint64_t alignment, uint64_t& offset) = 0;
+	virtual void free(uint64_t offset) = 0;
+	virtual SubAllocatorStats getStats() const = 0;
+
+	uint64_t getCapacity() const {
+		return capacity;
+	}
+
+	bool isEmpty() const {
+		return getStats().allocationCount == 0;
+	}
+
+protected:
+	uint64_t capacity;
+};
+
+/// <summary>
+/// Bump pointer. Allocation is a single add, individual frees only drop a counter and the space comes back all at once
+/// when the last live allocation is released. Meant for short lived data that dies together (staging, per frame).
+/// </summary>
+class LinearSubAllocator : public BlockSubAllocator {
+public:
+	explicit LinearSubAllocator(uint64_t capacity) : BlockSubAllocator(capacity) {}
+
+	bool allocate(uint64_t size, uint64_t alignment, uint64_t& offset) override;
+	void free(uint64_t offset) override;
+	SubAllocatorStats getStats() const override;
+
+private:
+	uint64_t head = 0;
+	uint64_t liveBytes = 0;
+	std::unordered_map<uint64_t, uint64_t> liveSizes; // offset -> size
+};
+
+/// <summary>
+/// Binary buddy system over a power of two capacity. Constant time-ish and fragmentation resistant, at the price of
+/// rounding every request up to a power of two. Good for uniformly sized resources such as render targets.
+/// </summary>
+class BuddySubAllocator : public BlockSubAllocator {
+public:
+	static constexpr uint64_t MIN_BLOCK_SIZE = 256;
+
+	explicit BuddySubAllocator(uint64_t capacity);
+
+	bool allocate(uint64_t size, uint64_t alignment, uint64_t& offset) override;
+	void free(uint64_t offset) override;
+	SubAllocatorStats getStats() const override;
+
+private:
+	struct LiveAllocation {
+		uint32_t order;
+		uint64_t requestedSize;
+	};
+
+	uint64_t blockSize(uint32_t order) const {
+		return MIN_BLOCK_SIZE << order;
+	}
+
+	uint32_t orderCount;
+	std::vector<std::unordered_set<uint64_t>> freeLists; // One per order, keyed by offset so buddies can be found in O(1)
+	std::unordered_map<uint64_t, LiveAllocation> live;
+	uint64_t bytesUsed = 0;
+	uint64_t bytesReserved = 0;
+};
+
+/// <summary>
+/// Two-level segregated fit (Masmano et al.). O(1) allocate and free with immediate coalescing and low fragmentation for
+/// mixed sizes, which makes it the default for meshes, buffers and textures.
+/// </summary>
+class TlsfSubAllocator : public BlockSubAllocator {
+public:
+	explicit TlsfSubAllocator(uint64_t capacity);
+
+	bool allocate(uint64_t size, uint64_t alignment, uint64_t& offset) override;
+	void free(uint64_t offset) override;
+	SubAllocatorStats getStats() const override;
+
+private:
+	static constexpr uint32_t SL_LOG2 = 5;
+	static constexpr uint32_t SL_COUNT = 1u << SL_LOG2;
+	static constexpr uint32_t GRANULARITY_LOG2 = 4;
+	static constexpr uint64_t GRANULARITY = 1ull << GRANULARITY_LOG2; // Every size and offset is a multiple of this
+	static constexpr uint32_t FL_SHIFT = SL_LOG2 + GRANULARITY_LOG2;
+	static constexpr uint64_t SMALL_BLOCK_SIZE = 1ull << FL_SHIFT; // Below this the first level is linear instead of logarithmic
+	static constexpr uint32_t FL_COUNT = 64 - FL_SHIFT + 1;
+	static constexpr uint32_t NONE = UINT32_MAX;
+
+	struct Block {
+		uint64_t offset;
+		uint64_t size;
+		uint32_t prevPhysical; // Neighbours in address order, for coalescing
+		uint32_t nextPhysical;
+		uint32_t prevFree; // Neighbours in the segregated free list this block sits in
+		uint32_t nextFree;
+		bool isFree;
+	};
+
+	void mappingInsert(uint64_t size, uint32_t& fl, uint32_t& sl) const;
+	void mappingSearch(uint64_t size, uint32_t& fl, uint32_t& sl) const;
+	uint32_t findSuitableBlock(uint32_t& fl, uint32_t& sl) const;
+	void insertFreeBlock(uint32_t index);
+	void removeFreeBlock(uint32_t index);
+	uint32_t createBlock(uint64_t offset, uint64_t size);
+	void releaseBlock(uint32_t index);
+	void mergeInto(uint32_t target, uint32_t absorbed);
+
+	std::vector<Block> blocks;
+	std::vector<uint32_t> unusedBlockSlots;
+	uint64_t flBitmap = 0;
+	uint32_t slBitmap[FL_COUNT] = {};
+	uint32_t freeHeads[FL_COUNT][SL_COUNT];
+	std::unordered_map<uint64_t, uint32_t> live; // offset handed out -> block index
+	std::unordered_map<uint64_t, uint64_t> requestedSizes; // offset handed out -> size the caller asked for
+	uint64_t bytesUsed = 0;
+	uint64_t bytesReserved = 0;
+};
+
+enum class PoolStrategy {
+	Linear,
+	Buddy,
+	Tlsf
+};
+
+const char* poolStrategyName(PoolStrategy strategy);
+
+std::unique_ptr<BlockSubAllocator> createSubAllocator(PoolStrategy strategy, uint64_t capacity);
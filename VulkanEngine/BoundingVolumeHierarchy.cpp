@@ -0,0 +1,213 @@
+#include "BoundingVolumeHierarchy.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <numeric>
+
+namespace {
+	float surfaceArea(const glm::vec3& min, const glm::vec3& max) {
+		const glm::vec3 size = max - min;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	double millisecondsSince(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+void BoundingVolumeHierarchy::build(const SceneStore& scene) {
+	const auto start = std::chrono::steady_clock::now();
+	const SceneStore::BoundsColumns columns = scene.getWorldBoundsColumns();
+
+	slots.resize(columns.count);
+	std::iota(slots.begin(), slots.end(), 0u);
+	for (int axis = 0; axis < 3; axis++) {
+		centroids[axis].resize(columns.count);
+		for (uint32_t slot = 0; slot < columns.count; slot++) {
+			centroids[axis][slot] = 0.5f * (columns.min[axis][slot] + columns.max[axis][slot]);
+		}
+	}
+
+	nodes.clear();
+	stats.depth = 0;
+	stats.leaves = 0;
+	if (columns.count > 0) {
+		buildNode(0, columns.count, 1);
+	}
+	stats.nodes = static_cast<uint32_t>(nodes.size());
+
+	entities.resize(columns.count);
+	for (uint32_t i = 0; i < columns.count; i++) {
+		entities[i] = columns.entities[slots[i]];
+	}
+	gatherBoxes(scene);
+	refitNodes();
+
+	layoutVersion = scene.getLayoutVersion();
+	builtArea = totalArea();
+	stats.builds++;
+	stats.lastBuildMilliseconds = millisecondsSince(start);
+}
+
+uint32_t BoundingVolumeHierarchy::buildNode(uint32_t begin, uint32_t end, uint32_t depth) {
+	const uint32_t index = static_cast<uint32_t>(nodes.size());
+	nodes.push_back({ glm::vec3(0.0f), glm::vec3(0.0f), begin, end - begin, 0 });
+	stats.depth = std::max(stats.depth, depth);
+
+	if (end - begin <= LEAF_SIZE || depth >= MAX_DEPTH) {
+		stats.leaves++;
+		return index;
+	}
+
+	// Split where the centroids are spread out the most. The median keeps the tree balanced whatever the distribution.
+	glm::vec3 low(centroids[0][slots[begin]], centroids[1][slots[begin]], centroids[2][slots[begin]]);
+	glm::vec3 high = low;
+	for (uint32_t i = begin + 1; i < end; i++) {
+		const glm::vec3 centroid(centroids[0][slots[i]], centroids[1][slots[i]], centroids[2][slots[i]]);
+		low = glm::min(low, centroid);
+		high = glm::max(high, centroid);
+	}
+	const glm::vec3 spread = high - low;
+	const int axis = spread.x >= spread.y && spread.x >= spread.z ? 0 : (spread.y >= spread.z ? 1 : 2);
+
+	const uint32_t middle = begin + (end - begin) / 2;
+	std::nth_element(slots.begin() + begin, slots.begin() + middle, slots.begin() + end,
+		[this, axis](uint32_t a, uint32_t b) { return centroids[axis][a] < centroids[axis][b]; });
+
+	buildNode(begin, middle, depth + 1);
+	const uint32_t secondChild = buildNode(middle, end, depth + 1);
+	nodes[index].secondChild = secondChild; // Not through a reference, the recursion may have reallocated nodes
+	return index;
+}
+
+void BoundingVolumeHierarchy::gatherBoxes(const SceneStore& scene) {
+	const SceneStore::BoundsColumns columns = scene.getWorldBoundsColumns();
+	for (int axis = 0; axis < 3; axis++) {
+		boxMin[axis].resize(slots.size());
+		boxMax[axis].resize(slots.size());
+		for (size_t i = 0; i < slots.size(); i++) {
+			boxMin[axis][i] = columns.min[axis][slots[i]];
+			boxMax[axis][i] = columns.max[axis][slots[i]];
+		}
+	}
+}
+
+void BoundingVolumeHierarchy::refitNodes() {
+	for (size_t i = nodes.size(); i-- > 0;) {
+		Node& node = nodes[i];
+		if (node.secondChild == 0) {
+			node.min = glm::vec3(boxMin[0][node.firstBox], boxMin[1][node.firstBox], boxMin[2][node.firstBox]);
+			node.max = glm::vec3(boxMax[0][node.firstBox], boxMax[1][node.firstBox], boxMax[2][node.firstBox]);
+			for (uint32_t box = node.firstBox + 1; box < node.firstBox + node.boxCount; box++) {
+				node.min = glm::min(node.min, glm::vec3(boxMin[0][box], boxMin[1][box], boxMin[2][box]));
+				node.max = glm::max(node.max, glm::vec3(boxMax[0][box], boxMax[1][box], boxMax[2][box]));
+			}
+		} else {
+			const Node& first = nodes[i + 1];
+			const Node& second = nodes[node.secondChild];
+			node.min = glm::min(first.min, second.min);
+			node.max = glm::max(first.max, second.max);
+		}
+	}
+}
+
+float BoundingVolumeHierarchy::totalArea() const {
+	float area = 0.0f;
+	for (const Node& node : nodes) {
+		area += surfaceArea(node.min, node.max);
+	}
+	return area;
+}
+
+void BoundingVolumeHierarchy::refit(const SceneStore& scene) {
+	const auto start = std::chrono::steady_clock::now();
+	gatherBoxes(scene);
+	refitNodes();
+	stats.refits++;
+	stats.lastRefitMilliseconds = millisecondsSince(start);
+}
+
+void BoundingVolumeHierarchy::update(const SceneStore& scene) {
+	if (nodes.empty() || scene.getLayoutVersion() != layoutVersion) {
+		build(scene);
+		return;
+	}
+
+	refit(scene);
+	if (totalArea() > REBUILD_RATIO * builtArea) {
+		build(scene);
+	}
+}
+
+void BoundingVolumeHierarchy::cull(const Frustum& frustum, std::vector<SceneStore::EntityId>& visible) {
+	stats.lastNodesVisited = 0;
+	stats.lastBoxesTested = 0;
+	if (nodes.empty()) {
+		return;
+	}
+
+	SceneStore::BoundsColumns columns;
+	for (int axis = 0; axis < 3; axis++) {
+		columns.min[axis] = boxMin[axis].data();
+		columns.max[axis] = boxMax[axis].data();
+	}
+	columns.entities = entities.data();
+	columns.count = static_cast<uint32_t>(entities.size());
+
+	// The node and the planes it still straddles as a bit mask
+	struct Entry {
+		uint32_t node;
+		uint32_t planes;
+	};
+	Entry stack[MAX_DEPTH + 1];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = { 0, (1u << 6) - 1 };
+
+	while (stackSize > 0) {
+		const Entry entry = stack[--stackSize];
+		const Node& node = nodes[entry.node];
+		stats.lastNodesVisited++;
+
+		uint32_t planes = entry.planes;
+		bool outside = false;
+		for (int i = 0; i < 6 && !outside; i++) {
+			if ((planes & (1u << i)) == 0) {
+				continue;
+			}
+
+			// The corner furthest along the normal decides outside, the one furthest against it decides inside
+			const glm::vec4& plane = frustum.planes[i];
+			const glm::vec3 normal(plane.x, plane.y, plane.z);
+			const glm::vec3 furthest(plane.x >= 0.0f ? node.max.x : node.min.x, plane.y >= 0.0f ? node.max.y : node.min.y,
+				plane.z >= 0.0f ? node.max.z : node.min.z);
+			const glm::vec3 nearest(plane.x >= 0.0f ? node.min.x : node.max.x, plane.y >= 0.0f ? node.min.y : node.max.y,
+				plane.z >= 0.0f ? node.min.z : node.max.z);
+			if (glm::dot(normal, furthest) + plane.w < 0.0f) {
+				outside = true;
+			} else if (glm::dot(normal, nearest) + plane.w >= 0.0f) {
+				planes &= ~(1u << i);
+			}
+		}
+
+		if (outside) {
+			continue;
+		}
+		if (planes == 0) {
+			visible.insert(visible.end(), entities.begin() + node.firstBox, entities.begin() + node.firstBox + node.boxCount);
+		} else if (node.secondChild == 0) {
+			cullSimd(columns, node.firstBox, node.firstBox + node.boxCount, frustum, visible);
+			stats.lastBoxesTested += node.boxCount;
+		} else {
+			stack[stackSize++] = { node.secondChild, planes };
+			stack[stackSize++] = { entry.node + 1, planes };
+		}
+	}
+}
+
+void BoundingVolumeHierarchy::printStats(std::ostream& out) const {
+	out << stats.nodes << " nodes, " << stats.leaves << " leaves, depth " << stats.depth << ", " << stats.builds << " builds (last "
+		<< std::fixed << std::setprecision(3) << stats.lastBuildMilliseconds << " ms), " << stats.refits << " refits (last "
+		<< stats.lastRefitMilliseconds << " ms), " << stats.lastNodesVisited << " nodes visited and " << stats.lastBoxesTested
+		<< " boxes tested by the last cull";
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "FrustumCulling.h"
+#include "SceneStore.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+struct BoundingVolumeHierarchyStats {
+	uint32_t nodes = 0;
+	uint32_t leaves = 0;
+	uint32_t depth = 0;
+	uint32_t builds = 0;
+	uint32_t refits = 0;
+	uint32_t lastNodesVisited = 0; // By the last cull()
+	uint32_t lastBoxesTested = 0; // Boxes of partially visible leaves, the only ones tested one by one
+	double lastBuildMilliseconds = 0.0;
+	double lastRefitMilliseconds = 0.0;
+};
+
+/// <summary>
+/// Binary tree of boxes over a SceneStore's world bounds, so culling a big scene touches the parts that are near the
+/// frustum's boundary instead of every box. build() splits at the median of the longest axis down to LEAF_SIZE boxes
+/// per leaf. Each subtree's boxes are contiguous, copied into the tree's own columns in leaf order, so a leaf is a
+/// single cullSimd() call and a subtree that is entirely inside is appended in one go.
+///
+/// When the scene moves, refit() recomputes every node's box bottom up and keeps the tree. That is linear and cheap, but
+/// a tree that was built for one arrangement gets looser as things move around, so update() rebuilds once the total node
+/// surface area has grown past REBUILD_RATIO times what the last build produced, and whenever the scene's slots changed.
+/// Not thread safe.
+/// </summary>
+class BoundingVolumeHierarchy {
+public:
+	static const uint32_t LEAF_SIZE = 8;
+	static constexpr float REBUILD_RATIO = 2.0f;
+
+	void build(const SceneStore& scene);
+	void refit(const SceneStore& scene);
+
+	/// <summary>
+	/// Build on first use or after the scene's layout changed, refit otherwise, rebuilding if that loosened the tree too far.
+	/// Call after SceneStore::update() did something.
+	/// </summary>
+	void update(const SceneStore& scene);
+
+	/// <summary>
+	/// Append the entity of every box that isn't entirely outside frustum, same result as cullBruteForce() in another order.
+	/// Planes a node is entirely inside of aren't tested again for the nodes below it; leaves that still straddle one test
+	/// their boxes against all six.
+	/// </summary>
+	void cull(const Frustum& frustum, std::vector<SceneStore::EntityId>& visible);
+
+	const BoundingVolumeHierarchyStats& getStats() const {
+		return stats;
+	}
+
+	void printStats(std::ostream& out) const;
+
+private:
+	// Children of an interior node are the next node and secondChild. A subtree's boxes are [firstBox, firstBox + boxCount).
+	struct Node {
+		glm::vec3 min;
+		glm::vec3 max;
+		uint32_t firstBox;
+		uint32_t boxCount;
+		uint32_t secondChild; // 0 for leaves, the root can't be anybody's child
+	};
+
+	// Deep enough for any tree build() makes: it halves every level and stops at LEAF_SIZE
+	static const uint32_t MAX_DEPTH = 64;
+
+	uint32_t buildNode(uint32_t begin, uint32_t end, uint32_t depth);
+	void gatherBoxes(const SceneStore& scene);
+	void refitNodes();
+	float totalArea() const;
+
+	std::vector<Node> nodes; // Depth first, so children always come after their parent
+	std::vector<uint32_t> slots; // Scene slot of each box, in leaf order
+	std::vector<float> centroids[3]; // Scratch space for build(), by scene slot
+	std::vector<float> boxMin[3]; // Box columns in leaf order
+	std::vector<float> boxMax[3];
+	std::vector<SceneStore::EntityId> entities;
+
+	uint32_t layoutVersion = UINT32_MAX; // What the scene's was at the last build()
+	float builtArea = 0.0f;
+
+	BoundingVolumeHierarchyStats stats;
+};
@@ -0,0 +1,262 @@
+#include "CapabilityRegistry.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+void CapabilityRegistry::queryInstance() {
+	// vkEnumerateInstanceVersion doesn't exist on a 1.0 loader, so it has to be looked up rather than called directly
+	auto enumerateInstanceVersion = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion"));
+	instanceVersion = VK_API_VERSION_1_0;
+	if (enumerateInstanceVersion) {
+		enumerateInstanceVersion(&instanceVersion);
+	}
+
+	uint32_t layerCount = 0;
+	vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
+	layers.resize(layerCount);
+	vkEnumerateInstanceLayerProperties(&layerCount, layers.data());
+	layers.resize(layerCount);
+
+	// Views point into layers and instanceExtensions, which are never touched again after this
+	layerNames.clear();
+	layerNames.reserve(layers.size());
+	for (const auto& layer : layers) {
+		layerNames.insert(layer.layerName);
+	}
+
+	uint32_t extensionCount = 0;
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+	instanceExtensions.resize(extensionCount);
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, instanceExtensions.data());
+	instanceExtensions.resize(extensionCount);
+
+	instanceExtensionNames.clear();
+	instanceExtensionNames.reserve(instanceExtensions.size());
+	for (const auto& extension : instanceExtensions) {
+		instanceExtensionNames.insert(extension.extensionName);
+	}
+}
+
+void CapabilityRegistry::queryDevice(VkPhysicalDevice physicalDevice, uint32_t instanceApiVersion) {
+	if (devices.count(physicalDevice)) {
+		return;
+	}
+
+	// Fill the entry in place; map nodes don't move, so the views stay valid
+	DeviceCapabilities& device = devices[physicalDevice];
+	deviceOrder.push_back(physicalDevice);
+
+	vkGetPhysicalDeviceProperties(physicalDevice, &device.properties);
+	vkGetPhysicalDeviceFeatures(physicalDevice, &device.features);
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &device.memoryProperties);
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	device.queueFamilies.resize(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, device.queueFamilies.data());
+
+	uint32_t extensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+	device.extensions.resize(extensionCount);
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, device.extensions.data());
+	device.extensions.resize(extensionCount);
+
+	device.extensionNames.reserve(device.extensions.size());
+	for (const auto& extension : device.extensions) {
+		device.extensionNames.insert(extension.extensionName);
+	}
+
+	// The feature structs may only be chained when the device knows them: core in 1.2, or through the extension on 1.1
+	const uint32_t apiVersion = std::min(instanceApiVersion, device.properties.apiVersion);
+	auto hasPromotedExtension = [&](const char* extensionName) {
+		return apiVersion >= VK_API_VERSION_1_2 || (apiVersion >= VK_API_VERSION_1_1 && device.extensionNames.count(extensionName));
+	};
+	const bool hasDescriptorIndexing = hasPromotedExtension(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+	const bool hasTimelineSemaphore = hasPromotedExtension(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+	// Core from 1.3, but the engine keeps enabling it as the extension, which 1.3 drivers still expose
+	const bool hasSynchronization2 = apiVersion >= VK_API_VERSION_1_1 && device.extensionNames.count(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+	// Mesh shaders are SPIR-V 1.4, which is core in 1.2; not worth also handling VK_KHR_spirv_1_4 on 1.1
+	const bool hasMeshShader = apiVersion >= VK_API_VERSION_1_2 && device.extensionNames.count(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+	// The extension needs VK_KHR_depth_stencil_resolve and VK_KHR_create_renderpass2, only handled where those are core
+	const bool hasDynamicRendering = apiVersion >= VK_API_VERSION_1_3 ||
+		(apiVersion >= VK_API_VERSION_1_2 && device.extensionNames.count(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME));
+	auto hasExtension = [&](const char* extensionName) {
+		return apiVersion >= VK_API_VERSION_1_1 && device.extensionNames.count(extensionName) != 0;
+	};
+	const bool hasExtendedDynamicState = hasExtension(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+	const bool hasExtendedDynamicState2 = hasExtension(VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME);
+	const bool hasExtendedDynamicState3 = hasExtension(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
+
+	void* featureChain = nullptr;
+	if (hasTimelineSemaphore) {
+		device.timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+		device.timelineSemaphoreFeatures.pNext = featureChain;
+		featureChain = &device.timelineSemaphoreFeatures;
+	}
+	if (hasSynchronization2) {
+		device.synchronization2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+		device.synchronization2Features.pNext = featureChain;
+		featureChain = &device.synchronization2Features;
+	}
+	if (hasDescriptorIndexing) {
+		device.descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+		device.descriptorIndexingFeatures.pNext = featureChain;
+		featureChain = &device.descriptorIndexingFeatures;
+	}
+	if (hasMeshShader) {
+		device.meshShaderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+		device.meshShaderFeatures.pNext = featureChain;
+		featureChain = &device.meshShaderFeatures;
+	}
+	if (hasDynamicRendering) {
+		device.dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
+		device.dynamicRenderingFeatures.pNext = featureChain;
+		featureChain = &device.dynamicRenderingFeatures;
+	}
+	if (hasExtendedDynamicState) {
+		device.extendedDynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+		device.extendedDynamicStateFeatures.pNext = featureChain;
+		featureChain = &device.extendedDynamicStateFeatures;
+	}
+	if (hasExtendedDynamicState2) {
+		device.extendedDynamicState2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_2_FEATURES_EXT;
+		device.extendedDynamicState2Features.pNext = featureChain;
+		featureChain = &device.extendedDynamicState2Features;
+	}
+	if (hasExtendedDynamicState3) {
+		device.extendedDynamicState3Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+		device.extendedDynamicState3Features.pNext = featureChain;
+		featureChain = &device.extendedDynamicState3Features;
+	}
+
+	if (featureChain) {
+		VkPhysicalDeviceFeatures2 features2{};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features2.pNext = featureChain;
+		vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+		// Handed out by reference, so don't leave them pointing at each other
+		device.descriptorIndexingFeatures.pNext = nullptr;
+		device.timelineSemaphoreFeatures.pNext = nullptr;
+		device.synchronization2Features.pNext = nullptr;
+		device.meshShaderFeatures.pNext = nullptr;
+		device.dynamicRenderingFeatures.pNext = nullptr;
+		device.extendedDynamicStateFeatures.pNext = nullptr;
+		device.extendedDynamicState2Features.pNext = nullptr;
+		device.extendedDynamicState3Features.pNext = nullptr;
+	}
+
+	if (hasDescriptorIndexing) {
+		device.descriptorIndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+		VkPhysicalDeviceProperties2 properties2{};
+		properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties2.pNext = &device.descriptorIndexingProperties;
+		vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+		device.descriptorIndexingProperties.pNext = nullptr;
+	}
+
+	if (hasMeshShader) {
+		device.meshShaderProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_PROPERTIES_EXT;
+		VkPhysicalDeviceProperties2 properties2{};
+		properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties2.pNext = &device.meshShaderProperties;
+		vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+		device.meshShaderProperties.pNext = nullptr;
+	}
+}
+
+bool CapabilityRegistry::hasLayer(std::string_view name) const {
+	return layerNames.count(name) != 0;
+}
+
+bool CapabilityRegistry::hasInstanceExtension(std::string_view name) const {
+	return instanceExtensionNames.count(name) != 0;
+}
+
+bool CapabilityRegistry::hasDeviceExtension(VkPhysicalDevice physicalDevice, std::string_view name) const {
+	return getDevice(physicalDevice).extensionNames.count(name) != 0;
+}
+
+const VkPhysicalDeviceProperties& CapabilityRegistry::getDeviceProperties(VkPhysicalDevice physicalDevice) const {
+	return getDevice(physicalDevice).properties;
+}
+
+const VkPhysicalDeviceFeatures& CapabilityRegistry::getDeviceFeatures(VkPhysicalDevice physicalDevice) const {
+	return getDevice(physicalDevice).features;
+}
+
+const VkPhysicalDeviceMemoryProperties& CapabilityRegistry::getMemoryProperties(VkPhysicalDevice physicalDevice) const {
+	return getDevice(physicalDevice).memoryProperties;
+}
+
+const std::vector<VkQueueFamilyProperties>& CapabilityRegistry::getQueueFamilies(VkPhysicalDevice physicalDevice) const {
+	return getDevice(physicalDevice).queueFamilies;
+}
+
+const VkPhysicalDeviceDescriptorIndexingFeatures& CapabilityRegistry::getDescriptorIndexingFeatures(VkPhysicalDevice physicalDevice) const {
+	return getDevice(physicalDevice).descriptorIndexingFeatures;
+}
+
+const VkPhysicalDeviceTimelineSemaphoreFeatures& CapabilityRegistry::getTimelineSemaphoreFeatures(VkPhysicalDevice physicalDevice) const {
+	return getDevice(physicalDevice).timelineSemaphoreFeatures;
+}
+
+const VkPhysicalDeviceSynchronization2FeaturesKHR& CapabilityRegistry::getSynchronization2Features(VkPhysicalDevice physicalDevice) const {
+	return getDevice(physicalDevice).synchronization2Features;
+}
+
+const VkPhysicalDeviceMeshShaderFeaturesEXT& CapabilityRegistry::getMeshShaderFeatures(VkPhysicalDevice physicalDevice) const {
+	return getDevice(physicalDevice).meshShaderFeatures;
+}
+
+const VkPhysicalDeviceMeshShaderPropertiesEXT& CapabilityRegistry::getMeshShaderProperties(VkPhysicalDevice physicalDevice) const {
+	return getDevice(physicalDevice).meshShaderProperties;
+}
+
+const VkPhysicalDeviceDynamicRenderingFeatures& CapabilityRegistry::getDynamicRenderingFeatures(VkPhysicalDevice physicalDevice) const {
+	return getDevice(physicalDevice).dynamicRenderingFeatures;
+}
+
+const VkPhysicalDeviceExtendedDynamicStateFeaturesEXT& CapabilityRegistry::getExtendedDynamicStateFeatures(VkPhysicalDevice physicalDevice) const {
+	return getDevice(physicalDevice).extendedDynamicStateFeatures;
+}
+
+const VkPhysicalDeviceExtendedDynamicState2FeaturesEXT& CapabilityRegistry::getExtendedDynamicState2Features(VkPhysicalDevice physicalDevice) const {
+	return getDevice(physicalDevice).extendedDynamicState2Features;
+}
+
+const VkPhysicalDeviceExtendedDynamicState3FeaturesEXT& CapabilityRegistry::getExtendedDynamicState3Features(VkPhysicalDevice physicalDevice) const {
+	return getDevice(physicalDevice).extendedDynamicState3Features;
+}
+
+const VkPhysicalDeviceDescriptorIndexingProperties& CapabilityRegistry::getDescriptorIndexingProperties(VkPhysicalDevice physicalDevice) const {
+	return getDevice(physicalDevice).descriptorIndexingProperties;
+}
+
+const CapabilityRegistry::DeviceCapabilities& CapabilityRegistry::getDevice(VkPhysicalDevice physicalDevice) const {
+	auto it = devices.find(physicalDevice);
+	if (it == devices.end()) {
+		throw std::logic_error("Physical device capabilities queried before queryDevice()!");
+	}
+	return it->second;
+}
+
+void CapabilityRegistry::print(std::ostream& out) const {
+	out << "Instance layers:\n";
+	for (const auto& layer : layers) {
+		out << '\t' << layer.layerName << '\n';
+	}
+
+	out << "Instance extensions:\n";
+	for (const auto& extension : instanceExtensions) {
+		out << '\t' << extension.extensionName << '\n';
+	}
+
+	for (VkPhysicalDevice physicalDevice : deviceOrder) {
+		const DeviceCapabilities& device = devices.at(physicalDevice);
+		out << "Device extensions (" << device.properties.deviceName << "):\n";
+		for (const auto& extension : device.extensions) {
+			out << '\t' << extension.extensionName << '\n';
+		}
+	}
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <ostream>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/// <summary>
+/// Everything Vulkan can tell us about what's supported, enumerated once and kept in hashed sets so the rest of the engine
+/// can ask "is X there" in O(1) without allocating. The sets hold views into the property arrays Vulkan filled in, so
+/// lookups by const char* or string_view never build a std::string.
+///
+/// The query functions are not thread safe. Lookups are, once the queries they depend on have finished.
+/// </summary>
+class CapabilityRegistry {
+public:
+	/// <summary>
+	/// Enumerate instance layers and extensions and the loader's version. Needs no instance, so it runs before
+	/// createInstance() picks what to enable.
+	/// </summary>
+	void queryInstance();
+
+	/// <summary>
+	/// Enumerate the extensions, features and properties of physicalDevice. Results are kept per device.
+	/// instanceApiVersion is what the instance was created with; the extended feature structs need 1.1 on both sides.
+	/// </summary>
+	void queryDevice(VkPhysicalDevice physicalDevice, uint32_t instanceApiVersion);
+
+	/// <summary>
+	/// Highest instance version the loader supports, VK_API_VERSION_1_0 for a 1.0 loader.
+	/// </summary>
+	uint32_t getInstanceVersion() const {
+		return instanceVersion;
+	}
+
+	bool hasLayer(std::string_view name) const;
+	bool hasInstanceExtension(std::string_view name) const;
+	bool hasDeviceExtension(VkPhysicalDevice physicalDevice, std::string_view name) const;
+
+	const VkPhysicalDeviceProperties& getDeviceProperties(VkPhysicalDevice physicalDevice) const;
+	const VkPhysicalDeviceFeatures& getDeviceFeatures(VkPhysicalDevice physicalDevice) const;
+	const VkPhysicalDeviceMemoryProperties& getMemoryProperties(VkPhysicalDevice physicalDevice) const;
+	const std::vector<VkQueueFamilyProperties>& getQueueFamilies(VkPhysicalDevice physicalDevice) const;
+
+	/// <summary>
+	/// All false / zero when the device has neither Vulkan 1.2 nor VK_EXT_descriptor_indexing.
+	/// </summary>
+	const VkPhysicalDeviceDescriptorIndexingFeatures& getDescriptorIndexingFeatures(VkPhysicalDevice physicalDevice) const;
+	const VkPhysicalDeviceDescriptorIndexingProperties& getDescriptorIndexingProperties(VkPhysicalDevice physicalDevice) const;
+
+	/// <summary>
+	/// All false when the device has neither Vulkan 1.2 nor VK_KHR_timeline_semaphore.
+	/// </summary>
+	const VkPhysicalDeviceTimelineSemaphoreFeatures& getTimelineSemaphoreFeatures(VkPhysicalDevice physicalDevice) const;
+
+	/// <summary>
+	/// All false when the device lacks VK_KHR_synchronization2 (or Vulkan 1.1 to query it through).
+	/// </summary>
+	const VkPhysicalDeviceSynchronization2FeaturesKHR& getSynchronization2Features(VkPhysicalDevice physicalDevice) const;
+
+	/// <summary>
+	/// All false / zero when the device lacks VK_EXT_mesh_shader, or Vulkan 1.2 for the SPIR-V 1.4 its shaders need.
+	/// </summary>
+	const VkPhysicalDeviceMeshShaderFeaturesEXT& getMeshShaderFeatures(VkPhysicalDevice physicalDevice) const;
+	const VkPhysicalDeviceMeshShaderPropertiesEXT& getMeshShaderProperties(VkPhysicalDevice physicalDevice) const;
+
+	/// <summary>
+	/// All false when the device has neither Vulkan 1.3 nor VK_KHR_dynamic_rendering on 1.2, which has its dependencies core.
+	/// </summary>
+	const VkPhysicalDeviceDynamicRenderingFeatures& getDynamicRenderingFeatures(VkPhysicalDevice physicalDevice) const;
+
+	/// <summary>
+	/// All false when the device lacks the extension (or Vulkan 1.1 to query it through). Vulkan 1.3 made the first two
+	/// core without a feature bit, so on 1.3 these only say whether the extension is there as well.
+	/// </summary>
+	const VkPhysicalDeviceExtendedDynamicStateFeaturesEXT& getExtendedDynamicStateFeatures(VkPhysicalDevice physicalDevice) const;
+	const VkPhysicalDeviceExtendedDynamicState2FeaturesEXT& getExtendedDynamicState2Features(VkPhysicalDevice physicalDevice) const;
+	const VkPhysicalDeviceExtendedDynamicState3FeaturesEXT& getExtendedDynamicState3Features(VkPhysicalDevice physicalDevice) const;
+
+	/// <summary>
+	/// Dump every layer and extension found, for the --print-capabilities flag.
+	/// </summary>
+	void print(std::ostream& out) const;
+
+private:
+	struct DeviceCapabilities {
+		VkPhysicalDeviceProperties properties{};
+		VkPhysicalDeviceFeatures features{};
+		VkPhysicalDeviceMemoryProperties memoryProperties{};
+		std::vector<VkQueueFamilyProperties> queueFamilies;
+		VkPhysicalDeviceDescriptorIndexingFeatures descriptorIndexingFeatures{};
+		VkPhysicalDeviceDescriptorIndexingProperties descriptorIndexingProperties{};
+		VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures{};
+		VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2Features{};
+		VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures{};
+		VkPhysicalDeviceMeshShaderPropertiesEXT meshShaderProperties{};
+		VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeatures{};
+		VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures{};
+		VkPhysicalDeviceExtendedDynamicState2FeaturesEXT extendedDynamicState2Features{};
+		VkPhysicalDeviceExtendedDynamicState3FeaturesEXT extendedDynamicState3Features{};
+		std::vector<VkExtensionProperties> extensions;
+		std::unordered_set<std::string_view> extensionNames;
+	};
+
+	const DeviceCapabilities& getDevice(VkPhysicalDevice physicalDevice) const;
+
+	uint32_t instanceVersion = VK_API_VERSION_1_0;
+
+	std::vector<VkLayerProperties> layers;
+	std::unordered_set<std::string_view> layerNames;
+
+	std::vector<VkExtensionProperties> instanceExtensions;
+	std::unordered_set<std::string_view> instanceExtensionNames;
+
+	std::unordered_map<VkPhysicalDevice, DeviceCapabilities> devices;
+	std::vector<VkPhysicalDevice> deviceOrder; // Enumeration order, so print() is stable
+};
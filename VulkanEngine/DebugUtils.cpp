@@ -0,0 +1,186 @@
+#include "DebugUtils.h"
+
+#include <cstring>
+#include <iostream>
+
+// Release builds only ever use DebugUtilsImpl<false>, keep this out of the binary entirely
+#ifndef NDEBUG
+
+namespace {
+	// Provides VK_EXT_validation_features, so that's where to look for it rather than the loader's list
+	const char* const VALIDATION_LAYER_NAME = "VK_LAYER_KHRONOS_validation";
+
+	VkDebugUtilsMessageSeverityFlagsEXT severitiesFrom(DebugSeverity lowest) {
+		VkDebugUtilsMessageSeverityFlagsEXT flags = VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+		if (lowest <= DebugSeverity::Warning) {
+			flags |= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT;
+		}
+		if (lowest <= DebugSeverity::Info) {
+			flags |= VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT;
+		}
+		if (lowest <= DebugSeverity::Verbose) {
+			flags |= VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT;
+		}
+		return flags;
+	}
+
+	const char* severityName(VkDebugUtilsMessageSeverityFlagBitsEXT severity) {
+		if (severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) {
+			return "error";
+		}
+		if (severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT) {
+			return "warning";
+		}
+		if (severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT) {
+			return "info";
+		}
+		return "verbose";
+	}
+
+	bool hasValidationFeatures() {
+		uint32_t count = 0;
+		if (vkEnumerateInstanceExtensionProperties(VALIDATION_LAYER_NAME, &count, nullptr) != VK_SUCCESS) {
+			return false;
+		}
+		std::vector<VkExtensionProperties> extensions(count);
+		vkEnumerateInstanceExtensionProperties(VALIDATION_LAYER_NAME, &count, extensions.data());
+
+		for (const auto& extension : extensions) {
+			if (std::strcmp(extension.extensionName, VK_EXT_VALIDATION_FEATURES_EXTENSION_NAME) == 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+const void* DebugUtilsImpl<true>::prepareInstance(const CapabilityRegistry& capabilities, const EngineConfig& config, bool validation,
+	std::vector<const char*>& extensions) {
+	messageLimit = config.debugMessageLimit;
+	available = capabilities.hasInstanceExtension(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+
+	const void* chain = nullptr;
+	if (available) {
+		extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+
+		messengerInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+		messengerInfo.messageSeverity = severitiesFrom(config.debugSeverity);
+		messengerInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
+			VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+		messengerInfo.pfnUserCallback = messengerCallback;
+		messengerInfo.pUserData = this;
+		chain = &messengerInfo;
+	} else {
+		std::cout << "VK_EXT_debug_utils not available; no debug messenger or object names" << std::endl;
+	}
+
+	if (!config.gpuAssistedValidation && !config.synchronizationValidation) {
+		return chain;
+	}
+	if (!validation || !hasValidationFeatures()) {
+		std::cout << "GPU-assisted or synchronization validation requested, but the validation layer can't do it; ignoring" << std::endl;
+		return chain;
+	}
+
+	extensions.push_back(VK_EXT_VALIDATION_FEATURES_EXTENSION_NAME);
+	if (config.gpuAssistedValidation) {
+		enabledValidationFeatures.push_back(VK_VALIDATION_FEATURE_ENABLE_GPU_ASSISTED_EXT);
+		enabledValidationFeatures.push_back(VK_VALIDATION_FEATURE_ENABLE_GPU_ASSISTED_RESERVE_BINDING_SLOT_EXT);
+	}
+	if (config.synchronizationValidation) {
+		enabledValidationFeatures.push_back(VK_VALIDATION_FEATURE_ENABLE_SYNCHRONIZATION_VALIDATION_EXT);
+	}
+
+	validationFeatures.sType = VK_STRUCTURE_TYPE_VALIDATION_FEATURES_EXT;
+	validationFeatures.pNext = chain;
+	validationFeatures.enabledValidationFeatureCount = static_cast<uint32_t>(enabledValidationFeatures.size());
+	validationFeatures.pEnabledValidationFeatures = enabledValidationFeatures.data();
+	return &validationFeatures;
+}
+
+void DebugUtilsImpl<true>::init(VkInstance instance) {
+	this->instance = instance;
+	if (!available) {
+		return;
+	}
+
+	auto createMessenger = reinterpret_cast<PFN_vkCreateDebugUtilsMessengerEXT>(vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT"));
+	if (createMessenger == nullptr || createMessenger(instance, &messengerInfo, nullptr, &messenger) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create debug messenger!");
+	}
+
+	setObjectNameFunction = reinterpret_cast<PFN_vkSetDebugUtilsObjectNameEXT>(vkGetInstanceProcAddr(instance, "vkSetDebugUtilsObjectNameEXT"));
+	beginLabelFunction = reinterpret_cast<PFN_vkCmdBeginDebugUtilsLabelEXT>(vkGetInstanceProcAddr(instance, "vkCmdBeginDebugUtilsLabelEXT"));
+	endLabelFunction = reinterpret_cast<PFN_vkCmdEndDebugUtilsLabelEXT>(vkGetInstanceProcAddr(instance, "vkCmdEndDebugUtilsLabelEXT"));
+}
+
+void DebugUtilsImpl<true>::initDevice(VkDevice device) {
+	this->device = device;
+}
+
+void DebugUtilsImpl<true>::cleanup() {
+	if (messenger != VK_NULL_HANDLE) {
+		auto destroyMessenger = reinterpret_cast<PFN_vkDestroyDebugUtilsMessengerEXT>(vkGetInstanceProcAddr(instance, "vkDestroyDebugUtilsMessengerEXT"));
+		destroyMessenger(instance, messenger, nullptr);
+		messenger = VK_NULL_HANDLE;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (mutedMessages > 0) {
+		std::cout << "Debug messenger: " << mutedMessages << " repeated messages muted after " << messageLimit << " of each" << std::endl;
+	}
+}
+
+void DebugUtilsImpl<true>::setName(uint64_t handle, VkObjectType type, const char* name) {
+	if (device == VK_NULL_HANDLE) {
+		return;
+	}
+
+	VkDebugUtilsObjectNameInfoEXT nameInfo{};
+	nameInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT;
+	nameInfo.objectType = type;
+	nameInfo.objectHandle = handle;
+	nameInfo.pObjectName = name;
+	setObjectNameFunction(device, &nameInfo);
+}
+
+void DebugUtilsImpl<true>::beginLabel(VkCommandBuffer commandBuffer, const char* name) {
+	if (beginLabelFunction == nullptr) {
+		return;
+	}
+
+	VkDebugUtilsLabelEXT label{};
+	label.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT;
+	label.pLabelName = name;
+	beginLabelFunction(commandBuffer, &label);
+}
+
+void DebugUtilsImpl<true>::endLabel(VkCommandBuffer commandBuffer) {
+	if (endLabelFunction != nullptr) {
+		endLabelFunction(commandBuffer);
+	}
+}
+
+VKAPI_ATTR VkBool32 VKAPI_CALL DebugUtilsImpl<true>::messengerCallback(VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+	VkDebugUtilsMessageTypeFlagsEXT, const VkDebugUtilsMessengerCallbackDataEXT* callbackData, void* userData) {
+	static_cast<DebugUtilsImpl*>(userData)->report(severity, callbackData);
+	return VK_FALSE; // The call that triggered the message goes ahead as usual
+}
+
+void DebugUtilsImpl<true>::report(VkDebugUtilsMessageSeverityFlagBitsEXT severity, const VkDebugUtilsMessengerCallbackDataEXT* callbackData) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// A bad call in the frame loop repeats every frame; after the first few copies they are just noise
+	const uint32_t count = ++messageCounts[callbackData->messageIdNumber];
+	if (count > messageLimit) {
+		mutedMessages++;
+		return;
+	}
+
+	std::cerr << "[vulkan " << severityName(severity) << "] " << callbackData->pMessage << "\n";
+	if (count == messageLimit) {
+		std::cerr << "[vulkan] muting further copies of " << (callbackData->pMessageIdName ? callbackData->pMessageIdName : "this message") << "\n";
+	}
+}
+
+#endif
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "CapabilityRegistry.h"
+#include "EngineConfig.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#ifdef NDEBUG
+constexpr bool DEBUG_UTILS_ENABLED = false;
+#else
+constexpr bool DEBUG_UTILS_ENABLED = true;
+#endif
+
+template <bool Enabled>
+class DebugUtilsImpl;
+
+/// <summary>
+/// VK_EXT_debug_utils plumbing for debug builds: a messenger that filters by severity and mutes messages that keep
+/// repeating, names for objects so validation messages and captures say "Frame 1 fence" instead of a handle, and
+/// command buffer labels around passes. Optionally switches on GPU-assisted and synchronization validation.
+///
+/// Release builds get the empty specialization below instead, whose members are inline no-ops, so call sites compile
+/// to nothing: no branch, no function pointer check, and no name formatting, which only ever happens in here.
+///
+/// The messenger callback can run on any thread; naming and labels follow the usual Vulkan external sync rules.
+/// </summary>
+template <>
+class DebugUtilsImpl<true> {
+public:
+	/// <summary>
+	/// RAII helper: a label around everything recorded into commandBuffer during its lifetime.
+	/// </summary>
+	class Label {
+	public:
+		Label(DebugUtilsImpl& debug, VkCommandBuffer commandBuffer, const char* name) : debug(debug), commandBuffer(commandBuffer) {
+			debug.beginLabel(commandBuffer, name);
+		}
+		~Label() {
+			debug.endLabel(commandBuffer);
+		}
+
+		Label(const Label&) = delete;
+		Label& operator=(const Label&) = delete;
+
+	private:
+		DebugUtilsImpl& debug;
+		VkCommandBuffer commandBuffer;
+	};
+
+	/// <summary>
+	/// Before vkCreateInstance: adds the extensions needed to extensions and returns the chain for
+	/// VkInstanceCreateInfo::pNext, so instance creation and destruction themselves get reported too. validation says
+	/// whether the validation layer is going to be enabled. The chain lives in this object.
+	/// </summary>
+	const void* prepareInstance(const CapabilityRegistry& capabilities, const EngineConfig& config, bool validation, std::vector<const char*>& extensions);
+
+	/// <summary>
+	/// Create the messenger and look up the debug utils entry points. Does nothing if prepareInstance() found no
+	/// VK_EXT_debug_utils.
+	/// </summary>
+	void init(VkInstance instance);
+	void initDevice(VkDevice device);
+
+	/// <summary>
+	/// Destroy the messenger, reporting how many messages were muted. Has to run before vkDestroyInstance.
+	/// </summary>
+	void cleanup();
+
+	/// <summary>
+	/// Name handle for validation messages and capture tools. format and args go through snprintf.
+	/// </summary>
+	template <typename Handle, typename... Args>
+	void setObjectName(Handle handle, VkObjectType type, const char* format, Args... args) {
+		if (setObjectNameFunction == nullptr) {
+			return;
+		}
+
+		char name[128];
+		if constexpr (sizeof...(Args) == 0) {
+			std::snprintf(name, sizeof(name), "%s", format);
+		} else {
+			std::snprintf(name, sizeof(name), format, args...);
+		}
+		setName(reinterpret_cast<uint64_t>(handle), type, name);
+	}
+
+	void beginLabel(VkCommandBuffer commandBuffer, const char* name);
+	void endLabel(VkCommandBuffer commandBuffer);
+
+private:
+	static VKAPI_ATTR VkBool32 VKAPI_CALL messengerCallback(VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+		VkDebugUtilsMessageTypeFlagsEXT types, const VkDebugUtilsMessengerCallbackDataEXT* callbackData, void* userData);
+
+	void setName(uint64_t handle, VkObjectType type, const char* name);
+	void report(VkDebugUtilsMessageSeverityFlagBitsEXT severity, const VkDebugUtilsMessengerCallbackDataEXT* callbackData);
+
+	bool available = false;
+	VkInstance instance = VK_NULL_HANDLE;
+	VkDevice device = VK_NULL_HANDLE;
+	VkDebugUtilsMessengerEXT messenger = VK_NULL_HANDLE;
+
+	VkDebugUtilsMessengerCreateInfoEXT messengerInfo{};
+	VkValidationFeaturesEXT validationFeatures{};
+	std::vector<VkValidationFeatureEnableEXT> enabledValidationFeatures;
+
+	PFN_vkSetDebugUtilsObjectNameEXT setObjectNameFunction = nullptr;
+	PFN_vkCmdBeginDebugUtilsLabelEXT beginLabelFunction = nullptr;
+	PFN_vkCmdEndDebugUtilsLabelEXT endLabelFunction = nullptr;
+
+	uint32_t messageLimit = 0;
+	std::mutex mutex; // Guards the counters below, the callback can come from any thread
+	std::unordered_map<int32_t, uint32_t> messageCounts; // messageIdNumber -> times seen
+	uint64_t mutedMessages = 0;
+};
+
+/// <summary>
+/// Release build stand-in, see DebugUtilsImpl<true>.
+/// </summary>
+template <>
+class DebugUtilsImpl<false> {
+public:
+	class Label {
+	public:
+		Label(DebugUtilsImpl&, VkCommandBuffer, const char*) {}
+	};
+
+	const void* prepareInstance(const CapabilityRegistry&, const EngineConfig&, bool, std::vector<const char*>&) {
+		return nullptr;
+	}
+	void init(VkInstance) {}
+	void initDevice(VkDevice) {}
+	void cleanup() {}
+
+	template <typename Handle, typename... Args>
+	void setObjectName(Handle, VkObjectType, const char*, Args...) {}
+
+	void beginLabel(VkCommandBuffer, const char*) {}
+	void endLabel(VkCommandBuffer) {}
+};
+
+using DebugUtils = DebugUtilsImpl<DEBUG_UTILS_ENABLED>;
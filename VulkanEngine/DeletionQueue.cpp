@@ -0,0 +1,64 @@
+#include "DeletionQueue.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+
+void DeletionQueue::init(uint32_t framesInFlight) {
+	this->framesInFlight = framesInFlight;
+	framesSubmitted = 0;
+}
+
+void DeletionQueue::cleanup() {
+	flush();
+}
+
+void DeletionQueue::defer(std::function<void()> destroy, VkDeviceSize bytes) {
+	if (running) {
+		throw std::logic_error("DeletionQueue::defer called from a deferred deletion!");
+	}
+
+	if (batches.empty() || batches.back().frame != framesSubmitted) {
+		batches.push_back({ framesSubmitted, {} });
+		stats.batches++;
+	}
+	batches.back().entries.push_back({ std::move(destroy), bytes });
+
+	stats.depth++;
+	stats.peakDepth = std::max(stats.peakDepth, stats.depth);
+	stats.deferredBytes += bytes;
+	stats.peakDeferredBytes = std::max(stats.peakDeferredBytes, stats.deferredBytes);
+}
+
+void DeletionQueue::beginFrame(uint64_t framesSubmitted) {
+	this->framesSubmitted = framesSubmitted;
+	while (!batches.empty() && framesSubmitted >= batches.front().frame + framesInFlight) {
+		run(batches.front());
+		batches.pop_front();
+	}
+}
+
+void DeletionQueue::flush() {
+	for (Batch& batch : batches) {
+		run(batch);
+	}
+	batches.clear();
+}
+
+void DeletionQueue::run(Batch& batch) {
+	running = true;
+	for (Entry& entry : batch.entries) {
+		entry.destroy();
+		stats.depth--;
+		stats.deferredBytes -= entry.bytes;
+		stats.deletions++;
+		stats.bytesDeleted += entry.bytes;
+	}
+	running = false;
+}
+
+void DeletionQueue::printStats(std::ostream& out) const {
+	out << "Deletion queue: " << stats.deletions << " deferred deletions over " << stats.batches << " frames, "
+		<< std::fixed << std::setprecision(1) << stats.bytesDeleted / (1024.0 * 1024.0) << " MiB freed, " << stats.peakDepth
+		<< " waiting at most holding " << stats.peakDeferredBytes / (1024.0 * 1024.0) << " MiB\n";
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <ostream>
+#include <vector>
+
+struct DeletionQueueStats {
+	uint32_t depth = 0; // Deletions waiting right now
+	uint32_t peakDepth = 0;
+	uint64_t deferredBytes = 0; // Device memory the waiting deletions hold on to
+	uint64_t peakDeferredBytes = 0;
+	uint64_t deletions = 0; // Run so far, flush() included
+	uint64_t bytesDeleted = 0;
+	uint64_t batches = 0; // Frames that deferred anything
+};
+
+/// <summary>
+/// Destroys resources once the GPU can no longer be using them, instead of draining it with vkDeviceWaitIdle. Whatever
+/// is deferred goes into the batch of the frame being recorded and runs when beginFrame() comes back round to that
+/// frame's slot: it is called right after the fence wait on the frame submitted framesInFlight frames ago, and a fence
+/// signals only once everything submitted before it has finished, so every frame that could have referenced a batch's
+/// resources is done by then. Batches run oldest first, entries within one in the order they were deferred.
+///
+/// Anything recorded into a single frame's command buffers qualifies. Resources used across frames, such as a descriptor
+/// set every frame binds, have to be unhooked first, otherwise the next frame picks them back up. Not thread safe; the
+/// render thread defers and runs everything. Deferred functions must not defer more.
+/// </summary>
+class DeletionQueue {
+public:
+	void init(uint32_t framesInFlight);
+
+	/// <summary>
+	/// Runs everything still queued, so the GPU must be idle.
+	/// </summary>
+	void cleanup();
+
+	/// <summary>
+	/// Queue destroy with the frame being recorded. bytes is the device memory it frees, for the stats only.
+	/// </summary>
+	void defer(std::function<void()> destroy, VkDeviceSize bytes = 0);
+
+	/// <summary>
+	/// Call right after waiting on the fence of the frame slot about to be reused, with the number of frames submitted so
+	/// far. Runs every batch of a frame framesInFlight or more frames ago.
+	/// </summary>
+	void beginFrame(uint64_t framesSubmitted);
+
+	/// <summary>
+	/// Run every batch now. Only for when the GPU is idle.
+	/// </summary>
+	void flush();
+
+	DeletionQueueStats getStats() const {
+		return stats;
+	}
+
+	void printStats(std::ostream& out) const;
+
+private:
+	struct Entry {
+		std::function<void()> destroy;
+		VkDeviceSize bytes;
+	};
+
+	struct Batch {
+		uint64_t frame; // framesSubmitted while it was recorded
+		std::vector<Entry> entries;
+	};
+
+	void run(Batch& batch);
+
+	uint32_t framesInFlight = 1;
+	uint64_t framesSubmitted = 0;
+	std::deque<Batch> batches; // Oldest first, one per frame that deferred anything
+	bool running = false;
+	DeletionQueueStats stats;
+};
@@ -0,0 +1,369 @@
+#include "DeviceMemoryAllocator.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+
+namespace {
+	// Heaps at or below this size (integrated GPUs, the small BAR heap) get blocks scaled down to a fraction of the heap
+	const VkDeviceSize SMALL_HEAP_MAX_SIZE = 1024ull * 1024 * 1024;
+
+	VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	double toMiB(VkDeviceSize bytes) {
+		return static_cast<double>(bytes) / (1024.0 * 1024.0);
+	}
+}
+
+void DeviceMemoryAllocator::init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize preferredBlockSize) {
+	this->physicalDevice = physicalDevice;
+	this->device = device;
+	this->preferredBlockSize = preferredBlockSize;
+
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	nonCoherentAtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+	maxMemoryAllocationCount = properties.limits.maxMemoryAllocationCount;
+}
+
+void DeviceMemoryAllocator::cleanup() {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (auto& pool : pools) {
+		for (auto& block : pool.blocks) {
+			if (block.memory != VK_NULL_HANDLE) {
+				freeDeviceMemory(block.memory, block.mappedData != nullptr);
+			}
+		}
+	}
+	pools.clear();
+
+	if (dedicatedAllocationCount > 0) {
+		throw std::runtime_error("Device memory allocator destroyed with " + std::to_string(dedicatedAllocationCount) + " dedicated allocations still alive!");
+	}
+}
+
+bool DeviceMemoryAllocator::isHostVisible(uint32_t memoryTypeIndex) const {
+	return (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+}
+
+uint32_t DeviceMemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags requiredFlags, VkMemoryPropertyFlags preferredFlags) const {
+	// First pass wants everything, second pass settles for what is actually required
+	const VkMemoryPropertyFlags passes[] = { requiredFlags | preferredFlags, requiredFlags };
+
+	for (VkMemoryPropertyFlags flags : passes) {
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+			if ((typeFilter & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & flags) == flags) {
+				return i;
+			}
+		}
+	}
+
+	throw std::runtime_error("Failed to find suitable memory type!");
+}
+
+VkDeviceMemory DeviceMemoryAllocator::allocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void** mappedData) {
+	if (deviceMemoryAllocationCount >= maxMemoryAllocationCount) {
+		throw std::runtime_error("Exceeded maxMemoryAllocationCount (" + std::to_string(maxMemoryAllocationCount) + ")!");
+	}
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+	VkDeviceMemory memory;
+	if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+		return VK_NULL_HANDLE;
+	}
+	deviceMemoryAllocationCount++;
+
+	*mappedData = nullptr;
+	if (isHostVisible(memoryTypeIndex)) {
+		// Map once for the lifetime of the block, mapping is expensive and sub-allocations share it anyway
+		if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, mappedData) != VK_SUCCESS) {
+			vkFreeMemory(device, memory, nullptr);
+			deviceMemoryAllocationCount--;
+			throw std::runtime_error("Failed to map device memory!");
+		}
+	}
+
+	return memory;
+}
+
+void DeviceMemoryAllocator::freeDeviceMemory(VkDeviceMemory memory, bool mapped) {
+	if (mapped) {
+		vkUnmapMemory(device, memory);
+	}
+	vkFreeMemory(device, memory, nullptr);
+	deviceMemoryAllocationCount--;
+}
+
+uint32_t DeviceMemoryAllocator::findOrCreatePool(uint32_t memoryTypeIndex, PoolStrategy strategy, bool linearResource) {
+	for (uint32_t i = 0; i < pools.size(); i++) {
+		if (pools[i].memoryTypeIndex == memoryTypeIndex && pools[i].strategy == strategy && pools[i].linearResources == linearResource) {
+			return i;
+		}
+	}
+
+	// Don't let a single block swallow a big chunk of a small heap
+	const VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+	VkDeviceSize blockSize = preferredBlockSize;
+	if (heapSize <= SMALL_HEAP_MAX_SIZE) {
+		blockSize = std::min(blockSize, heapSize / 8);
+	}
+
+	MemoryPool pool;
+	pool.memoryTypeIndex = memoryTypeIndex;
+	pool.strategy = strategy;
+	pool.linearResources = linearResource;
+	pool.blockSize = blockSize;
+	pools.push_back(std::move(pool));
+
+	return static_cast<uint32_t>(pools.size() - 1);
+}
+
+Allocation DeviceMemoryAllocator::allocate(const VkMemoryRequirements& requirements, const AllocationCreateInfo& createInfo, bool linearResource) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	Allocation allocation;
+	allocation.memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, createInfo.requiredFlags, createInfo.preferredFlags);
+	allocation.size = requirements.size;
+
+	const uint32_t poolIndex = findOrCreatePool(allocation.memoryTypeIndex, createInfo.strategy, linearResource);
+	MemoryPool& pool = pools[poolIndex];
+
+	const VkMemoryPropertyFlags typeFlags = memoryProperties.memoryTypes[allocation.memoryTypeIndex].propertyFlags;
+	const bool nonCoherent = (typeFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(typeFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	// Resources bigger than half a block would mostly waste the block they land in
+	if (createInfo.dedicated || requirements.size > pool.blockSize / 2) {
+		// Whole atoms, so flush() can round the end of the range up without running past the memory
+		if (nonCoherent) {
+			allocation.size = alignUp(requirements.size, nonCoherentAtomSize);
+		}
+		allocation.memory = allocateDeviceMemory(allocation.size, allocation.memoryTypeIndex, &allocation.mappedData);
+		if (allocation.memory == VK_NULL_HANDLE) {
+			throw std::runtime_error("Failed to allocate dedicated device memory!");
+		}
+		allocation.dedicated = true;
+		dedicatedAllocationCount++;
+		dedicatedBytes += allocation.size;
+		return allocation;
+	}
+
+	// Keep separately flushed sub-allocations from sharing a non-coherent atom
+	VkDeviceSize alignment = requirements.alignment;
+	if (nonCoherent) {
+		alignment = std::max(alignment, nonCoherentAtomSize);
+	}
+
+	uint32_t freeSlot = UINT32_MAX;
+	for (uint32_t i = 0; i < pool.blocks.size(); i++) {
+		MemoryBlock& block = pool.blocks[i];
+		if (block.memory == VK_NULL_HANDLE) {
+			freeSlot = std::min(freeSlot, i);
+			continue;
+		}
+
+		if (block.subAllocator->allocate(requirements.size, alignment, allocation.offset)) {
+			allocation.memory = block.memory;
+			allocation.mappedData = block.mappedData ? static_cast<char*>(block.mappedData) + allocation.offset : nullptr;
+			allocation.poolIndex = poolIndex;
+			allocation.blockIndex = i;
+			return allocation;
+		}
+	}
+
+	// Every block is full, grab a new one. If the heap is tight fall back to smaller blocks before giving up.
+	MemoryBlock block;
+	for (VkDeviceSize blockSize = pool.blockSize; blockSize >= requirements.size; blockSize /= 2) {
+		block.subAllocator = createSubAllocator(pool.strategy, blockSize);
+		block.memory = allocateDeviceMemory(block.subAllocator->getCapacity(), pool.memoryTypeIndex, &block.mappedData);
+		if (block.memory != VK_NULL_HANDLE) {
+			break;
+		}
+	}
+
+	if (block.memory == VK_NULL_HANDLE || !block.subAllocator->allocate(requirements.size, alignment, allocation.offset)) {
+		if (block.memory != VK_NULL_HANDLE) {
+			freeDeviceMemory(block.memory, block.mappedData != nullptr);
+		}
+		throw std::runtime_error("Failed to allocate a device memory block!");
+	}
+
+	allocation.memory = block.memory;
+	allocation.mappedData = block.mappedData ? static_cast<char*>(block.mappedData) + allocation.offset : nullptr;
+	allocation.poolIndex = poolIndex;
+
+	// Reuse a released slot so blockIndex of existing allocations stays valid
+	if (freeSlot != UINT32_MAX) {
+		pool.blocks[freeSlot] = std::move(block);
+		allocation.blockIndex = freeSlot;
+	} else {
+		pool.blocks.push_back(std::move(block));
+		allocation.blockIndex = static_cast<uint32_t>(pool.blocks.size() - 1);
+	}
+
+	return allocation;
+}
+
+void DeviceMemoryAllocator::free(Allocation& allocation) {
+	if (allocation.memory == VK_NULL_HANDLE) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (allocation.dedicated) {
+		freeDeviceMemory(allocation.memory, allocation.mappedData != nullptr);
+		dedicatedAllocationCount--;
+		dedicatedBytes -= allocation.size;
+		allocation = Allocation{};
+		return;
+	}
+
+	MemoryPool& pool = pools[allocation.poolIndex];
+	MemoryBlock& block = pool.blocks[allocation.blockIndex];
+	block.subAllocator->free(allocation.offset);
+
+	// Hold on to one empty block per pool so a resource being recreated doesn't bounce a block in and out of the driver
+	if (block.subAllocator->isEmpty()) {
+		const auto emptyBlocks = std::count_if(pool.blocks.begin(), pool.blocks.end(), [](const MemoryBlock& b) {
+			return b.memory != VK_NULL_HANDLE && b.subAllocator->isEmpty();
+		});
+		if (emptyBlocks > 1) {
+			freeDeviceMemory(block.memory, block.mappedData != nullptr);
+			block = MemoryBlock{};
+		}
+	}
+
+	allocation = Allocation{};
+}
+
+VkBuffer DeviceMemoryAllocator::createBuffer(const VkBufferCreateInfo& bufferInfo, const AllocationCreateInfo& createInfo, Allocation& allocation) {
+	VkBuffer buffer;
+	if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create buffer!");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+
+	try {
+		allocation = allocate(memRequirements, createInfo, true);
+	} catch (...) {
+		vkDestroyBuffer(device, buffer, nullptr);
+		throw;
+	}
+
+	vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset);
+	return buffer;
+}
+
+void DeviceMemoryAllocator::destroyBuffer(VkBuffer buffer, Allocation& allocation) {
+	vkDestroyBuffer(device, buffer, nullptr);
+	free(allocation);
+}
+
+VkImage DeviceMemoryAllocator::createImage(const VkImageCreateInfo& imageInfo, const AllocationCreateInfo& createInfo, Allocation& allocation) {
+	VkImage image;
+	if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create image!");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(device, image, &memRequirements);
+
+	try {
+		allocation = allocate(memRequirements, createInfo, imageInfo.tiling == VK_IMAGE_TILING_LINEAR);
+	} catch (...) {
+		vkDestroyImage(device, image, nullptr);
+		throw;
+	}
+
+	vkBindImageMemory(device, image, allocation.memory, allocation.offset);
+	return image;
+}
+
+void DeviceMemoryAllocator::destroyImage(VkImage image, Allocation& allocation) {
+	vkDestroyImage(device, image, nullptr);
+	free(allocation);
+}
+
+void DeviceMemoryAllocator::flush(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size) {
+	if (memoryProperties.memoryTypes[allocation.memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) {
+		return;
+	}
+
+	if (size == VK_WHOLE_SIZE) {
+		size = allocation.size - offset;
+	}
+
+	// Flush ranges must be expressed in whole atoms. Sub-allocations of non-coherent memory are atom aligned and
+	// dedicated ones a whole number of atoms, so rounding outwards can't touch a neighbour's data or leave the memory.
+	const VkDeviceSize begin = (allocation.offset + offset) & ~(nonCoherentAtomSize - 1);
+	const VkDeviceSize end = alignUp(allocation.offset + offset + size, nonCoherentAtomSize);
+
+	VkMappedMemoryRange range{};
+	range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+	range.memory = allocation.memory;
+	range.offset = begin;
+	range.size = end - begin;
+	vkFlushMappedMemoryRanges(device, 1, &range);
+}
+
+DeviceMemoryStats DeviceMemoryAllocator::getStats() const {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	DeviceMemoryStats stats;
+	stats.deviceMemoryAllocationCount = deviceMemoryAllocationCount;
+	stats.dedicatedAllocationCount = dedicatedAllocationCount;
+	stats.dedicatedBytes = dedicatedBytes;
+	stats.maxMemoryAllocationCount = maxMemoryAllocationCount;
+
+	for (const auto& pool : pools) {
+		MemoryPoolStats poolStats{};
+		poolStats.memoryTypeIndex = pool.memoryTypeIndex;
+		poolStats.strategy = pool.strategy;
+		poolStats.linearResources = pool.linearResources;
+
+		for (const auto& block : pool.blocks) {
+			if (block.memory == VK_NULL_HANDLE) {
+				continue;
+			}
+
+			const SubAllocatorStats blockStats = block.subAllocator->getStats();
+			poolStats.blockCount++;
+			poolStats.totals.capacity += blockStats.capacity;
+			poolStats.totals.bytesUsed += blockStats.bytesUsed;
+			poolStats.totals.bytesWasted += blockStats.bytesWasted;
+			poolStats.totals.allocationCount += blockStats.allocationCount;
+			poolStats.totals.largestFreeRange = std::max(poolStats.totals.largestFreeRange, blockStats.largestFreeRange);
+		}
+
+		stats.pools.push_back(poolStats);
+	}
+
+	return stats;
+}
+
+void DeviceMemoryAllocator::printStats(std::ostream& out) const {
+	const DeviceMemoryStats stats = getStats();
+
+	out << "Device memory: " << stats.deviceMemoryAllocationCount << '/' << stats.maxMemoryAllocationCount << " vkAllocateMemory allocations, "
+		<< stats.dedicatedAllocationCount << " dedicated (" << std::fixed << std::setprecision(2) << toMiB(stats.dedicatedBytes) << " MiB)\n";
+
+	for (const auto& pool : stats.pools) {
+		out << "\ttype " << pool.memoryTypeIndex << ' ' << poolStrategyName(pool.strategy) << (pool.linearResources ? " linear" : " optimal")
+			<< ": " << pool.blockCount << " blocks, " << pool.totals.allocationCount << " allocations, "
+			<< toMiB(pool.totals.bytesUsed) << '/' << toMiB(pool.totals.capacity) << " MiB used, "
+			<< toMiB(pool.totals.bytesWasted) << " MiB wasted, "
+			<< std::setprecision(1) << pool.totals.fragmentation() * 100.0 << "% fragmented\n" << std::setprecision(2);
+	}
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "BlockSubAllocator.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+/// <summary>
+/// What the caller needs from the memory backing a resource.
+/// </summary>
+struct AllocationCreateInfo {
+	VkMemoryPropertyFlags requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	VkMemoryPropertyFlags preferredFlags = 0; // Used if some memory type has them, ignored otherwise
+	PoolStrategy strategy = PoolStrategy::Tlsf;
+	bool dedicated = false; // Force a VkDeviceMemory of its own, e.g. for resources that get resized or aliased
+};
+
+/// <summary>
+/// A sub-range of some VkDeviceMemory. Host visible memory is kept persistently mapped, mappedData points at offset.
+/// </summary>
+struct Allocation {
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	void* mappedData = nullptr;
+	uint32_t memoryTypeIndex = 0;
+
+	// Bookkeeping so free() can find its way back without a search
+	uint32_t poolIndex = UINT32_MAX;
+	uint32_t blockIndex = UINT32_MAX;
+	bool dedicated = false;
+};
+
+/// <summary>
+/// Aggregated numbers for one pool (memory type + strategy + resource kind).
+/// </summary>
+struct MemoryPoolStats {
+	uint32_t memoryTypeIndex;
+	PoolStrategy strategy;
+	bool linearResources;
+	uint32_t blockCount;
+	SubAllocatorStats totals; // capacity/used/wasted summed over blocks, largestFreeRange is the max over blocks
+};
+
+struct DeviceMemoryStats {
+	std::vector<MemoryPoolStats> pools;
+	uint32_t deviceMemoryAllocationCount = 0; // Live vkAllocateMemory calls, capped by maxMemoryAllocationCount
+	uint32_t dedicatedAllocationCount = 0;
+	VkDeviceSize dedicatedBytes = 0;
+	uint32_t maxMemoryAllocationCount = 0;
+};
+
+/// <summary>
+/// Carves buffers and images out of large VkDeviceMemory blocks instead of making one vkAllocateMemory call per resource.
+/// Pools are created lazily per (memory type, strategy, linear or optimal tiling) so buffers and optimal images never
+/// share a block and bufferImageGranularity can be ignored.
+/// </summary>
+class DeviceMemoryAllocator {
+public:
+	static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+	void init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize preferredBlockSize = DEFAULT_BLOCK_SIZE);
+	void cleanup();
+
+	/// <summary>
+	/// Sub-allocate memory satisfying requirements. linearResource is true for buffers and linear tiled images.
+	/// </summary>
+	Allocation allocate(const VkMemoryRequirements& requirements, const AllocationCreateInfo& createInfo, bool linearResource);
+	void free(Allocation& allocation);
+
+	VkBuffer createBuffer(const VkBufferCreateInfo& bufferInfo, const AllocationCreateInfo& createInfo, Allocation& allocation);
+	void destroyBuffer(VkBuffer buffer, Allocation& allocation);
+
+	VkImage createImage(const VkImageCreateInfo& imageInfo, const AllocationCreateInfo& createInfo, Allocation& allocation);
+	void destroyImage(VkImage image, Allocation& allocation);
+
+	/// <summary>
+	/// Make host writes visible to the device. A no-op for coherent memory.
+	/// </summary>
+	void flush(const Allocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags requiredFlags, VkMemoryPropertyFlags preferredFlags = 0) const;
+
+	const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const {
+		return memoryProperties;
+	}
+
+	DeviceMemoryStats getStats() const;
+	void printStats(std::ostream& out) const;
+
+private:
+	struct MemoryBlock {
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		std::unique_ptr<BlockSubAllocator> subAllocator;
+		void* mappedData = nullptr;
+	};
+
+	struct MemoryPool {
+		uint32_t memoryTypeIndex;
+		PoolStrategy strategy;
+		bool linearResources;
+		VkDeviceSize blockSize;
+		std::vector<MemoryBlock> blocks;
+	};
+
+	uint32_t findOrCreatePool(uint32_t memoryTypeIndex, PoolStrategy strategy, bool linearResource);
+	VkDeviceMemory allocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void** mappedData);
+	void freeDeviceMemory(VkDeviceMemory memory, bool mapped);
+	bool isHostVisible(uint32_t memoryTypeIndex) const;
+
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	VkDevice device = VK_NULL_HANDLE;
+	VkPhysicalDeviceMemoryProperties memoryProperties{};
+	VkDeviceSize nonCoherentAtomSize = 1;
+	uint32_t maxMemoryAllocationCount = 0;
+	VkDeviceSize preferredBlockSize = DEFAULT_BLOCK_SIZE;
+
+	mutable std::mutex mutex;
+	std::vector<MemoryPool> pools;
+	uint32_t deviceMemoryAllocationCount = 0;
+	uint32_t dedicatedAllocationCount = 0;
+	VkDeviceSize dedicatedBytes = 0;
+};
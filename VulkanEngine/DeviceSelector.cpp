@@ -0,0 +1,210 @@
+#include "DeviceSelector.h"
+
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+namespace {
+	/// <summary>
+	/// Higher is better. Discrete GPUs have their own memory and the most throughput; a CPU implementation is a last resort.
+	/// </summary>
+	uint64_t getTypeRank(VkPhysicalDeviceType type) {
+		switch (type) {
+		case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+			return 4;
+		case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+			return 3;
+		case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+			return 2;
+		case VK_PHYSICAL_DEVICE_TYPE_CPU:
+			return 1;
+		default:
+			return 0;
+		}
+	}
+
+	const char* getTypeName(VkPhysicalDeviceType type) {
+		switch (type) {
+		case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+			return "discrete";
+		case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+			return "integrated";
+		case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+			return "virtual";
+		case VK_PHYSICAL_DEVICE_TYPE_CPU:
+			return "cpu";
+		default:
+			return "other";
+		}
+	}
+
+	std::string toLower(std::string text) {
+		std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return text;
+	}
+}
+
+void DeviceSelector::init(VkInstance instance, uint32_t instanceApiVersion) {
+	uint32_t deviceCount = 0;
+	vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+
+	if (deviceCount == 0) {
+		throw std::runtime_error("Failed to find GPUs with Vulkan support!");
+	}
+
+	devices.resize(deviceCount);
+	vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
+	devices.resize(deviceCount);
+
+	if (instanceApiVersion < VK_API_VERSION_1_1) {
+		return;
+	}
+
+	uint32_t groupCount = 0;
+	vkEnumeratePhysicalDeviceGroups(instance, &groupCount, nullptr);
+	groups.resize(groupCount);
+	for (auto& group : groups) {
+		group.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GROUP_PROPERTIES;
+	}
+	vkEnumeratePhysicalDeviceGroups(instance, &groupCount, groups.data());
+	groups.resize(groupCount);
+}
+
+void DeviceSelector::addCandidate(VkPhysicalDevice physicalDevice, const CapabilityRegistry& capabilities,
+	const std::string& rejectReason, uint32_t preferredFeatures) {
+	const auto it = std::find(devices.begin(), devices.end(), physicalDevice);
+	if (it == devices.end()) {
+		throw std::logic_error("Device candidate that DeviceSelector::init() didn't enumerate!");
+	}
+
+	const VkPhysicalDeviceProperties& properties = capabilities.getDeviceProperties(physicalDevice);
+
+	DeviceCandidate candidate;
+	candidate.physicalDevice = physicalDevice;
+	candidate.index = static_cast<uint32_t>(it - devices.begin());
+	candidate.name = properties.deviceName;
+	candidate.type = properties.deviceType;
+	candidate.preferredFeatures = preferredFeatures;
+	candidate.groupSize = static_cast<uint32_t>(getGroup(physicalDevice).size());
+	candidate.rejectReason = rejectReason;
+
+	const VkPhysicalDeviceMemoryProperties& memory = capabilities.getMemoryProperties(physicalDevice);
+	for (uint32_t i = 0; i < memory.memoryHeapCount; i++) {
+		if (memory.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+			candidate.deviceLocalBytes = std::max<uint64_t>(candidate.deviceLocalBytes, memory.memoryHeaps[i].size);
+		}
+	}
+
+	// The same families findQueueFamilies() looks for: copies and compute that don't queue up behind the frame's graphics work
+	bool transferOnly = false;
+	bool computeOnly = false;
+	for (const VkQueueFamilyProperties& family : capabilities.getQueueFamilies(physicalDevice)) {
+		const VkQueueFlags flags = family.queueFlags;
+		transferOnly |= (flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT));
+		computeOnly |= (flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT);
+	}
+	candidate.dedicatedQueueFamilies = (transferOnly ? 1 : 0) + (computeOnly ? 1 : 0);
+
+	candidate.score = rejectReason.empty() ? computeScore(candidate) : 0;
+	candidates.push_back(candidate);
+}
+
+uint64_t DeviceSelector::computeScore(const DeviceCandidate& candidate) {
+	// Packed so each criterion only matters between devices that tie on all the ones above it
+	const uint64_t memoryMebibytes = std::min<uint64_t>(candidate.deviceLocalBytes >> 20, (1ull << 40) - 1);
+
+	return (uint64_t(std::min(candidate.preferredFeatures, 255u)) << 56) | (getTypeRank(candidate.type) << 48) |
+		(uint64_t(candidate.dedicatedQueueFamilies) << 40) | memoryMebibytes;
+}
+
+VkPhysicalDevice DeviceSelector::select(const std::string& selection) {
+	const DeviceCandidate* pick = nullptr;
+
+	if (selection.empty()) {
+		for (const DeviceCandidate& candidate : candidates) {
+			if (candidate.rejectReason.empty() && (!pick || candidate.score > pick->score)) {
+				pick = &candidate;
+			}
+		}
+		if (!pick) {
+			throw std::runtime_error("Failed to find a suitable GPU!");
+		}
+	} else {
+		const bool isIndex = std::all_of(selection.begin(), selection.end(), [](unsigned char c) { return std::isdigit(c) != 0; });
+		const std::string lowerSelection = toLower(selection);
+
+		for (const DeviceCandidate& candidate : candidates) {
+			const bool matches = isIndex ? std::to_string(candidate.index) == selection
+				: toLower(candidate.name).find(lowerSelection) != std::string::npos;
+			if (matches) {
+				pick = &candidate;
+				break;
+			}
+		}
+		if (!pick) {
+			throw std::runtime_error("Failed to find the GPU \"" + selection + "\" asked for, there are " +
+				std::to_string(candidates.size()) + "!");
+		}
+		if (!pick->rejectReason.empty()) {
+			throw std::runtime_error("The GPU asked for, " + pick->name + ", can't be used: " + pick->rejectReason + "!");
+		}
+	}
+
+	selected = pick->physicalDevice;
+	selectedExplicitly = !selection.empty();
+	return selected;
+}
+
+std::vector<VkPhysicalDevice> DeviceSelector::getGroup(VkPhysicalDevice physicalDevice) const {
+	for (const VkPhysicalDeviceGroupProperties& group : groups) {
+		const VkPhysicalDevice* begin = group.physicalDevices;
+		const VkPhysicalDevice* end = group.physicalDevices + group.physicalDeviceCount;
+		if (std::find(begin, end, physicalDevice) != end) {
+			return std::vector<VkPhysicalDevice>(begin, end);
+		}
+	}
+	return { physicalDevice };
+}
+
+const DeviceCandidate& DeviceSelector::getCandidate(VkPhysicalDevice physicalDevice) const {
+	for (const DeviceCandidate& candidate : candidates) {
+		if (candidate.physicalDevice == physicalDevice) {
+			return candidate;
+		}
+	}
+	throw std::logic_error("Device candidate looked up before addCandidate()!");
+}
+
+void DeviceSelector::printRanking(std::ostream& out) const {
+	std::vector<const DeviceCandidate*> ranking;
+	for (const DeviceCandidate& candidate : candidates) {
+		ranking.push_back(&candidate);
+	}
+	std::stable_sort(ranking.begin(), ranking.end(), [](const DeviceCandidate* a, const DeviceCandidate* b) {
+		if (a->rejectReason.empty() != b->rejectReason.empty()) {
+			return a->rejectReason.empty();
+		}
+		return a->score > b->score;
+	});
+
+	out << "Physical devices, best first:\n";
+	for (const DeviceCandidate* candidate : ranking) {
+		out << (candidate->physicalDevice == selected ? "  * " : "    ") << candidate->index << ": " << candidate->name
+			<< " (" << getTypeName(candidate->type) << ", " << (candidate->deviceLocalBytes >> 20) << " MiB device local";
+		if (candidate->groupSize > 1) {
+			out << ", group of " << candidate->groupSize;
+		}
+		out << ")";
+
+		if (candidate->rejectReason.empty()) {
+			out << " " << candidate->preferredFeatures << " requested features, " << candidate->dedicatedQueueFamilies
+				<< " dedicated queue families";
+		} else {
+			out << " rejected: " << candidate->rejectReason;
+		}
+		out << '\n';
+	}
+	if (selectedExplicitly) {
+		out << "  (* selected explicitly, by --device or VULKAN_ENGINE_DEVICE)\n";
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "CapabilityRegistry.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// One physical device as the selector sees it: what it was scored on, or why it can't be used at all.
+/// </summary>
+struct DeviceCandidate {
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	uint32_t index = 0; // In vkEnumeratePhysicalDevices order, what --device N refers to
+	std::string name;
+	VkPhysicalDeviceType type = VK_PHYSICAL_DEVICE_TYPE_OTHER;
+	uint64_t deviceLocalBytes = 0; // Of its largest device local heap
+	uint32_t dedicatedQueueFamilies = 0; // A transfer-only and a compute-only family, each runs alongside graphics
+	uint32_t preferredFeatures = 0; // How many of the optional paths the config asked for the device can run
+	uint32_t groupSize = 1; // Physical devices in its device group, counting itself
+	std::string rejectReason; // Empty when the device can be used
+	uint64_t score = 0;
+};
+
+/// <summary>
+/// Picks the physical device to render on. Every device the caller didn't reject is scored, in order of importance, on
+/// the optional paths the config asked for that it can run, then discrete over integrated over virtual over CPU, then
+/// queue families that run copies and compute alongside graphics, then device local memory. Ties go to the device that
+/// enumerated first, so the pick is stable from run to run.
+///
+/// An explicit selection, from --device or VULKAN_ENGINE_DEVICE, bypasses the scores but not the rejections: asking for a
+/// device that can't run the engine is an error rather than a silent fallback to another one.
+///
+/// Also knows the device groups (core in Vulkan 1.1), for spreading frames over linked GPUs. Not thread safe; init() can
+/// run on a worker, the rest has to wait for it.
+/// </summary>
+class DeviceSelector {
+public:
+	/// <summary>
+	/// Enumerate the physical devices and the groups they form. A 1.0 instance has no groups, every device stands alone.
+	/// Throws if there are no devices at all.
+	/// </summary>
+	void init(VkInstance instance, uint32_t instanceApiVersion);
+
+	/// <summary>
+	/// Every physical device, in enumeration order.
+	/// </summary>
+	const std::vector<VkPhysicalDevice>& getDevices() const {
+		return devices;
+	}
+
+	/// <summary>
+	/// Describe and score one of getDevices(). capabilities must have queried it. rejectReason says why the caller's own
+	/// checks failed, empty if they passed. Call once per device before select().
+	/// </summary>
+	void addCandidate(VkPhysicalDevice physicalDevice, const CapabilityRegistry& capabilities, const std::string& rejectReason,
+		uint32_t preferredFeatures);
+
+	/// <summary>
+	/// The best scoring usable device, or with a selection, the device with that index or the first whose name contains it
+	/// (case insensitive). Throws if nothing is usable, or if the selection names no device or one that was rejected.
+	/// </summary>
+	VkPhysicalDevice select(const std::string& selection);
+
+	/// <summary>
+	/// The physical devices in physicalDevice's group, in the group's order, which is the device index order of a logical
+	/// device created over all of them. Just physicalDevice when it has no group.
+	/// </summary>
+	std::vector<VkPhysicalDevice> getGroup(VkPhysicalDevice physicalDevice) const;
+
+	/// <summary>
+	/// Throws std::logic_error for a device addCandidate() wasn't called for.
+	/// </summary>
+	const DeviceCandidate& getCandidate(VkPhysicalDevice physicalDevice) const;
+
+	/// <summary>
+	/// Every candidate best first with what it scored on, rejected ones last with their reasons.
+	/// </summary>
+	void printRanking(std::ostream& out) const;
+
+private:
+	static uint64_t computeScore(const DeviceCandidate& candidate);
+
+	std::vector<VkPhysicalDevice> devices;
+	std::vector<VkPhysicalDeviceGroupProperties> groups;
+	std::vector<DeviceCandidate> candidates;
+	VkPhysicalDevice selected = VK_NULL_HANDLE;
+	bool selectedExplicitly = false;
+};
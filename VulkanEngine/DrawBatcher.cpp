@@ -0,0 +1,113 @@
+#include "DrawBatcher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+
+namespace {
+	const uint32_t RADIX_BITS = 8;
+	const uint32_t RADIX_SIZE = 1u << RADIX_BITS;
+	const uint32_t DIGITS = 64 / RADIX_BITS;
+}
+
+uint64_t DrawBatcher::makeKey(uint32_t pipeline, uint32_t material, uint32_t mesh, float depth) {
+	const float clamped = std::min(std::max(depth, 0.0f), 1.0f);
+	const uint64_t quantized = static_cast<uint64_t>(clamped * static_cast<float>((1u << DEPTH_BITS) - 1));
+
+	uint64_t key = pipeline;
+	key = (key << MATERIAL_BITS) | material;
+	key = (key << MESH_BITS) | mesh;
+	return (key << DEPTH_BITS) | quantized;
+}
+
+void DrawBatcher::radixSort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values, std::vector<uint64_t>& keyScratch,
+	std::vector<uint32_t>& valueScratch) {
+	const size_t count = keys.size();
+	keyScratch.resize(count);
+	valueScratch.resize(count);
+
+	// Every digit's histogram in one read of the keys
+	uint32_t histograms[DIGITS][RADIX_SIZE] = {};
+	for (uint64_t key : keys) {
+		for (uint32_t digit = 0; digit < DIGITS; digit++) {
+			histograms[digit][(key >> (digit * RADIX_BITS)) & (RADIX_SIZE - 1)]++;
+		}
+	}
+
+	for (uint32_t digit = 0; digit < DIGITS; digit++) {
+		uint32_t* histogram = histograms[digit];
+		const uint32_t shift = digit * RADIX_BITS;
+
+		// All keys in one bucket means this pass wouldn't move anything
+		if (count == 0 || histogram[(keys[0] >> shift) & (RADIX_SIZE - 1)] == count) {
+			continue;
+		}
+
+		uint32_t offset = 0;
+		for (uint32_t bucket = 0; bucket < RADIX_SIZE; bucket++) {
+			const uint32_t size = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += size;
+		}
+
+		for (size_t i = 0; i < count; i++) {
+			const uint32_t target = histogram[(keys[i] >> shift) & (RADIX_SIZE - 1)]++;
+			keyScratch[target] = keys[i];
+			valueScratch[target] = values[i];
+		}
+		keys.swap(keyScratch);
+		values.swap(valueScratch);
+	}
+}
+
+void DrawBatcher::reserve(size_t draws) {
+	keys.reserve(draws);
+	this->draws.reserve(draws);
+	keyScratch.reserve(draws);
+	drawScratch.reserve(draws);
+}
+
+void DrawBatcher::clear() {
+	keys.clear();
+	draws.clear();
+}
+
+void DrawBatcher::build() {
+	const auto start = std::chrono::steady_clock::now();
+	radixSort(keys, draws, keyScratch, drawScratch);
+
+	batches.clear();
+	uint32_t stateChanges = 0;
+	for (uint32_t i = 0; i < keys.size(); i++) {
+		const uint64_t stateKey = keys[i] >> DEPTH_BITS;
+		if (!batches.empty() && batches.back().stateKey == stateKey) {
+			batches.back().drawCount++;
+			continue;
+		}
+
+		if (batches.empty()) {
+			stateChanges += 3;
+		} else {
+			const uint64_t previous = batches.back().stateKey;
+			stateChanges += (getPipeline(stateKey) != getPipeline(previous) ? 1 : 0) + (getMaterial(stateKey) != getMaterial(previous) ? 1 : 0)
+				+ (getMesh(stateKey) != getMesh(previous) ? 1 : 0);
+		}
+		batches.push_back({ stateKey, i, 1 });
+	}
+
+	stats.lastDraws = static_cast<uint32_t>(keys.size());
+	stats.lastDrawCalls = static_cast<uint32_t>(batches.size());
+	stats.lastStateChanges = stateChanges;
+	stats.totalDraws += stats.lastDraws;
+	stats.totalDrawCalls += stats.lastDrawCalls;
+	stats.totalStateChanges += stats.lastStateChanges;
+	stats.frames++;
+	stats.lastBuildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void DrawBatcher::printStats(std::ostream& out) const {
+	const double frames = std::max<double>(stats.frames, 1.0);
+	out << std::fixed << std::setprecision(1) << stats.totalDraws / frames << " draws merged into " << stats.totalDrawCalls / frames
+		<< " draw calls with " << stats.totalStateChanges / frames << " state changes per frame on average, last sort and merge "
+		<< std::setprecision(3) << stats.lastBuildMilliseconds << " ms";
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+struct DrawBatcherStats {
+	uint32_t lastDraws = 0; // What went into the last build()
+	uint32_t lastDrawCalls = 0; // Batches it merged them into, one instanced draw each
+	uint32_t lastStateChanges = 0; // Pipeline, material and mesh switches between those batches, the first binds counted
+	uint64_t totalDraws = 0;
+	uint64_t totalDrawCalls = 0;
+	uint64_t totalStateChanges = 0;
+	uint32_t frames = 0; // build() calls
+	double lastBuildMilliseconds = 0.0; // Sort and merge
+};
+
+/// <summary>
+/// A run of draws with the same pipeline, material and mesh, recorded as one instanced draw.
+/// </summary>
+struct DrawBatch {
+	uint64_t stateKey; // The draws' sort key with the depth bits shifted out
+	uint32_t firstDraw; // Into getSortedDraws()
+	uint32_t drawCount;
+};
+
+/// <summary>
+/// Turns a frame's draw list into as few draw calls as it can. Every draw gets a 64 bit sort key holding, from the top,
+/// its pipeline, material, mesh and quantized depth; build() radix sorts the keys, which puts draws that share state next
+/// to each other in the order that makes binding cheapest, and then merges every run of equal state into one batch.
+/// Within a batch draws stay front to back.
+///
+/// The sort is LSD radix over bytes with the payload carried along, one histogram pass up front for all eight digits.
+/// Digits every key agrees on, typically the pipeline byte and the unused part of the material and mesh fields, are
+/// skipped, so a frame only pays for the bits that vary. Not thread safe.
+/// </summary>
+class DrawBatcher {
+public:
+	static const uint32_t PIPELINE_BITS = 8;
+	static const uint32_t MATERIAL_BITS = 16;
+	static const uint32_t MESH_BITS = 16;
+	static const uint32_t DEPTH_BITS = 24;
+
+	/// <summary>
+	/// Sort key of a draw. depth is in [0, 1], smaller first, and clamped to it; the ids must fit their fields.
+	/// </summary>
+	static uint64_t makeKey(uint32_t pipeline, uint32_t material, uint32_t mesh, float depth);
+
+	static uint32_t getPipeline(uint64_t stateKey) {
+		return static_cast<uint32_t>(stateKey >> (MATERIAL_BITS + MESH_BITS));
+	}
+
+	static uint32_t getMaterial(uint64_t stateKey) {
+		return static_cast<uint32_t>(stateKey >> MESH_BITS) & ((1u << MATERIAL_BITS) - 1);
+	}
+
+	static uint32_t getMesh(uint64_t stateKey) {
+		return static_cast<uint32_t>(stateKey) & ((1u << MESH_BITS) - 1);
+	}
+
+	/// <summary>
+	/// Sort keys ascending and carry values along with them, using keyScratch and valueScratch as the other half of each
+	/// pass. Stable. Exposed for the benchmarks.
+	/// </summary>
+	static void radixSort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values, std::vector<uint64_t>& keyScratch,
+		std::vector<uint32_t>& valueScratch);
+
+	void reserve(size_t draws);
+
+	/// <summary>
+	/// Start a new draw list. What the last build() produced stays valid until the next one.
+	/// </summary>
+	void clear();
+
+	void add(uint64_t key, uint32_t draw) {
+		keys.push_back(key);
+		draws.push_back(draw);
+	}
+
+	/// <summary>
+	/// Sort what was added since clear() and merge it into batches.
+	/// </summary>
+	void build();
+
+	/// <summary>
+	/// The draws of the last build() in sort order. Batch b covers [firstDraw, firstDraw + drawCount) of it.
+	/// </summary>
+	const std::vector<uint32_t>& getSortedDraws() const {
+		return draws;
+	}
+
+	const std::vector<DrawBatch>& getBatches() const {
+		return batches;
+	}
+
+	const DrawBatcherStats& getStats() const {
+		return stats;
+	}
+
+	void printStats(std::ostream& out) const;
+
+private:
+	std::vector<uint64_t> keys;
+	std::vector<uint32_t> draws;
+	std::vector<uint64_t> keyScratch;
+	std::vector<uint32_t> drawScratch;
+	std::vector<DrawBatch> batches;
+
+	DrawBatcherStats stats;
+};
@@ -0,0 +1,152 @@
+#include "DynamicState.h"
+
+#include <stdexcept>
+#include <string>
+
+namespace {
+	/// <summary>
+	/// The core name on 1.3, the extension's otherwise; both have the same signature.
+	/// </summary>
+	template <typename Function>
+	Function load(VkDevice device, bool core, const char* coreName, const char* extensionName) {
+		auto function = reinterpret_cast<Function>(vkGetDeviceProcAddr(device, core ? coreName : extensionName));
+		if (!function) {
+			throw std::runtime_error(std::string("Failed to load ") + (core ? coreName : extensionName) + "!");
+		}
+		return function;
+	}
+
+	const VkColorComponentFlags ALL_COMPONENTS = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT |
+		VK_COLOR_COMPONENT_A_BIT;
+
+	VkColorBlendEquationEXT getBlendEquation() {
+		VkColorBlendEquationEXT equation{};
+		equation.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+		equation.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+		equation.colorBlendOp = VK_BLEND_OP_ADD;
+		equation.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+		equation.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		equation.alphaBlendOp = VK_BLEND_OP_ADD;
+		return equation;
+	}
+}
+
+void DynamicState::init(VkDevice device, const DynamicStateSupport& support) {
+	this->support = support;
+	const bool core = support.core;
+
+	if (support.dynamicRendering) {
+		cmdBeginRendering = load<PFN_vkCmdBeginRendering>(device, core, "vkCmdBeginRendering", "vkCmdBeginRenderingKHR");
+		cmdEndRendering = load<PFN_vkCmdEndRendering>(device, core, "vkCmdEndRendering", "vkCmdEndRenderingKHR");
+	}
+	if (support.extendedDynamicState) {
+		cmdSetCullMode = load<PFN_vkCmdSetCullMode>(device, core, "vkCmdSetCullMode", "vkCmdSetCullModeEXT");
+		cmdSetFrontFace = load<PFN_vkCmdSetFrontFace>(device, core, "vkCmdSetFrontFace", "vkCmdSetFrontFaceEXT");
+		cmdSetDepthTestEnable = load<PFN_vkCmdSetDepthTestEnable>(device, core, "vkCmdSetDepthTestEnable", "vkCmdSetDepthTestEnableEXT");
+		cmdSetDepthWriteEnable = load<PFN_vkCmdSetDepthWriteEnable>(device, core, "vkCmdSetDepthWriteEnable", "vkCmdSetDepthWriteEnableEXT");
+		cmdSetDepthCompareOp = load<PFN_vkCmdSetDepthCompareOp>(device, core, "vkCmdSetDepthCompareOp", "vkCmdSetDepthCompareOpEXT");
+	}
+	if (support.extendedDynamicState2) {
+		cmdSetRasterizerDiscardEnable = load<PFN_vkCmdSetRasterizerDiscardEnable>(device, core, "vkCmdSetRasterizerDiscardEnable",
+			"vkCmdSetRasterizerDiscardEnableEXT");
+		cmdSetDepthBiasEnable = load<PFN_vkCmdSetDepthBiasEnable>(device, core, "vkCmdSetDepthBiasEnable", "vkCmdSetDepthBiasEnableEXT");
+	}
+	if (support.dynamicBlend) {
+		// Never promoted, always the extension's names
+		cmdSetColorBlendEnable = load<PFN_vkCmdSetColorBlendEnableEXT>(device, false, nullptr, "vkCmdSetColorBlendEnableEXT");
+		cmdSetColorBlendEquation = load<PFN_vkCmdSetColorBlendEquationEXT>(device, false, nullptr, "vkCmdSetColorBlendEquationEXT");
+		cmdSetColorWriteMask = load<PFN_vkCmdSetColorWriteMaskEXT>(device, false, nullptr, "vkCmdSetColorWriteMaskEXT");
+	}
+}
+
+void DynamicState::bakePipelineState(const RasterState& state, VkPipelineRasterizationStateCreateInfo& rasterizer,
+	VkPipelineDepthStencilStateCreateInfo& depthStencil, VkPipelineColorBlendAttachmentState& blendAttachment) {
+	rasterizer.rasterizerDiscardEnable = VK_FALSE;
+	rasterizer.cullMode = state.cullMode;
+	rasterizer.frontFace = state.frontFace;
+	rasterizer.depthBiasEnable = state.depthBias ? VK_TRUE : VK_FALSE;
+
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = state.depthTest ? VK_TRUE : VK_FALSE;
+	depthStencil.depthWriteEnable = state.depthWrite ? VK_TRUE : VK_FALSE;
+	depthStencil.depthCompareOp = state.depthCompareOp;
+	depthStencil.depthBoundsTestEnable = VK_FALSE;
+	depthStencil.stencilTestEnable = VK_FALSE;
+
+	const VkColorBlendEquationEXT equation = getBlendEquation();
+	blendAttachment.blendEnable = state.blend ? VK_TRUE : VK_FALSE;
+	blendAttachment.srcColorBlendFactor = equation.srcColorBlendFactor;
+	blendAttachment.dstColorBlendFactor = equation.dstColorBlendFactor;
+	blendAttachment.colorBlendOp = equation.colorBlendOp;
+	blendAttachment.srcAlphaBlendFactor = equation.srcAlphaBlendFactor;
+	blendAttachment.dstAlphaBlendFactor = equation.dstAlphaBlendFactor;
+	blendAttachment.alphaBlendOp = equation.alphaBlendOp;
+	blendAttachment.colorWriteMask = ALL_COMPONENTS;
+}
+
+void DynamicState::addDynamicStates(std::vector<VkDynamicState>& states) const {
+	if (support.extendedDynamicState) {
+		states.insert(states.end(), { VK_DYNAMIC_STATE_CULL_MODE, VK_DYNAMIC_STATE_FRONT_FACE, VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE,
+			VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE, VK_DYNAMIC_STATE_DEPTH_COMPARE_OP });
+	}
+	if (support.extendedDynamicState2) {
+		states.insert(states.end(), { VK_DYNAMIC_STATE_RASTERIZER_DISCARD_ENABLE, VK_DYNAMIC_STATE_DEPTH_BIAS_ENABLE });
+	}
+	if (support.dynamicBlend) {
+		states.insert(states.end(), { VK_DYNAMIC_STATE_COLOR_BLEND_ENABLE_EXT, VK_DYNAMIC_STATE_COLOR_BLEND_EQUATION_EXT,
+			VK_DYNAMIC_STATE_COLOR_WRITE_MASK_EXT });
+	}
+}
+
+void DynamicState::setRasterState(VkCommandBuffer commandBuffer, const RasterState& state) const {
+	if (support.extendedDynamicState) {
+		cmdSetCullMode(commandBuffer, state.cullMode);
+		cmdSetFrontFace(commandBuffer, state.frontFace);
+		cmdSetDepthTestEnable(commandBuffer, state.depthTest ? VK_TRUE : VK_FALSE);
+		cmdSetDepthWriteEnable(commandBuffer, state.depthWrite ? VK_TRUE : VK_FALSE);
+		cmdSetDepthCompareOp(commandBuffer, state.depthCompareOp);
+	}
+	if (support.extendedDynamicState2) {
+		cmdSetRasterizerDiscardEnable(commandBuffer, VK_FALSE);
+		cmdSetDepthBiasEnable(commandBuffer, state.depthBias ? VK_TRUE : VK_FALSE);
+	}
+	if (support.dynamicBlend) {
+		const VkBool32 blendEnable = state.blend ? VK_TRUE : VK_FALSE;
+		const VkColorBlendEquationEXT equation = getBlendEquation();
+		cmdSetColorBlendEnable(commandBuffer, 0, 1, &blendEnable);
+		cmdSetColorBlendEquation(commandBuffer, 0, 1, &equation);
+		cmdSetColorWriteMask(commandBuffer, 0, 1, &ALL_COMPONENTS);
+	}
+}
+
+void DynamicState::beginRendering(VkCommandBuffer commandBuffer, const VkRenderingInfo& renderingInfo) const {
+	cmdBeginRendering(commandBuffer, &renderingInfo);
+}
+
+void DynamicState::endRendering(VkCommandBuffer commandBuffer) const {
+	cmdEndRendering(commandBuffer);
+}
+
+void DynamicState::print(std::ostream& out) const {
+	std::vector<const char*> dynamic;
+	if (support.extendedDynamicState) {
+		dynamic.push_back("cull mode, front face, depth");
+	}
+	if (support.extendedDynamicState2) {
+		dynamic.push_back("rasterizer discard, depth bias");
+	}
+	if (support.dynamicBlend) {
+		dynamic.push_back("blend");
+	}
+
+	out << "Dynamic state: main pass begun with " << (support.dynamicRendering ? "vkCmdBeginRendering" : "a VkRenderPass") << ", ";
+	if (dynamic.empty()) {
+		out << "raster state baked into every pipeline";
+	} else {
+		for (size_t i = 0; i < dynamic.size(); i++) {
+			out << (i == 0 ? "" : ", ") << dynamic[i];
+		}
+		out << " set on the command buffer" << (support.core ? " (Vulkan 1.3)" : "");
+	}
+	out << "\n";
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <ostream>
+#include <vector>
+
+/// <summary>
+/// The fixed function state a draw wants from its pipeline. Without extended dynamic state it is baked in, and every
+/// combination needs a pipeline of its own; with it the command buffer sets it, so those pipelines collapse into one.
+/// </summary>
+struct RasterState {
+	VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+	VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+	bool depthTest = false; // Only does anything once a pass has a depth attachment
+	bool depthWrite = false;
+	VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+	bool depthBias = false;
+	bool blend = false; // Straight alpha over what is already there, alpha kept
+};
+
+/// <summary>
+/// What the device was created with, see DynamicState.
+/// </summary>
+struct DynamicStateSupport {
+	bool core = false; // Vulkan 1.3, where dynamic rendering and the first two extended dynamic states are core
+	bool dynamicRendering = false; // vkCmdBeginRendering instead of a VkRenderPass and VkFramebuffers
+	bool extendedDynamicState = false; // Cull mode, front face and depth state
+	bool extendedDynamicState2 = false; // Rasterizer discard and depth bias enable
+	bool dynamicBlend = false; // Blend enable, equation and colour write mask, from VK_EXT_extended_dynamic_state3
+};
+
+/// <summary>
+/// The opt-in path that moves as much as the device allows out of pipelines and render pass objects and into the
+/// command buffer: dynamic rendering (VK_KHR_dynamic_rendering, core in 1.3) replaces the main render pass and its per
+/// swap chain image framebuffers, and extended dynamic state 1, 2 and 3 take over RasterState. Vertex input, topology
+/// and primitive restart stay baked, mesh shader pipelines aren't allowed to make them dynamic.
+///
+/// Pipelines are built the same either way: addDynamicStates() adds what the device can change and
+/// bakePipelineState() fills in the rest, which the driver ignores for whatever is dynamic. Everything that binds such
+/// a pipeline has to call setRasterState() after it, in every command buffer, primaries and secondaries alike. Without
+/// extended dynamic state that is a no-op. Recording functions are const and may run on any thread.
+/// </summary>
+class DynamicState {
+public:
+	/// <summary>
+	/// Needs device created with everything support says it has.
+	/// </summary>
+	void init(VkDevice device, const DynamicStateSupport& support);
+
+	const DynamicStateSupport& getSupport() const {
+		return support;
+	}
+
+	bool isDynamicRendering() const {
+		return support.dynamicRendering;
+	}
+
+	/// <summary>
+	/// Fill the pipeline create info with state, whether or not it ends up dynamic.
+	/// </summary>
+	static void bakePipelineState(const RasterState& state, VkPipelineRasterizationStateCreateInfo& rasterizer,
+		VkPipelineDepthStencilStateCreateInfo& depthStencil, VkPipelineColorBlendAttachmentState& blendAttachment);
+
+	/// <summary>
+	/// Append the dynamic states this device supports on top of viewport and scissor, which are always dynamic.
+	/// </summary>
+	void addDynamicStates(std::vector<VkDynamicState>& states) const;
+
+	/// <summary>
+	/// Set every part of state addDynamicStates() made dynamic, for the single colour attachment the engine renders to.
+	/// </summary>
+	void setRasterState(VkCommandBuffer commandBuffer, const RasterState& state) const;
+
+	void beginRendering(VkCommandBuffer commandBuffer, const VkRenderingInfo& renderingInfo) const;
+	void endRendering(VkCommandBuffer commandBuffer) const;
+
+	/// <summary>
+	/// One line on which state is dynamic and how the main pass is begun.
+	/// </summary>
+	void print(std::ostream& out) const;
+
+private:
+	DynamicStateSupport support;
+
+	PFN_vkCmdBeginRendering cmdBeginRendering = nullptr;
+	PFN_vkCmdEndRendering cmdEndRendering = nullptr;
+	PFN_vkCmdSetCullMode cmdSetCullMode = nullptr;
+	PFN_vkCmdSetFrontFace cmdSetFrontFace = nullptr;
+	PFN_vkCmdSetDepthTestEnable cmdSetDepthTestEnable = nullptr;
+	PFN_vkCmdSetDepthWriteEnable cmdSetDepthWriteEnable = nullptr;
+	PFN_vkCmdSetDepthCompareOp cmdSetDepthCompareOp = nullptr;
+	PFN_vkCmdSetRasterizerDiscardEnable cmdSetRasterizerDiscardEnable = nullptr;
+	PFN_vkCmdSetDepthBiasEnable cmdSetDepthBiasEnable = nullptr;
+	PFN_vkCmdSetColorBlendEnableEXT cmdSetColorBlendEnable = nullptr;
+	PFN_vkCmdSetColorBlendEquationEXT cmdSetColorBlendEquation = nullptr;
+	PFN_vkCmdSetColorWriteMaskEXT cmdSetColorWriteMask = nullptr;
+};
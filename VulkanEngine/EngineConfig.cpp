@@ -0,0 +1,245 @@
+#include "EngineConfig.h"
+
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+namespace {
+	/// <summary>
+	/// Fetch the value following a flag, failing loudly if the flag was the last argument.
+	/// </summary>
+	const char* requireValue(int argc, char** argv, int& i) {
+		if (i + 1 >= argc) {
+			throw std::runtime_error(std::string("Missing value for ") + argv[i] + "!");
+		}
+		return argv[++i];
+	}
+}
+
+EngineConfig parseCommandLine(int argc, char** argv) {
+	EngineConfig config{};
+
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+
+		if (arg == "--frames-in-flight") {
+			const long value = std::strtol(requireValue(argc, argv, i), nullptr, 10);
+			if (value < 1 || value > 8) {
+				throw std::runtime_error("--frames-in-flight must be between 1 and 8!");
+			}
+			config.framesInFlight = static_cast<uint32_t>(value);
+		} else if (arg == "--window-size") {
+			char* end = nullptr;
+			const long width = std::strtol(requireValue(argc, argv, i), &end, 10);
+			const long height = *end == 'x' ? std::strtol(end + 1, nullptr, 10) : 0;
+			if (width < 1 || width > 16384 || height < 1 || height > 16384) {
+				throw std::runtime_error("--window-size must look like 1280x720, at most 16384 each way!");
+			}
+			config.windowWidth = static_cast<uint32_t>(width);
+			config.windowHeight = static_cast<uint32_t>(height);
+		} else if (arg == "--present-mode") {
+			const std::string value = requireValue(argc, argv, i);
+			if (value == "fifo") {
+				config.presentMode = PresentMode::Fifo;
+			} else if (value == "fifo-relaxed") {
+				config.presentMode = PresentMode::FifoRelaxed;
+			} else if (value == "mailbox") {
+				config.presentMode = PresentMode::Mailbox;
+			} else if (value == "immediate") {
+				config.presentMode = PresentMode::Immediate;
+			} else {
+				throw std::runtime_error("--present-mode must be fifo, fifo-relaxed, mailbox or immediate!");
+			}
+		} else if (arg == "--swapchain-images") {
+			const long value = std::strtol(requireValue(argc, argv, i), nullptr, 10);
+			if (value < 0 || value > 8) {
+				throw std::runtime_error("--swapchain-images must be between 0 (auto) and 8!");
+			}
+			config.swapChainImageCount = static_cast<uint32_t>(value);
+		} else if (arg == "--fps-limit") {
+			const double value = std::strtod(requireValue(argc, argv, i), nullptr);
+			if (value < 0.0 || value > 10000.0) {
+				throw std::runtime_error("--fps-limit must be between 0 (off) and 10000!");
+			}
+			config.frameRateLimit = value;
+		} else if (arg == "--idle-timeout") {
+			const double value = std::strtod(requireValue(argc, argv, i), nullptr);
+			if (value <= 0.0) {
+				throw std::runtime_error("--idle-timeout must be greater than zero!");
+			}
+			config.idleWaitTimeout = value;
+		} else if (arg == "--memory-block-size") {
+			const long value = std::strtol(requireValue(argc, argv, i), nullptr, 10);
+			if (value < 1 || value > 4096) {
+				throw std::runtime_error("--memory-block-size must be between 1 and 4096 MiB!");
+			}
+			config.memoryBlockSize = static_cast<uint64_t>(value) * 1024 * 1024;
+		} else if (arg == "--memory-stats") {
+			config.printMemoryStats = true;
+		} else if (arg == "--staging-size") {
+			const long value = std::strtol(requireValue(argc, argv, i), nullptr, 10);
+			if (value < 1 || value > 1024) {
+				throw std::runtime_error("--staging-size must be between 1 and 1024 MiB!");
+			}
+			config.stagingBufferSize = static_cast<uint64_t>(value) * 1024 * 1024;
+		} else if (arg == "--frame-arena-size") {
+			const long value = std::strtol(requireValue(argc, argv, i), nullptr, 10);
+			if (value < 1 || value > 1024 * 1024) {
+				throw std::runtime_error("--frame-arena-size must be between 1 and 1048576 KiB!");
+			}
+			config.frameArenaSize = static_cast<uint64_t>(value) * 1024;
+		} else if (arg == "--uniform-ring-size") {
+			const long value = std::strtol(requireValue(argc, argv, i), nullptr, 10);
+			if (value < 1 || value > 1024) {
+				throw std::runtime_error("--uniform-ring-size must be between 1 and 1024 MiB!");
+			}
+			config.uniformRingSize = static_cast<uint64_t>(value) * 1024 * 1024;
+		} else if (arg == "--pipeline-cache") {
+			config.pipelineCachePath = requireValue(argc, argv, i);
+		} else if (arg == "--no-pipeline-cache") {
+			config.pipelineCachePath.clear();
+		} else if (arg == "--hot-reload-shaders") {
+			config.shaderHotReload = true;
+		} else if (arg == "--threads") {
+			const long value = std::strtol(requireValue(argc, argv, i), nullptr, 10);
+			if (value < 0 || value > 64) {
+				throw std::runtime_error("--threads must be between 0 (auto) and 64!");
+			}
+			config.threadCount = static_cast<uint32_t>(value);
+		} else if (arg == "--draw-count") {
+			const long value = std::strtol(requireValue(argc, argv, i), nullptr, 10);
+			if (value < 1 || value > 1000000) {
+				throw std::runtime_error("--draw-count must be between 1 and 1000000!");
+			}
+			config.drawCount = static_cast<uint32_t>(value);
+		} else if (arg == "--print-capabilities") {
+			config.printCapabilities = true;
+		} else if (arg == "--device") {
+			config.device = requireValue(argc, argv, i);
+		} else if (arg == "--device-group") {
+			const std::string value = requireValue(argc, argv, i);
+			if (value == "afr") {
+				config.deviceGroup = DeviceGroupMode::AlternateFrame;
+			} else if (value == "sfr") {
+				config.deviceGroup = DeviceGroupMode::SplitFrame;
+			} else {
+				throw std::runtime_error("--device-group must be afr or sfr!");
+			}
+		} else if (arg == "--print-render-graph") {
+			config.printRenderGraph = true;
+		} else if (arg == "--bindless") {
+			config.bindless = true;
+		} else if (arg == "--gpu-driven") {
+			config.gpuDriven = true;
+		} else if (arg == "--mesh") {
+			config.meshPath = requireValue(argc, argv, i);
+		} else if (arg == "--mesh-shaders") {
+			config.meshShaders = true;
+		} else if (arg == "--texture-budget") {
+			const long value = std::strtol(requireValue(argc, argv, i), nullptr, 10);
+			if (value < 1 || value > 65536) {
+				throw std::runtime_error("--texture-budget must be between 1 and 65536 MiB!");
+			}
+			config.textureBudget = static_cast<uint64_t>(value) * 1024 * 1024;
+		} else if (arg == "--dynamic-rendering") {
+			config.dynamicRendering = true;
+		} else if (arg == "--no-async-compute") {
+			config.asyncCompute = false;
+		} else if (arg == "--no-draw-batching") {
+			config.drawBatching = false;
+		} else if (arg == "--cpu-culling") {
+			const std::string value = requireValue(argc, argv, i);
+			if (value == "none") {
+				config.cpuCulling = CpuCulling::None;
+			} else if (value == "brute-force") {
+				config.cpuCulling = CpuCulling::BruteForce;
+			} else if (value == "simd") {
+				config.cpuCulling = CpuCulling::Simd;
+			} else if (value == "bvh") {
+				config.cpuCulling = CpuCulling::Bvh;
+			} else {
+				throw std::runtime_error("--cpu-culling must be none, brute-force, simd or bvh!");
+			}
+		} else if (arg == "--pipeline-statistics") {
+			config.pipelineStatistics = true;
+		} else if (arg == "--trace") {
+			config.tracePath = requireValue(argc, argv, i);
+		} else if (arg == "--headless") {
+			config.headless = true;
+		} else if (arg == "--frames") {
+			const long value = std::strtol(requireValue(argc, argv, i), nullptr, 10);
+			if (value < 1 || value > 10000000) {
+				throw std::runtime_error("--frames must be between 1 and 10000000!");
+			}
+			config.frameCount = static_cast<uint32_t>(value);
+		} else if (arg == "--warmup-frames") {
+			const long value = std::strtol(requireValue(argc, argv, i), nullptr, 10);
+			if (value < 0 || value > 100000) {
+				throw std::runtime_error("--warmup-frames must be between 0 and 100000!");
+			}
+			config.warmupFrames = static_cast<uint32_t>(value);
+		} else if (arg == "--benchmark-output") {
+			config.benchmarkOutputPath = requireValue(argc, argv, i);
+		} else if (arg == "--scene") {
+			config.benchmarkScene = requireValue(argc, argv, i);
+		} else if (arg == "--debug-severity") {
+			const std::string value = requireValue(argc, argv, i);
+			if (value == "verbose") {
+				config.debugSeverity = DebugSeverity::Verbose;
+			} else if (value == "info") {
+				config.debugSeverity = DebugSeverity::Info;
+			} else if (value == "warning") {
+				config.debugSeverity = DebugSeverity::Warning;
+			} else if (value == "error") {
+				config.debugSeverity = DebugSeverity::Error;
+			} else {
+				throw std::runtime_error("--debug-severity must be verbose, info, warning or error!");
+			}
+		} else if (arg == "--debug-message-limit") {
+			const long value = std::strtol(requireValue(argc, argv, i), nullptr, 10);
+			if (value < 1 || value > 1000000) {
+				throw std::runtime_error("--debug-message-limit must be between 1 and 1000000!");
+			}
+			config.debugMessageLimit = static_cast<uint32_t>(value);
+		} else if (arg == "--gpu-validation") {
+			config.gpuAssistedValidation = true;
+		} else if (arg == "--sync-validation") {
+			config.synchronizationValidation = true;
+		} else if (arg == "--scene-scale") {
+			const double value = std::strtod(requireValue(argc, argv, i), nullptr);
+			if (value < 1.0 || value > 100.0) {
+				throw std::runtime_error("--scene-scale must be between 1 and 100!");
+			}
+			config.sceneScale = static_cast<float>(value);
+		} else if (arg == "--simulation-threads") {
+			const long value = std::strtol(requireValue(argc, argv, i), nullptr, 10);
+			if (value < 1 || value > 32) {
+				throw std::runtime_error("--simulation-threads must be between 1 and 32!");
+			}
+			config.simulationThreads = static_cast<uint32_t>(value);
+		} else {
+			throw std::runtime_error("Unknown argument: " + arg);
+		}
+	}
+
+	if (config.meshShaders && config.meshPath.empty()) {
+		throw std::runtime_error("--mesh-shaders needs a mesh to draw, pass one with --mesh PATH!");
+	}
+	if (config.textureBudget != 0 && (config.meshPath.empty() || (!config.gpuDriven && !config.meshShaders))) {
+		throw std::runtime_error("--texture-budget needs a textured mesh drawn on the GPU, pass --mesh PATH and --gpu-driven or --mesh-shaders!");
+	}
+	if (config.simulationThreads != 0 && (config.gpuDriven || config.meshShaders)) {
+		throw std::runtime_error("--simulation-threads only moves the CPU recorded path's draws, drop --gpu-driven and --mesh-shaders!");
+	}
+	if (config.deviceGroup != DeviceGroupMode::None && !config.headless) {
+		throw std::runtime_error("--device-group needs --headless, presenting from a device group isn't supported!");
+	}
+
+	if (config.device.empty()) {
+		if (const char* device = std::getenv("VULKAN_ENGINE_DEVICE")) {
+			config.device = device;
+		}
+	}
+
+	return config;
+}
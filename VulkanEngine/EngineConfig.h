@@ -0,0 +1,195 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+enum class DebugSeverity {
+	Verbose,
+	Info,
+	Warning,
+	Error
+};
+
+/// <summary>
+/// Present mode the swap chain asks for. Modes the surface doesn't offer fall back towards Fifo, which always exists.
+/// </summary>
+enum class PresentMode {
+	Fifo, // Vsync, queues up to the image count. Lowest power, most latency
+	FifoRelaxed, // Vsync, but a late frame is shown right away and tears instead of waiting another refresh
+	Mailbox, // Vsync without backpressure, the newest frame replaces a queued one. Falls back to Fifo
+	Immediate // No vsync, tears. Falls back to Mailbox, then Fifo
+};
+
+/// <summary>
+/// How the CPU recorded path picks the draws it records. The GPU driven path culls on the GPU and ignores this.
+/// </summary>
+enum class CpuCulling {
+	None, // Record everything
+	BruteForce, // Test every box, one at a time
+	Simd, // Test every box, a SIMD vector at a time
+	Bvh // Walk a bounding volume hierarchy over the scene, refitted when it moves
+};
+
+/// <summary>
+/// How frames are spread over the physical devices of a device group (core in Vulkan 1.1), for machines with linked GPUs.
+/// </summary>
+enum class DeviceGroupMode {
+	None, // Render on the selected device alone
+	AlternateFrame, // Each frame runs on the next device of the group in turn, so frames in flight overlap across devices
+	SplitFrame // Every frame runs on every device, each rasterizing its own horizontal band of the target
+};
+
+/// <summary>
+/// Runtime knobs for the engine. Filled in from the command line by parseCommandLine() before run() is called.
+/// </summary>
+struct EngineConfig {
+	// How many frames the CPU is allowed to record ahead of the GPU. Each one gets its own command buffer, fence and semaphores.
+	uint32_t framesInFlight = 2;
+
+	// Initial window size, and the size of the offscreen target when headless. The window can be resized afterwards.
+	uint32_t windowWidth = 800;
+	uint32_t windowHeight = 600;
+
+	PresentMode presentMode = PresentMode::Fifo;
+
+	// Swap chain images to ask for. 0 uses one more than the surface minimum. Clamped to what the surface supports.
+	uint32_t swapChainImageCount = 0;
+
+	// Cap on frames per second, 0 for none. The limiter sleeps before input is polled rather than after the frame, so
+	// the frame that follows starts from the freshest input it can get.
+	double frameRateLimit = 0.0;
+
+	// How long (in seconds) mainLoop() blocks in glfwWaitEventsTimeout while the window is minimized or unfocused.
+	double idleWaitTimeout = 0.1;
+
+	// Size of the VkDeviceMemory blocks the memory allocator sub-allocates from. Smaller heaps get scaled down from this.
+	uint64_t memoryBlockSize = 64ull * 1024 * 1024;
+
+	// Dump per pool memory usage and fragmentation at shutdown, for tuning memoryBlockSize.
+	bool printMemoryStats = false;
+
+	// Size of the persistently mapped ring every upload to device local memory is staged through.
+	uint64_t stagingBufferSize = 64ull * 1024 * 1024;
+
+	// Starting size of each frame in flight's bump arena for per-frame CPU data. Grows by itself if a frame needs more.
+	uint64_t frameArenaSize = 1024 * 1024;
+
+	// Size of each frame in flight's region of the dynamic uniform ring. Raised at startup if the scene needs more.
+	uint64_t uniformRingSize = 4ull * 1024 * 1024;
+
+	// Where the VkPipelineCache blob is persisted between runs. Empty disables the on-disk cache.
+	std::string pipelineCachePath = "pipeline_cache.bin";
+
+	// Development only: watch the shader sources, recompile whatever changes with glslc and rebuild the pipelines that use
+	// it while the engine runs, see ShaderWatcher.
+	bool shaderHotReload = false;
+
+	// Threads in the job system, counting the main thread. 0 uses one per hardware thread.
+	uint32_t threadCount = 0;
+
+	// Dump every instance layer, instance extension and device extension found at startup, and how the devices ranked.
+	bool printCapabilities = false;
+
+	// The physical device to render on: its index in enumeration order, or part of its name, case insensitive. Empty picks
+	// the best scoring one, see DeviceSelector. Taken from the VULKAN_ENGINE_DEVICE environment variable if not given.
+	std::string device;
+
+	// Headless only: spread frames over the selected device's group, see DeviceGroupMode. Falls back to the device alone
+	// when it has no other device to share the work with.
+	DeviceGroupMode deviceGroup = DeviceGroupMode::None;
+
+	// Dump the first frame's compiled render graph: its passes, the barriers between them and where transients were placed.
+	bool printRenderGraph = false;
+
+	// Number of triangles drawn each frame, laid out on a grid. Raise it to put load on the parallel recording path.
+	uint32_t drawCount = 1;
+
+	// Bind every texture and storage buffer through one update-after-bind descriptor set and pick them by index.
+	// Falls back to classic descriptor sets when the device lacks descriptor indexing.
+	bool bindless = false;
+
+	// Cull on the GPU and draw the survivors with vkCmdDrawIndexedIndirectCount instead of one CPU recorded draw per object.
+	// Falls back to the classic path when the device can't do indirect count draws.
+	bool gpuDriven = false;
+
+	// A cooked asset file (.vea) whose first mesh the GPU driven and mesh shader paths draw for every object instead of the
+	// triangle. The CPU recorded path keeps drawing the triangle. Empty draws the triangle everywhere.
+	std::string meshPath;
+
+	// Draw the mesh's meshlets with task and mesh shaders (VK_EXT_mesh_shader), culling every meshlet against the view and
+	// by its normal cone in the task shader. Needs meshPath. Falls back to the GPU driven path when the device lacks
+	// mesh shaders.
+	bool meshShaders = false;
+
+	// Stream the textures of meshPath's file under this many bytes of device memory, loading and evicting mips by what
+	// the GPU driven and mesh shader paths sampled, see TextureStreamer. 0 leaves the mesh untextured. Needs meshPath and
+	// one of those paths. Falls back to untextured when the device can't index sampler arrays or store from fragments.
+	uint64_t textureBudget = 0;
+
+	// Begin the main pass with dynamic rendering instead of a VkRenderPass and framebuffers, and set cull mode, winding,
+	// depth and blend state on the command buffer with extended dynamic state so pipelines don't bake them in. Each part
+	// falls back to the classic way on its own when the device lacks it, see DynamicState.
+	bool dynamicRendering = false;
+
+	// Run async compute passes, today the GPU cull, on a compute-only queue so they overlap graphics work. Without such a
+	// queue they run in line on the graphics queue.
+	bool asyncCompute = true;
+
+	// How the CPU recorded path culls its draw list every frame, see CpuCulling.
+	CpuCulling cpuCulling = CpuCulling::Bvh;
+
+	// Sort the CPU recorded path's draws by state and merge every run with the same pipeline, material and mesh into one
+	// instanced draw, see DrawBatcher. Off records one draw per object.
+	bool drawBatching = true;
+
+	// Wrap each GPU scope in a pipeline statistics query too. Ignored when the device lacks pipelineStatisticsQuery.
+	bool pipelineStatistics = false;
+
+	// Write every CPU and GPU profiler scope to this file as a Chrome trace on exit. Empty disables tracing.
+	std::string tracePath;
+
+	// Render into an offscreen image with no window, surface or swap chain, for benchmarking on machines without a display.
+	bool headless = false;
+
+	// Stop after this many frames. 0 runs until the window is closed, or DEFAULT_HEADLESS_FRAMES when headless.
+	uint32_t frameCount = 0;
+	static const uint32_t DEFAULT_HEADLESS_FRAMES = 600;
+
+	// Frames at the start of a run left out of the benchmark numbers, while caches, pools and clocks settle.
+	uint32_t warmupFrames = 60;
+
+	// Where the frame time, GPU time and memory numbers of the run go as JSON. Empty prints a summary only.
+	std::string benchmarkOutputPath;
+
+	// Benchmark suite only: run just the scene with this name instead of all of them.
+	std::string benchmarkScene;
+
+	// Debug builds only: the least severe validation message that gets printed, and how many times one message may
+	// repeat before it is muted for the rest of the run.
+	DebugSeverity debugSeverity = DebugSeverity::Warning;
+	uint32_t debugMessageLimit = 10;
+
+	// Debug builds only: GPU-assisted and synchronization validation in the validation layer. Both are slow.
+	bool gpuAssistedValidation = false;
+	bool synchronizationValidation = false;
+
+	// Size of the draw grid relative to the screen. Above 1 most of the scene is off screen, which is what culling is for.
+	float sceneScale = 1.0f;
+
+	// Move the draws and recolour them from this many simulation threads running a frame ahead of the render loop, see
+	// Simulation. 0 keeps the scene still. Only the CPU recorded path picks the motion up, the GPU driven paths upload
+	// their instances once.
+	uint32_t simulationThreads = 0;
+};
+
+/// <summary>
+/// Build an EngineConfig from argv. Unknown arguments are rejected so typos don't silently fall back to defaults.
+/// Supported: --frames-in-flight N, --window-size WxH, --present-mode fifo|fifo-relaxed|mailbox|immediate, --swapchain-images N,
+/// --fps-limit FPS, --idle-timeout SECONDS, --memory-block-size MIB, --memory-stats, --staging-size MIB, --frame-arena-size KIB,
+/// --uniform-ring-size MIB, --pipeline-cache PATH, --no-pipeline-cache, --hot-reload-shaders, --threads N, --draw-count N,
+/// --print-capabilities, --device INDEX|NAME, --device-group afr|sfr, --print-render-graph, --bindless, --gpu-driven, --mesh PATH, --mesh-shaders, --texture-budget MIB,
+/// --dynamic-rendering, --no-async-compute, --cpu-culling none|brute-force|simd|bvh, --no-draw-batching, --scene-scale S,
+/// --simulation-threads N, --pipeline-statistics, --trace PATH, --headless, --frames N, --warmup-frames N, --benchmark-output PATH, --scene NAME,
+/// --debug-severity verbose|info|warning|error, --debug-message-limit N, --gpu-validation, --sync-validation
+/// </summary>
+EngineConfig parseCommandLine(int argc, char** argv);
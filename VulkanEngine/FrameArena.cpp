@@ -0,0 +1,75 @@
+#include "FrameArena.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+
+namespace {
+	size_t alignUp(size_t value, size_t alignment) {
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+void FrameArena::init(size_t size) {
+	capacity = std::max<size_t>(size, 64);
+	block = std::make_unique<char[]>(capacity);
+	offset = 0;
+	frameBytes = 0;
+	overflow.clear();
+	stats = FrameArenaStats{};
+	stats.capacity = capacity;
+}
+
+void FrameArena::cleanup() {
+	block.reset();
+	overflow.clear();
+	capacity = 0;
+	offset = 0;
+	frameBytes = 0;
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment) {
+	if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+		throw std::runtime_error("Frame arena alignment must be a power of two!");
+	}
+	size = std::max<size_t>(size, 1);
+
+	// Align the address rather than the offset, make_unique<char[]> only promises max_align_t
+	const uintptr_t base = reinterpret_cast<uintptr_t>(block.get());
+	const size_t aligned = alignUp(base + offset, alignment) - base;
+	if (aligned + size <= capacity) {
+		frameBytes += aligned + size - offset;
+		offset = aligned + size;
+		return block.get() + aligned;
+	}
+
+	// Out of room: hand out a block of its own and remember to grow at the next reset
+	overflow.push_back(std::make_unique<char[]>(size + alignment - 1));
+	stats.overflowBlocks++;
+	frameBytes += size + alignment - 1;
+
+	const uintptr_t overflowBase = reinterpret_cast<uintptr_t>(overflow.back().get());
+	return overflow.back().get() + (alignUp(overflowBase, alignment) - overflowBase);
+}
+
+void FrameArena::reset() {
+	stats.lastFrameBytes = frameBytes;
+	stats.peakBytes = std::max(stats.peakBytes, frameBytes);
+	stats.frames++;
+
+	if (!overflow.empty()) {
+		// Grow past the high-water mark with some slack, so a frame that comes close doesn't spill again straight away
+		overflow.clear();
+		capacity = alignUp(stats.peakBytes + stats.peakBytes / 4, 4096);
+		block = std::make_unique<char[]>(capacity);
+		stats.capacity = capacity;
+	}
+
+	offset = 0;
+	frameBytes = 0;
+}
+
+void FrameArena::printStats(std::ostream& out) const {
+	out << std::fixed << std::setprecision(1) << stats.peakBytes / 1024.0 << " KiB peak, " << stats.lastFrameBytes / 1024.0
+		<< " KiB last frame, " << stats.capacity / 1024.0 << " KiB block, " << stats.overflowBlocks << " overflow blocks";
+}
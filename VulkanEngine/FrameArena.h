@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+struct FrameArenaStats {
+	size_t capacity = 0; // Size of the main block
+	size_t lastFrameBytes = 0; // Used by the frame before the last reset()
+	size_t peakBytes = 0; // High-water mark over every frame so far
+	uint32_t frames = 0;
+	uint32_t overflowBlocks = 0; // Extra blocks handed out because the main block ran out, summed over every frame
+};
+
+/// <summary>
+/// Bump allocator for CPU data that lives exactly as long as one frame in flight: draw lists, descriptor writes, the
+/// command buffer lists handed to vkCmdExecuteCommands. Allocation is a pointer increment, nothing is freed individually,
+/// and reset() recycles everything at once after the frame's fence has signalled.
+///
+/// Running out spills into overflow blocks instead of failing; the next reset() grows the main block to the frame's
+/// high-water mark, so the heap is only touched while the arena warms up. Not thread safe: each frame's arena belongs to
+/// the thread that records the frame.
+/// </summary>
+class FrameArena {
+public:
+	static const size_t DEFAULT_SIZE = 1024 * 1024;
+
+	void init(size_t size = DEFAULT_SIZE);
+	void cleanup();
+
+	/// <summary>
+	/// alignment must be a power of two. Never returns null, zero sized requests get a unique pointer too.
+	/// </summary>
+	void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+	/// <summary>
+	/// Forget every allocation since the last reset. Anything still pointing into the arena dangles afterwards.
+	/// </summary>
+	void reset();
+
+	size_t getBytesUsed() const {
+		return frameBytes;
+	}
+
+	FrameArenaStats getStats() const {
+		return stats;
+	}
+
+	void printStats(std::ostream& out) const;
+
+private:
+	std::unique_ptr<char[]> block;
+	size_t capacity = 0;
+	size_t offset = 0;
+	size_t frameBytes = 0; // Including alignment padding and overflow allocations
+
+	std::vector<std::unique_ptr<char[]>> overflow;
+	FrameArenaStats stats;
+};
+
+/// <summary>
+/// Standard allocator over a FrameArena, so std containers can live in frame memory. deallocate() is a no-op: memory
+/// comes back when the arena is reset, which means such containers must not outlive the frame. Growing one leaves its
+/// old storage behind until then, so size or reserve them up front.
+/// </summary>
+template <typename T>
+class ArenaAllocator {
+public:
+	using value_type = T;
+
+	explicit ArenaAllocator(FrameArena& arena) : arena(&arena) {}
+
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.getArena()) {}
+
+	T* allocate(size_t count) {
+		return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T*, size_t) {}
+
+	FrameArena* getArena() const {
+		return arena;
+	}
+
+	template <typename U>
+	bool operator==(const ArenaAllocator<U>& other) const {
+		return arena == other.getArena();
+	}
+
+	template <typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const {
+		return arena != other.getArena();
+	}
+
+private:
+	FrameArena* arena;
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
@@ -0,0 +1,58 @@
+#include "FrameCommandPools.h"
+
+#include <stdexcept>
+
+void FrameCommandPools::init(VkDevice device, uint32_t queueFamilyIndex, uint32_t threadCount) {
+	this->device = device;
+	threads.resize(threadCount);
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT; // Everything is re-recorded every frame and reset as a whole
+	poolInfo.queueFamilyIndex = queueFamilyIndex;
+
+	for (auto& thread : threads) {
+		if (vkCreateCommandPool(device, &poolInfo, nullptr, &thread.pool) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create command pool!");
+		}
+	}
+}
+
+void FrameCommandPools::cleanup() {
+	// Destroying a pool frees every buffer allocated from it
+	for (auto& thread : threads) {
+		vkDestroyCommandPool(device, thread.pool, nullptr);
+	}
+	threads.clear();
+}
+
+void FrameCommandPools::reset() {
+	for (auto& thread : threads) {
+		vkResetCommandPool(device, thread.pool, 0);
+		thread.primariesUsed = 0;
+		thread.secondariesUsed = 0;
+	}
+}
+
+VkCommandBuffer FrameCommandPools::acquire(uint32_t threadIndex, VkCommandBufferLevel level) {
+	ThreadPool& thread = threads[threadIndex];
+	const bool primary = level == VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	std::vector<VkCommandBuffer>& buffers = primary ? thread.primaries : thread.secondaries;
+	size_t& used = primary ? thread.primariesUsed : thread.secondariesUsed;
+
+	if (used == buffers.size()) {
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = thread.pool;
+		allocInfo.level = level;
+		allocInfo.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer;
+		if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to allocate command buffers!");
+		}
+		buffers.push_back(commandBuffer);
+	}
+
+	return buffers[used++];
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// The command pools of one frame in flight, one per recording thread. A VkCommandPool must only be used from one thread
+/// at a time, so giving each thread its own means recording never takes a lock. Buffers are never freed individually:
+/// reset() recycles the whole frame with one vkResetCommandPool per thread once the frame's fence has signalled.
+/// </summary>
+class FrameCommandPools {
+public:
+	void init(VkDevice device, uint32_t queueFamilyIndex, uint32_t threadCount);
+	void cleanup();
+
+	/// <summary>
+	/// Must only be called once the GPU is done with everything recorded since the last reset.
+	/// </summary>
+	void reset();
+
+	/// <summary>
+	/// Hand out a command buffer from the calling thread's pool. Buffers are allocated the first time a frame needs them
+	/// and recycled by every reset() after that.
+	/// </summary>
+	VkCommandBuffer acquire(uint32_t threadIndex, VkCommandBufferLevel level);
+
+	uint32_t getThreadCount() const {
+		return static_cast<uint32_t>(threads.size());
+	}
+
+private:
+	struct ThreadPool {
+		VkCommandPool pool = VK_NULL_HANDLE;
+		std::vector<VkCommandBuffer> primaries;
+		std::vector<VkCommandBuffer> secondaries;
+		size_t primariesUsed = 0;
+		size_t secondariesUsed = 0;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	std::vector<ThreadPool> threads;
+};
@@ -0,0 +1,89 @@
+#include "FrustumCulling.h"
+
+#include "SimdFloat.h"
+
+namespace {
+	// A plane with its normal broadcast and the columns of the box corner it tests, the one furthest along the normal
+	template <typename V>
+	struct PreparedPlane {
+		V normal[3];
+		V distance;
+		const float* corner[3];
+	};
+
+	/// <summary>
+	/// Test V::WIDTH boxes from index on and append the entities of the visible ones. A box is outside when its furthest
+	/// corner is behind some plane, so the smallest of the six distances decides.
+	/// </summary>
+	template <typename V>
+	void cullBoxes(const PreparedPlane<V> (&planes)[6], const SceneStore::EntityId* entities, uint32_t index,
+		std::vector<SceneStore::EntityId>& visible) {
+		V nearest = planes[0].normal[0] * V::load(planes[0].corner[0] + index) + planes[0].normal[1] * V::load(planes[0].corner[1] + index)
+			+ planes[0].normal[2] * V::load(planes[0].corner[2] + index) + planes[0].distance;
+		for (int i = 1; i < 6; i++) {
+			const PreparedPlane<V>& plane = planes[i];
+			const V distance = plane.normal[0] * V::load(plane.corner[0] + index) + plane.normal[1] * V::load(plane.corner[1] + index)
+				+ plane.normal[2] * V::load(plane.corner[2] + index) + plane.distance;
+			nearest = min(nearest, distance);
+		}
+
+		uint32_t inside = ~nearest.negativeMask() & ((1u << V::WIDTH) - 1);
+		while (inside != 0) {
+			uint32_t lane = 0;
+			while ((inside & (1u << lane)) == 0) {
+				lane++;
+			}
+			visible.push_back(entities[index + lane]);
+			inside &= inside - 1;
+		}
+	}
+
+	template <typename V>
+	void preparePlanes(const SceneStore::BoundsColumns& boxes, const Frustum& frustum, PreparedPlane<V> (&planes)[6]) {
+		for (int i = 0; i < 6; i++) {
+			const glm::vec4& plane = frustum.planes[i];
+			const float normal[3] = { plane.x, plane.y, plane.z };
+			for (int axis = 0; axis < 3; axis++) {
+				planes[i].normal[axis] = V::broadcast(normal[axis]);
+				planes[i].corner[axis] = normal[axis] >= 0.0f ? boxes.max[axis] : boxes.min[axis];
+			}
+			planes[i].distance = V::broadcast(plane.w);
+		}
+	}
+}
+
+void cullBruteForce(const SceneStore::BoundsColumns& boxes, uint32_t begin, uint32_t end, const Frustum& frustum,
+	std::vector<SceneStore::EntityId>& visible) {
+	for (uint32_t i = begin; i < end; i++) {
+		bool inside = true;
+		for (int p = 0; p < 6 && inside; p++) {
+			const glm::vec4& plane = frustum.planes[p];
+			const float x = plane.x >= 0.0f ? boxes.max[0][i] : boxes.min[0][i];
+			const float y = plane.y >= 0.0f ? boxes.max[1][i] : boxes.min[1][i];
+			const float z = plane.z >= 0.0f ? boxes.max[2][i] : boxes.min[2][i];
+			inside = plane.x * x + plane.y * y + plane.z * z + plane.w >= 0.0f;
+		}
+		if (inside) {
+			visible.push_back(boxes.entities[i]);
+		}
+	}
+}
+
+void cullSimd(const SceneStore::BoundsColumns& boxes, uint32_t begin, uint32_t end, const Frustum& frustum,
+	std::vector<SceneStore::EntityId>& visible) {
+	PreparedPlane<SimdFloat> planes[6];
+	preparePlanes(boxes, frustum, planes);
+
+	uint32_t index = begin;
+	for (; index + SimdFloat::WIDTH <= end; index += SimdFloat::WIDTH) {
+		cullBoxes(planes, boxes.entities, index, visible);
+	}
+
+	if (index < end) {
+		PreparedPlane<ScalarFloat> scalarPlanes[6];
+		preparePlanes(boxes, frustum, scalarPlanes);
+		for (; index < end; index++) {
+			cullBoxes(scalarPlanes, boxes.entities, index, visible);
+		}
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "SceneStore.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// Six inward facing planes as (normal, distance): a point p is inside when dot(normal, p) + distance >= 0 for all of
+/// them. The normals don't have to be unit length.
+/// </summary>
+struct Frustum {
+	glm::vec4 planes[6];
+};
+
+/// <summary>
+/// Append the entity of every box in [begin, end) of boxes that isn't entirely outside one of frustum's planes, testing
+/// one box at a time and leaving as soon as a plane rejects it. The reference the other culling paths are measured against.
+/// </summary>
+void cullBruteForce(const SceneStore::BoundsColumns& boxes, uint32_t begin, uint32_t end, const Frustum& frustum,
+	std::vector<SceneStore::EntityId>& visible);
+
+/// <summary>
+/// Same result as cullBruteForce(), SimdFloat::WIDTH boxes against all six planes per step without branching. Each plane
+/// tests the box corner furthest along its normal, which is picked by the normal's signs once per plane rather than per box.
+/// </summary>
+void cullSimd(const SceneStore::BoundsColumns& boxes, uint32_t begin, uint32_t end, const Frustum& frustum,
+	std::vector<SceneStore::EntityId>& visible);
+
+inline void cullBruteForce(const SceneStore::BoundsColumns& boxes, const Frustum& frustum, std::vector<SceneStore::EntityId>& visible) {
+	cullBruteForce(boxes, 0, boxes.count, frustum, visible);
+}
+
+inline void cullSimd(const SceneStore::BoundsColumns& boxes, const Frustum& frustum, std::vector<SceneStore::EntityId>& visible) {
+	cullSimd(boxes, 0, boxes.count, frustum, visible);
+}
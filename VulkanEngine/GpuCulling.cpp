@@ -0,0 +1,297 @@
+#include "GpuCulling.h"
+
+#include <chrono>
+#include <iomanip>
+#include <stdexcept>
+
+void GpuCulling::init(VkDevice device, DeviceMemoryAllocator& allocator, StagingRing& stagingRing, PipelineCache& pipelineCache,
+	const std::vector<char>& cullShaderCode, uint32_t framesInFlight, const std::vector<GpuInstance>& instances, VkBuffer materialBuffer,
+	const std::vector<uint32_t>& sharedFamilies) {
+	this->device = device;
+	this->allocator = &allocator;
+	this->sharedFamilies = sharedFamilies;
+	instanceCount = static_cast<uint32_t>(instances.size());
+
+	// Loaded through the extension entry point so it works on 1.1 devices as well as 1.2 ones
+	drawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCountKHR"));
+	if (!drawIndexedIndirectCount) {
+		throw std::runtime_error("Failed to load vkCmdDrawIndexedIndirectCountKHR!");
+	}
+
+	// Written once and read every frame, so they live in device local memory
+	instanceBuffer = createDeviceBuffer(sizeof(GpuInstance) * instances.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, true, instanceAllocation);
+	stagingRing.uploadBuffer(instanceBuffer, 0, instances.data(), sizeof(GpuInstance) * instances.size());
+
+	const uint32_t indices[] = { 0, 1, 2 };
+	indexBuffer = createDeviceBuffer(sizeof(indices), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, false, indexAllocation); // Graphics only
+	stagingRing.uploadBuffer(indexBuffer, 0, indices, sizeof(indices));
+
+	frames.resize(framesInFlight);
+	for (auto& frame : frames) {
+		VkBufferCreateInfo bufferInfo{};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = sizeof(VkDrawIndexedIndirectCommand) * instances.size();
+		bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+		setSharing(bufferInfo);
+
+		AllocationCreateInfo allocationInfo{};
+		frame.commandBuffer = allocator.createBuffer(bufferInfo, allocationInfo, frame.commandAllocation);
+
+		// Coherent, so the host sees the count without an invalidate
+		VkBufferCreateInfo countInfo{};
+		countInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		countInfo.size = sizeof(uint32_t);
+		countInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		setSharing(countInfo);
+
+		AllocationCreateInfo countAllocationInfo{};
+		countAllocationInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		frame.countBuffer = allocator.createBuffer(countInfo, countAllocationInfo, frame.countAllocation);
+	}
+
+	createDescriptors(framesInFlight, materialBuffer);
+	createPipeline(pipelineCache, cullShaderCode);
+}
+
+void GpuCulling::cleanup() {
+	vkDestroyPipeline(device, pipeline, nullptr);
+	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+
+	for (auto& frame : frames) {
+		allocator->destroyBuffer(frame.countBuffer, frame.countAllocation);
+		allocator->destroyBuffer(frame.commandBuffer, frame.commandAllocation);
+	}
+	frames.clear();
+
+	allocator->destroyBuffer(indexBuffer, indexAllocation);
+	allocator->destroyBuffer(instanceBuffer, instanceAllocation);
+}
+
+void GpuCulling::reloadPipeline(PipelineCache& pipelineCache, const std::vector<char>& cullShaderCode, DeletionQueue& deletionQueue) {
+	VkDevice device = this->device;
+	VkPipeline pipeline = this->pipeline;
+	VkPipelineLayout pipelineLayout = this->pipelineLayout;
+	deletionQueue.defer([device, pipeline, pipelineLayout] {
+		vkDestroyPipeline(device, pipeline, nullptr);
+		vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+	});
+	createPipeline(pipelineCache, cullShaderCode);
+}
+
+void GpuCulling::setMesh(VkBuffer vertexBuffer, VkBuffer indexBuffer, uint32_t indexCount) {
+	meshVertexBuffer = vertexBuffer;
+	meshIndexBuffer = indexBuffer;
+	this->indexCount = indexCount;
+}
+
+VkBuffer GpuCulling::createDeviceBuffer(VkDeviceSize size, VkBufferUsageFlags usage, bool shared, Allocation& allocation) {
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if (shared) {
+		setSharing(bufferInfo);
+	}
+
+	AllocationCreateInfo allocationInfo{};
+	return allocator->createBuffer(bufferInfo, allocationInfo, allocation);
+}
+
+void GpuCulling::setSharing(VkBufferCreateInfo& bufferInfo) const {
+	// The staging ring's ownership transfers still get recorded; on a concurrent buffer they are plain barriers
+	if (sharedFamilies.size() > 1) {
+		bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(sharedFamilies.size());
+		bufferInfo.pQueueFamilyIndices = sharedFamilies.data();
+	} else {
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	}
+}
+
+void GpuCulling::createDescriptors(uint32_t framesInFlight, VkBuffer materialBuffer) {
+	VkDescriptorSetLayoutBinding bindings[4]{};
+	const VkShaderStageFlags stages[4] = {
+		VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT, // Instances: culled by compute, placed by the vertex shader
+		VK_SHADER_STAGE_VERTEX_BIT,
+		VK_SHADER_STAGE_COMPUTE_BIT,
+		VK_SHADER_STAGE_COMPUTE_BIT
+	};
+	for (uint32_t i = 0; i < 4; i++) {
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = stages[i];
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 4;
+	layoutInfo.pBindings = bindings;
+
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create culling descriptor set layout!");
+	}
+
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = 4 * framesInFlight;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = framesInFlight;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create culling descriptor pool!");
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(framesInFlight, setLayout);
+	std::vector<VkDescriptorSet> sets(framesInFlight);
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = framesInFlight;
+	allocInfo.pSetLayouts = layouts.data();
+
+	if (vkAllocateDescriptorSets(device, &allocInfo, sets.data()) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate culling descriptor sets!");
+	}
+
+	for (uint32_t i = 0; i < framesInFlight; i++) {
+		frames[i].set = sets[i];
+
+		const VkBuffer buffers[4] = { instanceBuffer, materialBuffer, frames[i].commandBuffer, frames[i].countBuffer };
+		VkDescriptorBufferInfo bufferInfos[4]{};
+		VkWriteDescriptorSet writes[4]{};
+		for (uint32_t binding = 0; binding < 4; binding++) {
+			bufferInfos[binding].buffer = buffers[binding];
+			bufferInfos[binding].offset = 0;
+			bufferInfos[binding].range = VK_WHOLE_SIZE;
+
+			writes[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[binding].dstSet = sets[i];
+			writes[binding].dstBinding = binding;
+			writes[binding].descriptorCount = 1;
+			writes[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[binding].pBufferInfo = &bufferInfos[binding];
+		}
+		vkUpdateDescriptorSets(device, 4, writes, 0, nullptr);
+	}
+}
+
+void GpuCulling::createPipeline(PipelineCache& pipelineCache, const std::vector<char>& cullShaderCode) {
+	VkShaderModuleCreateInfo moduleInfo{};
+	moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize = cullShaderCode.size();
+	moduleInfo.pCode = reinterpret_cast<const uint32_t*>(cullShaderCode.data());
+
+	VkShaderModule shaderModule;
+	if (vkCreateShaderModule(device, &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create culling shader module!");
+	}
+
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(CullPushConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &setLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create culling pipeline layout!");
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = pipelineLayout;
+
+	PipelineFeedback feedback;
+	if (pipelineCache.isFeedbackSupported()) {
+		pipelineInfo.pNext = feedback.chain(pipelineInfo.pNext);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	if (vkCreateComputePipelines(device, pipelineCache.get(), 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create culling pipeline!");
+	}
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	pipelineCache.record(pipelineCache.isFeedbackSupported() ? &feedback : nullptr, elapsed.count());
+
+	vkDestroyShaderModule(device, shaderModule, nullptr);
+}
+
+void GpuCulling::recordCull(VkCommandBuffer commandBuffer, uint32_t frameIndex, const glm::vec4 (&planes)[4]) {
+	FrameResources& frame = frames[frameIndex];
+
+	// The frame's fence has signalled, so last time's indirect reads of these buffers are long done
+	vkCmdFillBuffer(commandBuffer, frame.countBuffer, 0, sizeof(uint32_t), 0);
+
+	VkMemoryBarrier clearBarrier{};
+	clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+	CullPushConstants constants{};
+	for (int i = 0; i < 4; i++) {
+		constants.planes[i] = planes[i];
+	}
+	constants.instanceCount = instanceCount;
+	constants.indexCount = indexCount;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &frame.set, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants), &constants);
+	vkCmdDispatch(commandBuffer, (instanceCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+	frame.pending = true;
+}
+
+void GpuCulling::recordDraw(VkCommandBuffer commandBuffer, uint32_t frameIndex, VkPipelineLayout graphicsLayout) {
+	FrameResources& frame = frames[frameIndex];
+
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsLayout, 0, 1, &frame.set, 0, nullptr);
+	if (meshIndexBuffer != VK_NULL_HANDLE) {
+		const VkDeviceSize offset = 0;
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &meshVertexBuffer, &offset);
+		vkCmdBindIndexBuffer(commandBuffer, meshIndexBuffer, 0, VK_INDEX_TYPE_UINT32);
+	} else {
+		vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+	}
+	drawIndexedIndirectCount(commandBuffer, frame.commandBuffer, 0, frame.countBuffer, 0, instanceCount, sizeof(VkDrawIndexedIndirectCommand));
+}
+
+void GpuCulling::collectStats(uint32_t frameIndex) {
+	FrameResources& frame = frames[frameIndex];
+	if (!frame.pending) {
+		return;
+	}
+
+	stats.frames++;
+	stats.tested += instanceCount;
+	stats.visible += *static_cast<const uint32_t*>(frame.countAllocation.mappedData);
+	frame.pending = false;
+}
+
+void GpuCulling::printStats(std::ostream& out) const {
+	const double frameCount = stats.frames > 0 ? static_cast<double>(stats.frames) : 1.0;
+	const double visiblePercent = stats.tested > 0 ? 100.0 * stats.visible / stats.tested : 0.0;
+
+	out << "GPU culling: " << stats.frames << " frames, " << std::fixed << std::setprecision(0)
+		<< stats.tested / frameCount << " objects tested and " << stats.visible / frameCount << " visible per frame ("
+		<< std::setprecision(2) << visiblePercent << "% drawn)\n";
+}
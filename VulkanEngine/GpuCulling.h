@@ -0,0 +1,161 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include "DeletionQueue.h"
+#include "DeviceMemoryAllocator.h"
+#include "PipelineCache.h"
+#include "StagingRing.h"
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+/// <summary>
+/// One object as the GPU sees it. Layout has to match the Instance struct in cull.comp and indirect.vert.
+/// </summary>
+struct GpuInstance {
+	glm::vec4 bounds; // xy centre, z bounding radius, w unused
+	glm::vec2 offset;
+	float scale;
+	uint32_t materialIndex;
+};
+
+struct GpuCullingStats {
+	uint64_t frames = 0;
+	uint64_t tested = 0;
+	uint64_t visible = 0;
+};
+
+/// <summary>
+/// The GPU driven render path. A compute pass tests every instance's bounds against the view and appends a draw command
+/// for each survivor; vkCmdDrawIndexedIndirectCount then draws exactly those, so the CPU records the same handful of
+/// commands whether the scene has ten objects or a million.
+///
+/// Needs VK_KHR_draw_indirect_count plus the multiDrawIndirect and drawIndirectFirstInstance features. Every frame in
+/// flight has its own command and count buffers; the count buffer stays host visible so collectStats() can read how
+/// many objects survived once the frame's fence has signalled.
+///
+/// The cull can run on an async compute queue. The buffers it touches are then created concurrent between the families
+/// in sharedFamilies, since the instances are read on both queues every frame and ownership transfers would cost more
+/// than concurrent access does.
+/// </summary>
+class GpuCulling {
+public:
+	static const uint32_t WORKGROUP_SIZE = 64; // Must match local_size_x in cull.comp
+
+	static const uint32_t INSTANCE_BINDING = 0;
+	static const uint32_t MATERIAL_BINDING = 1;
+	static const uint32_t COMMAND_BINDING = 2;
+	static const uint32_t COUNT_BINDING = 3;
+
+	/// <summary>
+	/// The instances go up through stagingRing; the first frame that waits on the ring sees them. sharedFamilies lists every
+	/// family that touches the culling buffers when that is more than one, the transfer family included; empty otherwise.
+	/// </summary>
+	void init(VkDevice device, DeviceMemoryAllocator& allocator, StagingRing& stagingRing, PipelineCache& pipelineCache,
+		const std::vector<char>& cullShaderCode, uint32_t framesInFlight, const std::vector<GpuInstance>& instances, VkBuffer materialBuffer,
+		const std::vector<uint32_t>& sharedFamilies);
+	void cleanup();
+
+	/// <summary>
+	/// Swap the culling pipeline for one built from new SPIR-V, for shader hot reload. The old one goes to deletionQueue,
+	/// so culls still pending on the GPU keep running with it.
+	/// </summary>
+	void reloadPipeline(PipelineCache& pipelineCache, const std::vector<char>& cullShaderCode, DeletionQueue& deletionQueue);
+
+	/// <summary>
+	/// Draw a mesh for every instance instead of the triangle: indexCount indices from indexBuffer, with vertexBuffer bound
+	/// at binding 0 for an indirect pipeline that reads vertex attributes. The buffers stay the caller's.
+	/// </summary>
+	void setMesh(VkBuffer vertexBuffer, VkBuffer indexBuffer, uint32_t indexCount);
+
+	/// <summary>
+	/// Layout of set 0 for the indirect graphics pipeline: instances and materials are read by the vertex shader.
+	/// </summary>
+	VkDescriptorSetLayout getSetLayout() const {
+		return setLayout;
+	}
+
+	/// <summary>
+	/// Where frameIndex's draw commands and draw count get written, for whoever orders the draw after the cull.
+	/// </summary>
+	VkBuffer getIndirectBuffer(uint32_t frameIndex) const {
+		return frames[frameIndex].commandBuffer;
+	}
+	VkBuffer getCountBuffer(uint32_t frameIndex) const {
+		return frames[frameIndex].countBuffer;
+	}
+
+	/// <summary>
+	/// Record the culling dispatch for frameIndex. Has to be outside a render pass. planes are (normal.xyz, distance) with
+	/// the normals pointing into the view volume. The caller makes the results visible to the indirect draw and the host,
+	/// e.g. through the render graph.
+	/// </summary>
+	void recordCull(VkCommandBuffer commandBuffer, uint32_t frameIndex, const glm::vec4 (&planes)[4]);
+
+	/// <summary>
+	/// Draw whatever recordCull() left for frameIndex. Has to be inside the render pass with the indirect pipeline bound.
+	/// </summary>
+	void recordDraw(VkCommandBuffer commandBuffer, uint32_t frameIndex, VkPipelineLayout graphicsLayout);
+
+	/// <summary>
+	/// Fold frameIndex's visible count into the stats. Only valid once the frame's fence has signalled.
+	/// </summary>
+	void collectStats(uint32_t frameIndex);
+
+	GpuCullingStats getStats() const {
+		return stats;
+	}
+
+	void printStats(std::ostream& out) const;
+
+private:
+	struct FrameResources {
+		VkBuffer commandBuffer = VK_NULL_HANDLE;
+		Allocation commandAllocation;
+		VkBuffer countBuffer = VK_NULL_HANDLE;
+		Allocation countAllocation;
+		VkDescriptorSet set = VK_NULL_HANDLE;
+		bool pending = false; // Culled since the last collectStats()
+	};
+
+	/// <summary>
+	/// Must match the push_constant block in cull.comp.
+	/// </summary>
+	struct CullPushConstants {
+		glm::vec4 planes[4];
+		uint32_t instanceCount;
+		uint32_t indexCount; // Per draw
+	};
+
+	VkBuffer createDeviceBuffer(VkDeviceSize size, VkBufferUsageFlags usage, bool shared, Allocation& allocation);
+	void setSharing(VkBufferCreateInfo& bufferInfo) const;
+	void createDescriptors(uint32_t framesInFlight, VkBuffer materialBuffer);
+	void createPipeline(PipelineCache& pipelineCache, const std::vector<char>& cullShaderCode);
+
+	VkDevice device = VK_NULL_HANDLE;
+	DeviceMemoryAllocator* allocator = nullptr;
+	PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount = nullptr;
+
+	std::vector<uint32_t> sharedFamilies;
+
+	uint32_t instanceCount = 0;
+	VkBuffer instanceBuffer = VK_NULL_HANDLE;
+	Allocation instanceAllocation;
+	VkBuffer indexBuffer = VK_NULL_HANDLE; // Every instance is the same triangle, indexed 0, 1, 2
+	Allocation indexAllocation;
+	VkBuffer meshVertexBuffer = VK_NULL_HANDLE; // From setMesh(), which replaces the triangle
+	VkBuffer meshIndexBuffer = VK_NULL_HANDLE;
+	uint32_t indexCount = 3;
+
+	VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+
+	std::vector<FrameResources> frames;
+	GpuCullingStats stats;
+};
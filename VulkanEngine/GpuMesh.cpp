@@ -0,0 +1,92 @@
+#include "GpuMesh.h"
+
+#include <stdexcept>
+
+void GpuMesh::init(DeviceMemoryAllocator& allocator, StagingRing& stagingRing, const AssetFile& file, uint32_t meshIndex) {
+	this->allocator = &allocator;
+
+	const AssetMeshEntry& mesh = file.getMesh(meshIndex);
+	if (mesh.indexCount == 0 || mesh.meshletCount == 0) {
+		throw std::runtime_error("Asset mesh has no triangles to draw!");
+	}
+	validate(file, mesh);
+
+	indexCount = mesh.indexCount;
+	meshletCount = mesh.meshletCount;
+	bounds = glm::vec4(mesh.bounds[0], mesh.bounds[1], mesh.bounds[2], mesh.bounds[3]);
+
+	const VkDeviceSize triangleBytes = file.getSection(mesh.meshletTriangleSection).size;
+	vertexBuffer = createBuffer(file.getSection(mesh.vertexSection).size,
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, vertexAllocation);
+	indexBuffer = createBuffer(file.getSection(mesh.indexSection).size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indexAllocation);
+	meshletBuffer = createBuffer(file.getSection(mesh.meshletSection).size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, meshletAllocation);
+	meshletVertexBuffer = createBuffer(file.getSection(mesh.meshletVertexSection).size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		meshletVertexAllocation);
+	meshletTriangleBuffer = createBuffer((triangleBytes + 3) / 4 * 4, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, meshletTriangleAllocation);
+
+	file.uploadSection(stagingRing, mesh.vertexSection, vertexBuffer, 0);
+	file.uploadSection(stagingRing, mesh.indexSection, indexBuffer, 0);
+	file.uploadSection(stagingRing, mesh.meshletSection, meshletBuffer, 0);
+	file.uploadSection(stagingRing, mesh.meshletVertexSection, meshletVertexBuffer, 0);
+	file.uploadSection(stagingRing, mesh.meshletTriangleSection, meshletTriangleBuffer, 0);
+}
+
+void GpuMesh::cleanup() {
+	if (!allocator) {
+		return;
+	}
+
+	allocator->destroyBuffer(meshletTriangleBuffer, meshletTriangleAllocation);
+	allocator->destroyBuffer(meshletVertexBuffer, meshletVertexAllocation);
+	allocator->destroyBuffer(meshletBuffer, meshletAllocation);
+	allocator->destroyBuffer(indexBuffer, indexAllocation);
+	allocator->destroyBuffer(vertexBuffer, vertexAllocation);
+	allocator = nullptr;
+}
+
+VkBuffer GpuMesh::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, Allocation& allocation) {
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	AllocationCreateInfo allocationInfo{};
+	return allocator->createBuffer(bufferInfo, allocationInfo, allocation);
+}
+
+void GpuMesh::validate(const AssetFile& file, const AssetMeshEntry& mesh) const {
+	// One pass over the index and meshlet streams at load, cheaper than a device lost from a shader reading past a buffer
+	const uint64_t meshletVertexCount = file.getSection(mesh.meshletVertexSection).size / sizeof(uint32_t);
+	const uint64_t meshletTriangleCount = file.getSection(mesh.meshletTriangleSection).size / 3;
+	const auto* meshlets = static_cast<const AssetMeshlet*>(file.getSectionData(mesh.meshletSection));
+	const auto* vertices = static_cast<const uint32_t*>(file.getSectionData(mesh.meshletVertexSection));
+	const auto* triangles = static_cast<const uint8_t*>(file.getSectionData(mesh.meshletTriangleSection));
+
+	const auto* indices = static_cast<const uint32_t*>(file.getSectionData(mesh.indexSection));
+	for (uint32_t i = 0; i < mesh.indexCount; i++) {
+		if (indices[i] >= mesh.vertexCount) {
+			throw std::runtime_error("Asset mesh has an index out of range!");
+		}
+	}
+
+	for (uint32_t i = 0; i < mesh.meshletCount; i++) {
+		const AssetMeshlet& meshlet = meshlets[i];
+		if (meshlet.vertexCount > MESHLET_MAX_VERTICES || meshlet.triangleCount > MESHLET_MAX_TRIANGLES ||
+			uint64_t(meshlet.vertexOffset) + meshlet.vertexCount > meshletVertexCount ||
+			uint64_t(meshlet.triangleOffset) + meshlet.triangleCount > meshletTriangleCount) {
+			throw std::runtime_error("Asset mesh has a meshlet outside its streams!");
+		}
+
+		for (uint32_t vertex = 0; vertex < meshlet.vertexCount; vertex++) {
+			if (vertices[meshlet.vertexOffset + vertex] >= mesh.vertexCount) {
+				throw std::runtime_error("Asset mesh has a meshlet vertex out of range!");
+			}
+		}
+		for (uint32_t corner = 0; corner < meshlet.triangleCount * 3; corner++) {
+			if (triangles[size_t(meshlet.triangleOffset) * 3 + corner] >= meshlet.vertexCount) {
+				throw std::runtime_error("Asset mesh has a meshlet triangle out of range!");
+			}
+		}
+	}
+}
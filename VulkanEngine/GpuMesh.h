@@ -0,0 +1,93 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include "AssetFile.h"
+#include "DeviceMemoryAllocator.h"
+#include "StagingRing.h"
+
+#include <cstdint>
+
+/// <summary>
+/// One mesh of a cooked asset file in device local buffers, every stream the file has for it: vertices and indices for
+/// the vertex pipeline, and the meshlets with their vertex and triangle streams for mesh shaders. The payloads go from
+/// the file's mapping through the staging ring; the first frame that waits on the ring sees them.
+///
+/// Only the graphics queue reads the buffers, so they stay exclusive and the staging ring's ownership transfers cover them.
+/// </summary>
+class GpuMesh {
+public:
+	/// <summary>
+	/// Throws if the mesh is empty or its indices or meshlets point outside their streams, which the file's own validation
+	/// leaves alone since nothing on the CPU reads them.
+	/// </summary>
+	void init(DeviceMemoryAllocator& allocator, StagingRing& stagingRing, const AssetFile& file, uint32_t meshIndex);
+	void cleanup();
+
+	/// <summary>
+	/// AssetVertex, bound at binding 0 as the vertex pipeline reads it: position at location 0, normal at location 1. Also a
+	/// storage buffer, for mesh shaders to fetch from.
+	/// </summary>
+	VkBuffer getVertexBuffer() const {
+		return vertexBuffer;
+	}
+
+	/// <summary>
+	/// uint32 indices, three per triangle.
+	/// </summary>
+	VkBuffer getIndexBuffer() const {
+		return indexBuffer;
+	}
+
+	/// <summary>
+	/// AssetMeshlet, then the uint32 mesh vertex of every meshlet vertex, then three uint8 meshlet vertices per triangle.
+	/// All three are storage buffers; the triangle stream is padded to a whole number of uint32 for shaders that read it so.
+	/// </summary>
+	VkBuffer getMeshletBuffer() const {
+		return meshletBuffer;
+	}
+	VkBuffer getMeshletVertexBuffer() const {
+		return meshletVertexBuffer;
+	}
+	VkBuffer getMeshletTriangleBuffer() const {
+		return meshletTriangleBuffer;
+	}
+
+	uint32_t getIndexCount() const {
+		return indexCount;
+	}
+
+	uint32_t getMeshletCount() const {
+		return meshletCount;
+	}
+
+	/// <summary>
+	/// Bounding sphere of the whole mesh, xyz centre and radius, in the mesh's own space.
+	/// </summary>
+	glm::vec4 getBounds() const {
+		return bounds;
+	}
+
+private:
+	VkBuffer createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, Allocation& allocation);
+	void validate(const AssetFile& file, const AssetMeshEntry& mesh) const;
+
+	DeviceMemoryAllocator* allocator = nullptr;
+
+	VkBuffer vertexBuffer = VK_NULL_HANDLE;
+	Allocation vertexAllocation;
+	VkBuffer indexBuffer = VK_NULL_HANDLE;
+	Allocation indexAllocation;
+	VkBuffer meshletBuffer = VK_NULL_HANDLE;
+	Allocation meshletAllocation;
+	VkBuffer meshletVertexBuffer = VK_NULL_HANDLE;
+	Allocation meshletVertexAllocation;
+	VkBuffer meshletTriangleBuffer = VK_NULL_HANDLE;
+	Allocation meshletTriangleAllocation;
+
+	uint32_t indexCount = 0;
+	uint32_t meshletCount = 0;
+	glm::vec4 bounds{ 0.0f };
+};
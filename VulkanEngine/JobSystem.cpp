@@ -0,0 +1,388 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+
+struct Job {
+	std::function<void()> function;
+	JobCounter* counter = nullptr;
+	Job* nextFree = nullptr;
+	uint32_t owner = 0; // The thread whose chunk it was carved out of, and whose free list it goes back to
+};
+
+namespace {
+	// Jobs are carved out of chunks this size whenever a thread's free list runs dry
+	const size_t JOB_CHUNK_SIZE = 256;
+
+	// How many times an idle worker looks for work before going to sleep
+	const uint32_t IDLE_SPINS = 64;
+
+	const uint32_t NO_THREAD = UINT32_MAX;
+
+	thread_local uint32_t currentThreadIndex = NO_THREAD;
+}
+
+bool JobSystem::WorkStealingDeque::push(Job* job) {
+	const int64_t b = bottom.load(std::memory_order_relaxed);
+	const int64_t t = top.load(std::memory_order_acquire);
+	if (b - t >= CAPACITY) {
+		return false;
+	}
+
+	buffer[b & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	bottom.store(b + 1, std::memory_order_relaxed);
+	return true;
+}
+
+Job* JobSystem::WorkStealingDeque::pop() {
+	// Claim the bottom slot first, then check whether a thief got to it (or is racing us for the last one)
+	const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+	bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t t = top.load(std::memory_order_relaxed);
+
+	if (t > b) {
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	Job* job = buffer[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+	if (t == b) {
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			job = nullptr;
+		}
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+Job* JobSystem::WorkStealingDeque::steal() {
+	int64_t t = top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	const int64_t b = bottom.load(std::memory_order_acquire);
+	if (t >= b) {
+		return nullptr;
+	}
+
+	Job* job = buffer[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+	if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+		return nullptr; // Lost to the owner or another thief, the caller just looks elsewhere
+	}
+	return job;
+}
+
+JobSystem::JobSystem(uint32_t threadCount) {
+	if (threadCount == 0) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	for (uint32_t i = 0; i < threadCount; i++) {
+		threads.push_back(std::make_unique<ThreadState>());
+		threads.back()->stealSeed = i * 0x9E3779B9u + 1; // Any non zero seed works for xorshift
+	}
+
+	currentThreadIndex = 0;
+	for (uint32_t i = 1; i < threadCount; i++) {
+		workers.emplace_back(&JobSystem::workerLoop, this, i);
+	}
+}
+
+JobSystem::~JobSystem() {
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping.store(true);
+	}
+	wake.notify_all();
+
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+uint32_t JobSystem::getThreadIndex() {
+	return currentThreadIndex;
+}
+
+void JobSystem::workerLoop(uint32_t threadIndex) {
+	currentThreadIndex = threadIndex;
+
+	uint32_t idleSpins = 0;
+	while (!stopping.load(std::memory_order_relaxed)) {
+		if (Job* job = findJob(threadIndex)) {
+			execute(job);
+			idleSpins = 0;
+			continue;
+		}
+
+		if (++idleSpins < IDLE_SPINS) {
+			std::this_thread::yield();
+			continue;
+		}
+		idleSpins = 0;
+
+		// Pairs with the increment-then-check in enqueue(): either it sees us sleeping, or we see its job
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepingWorkers.fetch_add(1);
+		wake.wait(lock, [this] { return stopping.load() || queuedJobs.load() > 0; });
+		sleepingWorkers.fetch_sub(1);
+	}
+}
+
+Job* JobSystem::allocateJob() {
+	ThreadState& state = *threads[currentThreadIndex];
+
+	// Taking the whole stack at once means no pop ever races a push, so there is no ABA to worry about
+	if (!state.freeList) {
+		state.freeList = state.returnedJobs.exchange(nullptr, std::memory_order_acquire);
+	}
+	if (!state.freeList) {
+		auto chunk = std::make_unique<Job[]>(JOB_CHUNK_SIZE);
+		for (size_t i = 0; i < JOB_CHUNK_SIZE; i++) {
+			chunk[i].owner = currentThreadIndex;
+			chunk[i].nextFree = state.freeList;
+			state.freeList = &chunk[i];
+		}
+		state.jobChunks.push_back(std::move(chunk));
+	}
+
+	Job* job = state.freeList;
+	state.freeList = job->nextFree;
+	return job;
+}
+
+void JobSystem::enqueue(Job* job) {
+	// Count it before it becomes stealable, so a thief can never decrement below zero
+	queuedJobs.fetch_add(1);
+	if (!threads[currentThreadIndex]->deque.push(job)) {
+		// Deque full, better to run it now than to fail
+		queuedJobs.fetch_sub(1);
+		execute(job);
+		return;
+	}
+
+	if (sleepingWorkers.load() > 0) {
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		wake.notify_one();
+	}
+}
+
+Job* JobSystem::findJob(uint32_t threadIndex) {
+	ThreadState& state = *threads[threadIndex];
+
+	Job* job = state.deque.pop();
+	if (!job) {
+		// Start at a random victim so thieves spread out instead of all hammering thread 0
+		state.stealSeed ^= state.stealSeed << 13;
+		state.stealSeed ^= state.stealSeed >> 17;
+		state.stealSeed ^= state.stealSeed << 5;
+
+		const uint32_t threadCount = getThreadCount();
+		const uint32_t start = state.stealSeed % threadCount;
+		for (uint32_t i = 0; i < threadCount && !job; i++) {
+			const uint32_t victim = (start + i) % threadCount;
+			if (victim != threadIndex) {
+				job = threads[victim]->deque.steal();
+			}
+		}
+	}
+	if (!job && threadIndex != 0) {
+		job = popBackground();
+	}
+
+	if (job) {
+		queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+Job* JobSystem::popBackground() {
+	std::lock_guard<std::mutex> lock(backgroundMutex);
+	if (backgroundJobs.empty()) {
+		return nullptr;
+	}
+	Job* job = backgroundJobs.front();
+	backgroundJobs.pop_front();
+	return job;
+}
+
+void JobSystem::execute(Job* job) {
+	job->function();
+
+	JobCounter* counter = job->counter;
+	job->function = nullptr; // Drop captures now rather than whenever the slot gets reused
+	job->counter = nullptr;
+
+	if (job->owner == currentThreadIndex) {
+		ThreadState& state = *threads[currentThreadIndex];
+		job->nextFree = state.freeList;
+		state.freeList = job;
+	} else {
+		// Release, so the owner sees the cleared function before it hands the job out again
+		std::atomic<Job*>& returned = threads[job->owner]->returnedJobs;
+		job->nextFree = returned.load(std::memory_order_relaxed);
+		while (!returned.compare_exchange_weak(job->nextFree, job, std::memory_order_release, std::memory_order_relaxed)) {
+		}
+	}
+
+	if (counter) {
+		finish(*counter);
+	}
+}
+
+void JobSystem::finish(JobCounter& counter) {
+	// Decrements that can't reach zero don't need the lock
+	uint32_t value = counter.pending.load(std::memory_order_relaxed);
+	while (value > 1) {
+		if (counter.pending.compare_exchange_weak(value, value - 1, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+			return;
+		}
+	}
+
+	// The last decrement happens under the lock, so scheduleAfter() can't slip a continuation in after we've drained them,
+	// and wait() can't let the owner destroy the counter while we're still using it
+	std::vector<Job*> ready;
+	{
+		std::lock_guard<std::mutex> lock(counter.continuationMutex);
+		if (counter.pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			ready.swap(counter.continuations);
+		}
+	}
+
+	for (Job* job : ready) {
+		enqueue(job);
+	}
+}
+
+void JobSystem::schedule(std::function<void()> function, JobCounter* counter) {
+	if (currentThreadIndex >= getThreadCount()) {
+		throw std::logic_error("JobSystem::schedule called from a thread the job system doesn't own!");
+	}
+
+	Job* job = allocateJob();
+	job->function = std::move(function);
+	job->counter = counter;
+	if (counter) {
+		counter->pending.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	enqueue(job);
+}
+
+void JobSystem::scheduleAfter(JobCounter& dependency, std::function<void()> function, JobCounter* counter) {
+	if (currentThreadIndex >= getThreadCount()) {
+		throw std::logic_error("JobSystem::scheduleAfter called from a thread the job system doesn't own!");
+	}
+
+	Job* job = allocateJob();
+	job->function = std::move(function);
+	job->counter = counter;
+	if (counter) {
+		counter->pending.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(dependency.continuationMutex);
+		if (dependency.pending.load(std::memory_order_acquire) > 0) {
+			dependency.continuations.push_back(job);
+			return;
+		}
+	}
+
+	enqueue(job);
+}
+
+void JobSystem::scheduleBackground(std::function<void()> function, JobCounter* counter) {
+	if (currentThreadIndex >= getThreadCount()) {
+		throw std::logic_error("JobSystem::scheduleBackground called from a thread the job system doesn't own!");
+	}
+
+	Job* job = allocateJob();
+	job->function = std::move(function);
+	job->counter = counter;
+	if (counter) {
+		counter->pending.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	if (workers.empty()) {
+		execute(job);
+		return;
+	}
+
+	// Counted like any other queued job, so sleeping workers wake up for it
+	queuedJobs.fetch_add(1);
+	{
+		std::lock_guard<std::mutex> lock(backgroundMutex);
+		backgroundJobs.push_back(job);
+	}
+	if (sleepingWorkers.load() > 0) {
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		wake.notify_one();
+	}
+}
+
+void JobSystem::wait(JobCounter& counter) {
+	const uint32_t threadIndex = currentThreadIndex;
+	if (threadIndex >= getThreadCount()) {
+		throw std::logic_error("JobSystem::wait called from a thread the job system doesn't own!");
+	}
+
+	while (!counter.isDone()) {
+		if (Job* job = findJob(threadIndex)) {
+			execute(job);
+		} else {
+			std::this_thread::yield();
+		}
+	}
+
+	// finish() may still be holding the lock it dropped the last count under; once we get it, it's done with the counter
+	std::lock_guard<std::mutex> lock(counter.continuationMutex);
+}
+
+void JobSystem::parallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t begin, uint32_t end)>& body) {
+	if (count == 0) {
+		return;
+	}
+
+	batchSize = std::max(1u, batchSize);
+	const uint32_t batchCount = (count + batchSize - 1) / batchSize;
+
+	// Not worth scheduling anything for
+	if (batchCount == 1 || getThreadCount() == 1) {
+		body(0, count);
+		return;
+	}
+
+	struct Context {
+		const std::function<void(uint32_t, uint32_t)>* body;
+		std::mutex errorMutex;
+		std::exception_ptr error;
+	} context;
+	context.body = &body;
+
+	// Keep the capture down to a pointer and two indices so std::function doesn't heap allocate per batch
+	Context* shared = &context;
+	JobCounter counter;
+	for (uint32_t batch = 0; batch < batchCount; batch++) {
+		const uint32_t begin = batch * batchSize;
+		const uint32_t end = std::min(count, begin + batchSize);
+		schedule([shared, begin, end] {
+			try {
+				(*shared->body)(begin, end);
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(shared->errorMutex);
+				if (!shared->error) {
+					shared->error = std::current_exception();
+				}
+			}
+		}, &counter);
+	}
+
+	wait(counter);
+
+	// Surface failures on the calling thread, where the rest of the engine's error handling lives
+	if (context.error) {
+		std::rethrow_exception(context.error);
+	}
+}
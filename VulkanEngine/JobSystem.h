@@ -0,0 +1,150 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+struct Job;
+
+/// <summary>
+/// Tracks a group of jobs. Every job scheduled against a counter bumps it and drops it again once it has run, so a counter
+/// at zero means the whole group is done. Jobs scheduled after a counter are held back until it reaches zero, which is how
+/// dependencies between stages are expressed without anybody blocking.
+/// </summary>
+class JobCounter {
+public:
+	JobCounter() = default;
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	bool isDone() const {
+		return pending.load(std::memory_order_acquire) == 0;
+	}
+
+private:
+	friend class JobSystem;
+
+	std::atomic<uint32_t> pending{ 0 };
+	std::mutex continuationMutex; // Only taken when adding a continuation and when the counter drops to zero
+	std::vector<Job*> continuations;
+};
+
+/// <summary>
+/// Work-stealing scheduler shared by every engine subsystem that wants to go wide. Each thread owns a Chase-Lev deque:
+/// it pushes and pops its own work at the bottom without contention, and idle threads steal from the top of somebody else's.
+/// The thread that constructs the JobSystem counts as thread 0, and wait() runs other jobs instead of blocking, so waiting
+/// inside a job never ties up a worker.
+///
+/// schedule(), wait() and parallelFor() may only be called from the constructing thread or from inside a job.
+/// </summary>
+class JobSystem {
+public:
+	/// <summary>
+	/// threadCount includes the calling thread. 0 picks one thread per hardware thread.
+	/// </summary>
+	explicit JobSystem(uint32_t threadCount = 0);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	uint32_t getThreadCount() const {
+		return static_cast<uint32_t>(threads.size());
+	}
+
+	/// <summary>
+	/// Index of the calling thread in [0, getThreadCount()). Lets jobs pick per thread resources without locking.
+	/// </summary>
+	static uint32_t getThreadIndex();
+
+	/// <summary>
+	/// Queue function to run on any thread. counter, if given, is incremented now and decremented once function returns.
+	/// Jobs must not throw; use parallelFor() when the work can fail.
+	/// </summary>
+	void schedule(std::function<void()> function, JobCounter* counter = nullptr);
+
+	/// <summary>
+	/// Like schedule(), but function is only queued once dependency has dropped to zero.
+	/// </summary>
+	void scheduleAfter(JobCounter& dependency, std::function<void()> function, JobCounter* counter = nullptr);
+
+	/// <summary>
+	/// Like schedule(), for long running work that must never hold up a frame, such as compiling a pipeline. Only worker
+	/// threads run it, and only once they have nothing else to do, so wait() on thread 0 never ends up inside it. With a
+	/// single thread there are no workers and function runs right away.
+	/// </summary>
+	void scheduleBackground(std::function<void()> function, JobCounter* counter = nullptr);
+
+	/// <summary>
+	/// Return once counter reaches zero, running queued jobs on this thread in the meantime.
+	/// </summary>
+	void wait(JobCounter& counter);
+
+	/// <summary>
+	/// Run body over [0, count) in batches of at most batchSize and return once every batch has finished.
+	/// The first exception thrown by any batch is rethrown here.
+	/// </summary>
+	void parallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t begin, uint32_t end)>& body);
+
+private:
+	/// <summary>
+	/// Fixed size Chase-Lev deque ("Correct and Efficient Work-Stealing for Weak Memory Models", Le et al. 2013).
+	/// push() and pop() are owner only, steal() may be called from any thread.
+	/// </summary>
+	class WorkStealingDeque {
+	public:
+		static const int64_t CAPACITY = 4096;
+
+		bool push(Job* job);
+		Job* pop();
+		Job* steal();
+
+	private:
+		alignas(64) std::atomic<int64_t> top{ 0 };
+		alignas(64) std::atomic<int64_t> bottom{ 0 };
+		std::atomic<Job*> buffer[CAPACITY] = {};
+	};
+
+	/// <summary>
+	/// Everything one thread owns. Jobs always go back to the thread that allocated them: straight onto its free list when
+	/// it ran them itself, otherwise onto its returnedJobs stack, which other threads push to and the owner takes whole
+	/// once its free list runs dry. A thread that schedules more than it runs, like thread 0, so gets back what was stolen
+	/// instead of carving out new chunks forever.
+	/// </summary>
+	struct alignas(64) ThreadState {
+		WorkStealingDeque deque;
+		Job* freeList = nullptr; // Owner only
+		std::atomic<Job*> returnedJobs{ nullptr }; // Jobs of this thread's that other threads ran
+		std::vector<std::unique_ptr<Job[]>> jobChunks;
+		uint32_t stealSeed = 0;
+	};
+
+	void workerLoop(uint32_t threadIndex);
+	Job* allocateJob();
+	void enqueue(Job* job);
+	Job* findJob(uint32_t threadIndex);
+	Job* popBackground();
+	void execute(Job* job);
+	void finish(JobCounter& counter);
+
+	std::vector<std::unique_ptr<ThreadState>> threads;
+
+	// Background jobs are few and each runs for milliseconds, a lock costs nothing next to them
+	std::mutex backgroundMutex;
+	std::deque<Job*> backgroundJobs;
+	std::vector<std::thread> workers;
+
+	// Idle workers sleep here rather than spinning, so an idle engine stays idle
+	std::atomic<uint32_t> queuedJobs{ 0 };
+	std::atomic<uint32_t> sleepingWorkers{ 0 };
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	std::atomic<bool> stopping{ false };
+};
@@ -0,0 +1,142 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+#ifdef _WIN32
+
+void MappedFile::open(const std::string& path) {
+	close();
+
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Failed to open " + path + "!");
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize)) {
+		CloseHandle(file);
+		throw std::runtime_error("Failed to query the size of " + path + "!");
+	}
+
+	fileHandle = file;
+	length = static_cast<size_t>(fileSize.QuadPart);
+	opened = true;
+
+	if (length == 0) {
+		return; // CreateFileMapping refuses empty files
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping) {
+		close();
+		throw std::runtime_error("Failed to map " + path + "!");
+	}
+	mappingHandle = mapping;
+
+	view = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!view) {
+		close();
+		throw std::runtime_error("Failed to map " + path + "!");
+	}
+}
+
+void MappedFile::close() {
+	if (view) {
+		UnmapViewOfFile(view);
+	}
+	if (mappingHandle) {
+		CloseHandle(mappingHandle);
+	}
+	if (fileHandle) {
+		CloseHandle(fileHandle);
+	}
+
+	view = nullptr;
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+	length = 0;
+	opened = false;
+}
+
+void MappedFile::adviseSequential() const {
+	if (!view) {
+		return;
+	}
+
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = const_cast<char*>(view);
+	range.NumberOfBytes = length;
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0); // Only a hint, failure just means no read-ahead
+}
+
+#else
+
+void MappedFile::open(const std::string& path) {
+	close();
+
+	descriptor = ::open(path.c_str(), O_RDONLY);
+	if (descriptor < 0) {
+		throw std::runtime_error("Failed to open " + path + "!");
+	}
+
+	struct stat status;
+	if (fstat(descriptor, &status) != 0) {
+		close();
+		throw std::runtime_error("Failed to query the size of " + path + "!");
+	}
+
+	length = static_cast<size_t>(status.st_size);
+	opened = true;
+
+	if (length == 0) {
+		return; // mmap refuses empty ranges
+	}
+
+	void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+	if (mapping == MAP_FAILED) {
+		close();
+		throw std::runtime_error("Failed to map " + path + "!");
+	}
+	view = static_cast<const char*>(mapping);
+}
+
+void MappedFile::close() {
+	if (view) {
+		munmap(const_cast<char*>(view), length);
+	}
+	if (descriptor >= 0) {
+		::close(descriptor);
+	}
+
+	view = nullptr;
+	descriptor = -1;
+	length = 0;
+	opened = false;
+}
+
+void MappedFile::adviseSequential() const {
+	if (!view) {
+		return;
+	}
+
+	// Only hints, failure just means no read-ahead
+	madvise(const_cast<char*>(view), length, MADV_SEQUENTIAL);
+	madvise(const_cast<char*>(view), length, MADV_WILLNEED);
+}
+
+#endif
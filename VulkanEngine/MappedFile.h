@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/// <summary>
+/// A read-only view of a whole file through the OS page cache. Pages are faulted in as they are touched, so nothing is
+/// read that isn't used and nothing is copied onto the heap on the way.
+/// </summary>
+class MappedFile {
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/// <summary>
+	/// Throws if the file can't be opened or mapped. An empty file opens fine with a null data() and a size() of 0.
+	/// </summary>
+	void open(const std::string& path);
+	void close();
+
+	/// <summary>
+	/// Tell the OS the whole file is about to be read front to back, so it can read ahead instead of faulting page by page.
+	/// </summary>
+	void adviseSequential() const;
+
+	const char* data() const {
+		return view;
+	}
+
+	size_t size() const {
+		return length;
+	}
+
+	bool isOpen() const {
+		return opened;
+	}
+
+private:
+	const char* view = nullptr;
+	size_t length = 0;
+	bool opened = false;
+
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#else
+	int descriptor = -1;
+#endif
+};
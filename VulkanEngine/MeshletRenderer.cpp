@@ -0,0 +1,144 @@
+#include "MeshletRenderer.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+
+void MeshletRenderer::init(VkDevice device, DeviceMemoryAllocator& allocator, StagingRing& stagingRing, const GpuMesh& mesh,
+	const std::vector<GpuInstance>& instances, VkBuffer materialBuffer, const VkPhysicalDeviceMeshShaderPropertiesEXT& properties) {
+	this->device = device;
+	this->allocator = &allocator;
+	instanceCount = static_cast<uint32_t>(instances.size());
+	meshletCount = mesh.getMeshletCount();
+	triangleCount = mesh.getIndexCount() / 3;
+	groupsPerInstance = (meshletCount + TASK_WORKGROUP_SIZE - 1) / TASK_WORKGROUP_SIZE;
+	maxGroupsPerDraw = std::min(properties.maxTaskWorkGroupCount[0], properties.maxTaskWorkGroupTotalCount);
+
+	if (properties.maxMeshOutputVertices < MESHLET_MAX_VERTICES || properties.maxMeshOutputPrimitives < MESHLET_MAX_TRIANGLES ||
+		maxGroupsPerDraw == 0) {
+		throw std::runtime_error("Failed to initialize mesh shaders, the device's limits are below the cooked meshlets!");
+	}
+
+	drawMeshTasks = reinterpret_cast<PFN_vkCmdDrawMeshTasksEXT>(vkGetDeviceProcAddr(device, "vkCmdDrawMeshTasksEXT"));
+	if (!drawMeshTasks) {
+		throw std::runtime_error("Failed to load vkCmdDrawMeshTasksEXT!");
+	}
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = sizeof(GpuInstance) * instances.size();
+	bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	AllocationCreateInfo allocationInfo{};
+	instanceBuffer = allocator.createBuffer(bufferInfo, allocationInfo, instanceAllocation);
+	stagingRing.uploadBuffer(instanceBuffer, 0, instances.data(), sizeof(GpuInstance) * instances.size());
+
+	createDescriptors(mesh, materialBuffer);
+}
+
+void MeshletRenderer::cleanup() {
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+	allocator->destroyBuffer(instanceBuffer, instanceAllocation);
+}
+
+void MeshletRenderer::createDescriptors(const GpuMesh& mesh, VkBuffer materialBuffer) {
+	VkDescriptorSetLayoutBinding bindings[6]{};
+	const VkShaderStageFlags stages[6] = {
+		VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT, // Instances: culled by the task shader, placed by the mesh shader
+		VK_SHADER_STAGE_MESH_BIT_EXT,
+		VK_SHADER_STAGE_MESH_BIT_EXT,
+		VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT, // Meshlets: bounds and cones for the task shader, ranges for the mesh shader
+		VK_SHADER_STAGE_MESH_BIT_EXT,
+		VK_SHADER_STAGE_MESH_BIT_EXT
+	};
+	for (uint32_t i = 0; i < 6; i++) {
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = stages[i];
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 6;
+	layoutInfo.pBindings = bindings;
+
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create meshlet descriptor set layout!");
+	}
+
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = 6;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create meshlet descriptor pool!");
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &setLayout;
+
+	if (vkAllocateDescriptorSets(device, &allocInfo, &set) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate meshlet descriptor set!");
+	}
+
+	const VkBuffer buffers[6] = { instanceBuffer, materialBuffer, mesh.getVertexBuffer(), mesh.getMeshletBuffer(),
+		mesh.getMeshletVertexBuffer(), mesh.getMeshletTriangleBuffer() };
+	VkDescriptorBufferInfo bufferInfos[6]{};
+	VkWriteDescriptorSet writes[6]{};
+	for (uint32_t binding = 0; binding < 6; binding++) {
+		bufferInfos[binding].buffer = buffers[binding];
+		bufferInfos[binding].offset = 0;
+		bufferInfos[binding].range = VK_WHOLE_SIZE;
+
+		writes[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[binding].dstSet = set;
+		writes[binding].dstBinding = binding;
+		writes[binding].descriptorCount = 1;
+		writes[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[binding].pBufferInfo = &bufferInfos[binding];
+	}
+	vkUpdateDescriptorSets(device, 6, writes, 0, nullptr);
+}
+
+void MeshletRenderer::recordDraw(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, const glm::vec4 (&planes)[4]) {
+	MeshletPushConstants constants{};
+	for (int i = 0; i < 4; i++) {
+		constants.planes[i] = planes[i];
+	}
+	constants.instanceCount = instanceCount;
+	constants.meshletCount = meshletCount;
+	constants.groupsPerInstance = groupsPerInstance;
+
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &set, 0, nullptr);
+
+	// One task workgroup per TASK_WORKGROUP_SIZE meshlets of every instance, split into as many draws as the limits need
+	const uint64_t totalGroups = uint64_t(instanceCount) * groupsPerInstance;
+	for (uint64_t first = 0; first < totalGroups; first += maxGroupsPerDraw) {
+		constants.firstGroup = static_cast<uint32_t>(first);
+		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_TASK_BIT_EXT, 0, sizeof(MeshletPushConstants), &constants);
+		drawMeshTasks(commandBuffer, static_cast<uint32_t>(std::min<uint64_t>(maxGroupsPerDraw, totalGroups - first)), 1, 1);
+	}
+
+	stats.frames++;
+	stats.meshlets += uint64_t(instanceCount) * meshletCount;
+	stats.triangles += uint64_t(instanceCount) * triangleCount;
+}
+
+void MeshletRenderer::printStats(std::ostream& out) const {
+	const double frameCount = stats.frames > 0 ? static_cast<double>(stats.frames) : 1.0;
+
+	out << "Mesh shaders: " << stats.frames << " frames, " << std::fixed << std::setprecision(0)
+		<< stats.meshlets / frameCount << " meshlets and " << stats.triangles / frameCount << " triangles submitted per frame\n";
+}
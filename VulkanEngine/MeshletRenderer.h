@@ -0,0 +1,100 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include "DeviceMemoryAllocator.h"
+#include "GpuCulling.h"
+#include "GpuMesh.h"
+#include "StagingRing.h"
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+struct MeshletRendererStats {
+	uint64_t frames = 0;
+	uint64_t meshlets = 0; // Handed to the task shader, before its culling
+	uint64_t triangles = 0; // In those meshlets
+};
+
+/// <summary>
+/// The mesh shader render path. Every instance draws the same GpuMesh; a task workgroup takes TASK_WORKGROUP_SIZE of one
+/// instance's meshlets, drops those outside the view or facing away from it, and launches a mesh workgroup for each one
+/// left. Culling happens per cluster of triangles instead of per object, without a compute pass or indirect buffers
+/// between the two, and the CPU records one draw call or a few for the whole scene.
+///
+/// Needs VK_EXT_mesh_shader with the taskShader and meshShader features. Every buffer is written once at init and only
+/// read by the graphics queue afterwards, so there is nothing per frame in flight.
+/// </summary>
+class MeshletRenderer {
+public:
+	static constexpr uint32_t TASK_WORKGROUP_SIZE = 32; // Must match local_size_x in meshlet.task
+
+	static constexpr uint32_t INSTANCE_BINDING = 0;
+	static constexpr uint32_t MATERIAL_BINDING = 1;
+	static constexpr uint32_t VERTEX_BINDING = 2;
+	static constexpr uint32_t MESHLET_BINDING = 3;
+	static constexpr uint32_t MESHLET_VERTEX_BINDING = 4;
+	static constexpr uint32_t MESHLET_TRIANGLE_BINDING = 5;
+
+	/// <summary>
+	/// The instances go up through stagingRing; the first frame that waits on the ring sees them. mesh has to outlive the
+	/// renderer. properties caps how many task workgroups a single draw may launch.
+	/// </summary>
+	void init(VkDevice device, DeviceMemoryAllocator& allocator, StagingRing& stagingRing, const GpuMesh& mesh,
+		const std::vector<GpuInstance>& instances, VkBuffer materialBuffer, const VkPhysicalDeviceMeshShaderPropertiesEXT& properties);
+	void cleanup();
+
+	/// <summary>
+	/// Layout of set 0 for the mesh shader pipeline: the instances and meshlets for the task shader, everything for the mesh shader.
+	/// </summary>
+	VkDescriptorSetLayout getSetLayout() const {
+		return setLayout;
+	}
+
+	/// <summary>
+	/// Draw every instance. Has to be inside the render pass with the mesh shader pipeline bound. planes are (normal.xyz,
+	/// distance) with the normals pointing into the view volume, as for GpuCulling.
+	/// </summary>
+	void recordDraw(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, const glm::vec4 (&planes)[4]);
+
+	MeshletRendererStats getStats() const {
+		return stats;
+	}
+
+	void printStats(std::ostream& out) const;
+
+private:
+	/// <summary>
+	/// Must match the push_constant block in meshlet.task.
+	/// </summary>
+	struct MeshletPushConstants {
+		glm::vec4 planes[4];
+		uint32_t instanceCount;
+		uint32_t meshletCount;
+		uint32_t groupsPerInstance;
+		uint32_t firstGroup; // Of this draw call, when the dispatch is split to stay under the device's limits
+	};
+
+	void createDescriptors(const GpuMesh& mesh, VkBuffer materialBuffer);
+
+	VkDevice device = VK_NULL_HANDLE;
+	DeviceMemoryAllocator* allocator = nullptr;
+	PFN_vkCmdDrawMeshTasksEXT drawMeshTasks = nullptr;
+
+	uint32_t instanceCount = 0;
+	uint32_t meshletCount = 0;
+	uint32_t triangleCount = 0; // Of the whole mesh
+	uint32_t groupsPerInstance = 0;
+	uint32_t maxGroupsPerDraw = 0;
+	VkBuffer instanceBuffer = VK_NULL_HANDLE;
+	Allocation instanceAllocation;
+
+	VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSet set = VK_NULL_HANDLE;
+
+	MeshletRendererStats stats;
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+/// <summary>
+/// Bounded lock-free queue for any number of producer threads and a single consumer, built on a ring of slots that
+/// each carry a sequence number (Vyukov's bounded queue). A producer claims a slot by advancing the tail with one
+/// compare-exchange, writes its value and then publishes the slot by bumping its sequence; the consumer owns the head
+/// outright and never needs an atomic read-modify-write. Nothing allocates after init().
+///
+/// Values come out in the order their slots were claimed. A producer preempted between claiming and publishing holds up
+/// the values claimed after it until it resumes; tryPop() reports empty meanwhile. tryPush() fails rather than
+/// overwriting when the ring is full, what to do then (retry, drop, coalesce) is the producer's call.
+///
+/// T has to be default constructible and copy assignable.
+/// </summary>
+template <typename T>
+class MpscQueue {
+public:
+	/// <summary>
+	/// capacity is rounded up to a power of two. Not thread safe, call before any producer starts.
+	/// </summary>
+	void init(uint32_t capacity) {
+		if (capacity == 0 || capacity > (1u << 31)) {
+			throw std::logic_error("MpscQueue capacity must be between 1 and 2^31!");
+		}
+
+		uint32_t size = 1;
+		while (size < capacity) {
+			size <<= 1;
+		}
+		mask = size - 1;
+		slots.reset(new Slot[size]);
+		for (uint32_t i = 0; i < size; i++) {
+			slots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+		tail.store(0, std::memory_order_relaxed);
+		head = 0;
+	}
+
+	uint32_t getCapacity() const {
+		return mask + 1;
+	}
+
+	/// <summary>
+	/// Any thread. Returns false, leaving the queue as it was, when every slot is taken.
+	/// </summary>
+	bool tryPush(const T& value) {
+		uint64_t position = tail.load(std::memory_order_relaxed);
+		for (;;) {
+			Slot& slot = slots[position & mask];
+			const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+			const int64_t lap = static_cast<int64_t>(sequence - position);
+
+			if (lap == 0) {
+				// Free for this lap; the weak exchange reloads position when another producer got there first
+				if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+					slot.value = value;
+					slot.sequence.store(position + 1, std::memory_order_release);
+					return true;
+				}
+			} else if (lap < 0) {
+				// Still holds the value pushed a lap ago, the consumer hasn't got to it
+				return false;
+			} else {
+				position = tail.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/// <summary>
+	/// Consumer thread only.
+	/// </summary>
+	bool tryPop(T& value) {
+		Slot& slot = slots[head & mask];
+		if (slot.sequence.load(std::memory_order_acquire) != head + 1) {
+			return false;
+		}
+
+		value = slot.value;
+		// Free the slot for whoever claims it a lap from now
+		slot.sequence.store(head + mask + 1, std::memory_order_release);
+		head++;
+		return true;
+	}
+
+	/// <summary>
+	/// Consumer thread only: pop up to limit values, handing each to function. Returns how many there were.
+	/// </summary>
+	template <typename Function>
+	uint32_t drain(Function&& function, uint32_t limit = UINT32_MAX) {
+		uint32_t count = 0;
+		T value;
+		while (count < limit && tryPop(value)) {
+			function(value);
+			count++;
+		}
+		return count;
+	}
+
+private:
+	struct Slot {
+		std::atomic<uint64_t> sequence{ 0 };
+		T value{};
+	};
+
+	std::unique_ptr<Slot[]> slots;
+	uint32_t mask = 0;
+	// Producers hammer the tail, keep it off the consumer's line
+	alignas(64) std::atomic<uint64_t> tail{ 0 };
+	alignas(64) uint64_t head = 0;
+};
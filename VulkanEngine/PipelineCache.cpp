@@ -0,0 +1,219 @@
+#include "PipelineCache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+	const uint32_t FILE_MAGIC = 0x43505645; // "EVPC"
+	const uint32_t FILE_VERSION = 1;
+
+	/// <summary>
+	/// Our own wrapper around the driver blob. Drivers are not required to survive corrupt cache data gracefully,
+	/// so a truncated or bit-flipped file must be caught before it ever reaches vkCreatePipelineCache.
+	/// </summary>
+	struct FileHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint64_t dataSize;
+		uint64_t dataHash;
+	};
+
+	uint64_t fnv1a(const char* data, size_t size) {
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < size; i++) {
+			hash ^= static_cast<uint8_t>(data[i]);
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+}
+
+void PipelineCache::init(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path, bool feedbackSupported) {
+	this->device = device;
+	this->feedbackSupported = feedbackSupported;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+	if (!preloaded || this->path != path) {
+		preload(path);
+	}
+
+	const bool useData = !fileData.empty() && validateHeader(fileData, sizeof(FileHeader));
+
+	VkPipelineCacheCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	createInfo.initialDataSize = useData ? fileData.size() - sizeof(FileHeader) : 0;
+	createInfo.pInitialData = useData ? fileData.data() + sizeof(FileHeader) : nullptr;
+
+	if (vkCreatePipelineCache(device, &createInfo, nullptr, &cache) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create pipeline cache!");
+	}
+
+	stats.loadedFromDisk = useData;
+	stats.loadedBytes = useData ? createInfo.initialDataSize : 0;
+
+	// The driver has its own copy now
+	fileData.clear();
+	fileData.shrink_to_fit();
+}
+
+void PipelineCache::cleanup() {
+	if (cache == VK_NULL_HANDLE) {
+		return;
+	}
+
+	save();
+	vkDestroyPipelineCache(device, cache, nullptr);
+	cache = VK_NULL_HANDLE;
+}
+
+void PipelineCache::preload(const std::string& path) {
+	this->path = path;
+	preloaded = true;
+	fileData.clear();
+	stats.rejectReason.clear();
+
+	if (path.empty()) {
+		return;
+	}
+
+	std::ifstream file(path, std::ios::ate | std::ios::binary);
+	if (!file.is_open()) {
+		return; // First run, nothing to reject
+	}
+
+	std::string data;
+	data.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(&data[0], data.size());
+
+	if (data.size() < sizeof(FileHeader)) {
+		stats.rejectReason = "file truncated";
+		return;
+	}
+
+	FileHeader header;
+	std::memcpy(&header, data.data(), sizeof(header));
+	if (header.magic != FILE_MAGIC || header.version != FILE_VERSION) {
+		stats.rejectReason = "not a pipeline cache file, or an old format";
+		return;
+	}
+	if (header.dataSize != data.size() - sizeof(FileHeader)) {
+		stats.rejectReason = "file truncated";
+		return;
+	}
+	if (header.dataHash != fnv1a(data.data() + sizeof(FileHeader), static_cast<size_t>(header.dataSize))) {
+		stats.rejectReason = "checksum mismatch";
+		return;
+	}
+
+	fileData = std::move(data);
+}
+
+/// <summary>
+/// The driver blob starts with a VkPipelineCacheHeaderVersionOne. A cache from another GPU, or from another driver
+/// version (which changes pipelineCacheUUID), is useless at best, so only feed the driver data it wrote itself.
+/// </summary>
+bool PipelineCache::validateHeader(const std::string& data, size_t offset) {
+	VkPipelineCacheHeaderVersionOne header;
+	if (data.size() - offset < sizeof(header)) {
+		stats.rejectReason = "driver header truncated";
+		return false;
+	}
+	std::memcpy(&header, data.data() + offset, sizeof(header));
+
+	if (header.headerSize < sizeof(header) || header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) {
+		stats.rejectReason = "unknown driver header version";
+		return false;
+	}
+	if (header.vendorID != deviceProperties.vendorID || header.deviceID != deviceProperties.deviceID) {
+		stats.rejectReason = "written by a different GPU";
+		return false;
+	}
+	if (std::memcmp(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+		stats.rejectReason = "written by a different driver version";
+		return false;
+	}
+
+	return true;
+}
+
+bool PipelineCache::save() {
+	if (path.empty()) {
+		return false;
+	}
+
+	size_t dataSize = 0;
+	if (vkGetPipelineCacheData(device, cache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) {
+		return false;
+	}
+
+	std::vector<char> data(dataSize);
+	if (vkGetPipelineCacheData(device, cache, &dataSize, data.data()) != VK_SUCCESS) {
+		return false;
+	}
+
+	FileHeader header{};
+	header.magic = FILE_MAGIC;
+	header.version = FILE_VERSION;
+	header.dataSize = dataSize;
+	header.dataHash = fnv1a(data.data(), dataSize);
+
+	// Write next to the destination and rename over it, so readers only ever see a complete old or a complete new file
+	const std::string tempPath = path + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			return false;
+		}
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(data.data(), dataSize);
+		file.flush();
+		if (!file) {
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, path, error);
+	if (error) {
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+
+	return true;
+}
+
+void PipelineCache::record(const PipelineFeedback* feedback, double cpuMilliseconds) {
+	std::lock_guard<std::mutex> lock(statsMutex);
+	stats.creationMilliseconds += cpuMilliseconds;
+
+	if (!feedback || !(feedback->pipeline.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT_EXT)) {
+		stats.unknown++;
+	} else if (feedback->pipeline.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT) {
+		stats.hits++;
+	} else {
+		stats.misses++;
+	}
+}
+
+void PipelineCache::printStats(std::ostream& out) const {
+	std::lock_guard<std::mutex> lock(statsMutex);
+	out << "Pipeline cache: ";
+	if (stats.loadedFromDisk) {
+		out << "warm start (" << stats.loadedBytes << " bytes from " << path << ")";
+	} else if (!stats.rejectReason.empty()) {
+		out << "cold start (rejected " << path << ": " << stats.rejectReason << ")";
+	} else {
+		out << "cold start";
+	}
+
+	out << ", " << stats.hits << " hits, " << stats.misses << " misses";
+	if (stats.unknown > 0) {
+		out << ", " << stats.unknown << " unknown (no VK_EXT_pipeline_creation_feedback)";
+	}
+	out << ", " << std::fixed << std::setprecision(2) << stats.creationMilliseconds << " ms creating pipelines\n";
+}
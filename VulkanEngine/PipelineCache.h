@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+/// <summary>
+/// Chain this into a Vk*PipelineCreateInfo pNext to learn whether the driver served the pipeline from the cache.
+/// Only meaningful when VK_EXT_pipeline_creation_feedback is enabled on the device.
+/// </summary>
+struct PipelineFeedback {
+	VkPipelineCreationFeedbackEXT pipeline{};
+	VkPipelineCreationFeedbackCreateInfoEXT createInfo{};
+
+	/// <summary>
+	/// Returns the new head of the pNext chain, to be stored in the create info.
+	/// </summary>
+	const void* chain(const void* next) {
+		createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT;
+		createInfo.pNext = next;
+		createInfo.pPipelineCreationFeedback = &pipeline;
+		createInfo.pipelineStageCreationFeedbackCount = 0;
+		createInfo.pPipelineStageCreationFeedbacks = nullptr;
+		return &createInfo;
+	}
+};
+
+struct PipelineCacheStats {
+	bool loadedFromDisk = false;
+	size_t loadedBytes = 0;
+	std::string rejectReason; // Why an existing file wasn't used, empty if it was (or there was none)
+	uint32_t hits = 0;
+	uint32_t misses = 0;
+	uint32_t unknown = 0; // Pipelines created without feedback support, so we can't tell
+	double creationMilliseconds = 0.0;
+};
+
+/// <summary>
+/// A VkPipelineCache that survives restarts. The blob is loaded in init(), checked against the physical device it's about
+/// to be used with, and written back atomically in cleanup() so a crash mid-write never leaves a truncated cache behind.
+///
+/// Pipelines may be created against get() and reported through record() from any thread, VkPipelineCache synchronizes
+/// itself and the stats have a lock. Everything else belongs to the thread that drives startup and shutdown.
+/// </summary>
+class PipelineCache {
+public:
+	/// <summary>
+	/// Read and checksum the file at path. Needs no device, so startup runs it on a worker while the device is still being
+	/// picked. init() calls it itself if it hasn't been called with the same path.
+	/// </summary>
+	void preload(const std::string& path);
+
+	void init(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path, bool feedbackSupported);
+	void cleanup();
+
+	VkPipelineCache get() const {
+		return cache;
+	}
+
+	bool isFeedbackSupported() const {
+		return feedbackSupported;
+	}
+
+	/// <summary>
+	/// Report a pipeline creation. feedback may be null if it wasn't chained in.
+	/// </summary>
+	void record(const PipelineFeedback* feedback, double cpuMilliseconds);
+
+	/// <summary>
+	/// Serialize the current contents to disk. Called by cleanup(), but safe to call earlier (e.g. after a warm up).
+	/// </summary>
+	bool save();
+
+	PipelineCacheStats getStats() const {
+		std::lock_guard<std::mutex> lock(statsMutex);
+		return stats;
+	}
+
+	void printStats(std::ostream& out) const;
+
+private:
+	bool validateHeader(const std::string& data, size_t offset);
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkPhysicalDeviceProperties deviceProperties{};
+	VkPipelineCache cache = VK_NULL_HANDLE;
+	std::string path;
+	bool preloaded = false;
+	std::string fileData; // Whole file including our FileHeader, empty if it was missing or failed the checksum
+	bool feedbackSupported = false;
+	mutable std::mutex statsMutex; // Pipelines are compiled on worker threads
+	PipelineCacheStats stats;
+};
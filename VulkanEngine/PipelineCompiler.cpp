@@ -0,0 +1,256 @@
+#include "PipelineCompiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+	using Clock = std::chrono::steady_clock;
+
+	double millisecondsSince(Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+}
+
+void PipelineCompiler::init(VkDevice device, JobSystem& jobSystem, DeletionQueue& deletionQueue, const std::string& warmListPath) {
+	this->device = device;
+	this->jobSystem = &jobSystem;
+	this->deletionQueue = &deletionQueue;
+	this->warmListPath = warmListPath;
+	loadWarmList();
+}
+
+void PipelineCompiler::cleanup() {
+	if (jobSystem) {
+		jobSystem->wait(compiling);
+	}
+
+	for (const auto& entry : entries) {
+		if (entry->compiling && entry->finished.load(std::memory_order_acquire)) {
+			vkDestroyPipeline(device, entry->result, nullptr);
+		}
+		vkDestroyPipeline(device, entry->pipeline, nullptr);
+	}
+	saveWarmList();
+	entries.clear();
+}
+
+uint32_t PipelineCompiler::add(const std::string& name, CreateFunction create) {
+	for (const auto& entry : entries) {
+		if (entry->name == name) {
+			throw std::logic_error("PipelineCompiler already has a pipeline called " + name + "!");
+		}
+	}
+
+	auto entry = std::make_unique<Entry>();
+	entry->name = name;
+	entry->create = std::move(create);
+	entries.push_back(std::move(entry));
+	return static_cast<uint32_t>(entries.size() - 1);
+}
+
+void PipelineCompiler::prewarm() {
+	for (const auto& entry : entries) {
+		if (warmList.count(entry->name) != 0 && entry->pipeline == VK_NULL_HANDLE && !entry->compiling) {
+			stats.prewarmed++;
+			startCompile(*entry);
+		}
+	}
+}
+
+VkPipeline PipelineCompiler::compileNow(uint32_t id) {
+	Entry& entry = *entries.at(id);
+	if (entry.compiling) {
+		throw std::logic_error("PipelineCompiler::compileNow called on " + entry.name + " while it is compiling!");
+	}
+
+	const auto start = Clock::now();
+	const VkPipeline pipeline = entry.create();
+	recordCompile(millisecondsSince(start));
+
+	if (entry.pipeline != VK_NULL_HANDLE) {
+		retire(entry.pipeline);
+	}
+	entry.pipeline = pipeline;
+	entry.failed = false;
+	return pipeline;
+}
+
+void PipelineCompiler::recompile(uint32_t id, CreateFunction create) {
+	Entry& entry = *entries.at(id);
+	entry.create = std::move(create);
+	entry.failed = false;
+	if (entry.compiling) {
+		entry.stale = true;
+	} else {
+		startCompile(entry);
+	}
+}
+
+VkPipeline PipelineCompiler::get(uint32_t id) {
+	Entry& entry = *entries.at(id);
+	entry.used = true;
+
+	if (entry.pipeline == VK_NULL_HANDLE && !entry.compiling && !entry.failed) {
+		startCompile(entry);
+	}
+
+	if (entry.pipeline == VK_NULL_HANDLE || entry.compiling) {
+		stats.fallbacks++;
+		if (!hitchThisFrame) {
+			hitchThisFrame = true;
+			stats.hitchFrames++;
+		}
+	}
+	return entry.pipeline;
+}
+
+void PipelineCompiler::beginFrame() {
+	stats.frames++;
+	hitchThisFrame = false;
+
+	for (const auto& entry : entries) {
+		if (entry->compiling && entry->finished.load(std::memory_order_acquire)) {
+			install(*entry);
+		}
+	}
+}
+
+void PipelineCompiler::startCompile(Entry& entry) {
+	entry.compiling = true;
+	entry.stale = false;
+	entry.result = VK_NULL_HANDLE;
+	entry.error.clear();
+
+	// The job gets its own copy of create, recompile() may replace the entry's while it runs
+	Entry* target = &entry;
+	jobSystem->scheduleBackground([target, create = entry.create] {
+		const auto start = Clock::now();
+		try {
+			target->result = create();
+		} catch (const std::exception& e) {
+			target->error = e.what();
+		}
+		target->milliseconds = millisecondsSince(start);
+		target->finished.store(true, std::memory_order_release);
+	}, &compiling);
+
+	// Without workers the job has already run, and there's no reason to make anyone wait a frame for it
+	if (entry.finished.load(std::memory_order_acquire)) {
+		install(entry);
+	}
+}
+
+void PipelineCompiler::install(Entry& entry) {
+	entry.compiling = false;
+	entry.finished.store(false, std::memory_order_relaxed);
+	recordCompile(entry.milliseconds);
+
+	if (entry.result != VK_NULL_HANDLE) {
+		if (entry.pipeline != VK_NULL_HANDLE) {
+			retire(entry.pipeline);
+			std::cout << "Recompiled " << entry.name << " in " << std::fixed << std::setprecision(1) << entry.milliseconds << " ms\n";
+		}
+		entry.pipeline = entry.result;
+		entry.result = VK_NULL_HANDLE;
+		entry.failed = false;
+	} else {
+		stats.failures++;
+		entry.failed = true;
+		std::cerr << "Failed to compile " << entry.name << ": " << entry.error << "\n";
+	}
+
+	if (entry.stale) {
+		startCompile(entry);
+	}
+}
+
+void PipelineCompiler::retire(VkPipeline pipeline) {
+	VkDevice device = this->device;
+	deletionQueue->defer([device, pipeline] { vkDestroyPipeline(device, pipeline, nullptr); });
+}
+
+void PipelineCompiler::recordCompile(double milliseconds) {
+	stats.compiles++;
+	stats.totalMilliseconds += milliseconds;
+	stats.slowestMilliseconds = std::max(stats.slowestMilliseconds, milliseconds);
+
+	uint32_t bucket = 0;
+	if (milliseconds >= 1.0) {
+		bucket = std::min(PipelineCompilerStats::HISTOGRAM_BUCKETS - 1, 1 + static_cast<uint32_t>(std::log2(milliseconds)));
+	}
+	stats.histogram[bucket]++;
+}
+
+void PipelineCompiler::loadWarmList() {
+	warmList.clear();
+	if (warmListPath.empty()) {
+		return;
+	}
+
+	std::ifstream file(warmListPath);
+	std::string name;
+	while (std::getline(file, name)) {
+		if (!name.empty()) {
+			warmList.insert(name);
+		}
+	}
+}
+
+void PipelineCompiler::saveWarmList() const {
+	if (warmListPath.empty()) {
+		return;
+	}
+
+	std::set<std::string> names = warmList;
+	for (const auto& entry : entries) {
+		if (entry->used) {
+			names.insert(entry->name);
+		}
+	}
+
+	// Same dance as the pipeline cache: write next to the destination and rename over it
+	const std::string tempPath = warmListPath + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::trunc);
+		for (const std::string& name : names) {
+			file << name << "\n";
+		}
+		if (!file) {
+			return;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, warmListPath, error);
+	if (error) {
+		std::filesystem::remove(tempPath, error);
+	}
+}
+
+void PipelineCompiler::printStats(std::ostream& out) const {
+	out << "Pipeline compiler: " << stats.compiles << " compiles (" << stats.failures << " failed, " << stats.prewarmed << " prewarmed), "
+		<< std::fixed << std::setprecision(2) << stats.totalMilliseconds << " ms total, " << stats.slowestMilliseconds << " ms slowest, "
+		<< stats.hitchFrames << " of " << stats.frames << " frames drew with a fallback (" << stats.fallbacks << " fallbacks)\n";
+
+	out << "Pipeline compile times:";
+	for (uint32_t bucket = 0; bucket < PipelineCompilerStats::HISTOGRAM_BUCKETS; bucket++) {
+		if (stats.histogram[bucket] == 0) {
+			continue;
+		}
+		if (bucket == 0) {
+			out << " <1 ms";
+		} else if (bucket + 1 == PipelineCompilerStats::HISTOGRAM_BUCKETS) {
+			out << " >=" << (1u << (bucket - 1)) << " ms";
+		} else {
+			out << " " << (1u << (bucket - 1)) << "-" << (1u << bucket) << " ms";
+		}
+		out << ": " << stats.histogram[bucket];
+	}
+	out << "\n";
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "DeletionQueue.h"
+#include "JobSystem.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+struct PipelineCompilerStats {
+	// Compile times by power of two: under 1 ms, then [1, 2), [2, 4) and so on, the last bucket everything from 512 ms up
+	static constexpr uint32_t HISTOGRAM_BUCKETS = 11;
+
+	uint32_t compiles = 0;
+	uint32_t failures = 0;
+	uint32_t prewarmed = 0; // Started from the warm list before anything asked for them
+	uint64_t frames = 0;
+	uint64_t hitchFrames = 0; // Frames where something drew with a fallback, or not at all, because its pipeline wasn't ready
+	uint64_t fallbacks = 0; // get() calls that didn't return the latest build of their pipeline
+	uint32_t histogram[HISTOGRAM_BUCKETS] = {};
+	double totalMilliseconds = 0.0;
+	double slowestMilliseconds = 0.0;
+};
+
+/// <summary>
+/// Builds pipelines on the job system's background workers so their first use doesn't stall the frame for however long
+/// the driver takes, hundreds of milliseconds on a cold cache. Until a pipeline is ready, get() returns whatever it had
+/// before (the previous build after a recompile, VK_NULL_HANDLE on first use) and the caller draws with a fallback or
+/// skips the draw. Pipelines the caller can't do without, like the fallbacks themselves, go through compileNow().
+///
+/// Every pipeline asked for is remembered in a warm list next to the pipeline cache. The next session compiles those in
+/// the background from startup, before anything asks, so they're usually ready by their first frame. Replaced pipelines
+/// go to the deletion queue, which keeps them until every frame in flight that may have recorded them has finished.
+///
+/// Everything but the create functions runs on the thread that drives the frame.
+/// </summary>
+class PipelineCompiler {
+public:
+	using CreateFunction = std::function<VkPipeline()>;
+
+	static const uint32_t INVALID_ID = UINT32_MAX;
+
+	/// <summary>
+	/// warmListPath is where the names of used pipelines are kept between sessions, empty for none.
+	/// </summary>
+	void init(VkDevice device, JobSystem& jobSystem, DeletionQueue& deletionQueue, const std::string& warmListPath);
+
+	/// <summary>
+	/// Waits for compiles still running, writes the warm list, and destroys every pipeline the compiler handed out.
+	/// </summary>
+	void cleanup();
+
+	/// <summary>
+	/// Register a pipeline under a name unique across sessions. create runs on a worker, so it has to own or copy whatever
+	/// it reads; it reports failure by throwing. Nothing is compiled yet.
+	/// </summary>
+	uint32_t add(const std::string& name, CreateFunction create);
+
+	/// <summary>
+	/// Start compiling every registered pipeline on the warm list. Call once everything is registered.
+	/// </summary>
+	void prewarm();
+
+	/// <summary>
+	/// Build id on the calling thread and return it. Throws if that fails.
+	/// </summary>
+	VkPipeline compileNow(uint32_t id);
+
+	/// <summary>
+	/// Rebuild id in the background with a new create function, e.g. after its shaders were hot reloaded. get() keeps
+	/// returning the old pipeline until the new one is in.
+	/// </summary>
+	void recompile(uint32_t id, CreateFunction create);
+
+	/// <summary>
+	/// The pipeline to record id with this frame. Starts compiling it if nothing has yet; counts the frame as a hitch if
+	/// what comes back isn't the latest build, including VK_NULL_HANDLE.
+	/// </summary>
+	VkPipeline get(uint32_t id);
+
+	/// <summary>
+	/// Once per frame, after its fence wait and the deletion queue's beginFrame(): swaps in finished compiles, deferring
+	/// the destruction of the pipelines they replace.
+	/// </summary>
+	void beginFrame();
+
+	PipelineCompilerStats getStats() const {
+		return stats;
+	}
+
+	void printStats(std::ostream& out) const;
+
+private:
+	struct Entry {
+		std::string name;
+		CreateFunction create;
+		VkPipeline pipeline = VK_NULL_HANDLE; // What get() hands out
+		bool used = false; // Asked for by get() this session, which puts it on the warm list
+		bool compiling = false;
+		bool failed = false; // Last build threw, so get() doesn't keep retrying until recompile() brings new input
+		bool stale = false; // Recompile asked for while compiling, so the build in flight is already out of date
+
+		// Written by the compile job, read by the frame thread once finished is set
+		std::atomic<bool> finished{ false };
+		VkPipeline result = VK_NULL_HANDLE;
+		std::string error;
+		double milliseconds = 0.0;
+	};
+
+	void startCompile(Entry& entry);
+	void install(Entry& entry);
+	void retire(VkPipeline pipeline);
+	void recordCompile(double milliseconds);
+	void loadWarmList();
+	void saveWarmList() const;
+
+	VkDevice device = VK_NULL_HANDLE;
+	JobSystem* jobSystem = nullptr;
+	DeletionQueue* deletionQueue = nullptr;
+	std::string warmListPath;
+	std::set<std::string> warmList; // From the last session, kept even for pipelines this one never registers
+
+	std::vector<std::unique_ptr<Entry>> entries; // Compile jobs hold on to their entry, so it must not move
+	JobCounter compiling;
+	bool hitchThisFrame = false;
+	PipelineCompilerStats stats;
+};
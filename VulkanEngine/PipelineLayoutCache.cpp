@@ -0,0 +1,154 @@
+#include "PipelineLayoutCache.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+bool PipelineLayoutCache::PipelineLayoutKey::operator<(const PipelineLayoutKey& other) const {
+	return std::tie(setLayouts, pushConstantStages, pushConstantOffset, pushConstantSize)
+		< std::tie(other.setLayouts, other.pushConstantStages, other.pushConstantOffset, other.pushConstantSize);
+}
+
+void PipelineLayoutCache::init(VkDevice device) {
+	this->device = device;
+}
+
+void PipelineLayoutCache::cleanup() {
+	for (const auto& entry : pipelineLayouts) {
+		vkDestroyPipelineLayout(device, entry.second, nullptr);
+	}
+	pipelineLayouts.clear();
+
+	for (const auto& entry : setLayouts) {
+		vkDestroyDescriptorSetLayout(device, entry.second, nullptr);
+	}
+	setLayouts.clear();
+}
+
+std::vector<VkDescriptorSetLayoutBinding> PipelineLayoutCache::getSetBindings(const std::vector<const ShaderReflection*>& shaders, uint32_t set) {
+	std::vector<VkDescriptorSetLayoutBinding> bindings;
+	for (const ShaderReflection* shader : shaders) {
+		for (const ReflectedBinding& reflected : shader->bindings) {
+			if (reflected.set != set) {
+				continue;
+			}
+
+			const std::string where = "set " + std::to_string(set) + " binding " + std::to_string(reflected.binding);
+			if (reflected.count == 0) {
+				throw std::runtime_error("Runtime sized array at " + where + " needs its set layout provided!");
+			}
+
+			auto existing = std::find_if(bindings.begin(), bindings.end(),
+				[&](const VkDescriptorSetLayoutBinding& binding) { return binding.binding == reflected.binding; });
+			if (existing == bindings.end()) {
+				VkDescriptorSetLayoutBinding binding{};
+				binding.binding = reflected.binding;
+				binding.descriptorType = reflected.type;
+				binding.descriptorCount = reflected.count;
+				binding.stageFlags = reflected.stages;
+				bindings.push_back(binding);
+			} else if (existing->descriptorType != reflected.type || existing->descriptorCount != reflected.count) {
+				throw std::runtime_error("Shaders disagree on what " + where + " is!");
+			} else {
+				existing->stageFlags |= reflected.stages;
+			}
+		}
+	}
+	return bindings;
+}
+
+VkDescriptorSetLayout PipelineLayoutCache::getSetLayout(std::vector<VkDescriptorSetLayoutBinding> bindings) {
+	stats.setLayoutRequests++;
+
+	std::sort(bindings.begin(), bindings.end(),
+		[](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) { return a.binding < b.binding; });
+
+	std::vector<uint32_t> key;
+	key.reserve(bindings.size() * 4);
+	for (const VkDescriptorSetLayoutBinding& binding : bindings) {
+		if (binding.pImmutableSamplers != nullptr) {
+			throw std::runtime_error("Immutable samplers aren't supported by the pipeline layout cache!");
+		}
+		key.insert(key.end(), { binding.binding, static_cast<uint32_t>(binding.descriptorType), binding.descriptorCount, binding.stageFlags });
+	}
+
+	auto found = setLayouts.find(key);
+	if (found != setLayouts.end()) {
+		return found->second;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	VkDescriptorSetLayout layout;
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &layout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create descriptor set layout!");
+	}
+
+	stats.setLayoutsCreated++;
+	setLayouts.emplace(std::move(key), layout);
+	return layout;
+}
+
+VkPipelineLayout PipelineLayoutCache::getPipelineLayout(const std::vector<const ShaderReflection*>& shaders,
+	const std::vector<VkDescriptorSetLayout>& providedSets) {
+	stats.pipelineLayoutRequests++;
+
+	uint32_t setCount = static_cast<uint32_t>(providedSets.size());
+	PipelineLayoutKey key{ {}, 0, UINT32_MAX, 0 };
+	uint32_t pushConstantEnd = 0;
+	for (const ShaderReflection* shader : shaders) {
+		for (const ReflectedBinding& binding : shader->bindings) {
+			setCount = std::max(setCount, binding.set + 1);
+		}
+		if (shader->pushConstants.size > 0) {
+			key.pushConstantStages |= shader->pushConstants.stageFlags;
+			key.pushConstantOffset = std::min(key.pushConstantOffset, shader->pushConstants.offset);
+			pushConstantEnd = std::max(pushConstantEnd, shader->pushConstants.offset + shader->pushConstants.size);
+		}
+	}
+	if (key.pushConstantStages == 0) {
+		key.pushConstantOffset = 0;
+	}
+	key.pushConstantSize = pushConstantEnd - key.pushConstantOffset;
+
+	key.setLayouts.resize(setCount);
+	for (uint32_t set = 0; set < setCount; set++) {
+		const bool provided = set < providedSets.size() && providedSets[set] != VK_NULL_HANDLE;
+		key.setLayouts[set] = provided ? providedSets[set] : getSetLayout(getSetBindings(shaders, set));
+	}
+
+	auto found = pipelineLayouts.find(key);
+	if (found != pipelineLayouts.end()) {
+		return found->second;
+	}
+
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = key.pushConstantStages;
+	pushConstantRange.offset = key.pushConstantOffset;
+	pushConstantRange.size = key.pushConstantSize;
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = setCount;
+	pipelineLayoutInfo.pSetLayouts = key.setLayouts.data();
+	pipelineLayoutInfo.pushConstantRangeCount = key.pushConstantStages != 0 ? 1 : 0;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	VkPipelineLayout layout;
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create pipeline layout!");
+	}
+
+	stats.pipelineLayoutsCreated++;
+	pipelineLayouts.emplace(std::move(key), layout);
+	return layout;
+}
+
+void PipelineLayoutCache::printStats(std::ostream& out) const {
+	out << "Pipeline layouts: " << stats.setLayoutsCreated << " set layouts for " << stats.setLayoutRequests << " requests, "
+		<< stats.pipelineLayoutsCreated << " pipeline layouts for " << stats.pipelineLayoutRequests << " requests\n";
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "ShaderReflection.h"
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <vector>
+
+struct PipelineLayoutCacheStats {
+	uint32_t setLayoutRequests = 0;
+	uint32_t setLayoutsCreated = 0; // The rest were served from the cache
+	uint32_t pipelineLayoutRequests = 0;
+	uint32_t pipelineLayoutsCreated = 0;
+};
+
+/// <summary>
+/// Set and pipeline layouts built from shader reflection, one VkDescriptorSetLayout per distinct set of bindings and one
+/// VkPipelineLayout per distinct combination of set layouts and push constants, however many pipelines ask for them.
+/// Two pipelines whose shaders declare the same set get the same handle, so a set bound for one stays compatible with
+/// the other. Owns everything it hands out and destroys it in cleanup().
+///
+/// Sets whose layout belongs to another module, because reflection can't see what it knows (dynamic offsets, update after
+/// bind, variable descriptor counts), are passed in as they are and only the rest is built from the shaders. Not thread safe.
+/// </summary>
+class PipelineLayoutCache {
+public:
+	void init(VkDevice device);
+	void cleanup();
+
+	/// <summary>
+	/// The bindings every shader in shaders declares in set, merged: stages are or'ed together, and shaders that disagree
+	/// on a binding's type throw.
+	/// </summary>
+	static std::vector<VkDescriptorSetLayoutBinding> getSetBindings(const std::vector<const ShaderReflection*>& shaders, uint32_t set);
+
+	VkDescriptorSetLayout getSetLayout(std::vector<VkDescriptorSetLayoutBinding> bindings);
+
+	/// <summary>
+	/// Layout for a pipeline made of shaders. providedSets[i], where it exists and isn't VK_NULL_HANDLE, is used for set i
+	/// as it is; every other set up to the highest one the shaders use is built from their reflection. Push constant
+	/// ranges are merged into one covering every stage that reads them.
+	/// </summary>
+	VkPipelineLayout getPipelineLayout(const std::vector<const ShaderReflection*>& shaders,
+		const std::vector<VkDescriptorSetLayout>& providedSets = {});
+
+	PipelineLayoutCacheStats getStats() const {
+		return stats;
+	}
+
+	void printStats(std::ostream& out) const;
+
+private:
+	struct PipelineLayoutKey {
+		std::vector<VkDescriptorSetLayout> setLayouts;
+		VkShaderStageFlags pushConstantStages;
+		uint32_t pushConstantOffset;
+		uint32_t pushConstantSize;
+
+		bool operator<(const PipelineLayoutKey& other) const;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	std::map<std::vector<uint32_t>, VkDescriptorSetLayout> setLayouts; // By binding, type, count and stages of every binding
+	std::map<PipelineLayoutKey, VkPipelineLayout> pipelineLayouts;
+	PipelineLayoutCacheStats stats;
+};
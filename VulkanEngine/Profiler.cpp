@@ -0,0 +1,427 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+	const uint32_t NO_SCOPE = UINT32_MAX;
+	const uint32_t COMPUTE_SCOPE = 1u << 31; // Set in the handles of scopes in the compute pool
+
+	// In the order vkGetQueryPoolResults returns them, which is bit order
+	const VkQueryPipelineStatisticFlags STATISTICS =
+		VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+
+	const char* const STATISTIC_NAMES[] = { "input primitives", "vertex invocations", "clipped primitives", "fragment invocations", "compute invocations" };
+
+	VkQueryPool createQueryPool(VkDevice device, VkQueryType type, uint32_t count, VkQueryPipelineStatisticFlags statistics) {
+		VkQueryPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		poolInfo.queryType = type;
+		poolInfo.queryCount = count;
+		poolInfo.pipelineStatistics = statistics;
+
+		VkQueryPool pool;
+		if (vkCreateQueryPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create query pool!");
+		}
+		return pool;
+	}
+
+	uint64_t maskFor(uint32_t timestampValidBits) {
+		return timestampValidBits >= 64 ? ~0ull : (1ull << timestampValidBits) - 1;
+	}
+
+	// Ticks from from to to, negative when to came first; the counters wrap at mask
+	double signedTicks(uint64_t from, uint64_t to, uint64_t mask) {
+		const uint64_t forward = (to - from) & mask;
+		if (forward > mask / 2) {
+			return -static_cast<double>((from - to) & mask);
+		}
+		return static_cast<double>(forward);
+	}
+}
+
+void Profiler::init(VkDevice device, float timestampPeriod, uint32_t timestampValidBits, uint32_t framesInFlight, bool pipelineStatistics, bool trace) {
+	this->device = device;
+	this->timestampPeriod = timestampPeriod;
+	timestampMask = maskFor(timestampValidBits);
+	statisticsFlags = pipelineStatistics ? STATISTICS : 0;
+	tracing = trace;
+
+	frames.resize(framesInFlight);
+	for (auto& frame : frames) {
+		if (timestampValidBits > 0) {
+			frame.timestampPool = createQueryPool(device, VK_QUERY_TYPE_TIMESTAMP, 2 * MAX_GPU_SCOPES, 0);
+		}
+		if (pipelineStatistics) {
+			frame.statisticsPool = createQueryPool(device, VK_QUERY_TYPE_PIPELINE_STATISTICS, MAX_GPU_SCOPES, statisticsFlags);
+		}
+		frame.scopes.reserve(MAX_GPU_SCOPES);
+	}
+
+	origin = Clock::now();
+	overlayTime = origin;
+}
+
+void Profiler::initComputeQueue(uint32_t timestampValidBits) {
+	if (timestampValidBits == 0) {
+		return;
+	}
+
+	computeTimestampMask = maskFor(timestampValidBits);
+	for (auto& frame : frames) {
+		frame.computeTimestampPool = createQueryPool(device, VK_QUERY_TYPE_TIMESTAMP, 2 * MAX_GPU_SCOPES, 0);
+		frame.computeScopes.reserve(MAX_GPU_SCOPES);
+	}
+}
+
+void Profiler::cleanup() {
+	for (auto& frame : frames) {
+		if (frame.timestampPool != VK_NULL_HANDLE) {
+			vkDestroyQueryPool(device, frame.timestampPool, nullptr);
+		}
+		if (frame.computeTimestampPool != VK_NULL_HANDLE) {
+			vkDestroyQueryPool(device, frame.computeTimestampPool, nullptr);
+		}
+		if (frame.statisticsPool != VK_NULL_HANDLE) {
+			vkDestroyQueryPool(device, frame.statisticsPool, nullptr);
+		}
+	}
+	frames.clear();
+}
+
+void Profiler::beginFrame(uint32_t frameIndex) {
+	this->frameIndex = frameIndex;
+	openGpuScopes = 0;
+	openComputeScopes = 0;
+
+	FrameQueries& frame = frames[frameIndex];
+	if (frame.submitted) {
+		collect(frame);
+	}
+	frame.scopes.clear();
+	frame.computeScopes.clear();
+	frame.computeCommandBuffer = VK_NULL_HANDLE;
+	frame.submitted = false;
+}
+
+void Profiler::recordReset(VkCommandBuffer commandBuffer) {
+	const FrameQueries& frame = frames[frameIndex];
+	if (frame.timestampPool != VK_NULL_HANDLE) {
+		vkCmdResetQueryPool(commandBuffer, frame.timestampPool, 0, 2 * MAX_GPU_SCOPES);
+	}
+	if (frame.statisticsPool != VK_NULL_HANDLE) {
+		vkCmdResetQueryPool(commandBuffer, frame.statisticsPool, 0, MAX_GPU_SCOPES);
+	}
+}
+
+void Profiler::recordComputeReset(VkCommandBuffer computeCommandBuffer) {
+	FrameQueries& frame = frames[frameIndex];
+	frame.computeCommandBuffer = computeCommandBuffer;
+	if (frame.computeTimestampPool != VK_NULL_HANDLE) {
+		vkCmdResetQueryPool(computeCommandBuffer, frame.computeTimestampPool, 0, 2 * MAX_GPU_SCOPES);
+	}
+}
+
+uint32_t Profiler::beginGpuScope(VkCommandBuffer commandBuffer, const char* name) {
+	FrameQueries& frame = frames[frameIndex];
+	if (commandBuffer == frame.computeCommandBuffer) {
+		if (frame.computeTimestampPool == VK_NULL_HANDLE || frame.computeScopes.size() >= MAX_GPU_SCOPES) {
+			return NO_SCOPE;
+		}
+
+		const uint32_t scope = static_cast<uint32_t>(frame.computeScopes.size());
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.computeTimestampPool, 2 * scope);
+		frame.computeScopes.push_back({ name, openComputeScopes, false });
+		openComputeScopes++;
+		return COMPUTE_SCOPE | scope;
+	}
+
+	if (frame.timestampPool == VK_NULL_HANDLE || frame.scopes.size() >= MAX_GPU_SCOPES) {
+		return NO_SCOPE;
+	}
+
+	const uint32_t scope = static_cast<uint32_t>(frame.scopes.size());
+	const bool statistics = frame.statisticsPool != VK_NULL_HANDLE && openGpuScopes == 0;
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.timestampPool, 2 * scope);
+	if (statistics) {
+		vkCmdBeginQuery(commandBuffer, frame.statisticsPool, scope, 0);
+	}
+
+	frame.scopes.push_back({ name, openGpuScopes, statistics });
+	openGpuScopes++;
+	return scope;
+}
+
+void Profiler::endGpuScope(VkCommandBuffer commandBuffer, uint32_t scope) {
+	if (scope == NO_SCOPE) {
+		return;
+	}
+
+	FrameQueries& frame = frames[frameIndex];
+	if (scope & COMPUTE_SCOPE) {
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.computeTimestampPool, 2 * (scope & ~COMPUTE_SCOPE) + 1);
+		openComputeScopes--;
+		return;
+	}
+
+	if (frame.scopes[scope].statistics) {
+		vkCmdEndQuery(commandBuffer, frame.statisticsPool, scope);
+	}
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.timestampPool, 2 * scope + 1);
+	openGpuScopes--;
+}
+
+void Profiler::endFrame() {
+	FrameQueries& frame = frames[frameIndex];
+	frame.submitTime = Clock::now();
+	frame.submitted = true;
+	windowFrames++;
+}
+
+void Profiler::beginCpuScope(const char* name) {
+	cpuStack.push_back({ name, Clock::now() });
+}
+
+void Profiler::endCpuScope() {
+	const OpenCpuScope scope = cpuStack.back();
+	cpuStack.pop_back();
+
+	const Clock::time_point end = Clock::now();
+	const double milliseconds = std::chrono::duration<double, std::milli>(end - scope.start).count();
+
+	Summary& summary = getSummary(scope.name, false);
+	summary.totalMilliseconds += milliseconds;
+	summary.count++;
+	summary.windowMilliseconds += milliseconds;
+	summary.windowCount++;
+
+	if (tracing && traceEvents.size() < MAX_TRACE_EVENTS) {
+		const double start = std::chrono::duration<double, std::micro>(scope.start - origin).count();
+		traceEvents.push_back({ scope.name, false, false, static_cast<uint32_t>(cpuStack.size()), start, milliseconds * 1000.0 });
+	}
+}
+
+Profiler::Summary& Profiler::getSummary(const char* name, bool gpu) {
+	for (auto& summary : summaries) {
+		if (summary.gpu == gpu && summary.name == name) {
+			return summary;
+		}
+	}
+
+	summaries.emplace_back();
+	summaries.back().name = name;
+	summaries.back().gpu = gpu;
+	return summaries.back();
+}
+
+bool Profiler::readScopes(VkQueryPool pool, const std::vector<GpuScope>& scopes, std::vector<ScopeTicks>& ticks) {
+	// No WAIT_BIT: the fence says the frame is done, and a query that still isn't available is skipped, not waited for
+	struct TimestampResult {
+		uint64_t value;
+		uint64_t available;
+	};
+	TimestampResult timestamps[2 * MAX_GPU_SCOPES];
+	const uint32_t scopeCount = static_cast<uint32_t>(scopes.size());
+	const VkResult result = vkGetQueryPoolResults(device, pool, 0, 2 * scopeCount, sizeof(timestamps), timestamps, sizeof(TimestampResult),
+		VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+	if (result != VK_SUCCESS && result != VK_NOT_READY) {
+		return false;
+	}
+
+	ticks.resize(scopeCount);
+	for (uint32_t i = 0; i < scopeCount; i++) {
+		ticks[i] = { timestamps[2 * i].value, timestamps[2 * i + 1].value, timestamps[2 * i].available != 0 && timestamps[2 * i + 1].available != 0 };
+	}
+	return true;
+}
+
+void Profiler::collect(FrameQueries& frame) {
+	const bool graphics = !frame.scopes.empty() && readScopes(frame.timestampPool, frame.scopes, graphicsTicks) && graphicsTicks[0].available;
+	const bool compute = !frame.computeScopes.empty() && readScopes(frame.computeTimestampPool, frame.computeScopes, computeTicks);
+	if (!graphics && !compute) {
+		return;
+	}
+
+	uint64_t statistics[MAX_GPU_SCOPES][STATISTIC_COUNT + 1] = {};
+	if (graphics && frame.statisticsPool != VK_NULL_HANDLE) {
+		const uint32_t scopeCount = static_cast<uint32_t>(frame.scopes.size());
+		const VkResult statisticsResult = vkGetQueryPoolResults(device, frame.statisticsPool, 0, scopeCount, sizeof(statistics), statistics,
+			sizeof(statistics[0]), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+		if (statisticsResult != VK_SUCCESS && statisticsResult != VK_NOT_READY) {
+			std::memset(statistics, 0, sizeof(statistics));
+		}
+	}
+
+	// Compute timestamps are placed against the graphics queue's first one, which only works in the bits both queues have
+	const uint64_t base = graphics ? graphicsTicks[0].begin : computeTicks[0].begin;
+	const uint64_t crossMask = compute ? timestampMask & computeTimestampMask : timestampMask;
+	const double submitMicroseconds = std::chrono::duration<double, std::micro>(frame.submitTime - origin).count();
+
+	auto addScopes = [&](const std::vector<GpuScope>& scopes, const std::vector<ScopeTicks>& ticks, uint64_t mask, bool onCompute) {
+		for (uint32_t i = 0; i < scopes.size(); i++) {
+			const GpuScope& scope = scopes[i];
+			if (!ticks[i].available) {
+				continue;
+			}
+
+			const double milliseconds = ((ticks[i].end - ticks[i].begin) & mask) * timestampPeriod / 1e6;
+			Summary& summary = getSummary(scope.name, true);
+			summary.totalMilliseconds += milliseconds;
+			summary.count++;
+			summary.windowMilliseconds += milliseconds;
+			summary.windowCount++;
+
+			if (scope.statistics && statistics[i][STATISTIC_COUNT] != 0) {
+				for (uint32_t s = 0; s < STATISTIC_COUNT; s++) {
+					summary.statistics[s] += statistics[i][s];
+				}
+				summary.statisticsFrames++;
+			}
+
+			if (tracing && traceEvents.size() < MAX_TRACE_EVENTS) {
+				const double offset = signedTicks(base, ticks[i].begin, onCompute ? crossMask : mask) * timestampPeriod / 1e3;
+				traceEvents.push_back({ scope.name, true, onCompute, scope.depth, submitMicroseconds + offset, milliseconds * 1000.0 });
+			}
+		}
+	};
+
+	if (graphics) {
+		addScopes(frame.scopes, graphicsTicks, timestampMask, false);
+
+		uint64_t frameEnd = 0; // Ticks after base
+		bool anyAvailable = false;
+		for (const ScopeTicks& ticks : graphicsTicks) {
+			if (ticks.available) {
+				frameEnd = std::max(frameEnd, (ticks.end - base) & timestampMask);
+				anyAvailable = true;
+			}
+		}
+		if (anyAvailable) {
+			lastGpuFrameMilliseconds = frameEnd * timestampPeriod / 1e6;
+			gpuFramesCollected++;
+		}
+	}
+	if (!compute) {
+		return;
+	}
+	addScopes(frame.computeScopes, computeTicks, computeTimestampMask, true);
+
+	// Top level scopes on one queue run one after the other, so summing the pairwise intersections counts nothing twice
+	double busyTicks = 0.0;
+	double overlapTicks = 0.0;
+	for (uint32_t c = 0; c < computeTicks.size(); c++) {
+		if (frame.computeScopes[c].depth != 0 || !computeTicks[c].available) {
+			continue;
+		}
+		const double computeBegin = signedTicks(base, computeTicks[c].begin, crossMask);
+		const double computeEnd = signedTicks(base, computeTicks[c].end, crossMask);
+		busyTicks += computeEnd - computeBegin;
+
+		for (uint32_t g = 0; graphics && g < graphicsTicks.size(); g++) {
+			if (frame.scopes[g].depth != 0 || !graphicsTicks[g].available) {
+				continue;
+			}
+			const double graphicsBegin = signedTicks(base, graphicsTicks[g].begin, crossMask);
+			const double graphicsEnd = signedTicks(base, graphicsTicks[g].end, crossMask);
+			overlapTicks += std::max(0.0, std::min(computeEnd, graphicsEnd) - std::max(computeBegin, graphicsBegin));
+		}
+	}
+	computeBusyMilliseconds += busyTicks * timestampPeriod / 1e6;
+	computeOverlapMilliseconds += overlapTicks * timestampPeriod / 1e6;
+	computeFrames++;
+}
+
+bool Profiler::getOverlayText(std::string& text) {
+	const Clock::time_point now = Clock::now();
+	const double elapsed = std::chrono::duration<double>(now - overlayTime).count();
+	if (elapsed < OVERLAY_INTERVAL) {
+		return false;
+	}
+
+	std::ostringstream out;
+	out << std::fixed << std::setprecision(0) << windowFrames / elapsed << " fps" << std::setprecision(2);
+	for (bool gpu : { false, true }) {
+		bool first = true;
+		for (auto& summary : summaries) {
+			if (summary.gpu != gpu || summary.windowCount == 0) {
+				continue;
+			}
+			out << (first ? (gpu ? " | GPU " : " | CPU ") : ", ") << summary.name << " " << summary.windowMilliseconds / summary.windowCount << " ms";
+			first = false;
+		}
+	}
+	text = out.str();
+
+	for (auto& summary : summaries) {
+		summary.windowMilliseconds = 0.0;
+		summary.windowCount = 0;
+	}
+	windowFrames = 0;
+	overlayTime = now;
+	return true;
+}
+
+void Profiler::writeTrace(const std::string& path) const {
+	std::ofstream file(path);
+	if (!file) {
+		throw std::runtime_error("Failed to open trace file " + path + "!");
+	}
+
+	// One process, the CPU timeline on thread 1, the graphics queue on thread 2 and the async compute queue on thread 3
+	file << std::fixed << std::setprecision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}},\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":3,\"args\":{\"name\":\"GPU async compute\"}}";
+	for (const auto& event : traceEvents) {
+		file << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"" << (event.gpu ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+			<< (event.compute ? 3 : event.gpu ? 2 : 1) << ",\"ts\":" << event.startMicroseconds << ",\"dur\":" << event.durationMicroseconds
+			<< ",\"args\":{\"depth\":" << event.depth << "}}";
+	}
+	file << "\n]}\n";
+
+	if (!file) {
+		throw std::runtime_error("Failed to write trace file " + path + "!");
+	}
+}
+
+void Profiler::printStats(std::ostream& out) const {
+	const auto flags = out.flags();
+	out << std::fixed << std::setprecision(3);
+	out << "Profiler (averages over the whole run):\n";
+	for (const auto& summary : summaries) {
+		if (summary.count == 0) {
+			continue;
+		}
+		out << "  " << (summary.gpu ? "GPU " : "CPU ") << std::left << std::setw(20) << summary.name << std::right
+			<< std::setw(10) << summary.totalMilliseconds / summary.count << " ms\n";
+
+		if (summary.statisticsFrames > 0) {
+			out << "      ";
+			for (uint32_t s = 0; s < STATISTIC_COUNT; s++) {
+				out << (s == 0 ? "" : ", ") << summary.statistics[s] / summary.statisticsFrames << " " << STATISTIC_NAMES[s];
+			}
+			out << " per frame\n";
+		}
+	}
+	if (computeFrames > 0) {
+		const double busy = getAsyncComputeMilliseconds();
+		const double overlap = getAsyncOverlapMilliseconds();
+		out << "  Async compute: " << busy << " ms busy per frame, " << overlap << " ms of it (" << std::setprecision(1)
+			<< (busy > 0.0 ? 100.0 * overlap / busy : 0.0) << "%) alongside graphics scopes\n" << std::setprecision(3);
+	}
+	if (tracing) {
+		out << "  " << traceEvents.size() << " trace events" << (traceEvents.size() >= MAX_TRACE_EVENTS ? " (limit reached)" : "") << "\n";
+	}
+	out.flags(flags);
+}
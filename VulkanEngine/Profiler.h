@@ -0,0 +1,225 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Where frame time goes, on both sides. GPU scopes write a timestamp query at each end, and optionally a pipeline
+/// statistics query around the whole scope; CPU scopes read the steady clock. Each frame in flight has its own query
+/// pools, and their results are only read back when that slot comes round again after its fence, so nothing ever waits
+/// on the GPU for them.
+///
+/// Every scope feeds a rolling average shown by getOverlayText(), and when tracing is enabled an event in a Chrome trace
+/// (chrome://tracing, Perfetto) written by writeTrace(). GPU events are placed on the CPU timeline by lining the first
+/// timestamp of a frame up with the moment the frame was submitted, which is close enough to see the work overlap.
+///
+/// Scopes recorded into the command buffer handed to recordComputeReset() go to a separate pool for the async compute
+/// queue, which the graphics queue can't reset without racing it. Both queues read the same device clock, so each frame
+/// also measures how much of the compute queue's busy time overlapped the graphics scopes.
+///
+/// Everything here belongs to the thread that drives the frame, CPU scopes included.
+/// </summary>
+class Profiler {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	static const uint32_t MAX_GPU_SCOPES = 32; // Per frame
+	static const size_t MAX_TRACE_EVENTS = 1 << 20; // Tracing stops there rather than growing without bound
+
+	/// <summary>
+	/// RAII helper for CPU scopes: records [construction, destruction) under name, which has to outlive the profiler.
+	/// </summary>
+	class Scope {
+	public:
+		Scope(Profiler& profiler, const char* name) : profiler(profiler) {
+			profiler.beginCpuScope(name);
+		}
+		~Scope() {
+			profiler.endCpuScope();
+		}
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		Profiler& profiler;
+	};
+
+	/// <summary>
+	/// timestampValidBits comes from the queue family the scopes are recorded on; 0 turns GPU scopes into no-ops.
+	/// pipelineStatistics needs the pipelineStatisticsQuery feature to be enabled on the device.
+	/// </summary>
+	void init(VkDevice device, float timestampPeriod, uint32_t timestampValidBits, uint32_t framesInFlight, bool pipelineStatistics, bool trace);
+	void cleanup();
+
+	/// <summary>
+	/// After init(), when there is an async compute queue. timestampValidBits is that queue family's.
+	/// </summary>
+	void initComputeQueue(uint32_t timestampValidBits);
+
+	/// <summary>
+	/// Collect what frameIndex recorded last time round. Only valid once the frame's fence has signalled.
+	/// </summary>
+	void beginFrame(uint32_t frameIndex);
+
+	/// <summary>
+	/// Reset the current frame's queries. Has to be recorded outside a render pass, before the first GPU scope.
+	/// </summary>
+	void recordReset(VkCommandBuffer commandBuffer);
+
+	/// <summary>
+	/// Reset the current frame's compute queue queries, and send the GPU scopes recorded into computeCommandBuffer this frame
+	/// to them. Compute scopes never get pipeline statistics.
+	/// </summary>
+	void recordComputeReset(VkCommandBuffer computeCommandBuffer);
+
+	/// <summary>
+	/// Open a GPU scope. Statistics scopes can't nest, so only scopes opened while no other is open get statistics.
+	/// A scope that starts outside a render pass must end outside it too. Returns the handle for endGpuScope().
+	/// </summary>
+	uint32_t beginGpuScope(VkCommandBuffer commandBuffer, const char* name);
+	void endGpuScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+	/// <summary>
+	/// Call right before the frame is submitted; the GPU scopes of this frame are placed relative to this moment.
+	/// </summary>
+	void endFrame();
+
+	void beginCpuScope(const char* name);
+	void endCpuScope();
+
+	/// <summary>
+	/// What secondaries executed inside a statistics scope have to declare in VkCommandBufferInheritanceInfo.
+	/// </summary>
+	VkQueryPipelineStatisticFlags getStatisticsFlags() const {
+		return statisticsFlags;
+	}
+
+	/// <summary>
+	/// First to last timestamp of the most recently collected frame, and how many frames have been collected so far.
+	/// A frame's GPU time shows up framesInFlight frames after it was recorded.
+	/// </summary>
+	double getLastGpuFrameMilliseconds() const {
+		return lastGpuFrameMilliseconds;
+	}
+
+	uint64_t getGpuFramesCollected() const {
+		return gpuFramesCollected;
+	}
+
+	/// <summary>
+	/// Per frame averages over the whole run: how long the async compute queue was busy (first to last compute timestamp),
+	/// and how much of that ran alongside a top level graphics scope. Both 0 without compute scopes.
+	/// </summary>
+	double getAsyncComputeMilliseconds() const {
+		return computeFrames != 0 ? computeBusyMilliseconds / computeFrames : 0.0;
+	}
+	double getAsyncOverlapMilliseconds() const {
+		return computeFrames != 0 ? computeOverlapMilliseconds / computeFrames : 0.0;
+	}
+
+	/// <summary>
+	/// One line with the averaged scope times, rebuilt every OVERLAY_INTERVAL. Returns false while text is unchanged.
+	/// </summary>
+	bool getOverlayText(std::string& text);
+
+	/// <summary>
+	/// Write every traced event as Chrome trace JSON. Throws if the file can't be written.
+	/// </summary>
+	void writeTrace(const std::string& path) const;
+
+	/// <summary>
+	/// Average time of every scope over the whole run.
+	/// </summary>
+	void printStats(std::ostream& out) const;
+
+private:
+	static const uint32_t STATISTIC_COUNT = 5; // Bits set in statisticsFlags
+	static constexpr double OVERLAY_INTERVAL = 0.5; // Seconds
+
+	struct GpuScope {
+		const char* name;
+		uint32_t depth;
+		bool statistics; // Has a query in the statistics pool, at the same index
+	};
+
+	struct FrameQueries {
+		VkQueryPool timestampPool = VK_NULL_HANDLE; // Two queries per scope
+		VkQueryPool statisticsPool = VK_NULL_HANDLE;
+		std::vector<GpuScope> scopes;
+		VkQueryPool computeTimestampPool = VK_NULL_HANDLE;
+		std::vector<GpuScope> computeScopes;
+		VkCommandBuffer computeCommandBuffer = VK_NULL_HANDLE; // Null on frames without compute scopes
+		Clock::time_point submitTime;
+		bool submitted = false;
+	};
+
+	struct OpenCpuScope {
+		const char* name;
+		Clock::time_point start;
+	};
+
+	// Running totals for one scope name, both over the whole run and since the overlay was last rebuilt
+	struct Summary {
+		std::string name;
+		bool gpu;
+		double totalMilliseconds = 0.0;
+		uint64_t count = 0;
+		double windowMilliseconds = 0.0;
+		uint64_t windowCount = 0;
+		uint64_t statistics[STATISTIC_COUNT] = {};
+		uint64_t statisticsFrames = 0;
+	};
+
+	struct TraceEvent {
+		const char* name;
+		bool gpu;
+		bool compute;
+		uint32_t depth;
+		double startMicroseconds;
+		double durationMicroseconds;
+	};
+
+	// A scope's two timestamps, and whether both came back
+	struct ScopeTicks {
+		uint64_t begin;
+		uint64_t end;
+		bool available;
+	};
+
+	Summary& getSummary(const char* name, bool gpu);
+	void collect(FrameQueries& frame);
+	bool readScopes(VkQueryPool pool, const std::vector<GpuScope>& scopes, std::vector<ScopeTicks>& ticks);
+
+	VkDevice device = VK_NULL_HANDLE;
+	double timestampPeriod = 1.0; // Nanoseconds per tick
+	uint64_t timestampMask = 0;
+	uint64_t computeTimestampMask = 0;
+	VkQueryPipelineStatisticFlags statisticsFlags = 0;
+	bool tracing = false;
+
+	std::vector<FrameQueries> frames;
+	uint32_t frameIndex = 0;
+	uint32_t openGpuScopes = 0;
+	uint32_t openComputeScopes = 0;
+	double lastGpuFrameMilliseconds = 0.0;
+	uint64_t gpuFramesCollected = 0;
+	double computeBusyMilliseconds = 0.0;
+	double computeOverlapMilliseconds = 0.0;
+	uint64_t computeFrames = 0;
+	std::vector<ScopeTicks> graphicsTicks; // Scratch for collect()
+	std::vector<ScopeTicks> computeTicks;
+
+	Clock::time_point origin = Clock::now();
+	std::vector<OpenCpuScope> cpuStack;
+	std::vector<Summary> summaries;
+	std::vector<TraceEvent> traceEvents;
+
+	Clock::time_point overlayTime = Clock::now();
+	uint64_t windowFrames = 0;
+};
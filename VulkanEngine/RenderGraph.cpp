@@ -0,0 +1,733 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+
+namespace {
+	// Only legacy stage and access bits are used, whose synchronization2 values match the old ones, so narrowing is exact
+	const VkAccessFlags2 COLOR_ACCESS = VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+	const VkAccessFlags2 DEPTH_ACCESS = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	const VkPipelineStageFlags2 DEPTH_STAGES = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+
+	VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	bool lifetimesOverlap(uint32_t firstA, uint32_t lastA, uint32_t firstB, uint32_t lastB) {
+		return firstA <= lastB && firstB <= lastA;
+	}
+
+	bool sameTransient(const RenderGraph::TransientImageInfo& a, const RenderGraph::TransientImageInfo& b) {
+		return a.format == b.format && a.extent.width == b.extent.width && a.extent.height == b.extent.height && a.usage == b.usage &&
+			a.aspect == b.aspect;
+	}
+
+	const char* layoutName(VkImageLayout layout) {
+		switch (layout) {
+		case VK_IMAGE_LAYOUT_UNDEFINED:
+			return "UNDEFINED";
+		case VK_IMAGE_LAYOUT_GENERAL:
+			return "GENERAL";
+		case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+			return "COLOR_ATTACHMENT";
+		case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+			return "DEPTH_STENCIL_ATTACHMENT";
+		case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+			return "SHADER_READ_ONLY";
+		case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+			return "TRANSFER_SRC";
+		case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+			return "TRANSFER_DST";
+		case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+			return "PRESENT_SRC";
+		default:
+			return "other";
+		}
+	}
+
+	double toMiB(VkDeviceSize bytes) {
+		return bytes / (1024.0 * 1024.0);
+	}
+}
+
+// Access includes the reads where a usage may read as well as write; a read() of such a usage only counts the reads
+RenderGraph::UsageInfo RenderGraph::getUsageInfo(RenderGraphUsage usage) {
+	switch (usage) {
+	case RenderGraphUsage::ColorAttachment:
+		return { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, COLOR_ACCESS, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+	case RenderGraphUsage::DepthAttachment:
+		return { DEPTH_STAGES, DEPTH_ACCESS, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+	case RenderGraphUsage::SampledFragment:
+		return { VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+	case RenderGraphUsage::SampledCompute:
+		return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+	case RenderGraphUsage::StorageReadCompute:
+		return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_GENERAL };
+	case RenderGraphUsage::StorageWriteCompute:
+		return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT, VK_ACCESS_2_SHADER_WRITE_BIT,
+			VK_IMAGE_LAYOUT_GENERAL };
+	case RenderGraphUsage::StorageReadVertex:
+		return { VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_GENERAL };
+	case RenderGraphUsage::StorageWriteFragment:
+		return { VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT, VK_ACCESS_2_SHADER_WRITE_BIT,
+			VK_IMAGE_LAYOUT_GENERAL };
+	case RenderGraphUsage::IndirectRead:
+		return { VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED };
+	case RenderGraphUsage::TransferSource:
+		return { VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL };
+	case RenderGraphUsage::TransferDestination:
+		return { VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL };
+	case RenderGraphUsage::HostRead:
+		return { VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_GENERAL };
+	case RenderGraphUsage::Present:
+		// The presentation engine synchronizes through the render finished semaphore, the barrier only has to change the layout
+		return { VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR };
+	case RenderGraphUsage::None:
+		break;
+	}
+	return { VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED };
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::read(ResourceId resource, RenderGraphUsage usage) {
+	graph.passes[pass].uses.push_back({ resource, usage, false });
+	return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::write(ResourceId resource, RenderGraphUsage usage) {
+	graph.passes[pass].uses.push_back({ resource, usage, true });
+	return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::sideEffects() {
+	graph.passes[pass].sideEffects = true;
+	return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::asyncCompute() {
+	graph.passes[pass].asyncCompute = true;
+	return *this;
+}
+
+void RenderGraph::init(VkDevice device, DeviceMemoryAllocator& allocator, bool synchronization2, uint32_t graphicsFamily, uint32_t computeFamily) {
+	this->device = device;
+	this->allocator = &allocator;
+	this->graphicsFamily = graphicsFamily;
+	this->computeFamily = computeFamily;
+
+	if (synchronization2) {
+		pipelineBarrier2 = reinterpret_cast<PFN_vkCmdPipelineBarrier2KHR>(vkGetDeviceProcAddr(device, "vkCmdPipelineBarrier2KHR"));
+	}
+}
+
+void RenderGraph::cleanup() {
+	destroyTransients();
+	reset();
+}
+
+void RenderGraph::reset() {
+	passes.clear();
+	resources.clear();
+	transients.clear();
+	imageBarriers.clear();
+	legacyImageBarriers.clear();
+	finalBarriers = Batch{};
+	finalComputeBarriers = Batch{};
+	computeWaitStages = VK_PIPELINE_STAGE_2_NONE;
+}
+
+RenderGraph::ResourceId RenderGraph::importImage(const char* name, VkImage image, VkImageAspectFlags aspect, const RenderGraphState& initial,
+	RenderGraphUsage finalUsage) {
+	Resource resource{};
+	resource.name = name;
+	resource.image = true;
+	resource.imported = true;
+	resource.vkImage = image;
+	resource.aspect = aspect;
+	resource.initial = initial;
+	resource.finalUsage = finalUsage;
+	resources.push_back(resource);
+	return static_cast<ResourceId>(resources.size() - 1);
+}
+
+RenderGraph::ResourceId RenderGraph::importBuffer(const char* name, VkBuffer buffer, const RenderGraphState& initial, RenderGraphUsage finalUsage) {
+	Resource resource{};
+	resource.name = name;
+	resource.image = false;
+	resource.imported = true;
+	resource.vkBuffer = buffer;
+	resource.initial = initial;
+	resource.finalUsage = finalUsage;
+	resources.push_back(resource);
+	return static_cast<ResourceId>(resources.size() - 1);
+}
+
+RenderGraph::ResourceId RenderGraph::createImage(const char* name, const TransientImageInfo& info) {
+	Resource resource{};
+	resource.name = name;
+	resource.image = true;
+	resource.imported = false;
+	resource.aspect = info.aspect;
+	resource.transientInfo = info;
+	resources.push_back(resource);
+	return static_cast<ResourceId>(resources.size() - 1);
+}
+
+VkImage RenderGraph::getImage(ResourceId resource) const {
+	return resources[resource].vkImage;
+}
+
+RenderGraph::PassBuilder RenderGraph::addPass(const char* name, PassFunction execute) {
+	Pass pass{};
+	pass.name = name;
+	pass.execute = std::move(execute);
+	passes.push_back(std::move(pass));
+	return PassBuilder(*this, static_cast<uint32_t>(passes.size() - 1));
+}
+
+void RenderGraph::compile() {
+	cullPasses();
+	for (Pass& pass : passes) {
+		pass.onCompute = pass.asyncCompute && !pass.culled && computeFamily != VK_QUEUE_FAMILY_IGNORED;
+	}
+	checkAsyncCompute();
+
+	// Lifetimes in pass indices, counting only the passes that are kept
+	std::vector<bool> onCompute(resources.size(), false);
+	for (uint32_t i = 0; i < passes.size(); i++) {
+		if (passes[i].culled) {
+			continue;
+		}
+		for (const Use& use : passes[i].uses) {
+			Resource& resource = resources[use.resource];
+			resource.firstPass = std::min(resource.firstPass, i);
+			resource.lastPass = std::max(resource.lastPass, i);
+			onCompute[use.resource] = onCompute[use.resource] || passes[i].onCompute;
+		}
+	}
+
+	for (Resource& resource : resources) {
+		if (resource.imported || resource.firstPass == UINT32_MAX) {
+			continue;
+		}
+		resource.transient = static_cast<uint32_t>(transients.size());
+		TransientImage transient{};
+		transient.resource = static_cast<ResourceId>(&resource - resources.data());
+		transient.info = resource.transientInfo;
+		transient.firstPass = resource.firstPass;
+		transient.lastPass = resource.lastPass;
+
+		// The compute queue runs alongside every graphics pass up to the one that waits for it, so keep its bytes to itself
+		if (onCompute[transient.resource]) {
+			transient.shared = true;
+			transient.firstPass = 0;
+			transient.lastPass = static_cast<uint32_t>(passes.size() - 1);
+		}
+		transients.push_back(transient);
+	}
+
+	// Same transients with the same lifetimes means the same placement, so last frame's images still fit
+	bool reuse = transients.size() == liveTransients.size();
+	for (size_t i = 0; reuse && i < transients.size(); i++) {
+		reuse = sameTransient(transients[i].info, liveTransients[i].info) && transients[i].firstPass == liveTransients[i].firstPass &&
+			transients[i].lastPass == liveTransients[i].lastPass && transients[i].shared == liveTransients[i].shared;
+	}
+	if (reuse) {
+		// Keep this frame's resource ids, which need not match last frame's if it declared things in another order;
+		// predecessors index transients, which line up one for one
+		for (size_t i = 0; i < transients.size(); i++) {
+			const ResourceId resource = transients[i].resource;
+			transients[i] = liveTransients[i];
+			transients[i].resource = resource;
+		}
+	} else {
+		destroyTransients();
+		createTransients();
+		liveTransients = transients;
+	}
+
+	for (Resource& resource : resources) {
+		if (resource.transient != UINT32_MAX) {
+			resource.vkImage = transients[resource.transient].image;
+		}
+	}
+
+	computeBarriers();
+
+	stats = RenderGraphStats{};
+	stats.passes = static_cast<uint32_t>(passes.size());
+	auto countBatch = [this](const Batch& batch) {
+		const bool memory = batch.memoryBarrier.srcStageMask != VK_PIPELINE_STAGE_2_NONE || batch.memoryBarrier.dstStageMask != VK_PIPELINE_STAGE_2_NONE;
+		stats.imageBarriers += batch.imageBarrierCount;
+		stats.memoryBarriers += memory ? 1 : 0;
+		stats.barrierBatches += (batch.imageBarrierCount != 0 || memory) ? 1 : 0;
+	};
+	for (const Pass& pass : passes) {
+		stats.culledPasses += pass.culled ? 1 : 0;
+		stats.computePasses += pass.onCompute ? 1 : 0;
+		countBatch(pass.barriers);
+	}
+	countBatch(finalBarriers);
+	countBatch(finalComputeBarriers);
+	for (const TransientImage& transient : transients) {
+		stats.transientBytes += transient.requirements.size;
+	}
+	stats.transientHeapBytes = transientMemory.size;
+}
+
+void RenderGraph::cullPasses() {
+	// Walk back from the end: a pass is needed if anything later that is needed reads what it writes
+	std::vector<bool> needed(resources.size(), false);
+	for (size_t i = passes.size(); i-- > 0;) {
+		Pass& pass = passes[i];
+
+		bool keep = pass.sideEffects;
+		for (const Use& use : pass.uses) {
+			keep = keep || (use.write && (resources[use.resource].imported || needed[use.resource]));
+		}
+
+		pass.culled = !keep;
+		if (keep) {
+			for (const Use& use : pass.uses) {
+				if (!use.write) {
+					needed[use.resource] = true;
+				}
+			}
+		}
+	}
+}
+
+void RenderGraph::checkAsyncCompute() {
+	// The compute queue starts on its passes as soon as it can, it never waits for the graphics queue within a frame
+	std::vector<bool> usedOnGraphics(resources.size(), false);
+	for (const Pass& pass : passes) {
+		if (pass.culled) {
+			continue;
+		}
+		for (const Use& use : pass.uses) {
+			const Resource& resource = resources[use.resource];
+			if (!pass.onCompute) {
+				usedOnGraphics[use.resource] = true;
+			} else if (usedOnGraphics[use.resource]) {
+				throw std::runtime_error(std::string("Failed to compile render graph: async compute pass ") + pass.name + " uses " + resource.name +
+					" after a graphics pass!");
+			} else if (resource.imported && resource.initial.stages != VK_PIPELINE_STAGE_2_NONE) {
+				throw std::runtime_error(std::string("Failed to compile render graph: async compute pass ") + pass.name + " uses " + resource.name +
+					", which still has work to wait for!");
+			}
+		}
+	}
+}
+
+void RenderGraph::createTransients() {
+	if (transients.empty()) {
+		return;
+	}
+
+	uint32_t memoryTypeBits = UINT32_MAX;
+	VkDeviceSize alignment = 1;
+	for (TransientImage& transient : transients) {
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = transient.info.format;
+		imageInfo.extent = { transient.info.extent.width, transient.info.extent.height, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = transient.info.usage;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		// Concurrent rather than handed over between the queues, the one image a frame doesn't make that worth it
+		const uint32_t families[] = { graphicsFamily, computeFamily };
+		if (transient.shared && graphicsFamily != computeFamily) {
+			imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+			imageInfo.queueFamilyIndexCount = 2;
+			imageInfo.pQueueFamilyIndices = families;
+		}
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		if (vkCreateImage(device, &imageInfo, nullptr, &transient.image) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create transient image!");
+		}
+		vkGetImageMemoryRequirements(device, transient.image, &transient.requirements);
+		memoryTypeBits &= transient.requirements.memoryTypeBits;
+		alignment = std::max(alignment, transient.requirements.alignment);
+	}
+
+	if (memoryTypeBits == 0) {
+		throw std::runtime_error("Failed to find a memory type every transient image can live in!");
+	}
+
+	placeTransients();
+
+	VkDeviceSize heapSize = 0;
+	for (const TransientImage& transient : transients) {
+		heapSize = std::max(heapSize, transient.offset + transient.requirements.size);
+	}
+
+	VkMemoryRequirements heapRequirements{};
+	heapRequirements.size = heapSize;
+	heapRequirements.alignment = alignment;
+	heapRequirements.memoryTypeBits = memoryTypeBits;
+
+	AllocationCreateInfo allocationInfo{};
+	allocationInfo.dedicated = true; // Aliased, so sharing a block with anything outside the graph would only complicate things
+	transientMemory = allocator->allocate(heapRequirements, allocationInfo, false);
+
+	for (const TransientImage& transient : transients) {
+		if (vkBindImageMemory(device, transient.image, transientMemory.memory, transientMemory.offset + transient.offset) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to bind transient image memory!");
+		}
+	}
+}
+
+void RenderGraph::placeTransients() {
+	// Biggest first, each at the lowest offset that doesn't overlap anything alive at the same time
+	std::vector<uint32_t> order(transients.size());
+	for (uint32_t i = 0; i < order.size(); i++) {
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+		return transients[a].requirements.size > transients[b].requirements.size;
+	});
+
+	std::vector<uint32_t> placed;
+	std::vector<std::pair<VkDeviceSize, VkDeviceSize>> busy;
+	for (uint32_t index : order) {
+		TransientImage& transient = transients[index];
+
+		busy.clear();
+		for (uint32_t other : placed) {
+			const TransientImage& placedTransient = transients[other];
+			if (lifetimesOverlap(transient.firstPass, transient.lastPass, placedTransient.firstPass, placedTransient.lastPass)) {
+				busy.push_back({ placedTransient.offset, placedTransient.offset + placedTransient.requirements.size });
+			}
+		}
+		std::sort(busy.begin(), busy.end());
+
+		VkDeviceSize offset = 0;
+		for (const auto& range : busy) {
+			if (alignUp(offset, transient.requirements.alignment) + transient.requirements.size <= range.first) {
+				break;
+			}
+			offset = std::max(offset, range.second);
+		}
+		transient.offset = alignUp(offset, transient.requirements.alignment);
+		placed.push_back(index);
+	}
+
+	// Whoever had the bytes before has to be done with them before the new owner's first use
+	for (TransientImage& transient : transients) {
+		for (uint32_t other = 0; other < transients.size(); other++) {
+			const TransientImage& earlier = transients[other];
+			const bool bytesOverlap = transient.offset < earlier.offset + earlier.requirements.size &&
+				earlier.offset < transient.offset + transient.requirements.size;
+			if (bytesOverlap && earlier.lastPass < transient.firstPass) {
+				transient.predecessors.push_back(other);
+			}
+		}
+	}
+}
+
+void RenderGraph::destroyTransients() {
+	for (const TransientImage& transient : liveTransients) {
+		vkDestroyImage(device, transient.image, nullptr);
+	}
+	liveTransients.clear();
+
+	if (transientMemory.memory != VK_NULL_HANDLE) {
+		allocator->free(transientMemory);
+		transientMemory = Allocation{};
+	}
+}
+
+void RenderGraph::computeBarriers() {
+	std::vector<State> states(resources.size());
+	for (size_t i = 0; i < resources.size(); i++) {
+		const Resource& resource = resources[i];
+		if (resource.imported) {
+			states[i].layout = resource.initial.layout;
+			states[i].writeStages = resource.initial.stages;
+			states[i].writeAccess = resource.initial.access;
+		}
+	}
+
+	for (uint32_t passIndex = 0; passIndex < passes.size(); passIndex++) {
+		Pass& pass = passes[passIndex];
+		if (pass.culled) {
+			continue;
+		}
+		pass.barriers.firstImageBarrier = static_cast<uint32_t>(imageBarriers.size());
+
+		// A transient starting here inherits the last uses of whatever was in its bytes before
+		for (const TransientImage& transient : transients) {
+			if (transient.firstPass != passIndex) {
+				continue;
+			}
+			State& state = states[transient.resource];
+			for (uint32_t predecessor : transient.predecessors) {
+				const State& previous = states[transients[predecessor].resource];
+				state.writeStages |= previous.writeStages | previous.readStages;
+				state.writeAccess |= previous.writeAccess;
+			}
+		}
+
+		// Fold every use of a resource in this pass into one, so the pass gets one barrier per resource at most
+		for (size_t i = 0; i < pass.uses.size(); i++) {
+			const ResourceId resource = pass.uses[i].resource;
+			bool seenBefore = false;
+			for (size_t j = 0; j < i; j++) {
+				seenBefore = seenBefore || pass.uses[j].resource == resource;
+			}
+			if (seenBefore) {
+				continue;
+			}
+
+			UsageInfo combined = getUsageInfo(pass.uses[i].usage);
+			bool write = pass.uses[i].write;
+			for (size_t j = i + 1; j < pass.uses.size(); j++) {
+				if (pass.uses[j].resource != resource) {
+					continue;
+				}
+				const UsageInfo other = getUsageInfo(pass.uses[j].usage);
+				if (resources[resource].image && other.layout != combined.layout) {
+					throw std::runtime_error(std::string("Failed to compile render graph: ") + resources[resource].name + " is used with two layouts in " +
+						pass.name + "!");
+				}
+				combined.stages |= other.stages;
+				combined.access |= other.access;
+				combined.writeAccess |= other.writeAccess;
+				write = write || pass.uses[j].write;
+			}
+
+			// The semaphore wait made the compute queue's writes available and visible at these stages, so unless the layout
+			// changes there is nothing left to do. Later barriers chain on the wait through these stages.
+			State& state = states[resource];
+			if (state.onCompute && !pass.onCompute) {
+				computeWaitStages |= combined.stages;
+				const VkImageLayout layout = state.layout;
+				state = State{};
+				state.layout = layout;
+				state.writeStages = combined.stages;
+				state.visibleStages = combined.stages;
+				state.visibleAccess = combined.access;
+			}
+
+			addBarriers(state, resources[resource], combined, write, pass.barriers);
+			state.onCompute = pass.onCompute;
+		}
+
+		pass.barriers.imageBarrierCount = static_cast<uint32_t>(imageBarriers.size()) - pass.barriers.firstImageBarrier;
+	}
+
+	// Each queue hands over the imports it touched last
+	for (bool compute : { false, true }) {
+		Batch& batch = compute ? finalComputeBarriers : finalBarriers;
+		batch.firstImageBarrier = static_cast<uint32_t>(imageBarriers.size());
+		for (size_t i = 0; i < resources.size(); i++) {
+			const Resource& resource = resources[i];
+			if (resource.imported && resource.finalUsage != RenderGraphUsage::None && resource.firstPass != UINT32_MAX && states[i].onCompute == compute) {
+				addBarriers(states[i], resource, getUsageInfo(resource.finalUsage), false, batch);
+			}
+		}
+		batch.imageBarrierCount = static_cast<uint32_t>(imageBarriers.size()) - batch.firstImageBarrier;
+	}
+
+	if (pipelineBarrier2 == nullptr) {
+		for (const VkImageMemoryBarrier2& barrier2 : imageBarriers) {
+			VkImageMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcAccessMask = static_cast<VkAccessFlags>(barrier2.srcAccessMask);
+			barrier.dstAccessMask = static_cast<VkAccessFlags>(barrier2.dstAccessMask);
+			barrier.oldLayout = barrier2.oldLayout;
+			barrier.newLayout = barrier2.newLayout;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = barrier2.image;
+			barrier.subresourceRange = barrier2.subresourceRange;
+			legacyImageBarriers.push_back(barrier);
+		}
+	}
+}
+
+void RenderGraph::addBarriers(State& state, const Resource& resource, const UsageInfo& usage, bool write, Batch& batch) {
+	const VkAccessFlags2 access = write ? usage.access : usage.access & ~usage.writeAccess;
+	const bool transition = resource.image && usage.layout != state.layout;
+
+	if (write || transition) {
+		// Write after write needs the old writes flushed, write after read only has to wait for the reads
+		const VkPipelineStageFlags2 srcStages = state.writeStages | state.readStages;
+		if (transition) {
+			VkImageMemoryBarrier2 barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+			barrier.srcStageMask = srcStages;
+			barrier.srcAccessMask = state.writeAccess;
+			barrier.dstStageMask = usage.stages;
+			barrier.dstAccessMask = access;
+			barrier.oldLayout = state.layout;
+			barrier.newLayout = usage.layout;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = resource.vkImage;
+			barrier.subresourceRange = { resource.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+			imageBarriers.push_back(barrier);
+		} else if (srcStages != VK_PIPELINE_STAGE_2_NONE) {
+			batch.memoryBarrier.srcStageMask |= srcStages;
+			batch.memoryBarrier.srcAccessMask |= state.writeAccess;
+			batch.memoryBarrier.dstStageMask |= usage.stages;
+			batch.memoryBarrier.dstAccessMask |= access;
+		}
+
+		// A layout transition is a write as far as later uses are concerned, already visible to this one
+		state = State{};
+		state.layout = usage.layout;
+		state.writeStages = usage.stages;
+		state.writeAccess = write ? usage.writeAccess : VK_ACCESS_2_NONE;
+		if (!write) {
+			state.readStages = usage.stages;
+			state.visibleStages = usage.stages;
+			state.visibleAccess = access;
+		}
+		return;
+	}
+
+	// Read after write: only needs a barrier the first time the write has to become visible to these stages
+	const bool notYetVisible = (usage.stages & ~state.visibleStages) != 0 || (access & ~state.visibleAccess) != 0;
+	if (state.writeStages != VK_PIPELINE_STAGE_2_NONE && notYetVisible) {
+		batch.memoryBarrier.srcStageMask |= state.writeStages;
+		batch.memoryBarrier.srcAccessMask |= state.writeAccess;
+		batch.memoryBarrier.dstStageMask |= usage.stages;
+		batch.memoryBarrier.dstAccessMask |= access;
+		state.visibleStages |= usage.stages;
+		state.visibleAccess |= access;
+	}
+	state.readStages |= usage.stages;
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer, VkCommandBuffer computeCommandBuffer) {
+	for (const Pass& pass : passes) {
+		if (pass.culled) {
+			continue;
+		}
+		VkCommandBuffer target = pass.onCompute ? computeCommandBuffer : commandBuffer;
+		recordBarriers(target, pass.barriers);
+		pass.execute(target);
+	}
+	recordBarriers(commandBuffer, finalBarriers);
+	if (hasComputeWork()) {
+		recordBarriers(computeCommandBuffer, finalComputeBarriers);
+	}
+}
+
+VkPipelineStageFlags RenderGraph::getComputeWaitStages() const {
+	// Nothing on the graphics side reads compute results, the wait is only there to hold the fence back
+	if (computeWaitStages == VK_PIPELINE_STAGE_2_NONE) {
+		return VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+	}
+	return static_cast<VkPipelineStageFlags>(computeWaitStages);
+}
+
+void RenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const Batch& batch) {
+	const VkMemoryBarrier2& memoryBarrier2 = batch.memoryBarrier;
+	const bool memory = memoryBarrier2.srcStageMask != VK_PIPELINE_STAGE_2_NONE || memoryBarrier2.dstStageMask != VK_PIPELINE_STAGE_2_NONE;
+	if (batch.imageBarrierCount == 0 && !memory) {
+		return;
+	}
+
+	if (pipelineBarrier2 != nullptr) {
+		VkMemoryBarrier2 globalBarrier = memoryBarrier2;
+		globalBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+
+		VkDependencyInfo dependencyInfo{};
+		dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+		dependencyInfo.memoryBarrierCount = memory ? 1 : 0;
+		dependencyInfo.pMemoryBarriers = &globalBarrier;
+		dependencyInfo.imageMemoryBarrierCount = batch.imageBarrierCount;
+		dependencyInfo.pImageMemoryBarriers = imageBarriers.data() + batch.firstImageBarrier;
+		pipelineBarrier2(commandBuffer, &dependencyInfo);
+		return;
+	}
+
+	// Without synchronization2 every barrier in a batch shares one pair of stage masks, and NONE has to be spelled out
+	VkPipelineStageFlags2 srcStages = memoryBarrier2.srcStageMask;
+	VkPipelineStageFlags2 dstStages = memoryBarrier2.dstStageMask;
+	for (uint32_t i = 0; i < batch.imageBarrierCount; i++) {
+		srcStages |= imageBarriers[batch.firstImageBarrier + i].srcStageMask;
+		dstStages |= imageBarriers[batch.firstImageBarrier + i].dstStageMask;
+	}
+
+	const VkPipelineStageFlags legacySrcStages = srcStages != VK_PIPELINE_STAGE_2_NONE ? static_cast<VkPipelineStageFlags>(srcStages) :
+		static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+	const VkPipelineStageFlags legacyDstStages = dstStages != VK_PIPELINE_STAGE_2_NONE ? static_cast<VkPipelineStageFlags>(dstStages) :
+		static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+
+	VkMemoryBarrier globalBarrier{};
+	globalBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	globalBarrier.srcAccessMask = static_cast<VkAccessFlags>(memoryBarrier2.srcAccessMask);
+	globalBarrier.dstAccessMask = static_cast<VkAccessFlags>(memoryBarrier2.dstAccessMask);
+
+	vkCmdPipelineBarrier(commandBuffer, legacySrcStages, legacyDstStages, 0, memory ? 1 : 0, &globalBarrier, 0, nullptr, batch.imageBarrierCount, legacyImageBarriers.data() + batch.firstImageBarrier);
+}
+
+void RenderGraph::dump(std::ostream& out) const {
+	const auto flags = out.flags();
+	const auto precision = out.precision();
+	out << std::fixed << std::setprecision(1);
+
+	out << "Render graph: " << stats.passes << " passes (" << stats.culledPasses << " culled, " << stats.computePasses << " async compute), " << stats.imageBarriers << " image and "
+		<< stats.memoryBarriers << " memory barriers in " << stats.barrierBatches << " batches, "
+		<< (pipelineBarrier2 != nullptr ? "synchronization2" : "legacy barriers") << "\n";
+
+	auto dumpBatch = [&](const char* name, const Batch& batch, bool compute) {
+		out << "  " << name << (compute ? " (async compute):" : ":");
+		for (uint32_t i = 0; i < batch.imageBarrierCount; i++) {
+			const VkImageMemoryBarrier2& barrier = imageBarriers[batch.firstImageBarrier + i];
+			const auto resource = std::find_if(resources.begin(), resources.end(), [&](const Resource& r) {
+				return r.image && r.vkImage == barrier.image;
+			});
+			out << " [" << (resource != resources.end() ? resource->name : "?") << " " << layoutName(barrier.oldLayout) << " -> "
+				<< layoutName(barrier.newLayout) << "]";
+		}
+		if (batch.memoryBarrier.srcStageMask != VK_PIPELINE_STAGE_2_NONE || batch.memoryBarrier.dstStageMask != VK_PIPELINE_STAGE_2_NONE) {
+			out << " [memory 0x" << std::hex << batch.memoryBarrier.srcStageMask << " -> 0x" << batch.memoryBarrier.dstStageMask << std::dec << "]";
+		}
+		out << "\n";
+	};
+
+	for (const Pass& pass : passes) {
+		if (pass.culled) {
+			out << "  " << pass.name << ": culled\n";
+		} else {
+			dumpBatch(pass.name, pass.barriers, pass.onCompute);
+		}
+	}
+	dumpBatch("(end of frame)", finalBarriers, false);
+	if (hasComputeWork()) {
+		dumpBatch("(end of frame)", finalComputeBarriers, true);
+		out << "  Graphics waits for compute at 0x" << std::hex << getComputeWaitStages() << std::dec << "\n";
+	}
+
+	for (const Resource& resource : resources) {
+		out << "  " << std::left << std::setw(20) << resource.name << std::right << (resource.imported ? " imported " : " transient ")
+			<< (resource.image ? "image" : "buffer");
+		if (resource.firstPass == UINT32_MAX) {
+			out << ", unused\n";
+			continue;
+		}
+		out << ", passes " << resource.firstPass << "-" << resource.lastPass;
+		if (resource.transient != UINT32_MAX) {
+			const TransientImage& transient = transients[resource.transient];
+			out << ", " << toMiB(transient.requirements.size) << " MiB at " << toMiB(transient.offset) << " MiB";
+		}
+		out << "\n";
+	}
+
+	out << "  Transient images: " << toMiB(stats.transientBytes) << " MiB in a " << toMiB(stats.transientHeapBytes) << " MiB block, "
+		<< toMiB(stats.transientBytes - std::min(stats.transientBytes, stats.transientHeapBytes)) << " MiB saved by aliasing\n";
+
+	out.flags(flags);
+	out.precision(precision);
+}
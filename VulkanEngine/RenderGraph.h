@@ -0,0 +1,284 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "DeviceMemoryAllocator.h"
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <vector>
+
+/// <summary>
+/// What a pass does with a resource. Each one stands for a fixed stage, access and (for images) layout, see RenderGraph.cpp.
+/// </summary>
+enum class RenderGraphUsage {
+	None, // Only valid as a final usage: leave the resource as the last pass had it
+	ColorAttachment,
+	DepthAttachment,
+	SampledFragment,
+	SampledCompute,
+	StorageReadCompute,
+	StorageWriteCompute,
+	StorageReadVertex,
+	StorageWriteFragment, // Fragment shader stores and atomics, e.g. texture streaming feedback
+	IndirectRead,
+	TransferSource,
+	TransferDestination,
+	HostRead, // Mapped readback once the frame's fence has signalled
+	Present
+};
+
+/// <summary>
+/// How an imported resource was last touched before the graph runs, i.e. what the first barrier on it has to wait for.
+/// UNDEFINED discards the contents of an image.
+/// </summary>
+struct RenderGraphState {
+	VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_NONE;
+	VkAccessFlags2 access = VK_ACCESS_2_NONE; // Writes that still have to be made visible
+	VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+};
+
+struct RenderGraphStats {
+	uint32_t passes = 0;
+	uint32_t culledPasses = 0;
+	uint32_t computePasses = 0; // Kept passes that went to the async compute queue
+	uint32_t barrierBatches = 0; // Pipeline barrier commands recorded
+	uint32_t imageBarriers = 0;
+	uint32_t memoryBarriers = 0; // Buffer hazards, merged into one global barrier per batch
+	VkDeviceSize transientBytes = 0; // What the transient images would take without aliasing
+	VkDeviceSize transientHeapBytes = 0; // What they actually take
+};
+
+/// <summary>
+/// A frame's passes and the resources they touch, rebuilt every frame: import the resources that live outside the graph,
+/// create the transient ones, add passes with their reads and writes, then compile() and execute().
+///
+/// compile() drops passes nothing depends on (a pass is kept if it has side effects, writes an imported resource, or
+/// writes something a kept pass reads), works out the barriers between the rest and batches each pass's into a single
+/// pipeline barrier recorded right before it, using synchronization2 when the device has it. Buffer hazards become one
+/// global memory barrier per batch, which is what drivers end up doing with buffer barriers anyway.
+///
+/// Transient images are placed in one shared block of device memory, and when two of them are never alive during the
+/// same pass they get the same bytes. The first use of an aliased image waits for the last use of whatever was there
+/// before. The images, and the block, are kept for as long as the frame declares the same transients, so a steady frame
+/// creates nothing.
+///
+/// Passes marked asyncCompute() go to a second command buffer for a separate compute queue, when the graph was given one.
+/// That queue starts on them right away, so an async compute pass may only use resources no earlier graphics pass in the
+/// frame touches, and imports it uses must have nothing left to wait for. The graphics submission waits on a semaphore
+/// signalled by the compute one at getComputeWaitStages(), only right before the first pass that needs compute results.
+/// Memory is made visible by that wait, so the crossing costs no barrier; transients an async compute pass touches are
+/// created concurrent between the two families and never aliased. Without a compute queue those passes simply run in line.
+///
+/// Passes run in the order they were added; the graph does not reorder. Each frame in flight needs its own graph, since
+/// compile() may destroy transient images the previous frame on it used. Not thread safe.
+/// </summary>
+class RenderGraph {
+public:
+	using ResourceId = uint32_t;
+	using PassFunction = std::function<void(VkCommandBuffer)>;
+
+	struct TransientImageInfo {
+		VkFormat format;
+		VkExtent2D extent;
+		VkImageUsageFlags usage;
+		VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+	};
+
+	/// <summary>
+	/// Returned by addPass() to declare what the pass touches. A resource may be declared more than once in a pass as long
+	/// as the image layouts agree.
+	/// </summary>
+	class PassBuilder {
+	public:
+		PassBuilder& read(ResourceId resource, RenderGraphUsage usage);
+		PassBuilder& write(ResourceId resource, RenderGraphUsage usage);
+
+		/// <summary>
+		/// Keep the pass even if nothing reads what it writes, e.g. because the host does.
+		/// </summary>
+		PassBuilder& sideEffects();
+
+		/// <summary>
+		/// Run on the async compute queue. The pass may only record compute and transfer work.
+		/// </summary>
+		PassBuilder& asyncCompute();
+
+	private:
+		friend class RenderGraph;
+		PassBuilder(RenderGraph& graph, uint32_t pass) : graph(graph), pass(pass) {}
+
+		RenderGraph& graph;
+		uint32_t pass;
+	};
+
+	/// <summary>
+	/// synchronization2 needs VK_KHR_synchronization2 and its feature enabled on device. computeFamily is the family of the
+	/// async compute queue, VK_QUEUE_FAMILY_IGNORED to run asyncCompute() passes on the graphics queue.
+	/// </summary>
+	void init(VkDevice device, DeviceMemoryAllocator& allocator, bool synchronization2, uint32_t graphicsFamily, uint32_t computeFamily);
+
+	/// <summary>
+	/// Destroy the transient images and their memory. The GPU has to be done with them.
+	/// </summary>
+	void cleanup();
+
+	/// <summary>
+	/// Forget last frame's passes and resources. Transient images stay around for compile() to reuse.
+	/// </summary>
+	void reset();
+
+	ResourceId importImage(const char* name, VkImage image, VkImageAspectFlags aspect, const RenderGraphState& initial, RenderGraphUsage finalUsage);
+	ResourceId importBuffer(const char* name, VkBuffer buffer, const RenderGraphState& initial, RenderGraphUsage finalUsage);
+
+	/// <summary>
+	/// An image that only lives within the frame. Its contents are undefined at its first use. getImage() is valid after compile().
+	/// </summary>
+	ResourceId createImage(const char* name, const TransientImageInfo& info);
+
+	VkImage getImage(ResourceId resource) const;
+
+	/// <summary>
+	/// name has to outlive the graph's use of it, typically a string literal.
+	/// </summary>
+	PassBuilder addPass(const char* name, PassFunction execute);
+
+	/// <summary>
+	/// Cull, place transients and work out the barriers. Throws if a resource is used with two layouts in one pass.
+	/// </summary>
+	void compile();
+
+	/// <summary>
+	/// Record every kept pass into commandBuffer, each after its barriers, then the final transitions. Async compute passes
+	/// go into computeCommandBuffer instead, which needs to be recording when hasComputeWork() and is ignored otherwise.
+	/// </summary>
+	void execute(VkCommandBuffer commandBuffer, VkCommandBuffer computeCommandBuffer = VK_NULL_HANDLE);
+
+	/// <summary>
+	/// After compile(): whether anything went to the compute queue, in which case its submission has to signal a semaphore
+	/// the graphics one waits on at getComputeWaitStages(). The wait is there even when no graphics pass reads compute
+	/// results, so the graphics submission's fence still covers the compute work.
+	/// </summary>
+	bool hasComputeWork() const {
+		return stats.computePasses != 0;
+	}
+	VkPipelineStageFlags getComputeWaitStages() const;
+
+	const RenderGraphStats& getStats() const {
+		return stats;
+	}
+
+	/// <summary>
+	/// The compiled graph: each pass with its barriers, each resource with its lifetime and, for transients, its place in
+	/// the shared block.
+	/// </summary>
+	void dump(std::ostream& out) const;
+
+private:
+	struct Use {
+		ResourceId resource;
+		RenderGraphUsage usage;
+		bool write;
+	};
+
+	// The barriers recorded before a pass. memoryBarrier is unused while its stages are NONE.
+	struct Batch {
+		uint32_t firstImageBarrier = 0;
+		uint32_t imageBarrierCount = 0;
+		VkMemoryBarrier2 memoryBarrier{};
+	};
+
+	// Stage, access and layout a usage stands for. writeAccess is the part of access that writes.
+	struct UsageInfo {
+		VkPipelineStageFlags2 stages;
+		VkAccessFlags2 access;
+		VkAccessFlags2 writeAccess;
+		VkImageLayout layout;
+	};
+
+	struct Pass {
+		const char* name;
+		PassFunction execute;
+		std::vector<Use> uses;
+		bool sideEffects = false;
+		bool asyncCompute = false;
+		bool culled = false;
+		bool onCompute = false; // asyncCompute and the graph has a compute queue
+
+		// Filled in by compile(): a range of imageBarriers, and every buffer hazard merged into one barrier
+		Batch barriers;
+	};
+
+	struct Resource {
+		const char* name;
+		bool image;
+		bool imported;
+		VkImage vkImage = VK_NULL_HANDLE;
+		VkBuffer vkBuffer = VK_NULL_HANDLE;
+		VkImageAspectFlags aspect = 0;
+		RenderGraphState initial;
+		RenderGraphUsage finalUsage = RenderGraphUsage::None;
+		TransientImageInfo transientInfo{};
+
+		// Filled in by compile()
+		uint32_t transient = UINT32_MAX; // Index into transients, for the ones a kept pass uses
+		uint32_t firstPass = UINT32_MAX;
+		uint32_t lastPass = 0;
+	};
+
+	struct TransientImage {
+		ResourceId resource;
+		TransientImageInfo info;
+		uint32_t firstPass;
+		uint32_t lastPass;
+		bool shared = false; // Concurrent between the graphics and compute families; lives for the whole frame
+		VkImage image = VK_NULL_HANDLE;
+		VkMemoryRequirements requirements{};
+		VkDeviceSize offset = 0;
+		std::vector<uint32_t> predecessors; // Transients that used overlapping bytes earlier in the frame
+	};
+
+	// Where a resource stands while compile() walks the passes
+	struct State {
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags2 writeStages = VK_PIPELINE_STAGE_2_NONE; // Last write, or the layout transition that counts as one
+		VkAccessFlags2 writeAccess = VK_ACCESS_2_NONE;
+		VkPipelineStageFlags2 readStages = VK_PIPELINE_STAGE_2_NONE; // Reads since then
+		VkPipelineStageFlags2 visibleStages = VK_PIPELINE_STAGE_2_NONE; // Where the last write has already been made visible
+		VkAccessFlags2 visibleAccess = VK_ACCESS_2_NONE;
+		bool onCompute = false; // Last touched on the compute queue
+	};
+
+	static UsageInfo getUsageInfo(RenderGraphUsage usage);
+
+	void cullPasses();
+	void placeTransients();
+	void createTransients();
+	void destroyTransients();
+	void checkAsyncCompute();
+	void computeBarriers();
+	void addBarriers(State& state, const Resource& resource, const UsageInfo& usage, bool write, Batch& batch);
+	void recordBarriers(VkCommandBuffer commandBuffer, const Batch& batch);
+
+	VkDevice device = VK_NULL_HANDLE;
+	DeviceMemoryAllocator* allocator = nullptr;
+	PFN_vkCmdPipelineBarrier2KHR pipelineBarrier2 = nullptr; // Null without synchronization2
+	uint32_t graphicsFamily = VK_QUEUE_FAMILY_IGNORED;
+	uint32_t computeFamily = VK_QUEUE_FAMILY_IGNORED;
+
+	std::vector<Pass> passes;
+	std::vector<Resource> resources;
+	std::vector<TransientImage> transients;
+	std::vector<VkImageMemoryBarrier2> imageBarriers;
+	std::vector<VkImageMemoryBarrier> legacyImageBarriers; // Same barriers for vkCmdPipelineBarrier, without synchronization2
+	Batch finalBarriers; // After the last pass, into each imported resource's final usage
+	Batch finalComputeBarriers; // Same for the resources last touched on the compute queue
+	VkPipelineStageFlags2 computeWaitStages = VK_PIPELINE_STAGE_2_NONE;
+
+	// What the transients were created for, reused while a frame asks for exactly the same
+	std::vector<TransientImage> liveTransients;
+	Allocation transientMemory;
+
+	RenderGraphStats stats;
+};
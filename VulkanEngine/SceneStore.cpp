@@ -0,0 +1,346 @@
+#include "SceneStore.h"
+
+#include "JobSystem.h"
+#include "SimdFloat.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <stdexcept>
+
+namespace {
+	// Raw column pointers for the kernels, so the inner loops don't go through std::vector
+	struct Columns {
+		const float* local[10];
+		const float* localBounds[6];
+		float* world[12];
+		float* worldBounds[6];
+		const uint32_t* parentSlot;
+	};
+
+	/// <summary>
+	/// World matrices of V::WIDTH entities from slot on: the local rotation and scale as a 3x3, the position as the last
+	/// column, then for children the parent's world matrix times that. Parents are gathered, everything else is loaded
+	/// straight from consecutive slots.
+	/// </summary>
+	template <typename V>
+	void composeWorld(const Columns& columns, uint32_t slot, bool roots, V (&world)[12]) {
+		const V qx = V::load(columns.local[3] + slot);
+		const V qy = V::load(columns.local[4] + slot);
+		const V qz = V::load(columns.local[5] + slot);
+		const V qw = V::load(columns.local[6] + slot);
+		const V sx = V::load(columns.local[7] + slot);
+		const V sy = V::load(columns.local[8] + slot);
+		const V sz = V::load(columns.local[9] + slot);
+
+		const V one = V::broadcast(1.0f);
+		const V two = V::broadcast(2.0f);
+		const V xx = qx * qx, yy = qy * qy, zz = qz * qz;
+		const V xy = qx * qy, xz = qx * qz, yz = qy * qz;
+		const V xw = qx * qw, yw = qy * qw, zw = qz * qw;
+
+		V local[12];
+		local[0] = (one - two * (yy + zz)) * sx;
+		local[1] = two * (xy - zw) * sy;
+		local[2] = two * (xz + yw) * sz;
+		local[3] = V::load(columns.local[0] + slot);
+		local[4] = two * (xy + zw) * sx;
+		local[5] = (one - two * (xx + zz)) * sy;
+		local[6] = two * (yz - xw) * sz;
+		local[7] = V::load(columns.local[1] + slot);
+		local[8] = two * (xz - yw) * sx;
+		local[9] = two * (yz + xw) * sy;
+		local[10] = (one - two * (xx + yy)) * sz;
+		local[11] = V::load(columns.local[2] + slot);
+
+		if (roots) {
+			for (uint32_t i = 0; i < 12; i++) {
+				world[i] = local[i];
+			}
+			return;
+		}
+
+		const uint32_t* parents = columns.parentSlot + slot;
+		for (uint32_t row = 0; row < 3; row++) {
+			const V p0 = V::gather(columns.world[row * 4 + 0], parents);
+			const V p1 = V::gather(columns.world[row * 4 + 1], parents);
+			const V p2 = V::gather(columns.world[row * 4 + 2], parents);
+			const V p3 = V::gather(columns.world[row * 4 + 3], parents);
+			world[row * 4 + 0] = p0 * local[0] + p1 * local[4] + p2 * local[8];
+			world[row * 4 + 1] = p0 * local[1] + p1 * local[5] + p2 * local[9];
+			world[row * 4 + 2] = p0 * local[2] + p1 * local[6] + p2 * local[10];
+			world[row * 4 + 3] = p0 * local[3] + p1 * local[7] + p2 * local[11] + p3;
+		}
+	}
+
+	/// <summary>
+	/// World space boxes of the same entities (Arvo, "Transforming Axis-Aligned Bounding Boxes", Graphics Gems 1990): the
+	/// center goes through the matrix, the extent through its absolute value.
+	/// </summary>
+	template <typename V>
+	void transformBounds(const Columns& columns, uint32_t slot, const V (&world)[12]) {
+		const V cx = V::load(columns.localBounds[0] + slot);
+		const V cy = V::load(columns.localBounds[1] + slot);
+		const V cz = V::load(columns.localBounds[2] + slot);
+		const V ex = V::load(columns.localBounds[3] + slot);
+		const V ey = V::load(columns.localBounds[4] + slot);
+		const V ez = V::load(columns.localBounds[5] + slot);
+
+		for (uint32_t row = 0; row < 3; row++) {
+			const V center = world[row * 4 + 0] * cx + world[row * 4 + 1] * cy + world[row * 4 + 2] * cz + world[row * 4 + 3];
+			const V extent = abs(world[row * 4 + 0]) * ex + abs(world[row * 4 + 1]) * ey + abs(world[row * 4 + 2]) * ez;
+			(center - extent).store(columns.worldBounds[row] + slot);
+			(center + extent).store(columns.worldBounds[3 + row] + slot);
+		}
+	}
+
+	template <typename V>
+	void updateEntities(const Columns& columns, uint32_t slot, bool roots) {
+		V world[12];
+		composeWorld(columns, slot, roots, world);
+		for (uint32_t i = 0; i < 12; i++) {
+			world[i].store(columns.world[i] + slot);
+		}
+		transformBounds(columns, slot, world);
+	}
+
+	template <typename T>
+	void permute(std::vector<T>& values, const std::vector<uint32_t>& order) {
+		std::vector<T> sorted(values.size());
+		for (size_t i = 0; i < order.size(); i++) {
+			sorted[i] = values[order[i]];
+		}
+		values.swap(sorted);
+	}
+}
+
+void SceneStore::reserve(uint32_t count) {
+	for (auto& column : local) {
+		column.reserve(count);
+	}
+	for (auto& column : localBounds) {
+		column.reserve(count);
+	}
+	for (auto& column : world) {
+		column.reserve(count);
+	}
+	for (auto& column : worldBounds) {
+		column.reserve(count);
+	}
+	parentSlot.reserve(count);
+	depth.reserve(count);
+	slotOf.reserve(count);
+	entityAt.reserve(count);
+}
+
+void SceneStore::clear() {
+	const uint32_t version = layoutVersion + 1;
+	*this = SceneStore();
+	layoutVersion = version;
+}
+
+SceneStore::EntityId SceneStore::createEntity(EntityId parent, const SceneTransform& transform, const glm::vec3& boundsCenter,
+	const glm::vec3& boundsExtent) {
+	if (parent != NO_PARENT && parent >= slotOf.size()) {
+		throw std::runtime_error("Parent of a new scene entity has to exist already!");
+	}
+
+	const EntityId entity = static_cast<EntityId>(slotOf.size());
+	const uint32_t slot = static_cast<uint32_t>(entityAt.size());
+	slotOf.push_back(slot);
+	entityAt.push_back(entity);
+
+	for (auto& column : local) {
+		column.push_back(0.0f);
+	}
+	for (auto& column : localBounds) {
+		column.push_back(0.0f);
+	}
+	for (auto& column : world) {
+		column.push_back(0.0f);
+	}
+	for (auto& column : worldBounds) {
+		column.push_back(0.0f);
+	}
+	parentSlot.push_back(parent == NO_PARENT ? 0 : slotOf[parent]);
+	depth.push_back(parent == NO_PARENT ? 0 : depth[slotOf[parent]] + 1);
+
+	setLocalTransform(entity, transform);
+	localBounds[CENTER_X][slot] = boundsCenter.x;
+	localBounds[CENTER_Y][slot] = boundsCenter.y;
+	localBounds[CENTER_Z][slot] = boundsCenter.z;
+	localBounds[EXTENT_X][slot] = boundsExtent.x;
+	localBounds[EXTENT_Y][slot] = boundsExtent.y;
+	localBounds[EXTENT_Z][slot] = boundsExtent.z;
+
+	hierarchyDirty = true;
+	layoutVersion++;
+	return entity;
+}
+
+void SceneStore::setLocalTransform(EntityId entity, const SceneTransform& transform) {
+	const uint32_t slot = slotOf[entity];
+	local[POSITION_X][slot] = transform.position.x;
+	local[POSITION_Y][slot] = transform.position.y;
+	local[POSITION_Z][slot] = transform.position.z;
+	local[ROTATION_X][slot] = transform.rotation.x;
+	local[ROTATION_Y][slot] = transform.rotation.y;
+	local[ROTATION_Z][slot] = transform.rotation.z;
+	local[ROTATION_W][slot] = transform.rotation.w;
+	local[SCALE_X][slot] = transform.scale.x;
+	local[SCALE_Y][slot] = transform.scale.y;
+	local[SCALE_Z][slot] = transform.scale.z;
+	transformsDirty = true;
+}
+
+void SceneStore::sortByDepth() {
+	const uint32_t count = static_cast<uint32_t>(depth.size());
+	const uint32_t levels = count == 0 ? 0 : *std::max_element(depth.begin(), depth.end()) + 1;
+
+	// Counting sort, stable so siblings keep the order they were created in
+	levelStart.assign(levels + 1, 0);
+	for (uint32_t slot = 0; slot < count; slot++) {
+		levelStart[depth[slot] + 1]++;
+	}
+	for (uint32_t level = 0; level < levels; level++) {
+		levelStart[level + 1] += levelStart[level];
+	}
+	hierarchyDirty = false;
+
+	// Entities tend to be created parents first, in which case there is nothing to move
+	if (std::is_sorted(depth.begin(), depth.end())) {
+		return;
+	}
+
+	std::vector<uint32_t> order(count); // New slot -> old slot
+	std::vector<uint32_t> newSlot(count); // Old slot -> new slot
+	std::vector<uint32_t> next(levelStart.begin(), levelStart.end() - 1);
+	for (uint32_t slot = 0; slot < count; slot++) {
+		const uint32_t sorted = next[depth[slot]]++;
+		order[sorted] = slot;
+		newSlot[slot] = sorted;
+	}
+
+	for (auto& column : local) {
+		permute(column, order);
+	}
+	for (auto& column : localBounds) {
+		permute(column, order);
+	}
+	for (auto& column : world) {
+		permute(column, order);
+	}
+	for (auto& column : worldBounds) {
+		permute(column, order);
+	}
+	permute(parentSlot, order);
+	permute(depth, order);
+	permute(entityAt, order);
+
+	for (uint32_t slot = 0; slot < count; slot++) {
+		parentSlot[slot] = newSlot[parentSlot[slot]];
+		slotOf[entityAt[slot]] = slot;
+	}
+	layoutVersion++;
+	stats.sorts++;
+}
+
+void SceneStore::updateRange(uint32_t begin, uint32_t end, bool roots) {
+	Columns columns;
+	for (uint32_t i = 0; i < LOCAL_COUNT; i++) {
+		columns.local[i] = local[i].data();
+	}
+	for (uint32_t i = 0; i < LOCAL_BOUNDS_COUNT; i++) {
+		columns.localBounds[i] = localBounds[i].data();
+	}
+	for (uint32_t i = 0; i < WORLD_COUNT; i++) {
+		columns.world[i] = world[i].data();
+	}
+	for (uint32_t i = 0; i < WORLD_BOUNDS_COUNT; i++) {
+		columns.worldBounds[i] = worldBounds[i].data();
+	}
+	columns.parentSlot = parentSlot.data();
+
+	// Full vectors, then the rest one at a time. Running a vector past end would race with whoever owns the next batch.
+	uint32_t slot = begin;
+	for (; slot + SimdFloat::WIDTH <= end; slot += SimdFloat::WIDTH) {
+		updateEntities<SimdFloat>(columns, slot, roots);
+	}
+	for (; slot < end; slot++) {
+		updateEntities<ScalarFloat>(columns, slot, roots);
+	}
+}
+
+bool SceneStore::update(JobSystem* jobs) {
+	if (!hierarchyDirty && !transformsDirty) {
+		return false;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+
+	if (hierarchyDirty) {
+		sortByDepth();
+	}
+
+	const uint32_t levels = levelStart.empty() ? 0 : static_cast<uint32_t>(levelStart.size() - 1);
+	for (uint32_t level = 0; level < levels; level++) {
+		const uint32_t begin = levelStart[level];
+		const uint32_t count = levelStart[level + 1] - begin;
+		const bool roots = level == 0;
+
+		// Each level needs the one before it finished, which parallelFor returning guarantees
+		if (jobs && count > UPDATE_BATCH_SIZE) {
+			jobs->parallelFor(count, UPDATE_BATCH_SIZE, [this, begin, roots](uint32_t batchBegin, uint32_t batchEnd) {
+				updateRange(begin + batchBegin, begin + batchEnd, roots);
+			});
+		} else {
+			updateRange(begin, begin + count, roots);
+		}
+	}
+	transformsDirty = false;
+
+	stats.entities = getEntityCount();
+	stats.levels = levels;
+	stats.updates++;
+	stats.lastUpdateMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return true;
+}
+
+glm::vec3 SceneStore::getWorldPosition(EntityId entity) const {
+	const uint32_t slot = slotOf[entity];
+	return glm::vec3(world[3][slot], world[7][slot], world[11][slot]);
+}
+
+glm::mat4 SceneStore::getWorldMatrix(EntityId entity) const {
+	const uint32_t slot = slotOf[entity];
+	glm::mat4 matrix(1.0f);
+	for (int column = 0; column < 4; column++) {
+		matrix[column] = glm::vec4(world[column][slot], world[4 + column][slot], world[8 + column][slot], column == 3 ? 1.0f : 0.0f);
+	}
+	return matrix;
+}
+
+SceneStore::Bounds SceneStore::getWorldBounds(EntityId entity) const {
+	const uint32_t slot = slotOf[entity];
+	Bounds bounds;
+	bounds.min = glm::vec3(worldBounds[MIN_X][slot], worldBounds[MIN_Y][slot], worldBounds[MIN_Z][slot]);
+	bounds.max = glm::vec3(worldBounds[MAX_X][slot], worldBounds[MAX_Y][slot], worldBounds[MAX_Z][slot]);
+	return bounds;
+}
+
+SceneStore::BoundsColumns SceneStore::getWorldBoundsColumns() const {
+	BoundsColumns columns;
+	for (int axis = 0; axis < 3; axis++) {
+		columns.min[axis] = worldBounds[MIN_X + axis].data();
+		columns.max[axis] = worldBounds[MAX_X + axis].data();
+	}
+	columns.entities = entityAt.data();
+	columns.count = static_cast<uint32_t>(entityAt.size());
+	return columns;
+}
+
+void SceneStore::printStats(std::ostream& out) const {
+	out << stats.entities << " entities over " << stats.levels << " levels, " << stats.updates << " updates (last "
+		<< std::fixed << std::setprecision(3) << stats.lastUpdateMilliseconds << " ms, " << SimdFloat::NAME << "), "
+		<< stats.sorts << " reorders";
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+class JobSystem;
+
+/// <summary>
+/// Position, rotation and scale of an entity relative to its parent, or to the world for roots.
+/// </summary>
+struct SceneTransform {
+	glm::vec3 position = glm::vec3(0.0f);
+	glm::vec4 rotation = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f); // Unit quaternion, xyzw
+	glm::vec3 scale = glm::vec3(1.0f);
+};
+
+struct SceneStats {
+	uint32_t entities = 0;
+	uint32_t levels = 0; // Depth of the deepest entity plus one
+	uint32_t updates = 0; // update() calls that had something to do
+	uint32_t sorts = 0; // Times the arrays were reordered because the hierarchy changed
+	double lastUpdateMilliseconds = 0.0;
+};
+
+/// <summary>
+/// Every entity of the scene as plain arrays rather than a graph of node objects: one array per float of the local
+/// transform, the parent, the local bounds, the world matrix and the world bounds, all indexed by the entity's slot.
+/// update() walks them front to back with SIMD kernels, so each cache line fetched is all payload.
+///
+/// Slots are kept sorted by depth in the hierarchy, roots first, so a parent's world matrix is always final before any
+/// child reads it. One depth level is a contiguous range with no dependencies inside it, which is what lets update()
+/// split it across the job system. Entities are addressed by a stable EntityId; the slots behind it move whenever
+/// new entities change the order, and update() puts them back in order before propagating.
+///
+/// Parents have to exist before their children, so the hierarchy can't have cycles. update() only does work after
+/// something changed. World matrices are affine and stored as the three rows of a 3x4. Not thread safe.
+/// </summary>
+class SceneStore {
+public:
+	using EntityId = uint32_t;
+	static const EntityId NO_PARENT = UINT32_MAX;
+
+	/// <summary>
+	/// World space box, read by whoever consumes the scene in bulk.
+	/// </summary>
+	struct Bounds {
+		glm::vec3 min;
+		glm::vec3 max;
+	};
+
+	/// <summary>
+	/// Every world space box as columns by slot, for kernels that test them in bulk. entities maps a slot back to its
+	/// entity. Valid until the next createEntity() or update().
+	/// </summary>
+	struct BoundsColumns {
+		const float* min[3];
+		const float* max[3];
+		const EntityId* entities;
+		uint32_t count;
+	};
+
+	void reserve(uint32_t count);
+	void clear();
+
+	/// <summary>
+	/// boundsCenter and boundsExtent are the entity's local space box, which update() turns into a world space one.
+	/// </summary>
+	EntityId createEntity(EntityId parent, const SceneTransform& local, const glm::vec3& boundsCenter, const glm::vec3& boundsExtent);
+
+	void setLocalTransform(EntityId entity, const SceneTransform& local);
+
+	uint32_t getEntityCount() const {
+		return static_cast<uint32_t>(slotOf.size());
+	}
+
+	/// <summary>
+	/// Reorder if the hierarchy changed, then recompute every world matrix and world box, one depth level after the other.
+	/// jobs, if given, splits each level into batches for its threads. Returns whether anything was recomputed.
+	/// </summary>
+	bool update(JobSystem* jobs = nullptr);
+
+	/// <summary>
+	/// Force the next update() to recompute everything even if nothing changed, for benchmarking.
+	/// </summary>
+	void markDirty() {
+		transformsDirty = true;
+	}
+
+	// Valid after update()
+	glm::vec3 getWorldPosition(EntityId entity) const;
+	glm::mat4 getWorldMatrix(EntityId entity) const;
+	Bounds getWorldBounds(EntityId entity) const;
+	BoundsColumns getWorldBoundsColumns() const;
+
+	/// <summary>
+	/// Changes whenever entities are added or slots move, i.e. whenever anything that remembered slots has to start over.
+	/// </summary>
+	uint32_t getLayoutVersion() const {
+		return layoutVersion;
+	}
+
+	const SceneStats& getStats() const {
+		return stats;
+	}
+
+	void printStats(std::ostream& out) const;
+
+private:
+	// Floats of the local transform, one array each
+	enum Local {
+		POSITION_X, POSITION_Y, POSITION_Z,
+		ROTATION_X, ROTATION_Y, ROTATION_Z, ROTATION_W,
+		SCALE_X, SCALE_Y, SCALE_Z,
+		LOCAL_COUNT
+	};
+
+	// Local space box as center and half extent
+	enum BoundsComponent {
+		CENTER_X, CENTER_Y, CENTER_Z,
+		EXTENT_X, EXTENT_Y, EXTENT_Z,
+		LOCAL_BOUNDS_COUNT
+	};
+	// World space box as corners
+	enum WorldBoundsComponent {
+		MIN_X, MIN_Y, MIN_Z,
+		MAX_X, MAX_Y, MAX_Z,
+		WORLD_BOUNDS_COUNT
+	};
+
+	// World matrix entries, row major: WORLD_COUNT floats are rows 0 to 2 of the 3x4
+	static const uint32_t WORLD_COUNT = 12;
+
+	// Level ranges smaller than this aren't worth a job
+	static const uint32_t UPDATE_BATCH_SIZE = 4096;
+
+	void sortByDepth();
+	void updateRange(uint32_t begin, uint32_t end, bool roots);
+
+	std::vector<float> local[LOCAL_COUNT];
+	std::vector<float> localBounds[LOCAL_BOUNDS_COUNT];
+	std::vector<float> world[WORLD_COUNT];
+	std::vector<float> worldBounds[WORLD_BOUNDS_COUNT];
+	std::vector<uint32_t> parentSlot; // Slot of the parent, 0 for roots so a gather never reads out of range
+	std::vector<uint32_t> depth;
+
+	std::vector<uint32_t> slotOf; // EntityId -> slot
+	std::vector<EntityId> entityAt; // Slot -> EntityId
+	std::vector<uint32_t> levelStart; // First slot of each depth, plus one past the end
+
+	bool hierarchyDirty = false;
+	bool transformsDirty = false;
+	uint32_t layoutVersion = 0;
+
+	SceneStats stats;
+};
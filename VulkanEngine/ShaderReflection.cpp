@@ -0,0 +1,380 @@
+#include "ShaderReflection.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+	const uint32_t SPIRV_MAGIC = 0x07230203;
+	const uint32_t HEADER_WORDS = 5;
+
+	// The few opcodes, decorations and storage classes from the SPIR-V specification that reflection looks at
+	enum Op : uint32_t {
+		OpName = 5,
+		OpEntryPoint = 15,
+		OpTypeInt = 21,
+		OpTypeFloat = 22,
+		OpTypeVector = 23,
+		OpTypeMatrix = 24,
+		OpTypeImage = 25,
+		OpTypeSampler = 26,
+		OpTypeSampledImage = 27,
+		OpTypeArray = 28,
+		OpTypeRuntimeArray = 29,
+		OpTypeStruct = 30,
+		OpTypePointer = 32,
+		OpConstant = 43,
+		OpVariable = 59,
+		OpDecorate = 71,
+		OpMemberDecorate = 72,
+		OpTypeAccelerationStructureKHR = 5341
+	};
+
+	enum Decoration : uint32_t {
+		DecorationBlock = 2,
+		DecorationBufferBlock = 3,
+		DecorationArrayStride = 6,
+		DecorationMatrixStride = 7,
+		DecorationBinding = 33,
+		DecorationDescriptorSet = 34,
+		DecorationOffset = 35
+	};
+
+	enum StorageClass : uint32_t {
+		StorageClassUniformConstant = 0,
+		StorageClassUniform = 2,
+		StorageClassPushConstant = 9,
+		StorageClassStorageBuffer = 12
+	};
+
+	const uint32_t DIM_BUFFER = 5;
+	const uint32_t DIM_SUBPASS_DATA = 6;
+	const uint32_t IMAGE_SAMPLED = 1; // OpTypeImage's Sampled operand: 1 is used with a sampler, 2 is a storage image
+
+	/// <summary>
+	/// Everything reflection learned about one result id. Types keep their operands after the result id, constants their
+	/// value, variables their pointer type and storage class.
+	/// </summary>
+	struct IdInfo {
+		uint32_t opcode = 0;
+		std::vector<uint32_t> operands;
+		uint32_t set = UINT32_MAX;
+		uint32_t binding = UINT32_MAX;
+		uint32_t arrayStride = 0;
+		bool block = false;
+		bool bufferBlock = false;
+		std::string name;
+		std::vector<uint32_t> memberOffsets; // Structs only, indexed by member
+		std::vector<uint32_t> memberMatrixStrides;
+	};
+
+	VkShaderStageFlags stageOf(uint32_t executionModel) {
+		switch (executionModel) {
+		case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+		case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+		case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+		case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+		case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+		case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+		case 5267: return VK_SHADER_STAGE_TASK_BIT_NV;
+		case 5268: return VK_SHADER_STAGE_MESH_BIT_NV;
+		case 5364: return VK_SHADER_STAGE_TASK_BIT_EXT;
+		case 5365: return VK_SHADER_STAGE_MESH_BIT_EXT;
+		case 5313: return VK_SHADER_STAGE_RAYGEN_BIT_KHR;
+		case 5314: return VK_SHADER_STAGE_INTERSECTION_BIT_KHR;
+		case 5315: return VK_SHADER_STAGE_ANY_HIT_BIT_KHR;
+		case 5316: return VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR;
+		case 5317: return VK_SHADER_STAGE_MISS_BIT_KHR;
+		case 5318: return VK_SHADER_STAGE_CALLABLE_BIT_KHR;
+		default: return 0;
+		}
+	}
+
+	class Reflector {
+	public:
+		explicit Reflector(const std::vector<char>& spirv) {
+			if (spirv.size() % 4 != 0 || spirv.size() < HEADER_WORDS * 4) {
+				throw std::runtime_error("Failed to reflect shader, not a SPIR-V binary!");
+			}
+			words.resize(spirv.size() / 4);
+			std::memcpy(words.data(), spirv.data(), spirv.size());
+			if (words[0] != SPIRV_MAGIC) {
+				throw std::runtime_error("Failed to reflect shader, not a SPIR-V binary!");
+			}
+		}
+
+		ShaderReflection reflect() {
+			parse();
+
+			ShaderReflection reflection;
+			reflection.stages = stages;
+			for (const auto& entry : ids) {
+				const IdInfo& variable = entry.second;
+				if (variable.opcode == OpVariable) {
+					addVariable(variable, reflection);
+				}
+			}
+
+			std::sort(reflection.bindings.begin(), reflection.bindings.end(), [](const ReflectedBinding& a, const ReflectedBinding& b) {
+				return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+			});
+			return reflection;
+		}
+
+	private:
+		void parse() {
+			size_t position = HEADER_WORDS;
+			while (position < words.size()) {
+				const uint32_t wordCount = words[position] >> 16;
+				const uint32_t opcode = words[position] & 0xFFFF;
+				if (wordCount == 0 || position + wordCount > words.size()) {
+					throw std::runtime_error("Failed to reflect shader, truncated SPIR-V!");
+				}
+
+				const uint32_t* operands = &words[position + 1];
+				const uint32_t operandCount = wordCount - 1;
+				parseInstruction(opcode, operands, operandCount);
+				position += wordCount;
+			}
+		}
+
+		void parseInstruction(uint32_t opcode, const uint32_t* operands, uint32_t operandCount) {
+			switch (opcode) {
+			case OpEntryPoint:
+				require(operandCount >= 1);
+				stages |= stageOf(operands[0]);
+				break;
+			case OpName:
+				require(operandCount >= 2);
+				ids[operands[0]].name = readString(operands + 1, operandCount - 1);
+				break;
+			case OpDecorate:
+				require(operandCount >= 2);
+				decorate(ids[operands[0]], operands[1], operandCount > 2 ? operands[2] : 0);
+				break;
+			case OpMemberDecorate: {
+				require(operandCount >= 3);
+				IdInfo& structType = ids[operands[0]];
+				const uint32_t member = operands[1];
+				if (operands[2] == DecorationOffset || operands[2] == DecorationMatrixStride) {
+					require(operandCount >= 4);
+					std::vector<uint32_t>& values = operands[2] == DecorationOffset ? structType.memberOffsets : structType.memberMatrixStrides;
+					if (values.size() <= member) {
+						values.resize(member + 1, 0);
+					}
+					values[member] = operands[3];
+				}
+				break;
+			}
+			case OpTypeInt:
+			case OpTypeFloat:
+			case OpTypeVector:
+			case OpTypeMatrix:
+			case OpTypeImage:
+			case OpTypeSampler:
+			case OpTypeSampledImage:
+			case OpTypeArray:
+			case OpTypeRuntimeArray:
+			case OpTypeStruct:
+			case OpTypePointer:
+			case OpTypeAccelerationStructureKHR: {
+				require(operandCount >= 1);
+				IdInfo& type = ids[operands[0]];
+				type.opcode = opcode;
+				type.operands.assign(operands + 1, operands + operandCount);
+				break;
+			}
+			case OpConstant:
+			case OpVariable: {
+				// Both have the result type first and the result id second
+				require(operandCount >= 3);
+				IdInfo& value = ids[operands[1]];
+				value.opcode = opcode;
+				value.operands.assign({ operands[0], operands[2] });
+				break;
+			}
+			default:
+				break;
+			}
+		}
+
+		void decorate(IdInfo& target, uint32_t decoration, uint32_t value) {
+			switch (decoration) {
+			case DecorationBlock:
+				target.block = true;
+				break;
+			case DecorationBufferBlock:
+				target.bufferBlock = true;
+				break;
+			case DecorationArrayStride:
+				target.arrayStride = value;
+				break;
+			case DecorationBinding:
+				target.binding = value;
+				break;
+			case DecorationDescriptorSet:
+				target.set = value;
+				break;
+			default:
+				break;
+			}
+		}
+
+		void addVariable(const IdInfo& variable, ShaderReflection& reflection) {
+			const IdInfo& pointer = get(variable.operands[0], OpTypePointer);
+			require(pointer.operands.size() >= 2);
+			const uint32_t storageClass = variable.operands[1];
+			uint32_t typeId = pointer.operands[1];
+
+			if (storageClass == StorageClassPushConstant) {
+				const IdInfo& block = get(typeId, OpTypeStruct);
+				uint32_t begin = UINT32_MAX;
+				uint32_t end = 0;
+				for (size_t member = 0; member < block.operands.size(); member++) {
+					const uint32_t offset = member < block.memberOffsets.size() ? block.memberOffsets[member] : 0;
+					const uint32_t matrixStride = member < block.memberMatrixStrides.size() ? block.memberMatrixStrides[member] : 0;
+					begin = std::min(begin, offset);
+					end = std::max(end, offset + sizeOf(block.operands[member], matrixStride));
+				}
+				if (end > 0) {
+					reflection.pushConstants.stageFlags = stages;
+					reflection.pushConstants.offset = begin;
+					reflection.pushConstants.size = end - begin;
+				}
+				return;
+			}
+
+			if (storageClass != StorageClassUniformConstant && storageClass != StorageClassUniform && storageClass != StorageClassStorageBuffer) {
+				return; // Inputs, outputs and workgroup memory aren't descriptors
+			}
+
+			ReflectedBinding binding;
+			binding.set = variable.set == UINT32_MAX ? 0 : variable.set;
+			binding.binding = variable.binding;
+			binding.stages = stages;
+			binding.name = variable.name;
+			if (variable.binding == UINT32_MAX) {
+				throw std::runtime_error("Failed to reflect shader, " + describe(binding) + " has no binding!");
+			}
+
+			// Arrays of descriptors multiply out into the count
+			const IdInfo* type = &get(typeId);
+			while (type->opcode == OpTypeArray || type->opcode == OpTypeRuntimeArray) {
+				if (type->opcode == OpTypeRuntimeArray) {
+					binding.count = 0;
+				} else {
+					binding.count *= constantValue(type->operands.at(1));
+				}
+				typeId = type->operands.at(0);
+				type = &get(typeId);
+			}
+
+			binding.type = descriptorType(*type, storageClass);
+			if (binding.type == VK_DESCRIPTOR_TYPE_MAX_ENUM) {
+				throw std::runtime_error("Failed to reflect shader, " + describe(binding) + " has a type reflection doesn't know!");
+			}
+			reflection.bindings.push_back(binding);
+		}
+
+		VkDescriptorType descriptorType(const IdInfo& type, uint32_t storageClass) const {
+			if (storageClass == StorageClassStorageBuffer) {
+				return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			}
+			if (storageClass == StorageClassUniform) {
+				// Before SPIR-V 1.3, storage buffers were Uniform blocks decorated BufferBlock
+				return type.bufferBlock ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			}
+
+			switch (type.opcode) {
+			case OpTypeSampler:
+				return VK_DESCRIPTOR_TYPE_SAMPLER;
+			case OpTypeSampledImage:
+				return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			case OpTypeAccelerationStructureKHR:
+				return VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+			case OpTypeImage: {
+				const uint32_t dim = type.operands.at(1);
+				const bool sampled = type.operands.at(5) == IMAGE_SAMPLED;
+				if (dim == DIM_SUBPASS_DATA) {
+					return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+				}
+				if (dim == DIM_BUFFER) {
+					return sampled ? VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER;
+				}
+				return sampled ? VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+			}
+			default:
+				return VK_DESCRIPTOR_TYPE_MAX_ENUM;
+			}
+		}
+
+		/// <summary>
+		/// Bytes a member of an explicitly laid out block occupies, from the strides the compiler decorated it with.
+		/// </summary>
+		uint32_t sizeOf(uint32_t typeId, uint32_t matrixStride) const {
+			const IdInfo& type = get(typeId);
+			switch (type.opcode) {
+			case OpTypeInt:
+			case OpTypeFloat:
+				return type.operands.at(0) / 8;
+			case OpTypeVector:
+				return type.operands.at(1) * sizeOf(type.operands.at(0), 0);
+			case OpTypeMatrix:
+				return type.operands.at(1) * (matrixStride != 0 ? matrixStride : sizeOf(type.operands.at(0), 0));
+			case OpTypeArray: {
+				const uint32_t length = constantValue(type.operands.at(1));
+				return length * (type.arrayStride != 0 ? type.arrayStride : sizeOf(type.operands.at(0), matrixStride));
+			}
+			case OpTypeStruct: {
+				uint32_t end = 0;
+				for (size_t member = 0; member < type.operands.size(); member++) {
+					const uint32_t offset = member < type.memberOffsets.size() ? type.memberOffsets[member] : 0;
+					const uint32_t stride = member < type.memberMatrixStrides.size() ? type.memberMatrixStrides[member] : 0;
+					end = std::max(end, offset + sizeOf(type.operands[member], stride));
+				}
+				return end;
+			}
+			default:
+				throw std::runtime_error("Failed to reflect shader, a push constant member has a type without a size!");
+			}
+		}
+
+		uint32_t constantValue(uint32_t id) const {
+			const IdInfo& constant = get(id, OpConstant);
+			return constant.operands.at(1);
+		}
+
+		const IdInfo& get(uint32_t id, uint32_t expectedOpcode = 0) const {
+			const auto found = ids.find(id);
+			if (found == ids.end() || (expectedOpcode != 0 && found->second.opcode != expectedOpcode)) {
+				throw std::runtime_error("Failed to reflect shader, SPIR-V refers to an id it never defined!");
+			}
+			return found->second;
+		}
+
+		static std::string readString(const uint32_t* operands, uint32_t operandCount) {
+			const char* characters = reinterpret_cast<const char*>(operands);
+			return std::string(characters, std::find(characters, characters + operandCount * 4, '\0'));
+		}
+
+		static std::string describe(const ReflectedBinding& binding) {
+			const std::string name = binding.name.empty() ? "a variable" : "\"" + binding.name + "\"";
+			return name + " in set " + std::to_string(binding.set);
+		}
+
+		static void require(bool condition) {
+			if (!condition) {
+				throw std::runtime_error("Failed to reflect shader, malformed SPIR-V instruction!");
+			}
+		}
+
+		std::vector<uint32_t> words;
+		std::unordered_map<uint32_t, IdInfo> ids;
+		VkShaderStageFlags stages = 0;
+	};
+}
+
+ShaderReflection reflectShader(const std::vector<char>& spirv) {
+	return Reflector(spirv).reflect();
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// One descriptor a shader declares.
+/// </summary>
+struct ReflectedBinding {
+	uint32_t set = 0;
+	uint32_t binding = 0;
+	VkDescriptorType type = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+	uint32_t count = 1; // Product of the array sizes, 0 for a runtime sized array
+	VkShaderStageFlags stages = 0;
+	std::string name; // The variable's name if the compiler kept debug names, for error messages
+};
+
+/// <summary>
+/// What a SPIR-V module needs from a pipeline layout: its descriptors and the bytes of push constants it reads.
+/// </summary>
+struct ShaderReflection {
+	VkShaderStageFlags stages = 0; // Of every entry point in the module
+	std::vector<ReflectedBinding> bindings; // Sorted by set, then binding
+	VkPushConstantRange pushConstants{}; // size 0 when the module has no push constant block
+};
+
+/// <summary>
+/// Read the descriptor and push constant interface out of a SPIR-V binary, enough to build the module's set and pipeline
+/// layouts without restating them in C++. Walks the instruction stream once for decorations, types and variables; there
+/// is no dependency on SPIRV-Cross or SPIRV-Reflect.
+///
+/// What only the application knows is left to it: a uniform or storage buffer comes back plain even if the engine binds
+/// it with a dynamic offset, and a runtime sized array has no count. Throws on anything that isn't valid SPIR-V.
+/// </summary>
+ShaderReflection reflectShader(const std::vector<char>& spirv);
@@ -0,0 +1,146 @@
+#include "ShaderWatcher.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+
+namespace {
+	/// <summary>
+	/// glslc from the SDK the project builds against, falling back on whatever is on the path.
+	/// </summary>
+	std::string findCompiler() {
+#ifdef _WIN32
+		const char* executable = "glslc.exe";
+#else
+		const char* executable = "glslc";
+#endif
+		if (const char* sdk = std::getenv("VULKAN_SDK")) {
+			const std::filesystem::path path = std::filesystem::path(sdk) / "Bin" / executable;
+			std::error_code error;
+			if (std::filesystem::exists(path, error)) {
+				return path.string();
+			}
+		}
+		return executable;
+	}
+
+	std::string quote(const std::string& argument) {
+		return "\"" + argument + "\"";
+	}
+}
+
+void ShaderWatcher::start(const std::vector<ShaderSource>& sources) {
+	stop();
+
+	this->sources = sources;
+	compiler = findCompiler();
+	running = true;
+	thread = std::thread([this] { run(); });
+}
+
+void ShaderWatcher::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		running = false;
+	}
+	wake.notify_all();
+	if (thread.joinable()) {
+		thread.join();
+	}
+}
+
+std::vector<size_t> ShaderWatcher::takeRebuilt() {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<size_t> result;
+	result.swap(rebuilt);
+	return result;
+}
+
+ShaderWatcherStats ShaderWatcher::getStats() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
+
+void ShaderWatcher::run() {
+	// Keyed by source rather than variant, every variant of a source is rebuilt when it changes
+	std::map<std::string, std::filesystem::file_time_type> writeTimes;
+	bool first = true;
+
+	while (running) {
+		for (const ShaderSource& source : sources) {
+			std::error_code error;
+			const std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(source.sourcePath, error);
+			if (error) {
+				continue; // Missing, or mid save by an editor that replaces the file
+			}
+
+			auto known = writeTimes.find(source.sourcePath);
+			if (known == writeTimes.end()) {
+				writeTimes.emplace(source.sourcePath, writeTime);
+				if (first) {
+					continue;
+				}
+			} else if (known->second == writeTime) {
+				continue;
+			} else {
+				known->second = writeTime;
+			}
+
+			for (size_t i = 0; i < sources.size(); i++) {
+				if (sources[i].sourcePath == source.sourcePath && compile(sources[i])) {
+					std::lock_guard<std::mutex> lock(mutex);
+					rebuilt.push_back(i);
+				}
+			}
+		}
+		first = false;
+
+		std::unique_lock<std::mutex> lock(mutex);
+		wake.wait_for(lock, std::chrono::milliseconds(POLL_MILLISECONDS), [this] { return !running; });
+	}
+}
+
+bool ShaderWatcher::compile(const ShaderSource& source) {
+	const std::string tempPath = source.outputPath + ".tmp";
+
+	std::string command = quote(compiler);
+	for (const std::string& define : source.defines) {
+		command += " -D" + define;
+	}
+	if (!source.targetEnvironment.empty()) {
+		command += " --target-env=" + source.targetEnvironment;
+	}
+	command += " " + quote(source.sourcePath) + " -o " + quote(tempPath);
+#ifdef _WIN32
+	// cmd strips the first and last quote of a command line that starts with one, so give it a pair to strip
+	command = quote(command);
+#endif
+
+	const auto start = std::chrono::steady_clock::now();
+	const int result = std::system(command.c_str()); // glslc prints its own errors
+	const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+	std::error_code error;
+	bool compiled = result == 0;
+	if (compiled) {
+		std::filesystem::rename(tempPath, source.outputPath, error);
+		compiled = !error;
+	}
+	if (!compiled) {
+		std::filesystem::remove(tempPath, error);
+		std::cerr << "Failed to compile " << source.outputPath << ", keeping the last good binary\n";
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	stats.compiles++;
+	stats.failures += compiled ? 0 : 1;
+	stats.lastCompileMilliseconds = elapsed.count();
+	return compiled;
+}
+
+void ShaderWatcher::printStats(std::ostream& out) {
+	const ShaderWatcherStats current = getStats();
+	out << "Shader hot reload: " << current.compiles << " compiles, " << current.failures << " failed, last took "
+		<< current.lastCompileMilliseconds << " ms\n";
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// One SPIR-V binary and what it's compiled from. The same source shows up once per variant, with different defines.
+/// </summary>
+struct ShaderSource {
+	std::string sourcePath;
+	std::vector<std::string> defines; // Passed as -D<define>
+	std::string outputPath;
+	std::string targetEnvironment = ""; // Passed as --target-env=<environment>, empty for glslc's default
+};
+
+struct ShaderWatcherStats {
+	uint32_t compiles = 0;
+	uint32_t failures = 0; // The old binary stays in place, so the running pipelines keep working
+	double lastCompileMilliseconds = 0.0;
+};
+
+/// <summary>
+/// Development only: polls the shader sources on a background thread and recompiles the variants of any that changed
+/// with glslc, the same compiler and flags the project's build step uses. glslc takes GLSL and HLSL alike, so either
+/// kind of source works.
+///
+/// A variant is compiled to a temporary file and renamed over its binary, so a reader never sees a half written module
+/// and a source with errors leaves the last good binary in place. The render loop asks takeRebuilt() which variants are
+/// new and rebuilds only the pipelines that use them. Only the sources themselves are watched, not files they #include.
+/// </summary>
+class ShaderWatcher {
+public:
+	static constexpr uint32_t POLL_MILLISECONDS = 250;
+
+	/// <summary>
+	/// Start watching. Sources that don't exist yet are picked up once they appear. The first poll only records timestamps,
+	/// binaries the build step already produced aren't compiled again.
+	/// </summary>
+	void start(const std::vector<ShaderSource>& sources);
+	void stop();
+
+	/// <summary>
+	/// Indices into the sources passed to start() whose binaries were rebuilt since the last call.
+	/// </summary>
+	std::vector<size_t> takeRebuilt();
+
+	ShaderWatcherStats getStats();
+
+	void printStats(std::ostream& out);
+
+	~ShaderWatcher() {
+		stop();
+	}
+
+private:
+	void run();
+	bool compile(const ShaderSource& source);
+
+	std::vector<ShaderSource> sources;
+	std::string compiler;
+	std::thread thread;
+	std::atomic<bool> running{ false };
+
+	std::mutex mutex; // Guards rebuilt and stats, and running for the wait between polls
+	std::condition_variable wake;
+	std::vector<size_t> rebuilt;
+	ShaderWatcherStats stats;
+};
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_FLOAT_AVX2
+#elif defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SIMD_FLOAT_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SIMD_FLOAT_NEON
+#endif
+
+/// <summary>
+/// One float with the same interface as SimdFloat, for the tail of an array that doesn't fill a vector and for builds
+/// without vector instructions. Kernels are written once as templates over the two.
+/// </summary>
+struct ScalarFloat {
+	static const uint32_t WIDTH = 1;
+	static constexpr const char* NAME = "scalar";
+
+	float value;
+
+	static ScalarFloat load(const float* source) {
+		return { *source };
+	}
+	static ScalarFloat broadcast(float value) {
+		return { value };
+	}
+	static ScalarFloat gather(const float* base, const uint32_t* indices) {
+		return { base[*indices] };
+	}
+	void store(float* destination) const {
+		*destination = value;
+	}
+
+	friend ScalarFloat operator+(ScalarFloat a, ScalarFloat b) {
+		return { a.value + b.value };
+	}
+	friend ScalarFloat operator-(ScalarFloat a, ScalarFloat b) {
+		return { a.value - b.value };
+	}
+	friend ScalarFloat operator*(ScalarFloat a, ScalarFloat b) {
+		return { a.value * b.value };
+	}
+	friend ScalarFloat abs(ScalarFloat a) {
+		return { std::fabs(a.value) };
+	}
+	friend ScalarFloat min(ScalarFloat a, ScalarFloat b) {
+		return { a.value < b.value ? a.value : b.value };
+	}
+
+	/// <summary>
+	/// Bit i set if lane i is negative.
+	/// </summary>
+	uint32_t negativeMask() const {
+		return value < 0.0f ? 1u : 0u;
+	}
+};
+
+/// <summary>
+/// The widest float vector the build targets, for batch kernels over structure of arrays data: 8 lanes with AVX2
+/// (/arch:AVX2 or -mavx2), 4 with SSE2 (every x64 build) or NEON, otherwise just ScalarFloat. Loads and stores don't need
+/// any alignment. NAME says which one was compiled in, for benchmark output.
+/// </summary>
+#if defined(SIMD_FLOAT_AVX2)
+struct SimdFloat {
+	static const uint32_t WIDTH = 8;
+	static constexpr const char* NAME = "AVX2";
+
+	__m256 value;
+
+	static SimdFloat load(const float* source) {
+		return { _mm256_loadu_ps(source) };
+	}
+	static SimdFloat broadcast(float value) {
+		return { _mm256_set1_ps(value) };
+	}
+	static SimdFloat gather(const float* base, const uint32_t* indices) {
+		return { _mm256_i32gather_ps(base, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices)), 4) };
+	}
+	void store(float* destination) const {
+		_mm256_storeu_ps(destination, value);
+	}
+
+	friend SimdFloat operator+(SimdFloat a, SimdFloat b) {
+		return { _mm256_add_ps(a.value, b.value) };
+	}
+	friend SimdFloat operator-(SimdFloat a, SimdFloat b) {
+		return { _mm256_sub_ps(a.value, b.value) };
+	}
+	friend SimdFloat operator*(SimdFloat a, SimdFloat b) {
+		return { _mm256_mul_ps(a.value, b.value) };
+	}
+	friend SimdFloat abs(SimdFloat a) {
+		return { _mm256_and_ps(a.value, _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff))) };
+	}
+	friend SimdFloat min(SimdFloat a, SimdFloat b) {
+		return { _mm256_min_ps(a.value, b.value) };
+	}
+	uint32_t negativeMask() const {
+		return static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(value, _mm256_setzero_ps(), _CMP_LT_OQ)));
+	}
+};
+#elif defined(SIMD_FLOAT_SSE2)
+struct SimdFloat {
+	static const uint32_t WIDTH = 4;
+	static constexpr const char* NAME = "SSE2";
+
+	__m128 value;
+
+	static SimdFloat load(const float* source) {
+		return { _mm_loadu_ps(source) };
+	}
+	static SimdFloat broadcast(float value) {
+		return { _mm_set1_ps(value) };
+	}
+	static SimdFloat gather(const float* base, const uint32_t* indices) {
+		return { _mm_setr_ps(base[indices[0]], base[indices[1]], base[indices[2]], base[indices[3]]) };
+	}
+	void store(float* destination) const {
+		_mm_storeu_ps(destination, value);
+	}
+
+	friend SimdFloat operator+(SimdFloat a, SimdFloat b) {
+		return { _mm_add_ps(a.value, b.value) };
+	}
+	friend SimdFloat operator-(SimdFloat a, SimdFloat b) {
+		return { _mm_sub_ps(a.value, b.value) };
+	}
+	friend SimdFloat operator*(SimdFloat a, SimdFloat b) {
+		return { _mm_mul_ps(a.value, b.value) };
+	}
+	friend SimdFloat abs(SimdFloat a) {
+		return { _mm_and_ps(a.value, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff))) };
+	}
+	friend SimdFloat min(SimdFloat a, SimdFloat b) {
+		return { _mm_min_ps(a.value, b.value) };
+	}
+	uint32_t negativeMask() const {
+		return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmplt_ps(value, _mm_setzero_ps())));
+	}
+};
+#elif defined(SIMD_FLOAT_NEON)
+struct SimdFloat {
+	static const uint32_t WIDTH = 4;
+	static constexpr const char* NAME = "NEON";
+
+	float32x4_t value;
+
+	static SimdFloat load(const float* source) {
+		return { vld1q_f32(source) };
+	}
+	static SimdFloat broadcast(float value) {
+		return { vdupq_n_f32(value) };
+	}
+	static SimdFloat gather(const float* base, const uint32_t* indices) {
+		const float lanes[4] = { base[indices[0]], base[indices[1]], base[indices[2]], base[indices[3]] };
+		return { vld1q_f32(lanes) };
+	}
+	void store(float* destination) const {
+		vst1q_f32(destination, value);
+	}
+
+	friend SimdFloat operator+(SimdFloat a, SimdFloat b) {
+		return { vaddq_f32(a.value, b.value) };
+	}
+	friend SimdFloat operator-(SimdFloat a, SimdFloat b) {
+		return { vsubq_f32(a.value, b.value) };
+	}
+	friend SimdFloat operator*(SimdFloat a, SimdFloat b) {
+		return { vmulq_f32(a.value, b.value) };
+	}
+	friend SimdFloat abs(SimdFloat a) {
+		return { vabsq_f32(a.value) };
+	}
+	friend SimdFloat min(SimdFloat a, SimdFloat b) {
+		return { vminq_f32(a.value, b.value) };
+	}
+	uint32_t negativeMask() const {
+		// No movemask on NEON: keep one distinct bit per negative lane and add them up
+		const uint32x4_t negative = vcltq_f32(value, vdupq_n_f32(0.0f));
+		const uint32_t bits[4] = { 1, 2, 4, 8 };
+		const uint32x4_t lanes = vandq_u32(negative, vld1q_u32(bits));
+		return vgetq_lane_u32(lanes, 0) | vgetq_lane_u32(lanes, 1) | vgetq_lane_u32(lanes, 2) | vgetq_lane_u32(lanes, 3);
+	}
+};
+#else
+using SimdFloat = ScalarFloat;
+#endif
@@ -0,0 +1,142 @@
+#include "Simulation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+	/// <summary>
+	/// Spin first, the next frame is usually a few microseconds away; then yield, then nap so a simulation waiting on a
+	/// vsynced render loop doesn't keep a core busy.
+	/// </summary>
+	void backOff(uint32_t& attempt) {
+		if (attempt < 64) {
+			attempt++;
+		} else if (attempt < 128) {
+			attempt++;
+			std::this_thread::yield();
+		} else {
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+	}
+}
+
+void Simulation::start(uint32_t threadCount, const std::vector<glm::vec2>& basePositions, float amplitude, uint32_t materialCount) {
+	if (threadCount == 0 || threadCount > MAX_THREADS) {
+		throw std::logic_error("Simulation thread count must be between 1 and MAX_THREADS!");
+	}
+
+	this->threadCount = threadCount;
+	this->basePositions = basePositions;
+	this->amplitude = amplitude;
+	this->materialCount = std::max(materialCount, 1u);
+
+	for (uint32_t i = 0; i < 3; i++) {
+		states.getBuffer(i).frame = 0;
+		states.getBuffer(i).offsets = basePositions;
+	}
+	commands.init(QUEUE_CAPACITY);
+
+	requestedFrame.store(0, std::memory_order_relaxed);
+	publishedFrame.store(0, std::memory_order_relaxed);
+	finishedThreads.store(0, std::memory_order_relaxed);
+	running.store(true, std::memory_order_relaxed);
+
+	threads.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; i++) {
+		threads.emplace_back([this, i] { run(i); });
+	}
+}
+
+void Simulation::stop() {
+	running.store(false, std::memory_order_relaxed);
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	threads.clear();
+}
+
+const SimulationState* Simulation::acquireState() {
+	if (!states.acquire()) {
+		staleFrames++;
+		return nullptr;
+	}
+	statesAcquired++;
+	return &states.getReadBuffer();
+}
+
+void Simulation::push(const RenderCommand& command) {
+	uint32_t attempt = 0;
+	while (!commands.tryPush(command)) {
+		queueFullRetries.fetch_add(1, std::memory_order_relaxed);
+		if (!running.load(std::memory_order_relaxed)) {
+			return; // The render thread has stopped draining, nobody is going to make room
+		}
+		backOff(attempt);
+	}
+	commandsPushed.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Simulation::run(uint32_t threadIndex) {
+	const uint32_t drawCount = static_cast<uint32_t>(basePositions.size());
+	const uint32_t begin = static_cast<uint32_t>(uint64_t(drawCount) * threadIndex / threadCount);
+	const uint32_t end = static_cast<uint32_t>(uint64_t(drawCount) * (threadIndex + 1) / threadCount);
+
+	uint64_t frame = 0;
+	uint32_t attempt = 0;
+	while (running.load(std::memory_order_relaxed)) {
+		// Wait for the render thread to ask for the next frame, and for every thread to be done with this one: they all
+		// write into the same buffer, which only changes once the last of them has published
+		const uint64_t next = frame + 1;
+		if (requestedFrame.load(std::memory_order_acquire) < next || publishedFrame.load(std::memory_order_acquire) < frame) {
+			backOff(attempt);
+			continue;
+		}
+		attempt = 0;
+
+		SimulationState& state = states.getWriteBuffer();
+		const float time = next * FRAME_SECONDS;
+		for (uint32_t i = begin; i < end; i++) {
+			// Every draw circles its place in the grid, out of phase with its neighbours
+			const float phase = time * 2.0f + i * 0.37f;
+			state.offsets[i] = basePositions[i] + amplitude * glm::vec2(std::cos(phase), std::sin(phase));
+		}
+
+		// Staggered so the threads don't all push on the same frame
+		if (end > begin && (next + threadIndex) % RECOLOR_INTERVAL == 0) {
+			RenderCommand command;
+			command.type = RenderCommand::Type::SetMaterial;
+			command.draw = begin + static_cast<uint32_t>((next / RECOLOR_INTERVAL * 7919) % (end - begin));
+			command.value = static_cast<uint32_t>((command.draw + next / RECOLOR_INTERVAL) % materialCount);
+			push(command);
+		}
+
+		if (finishedThreads.fetch_add(1, std::memory_order_acq_rel) + 1 == threadCount) {
+			state.frame = next;
+			finishedThreads.store(0, std::memory_order_relaxed);
+			states.publish();
+			publishedFrame.store(next, std::memory_order_release);
+		}
+		frame = next;
+	}
+}
+
+SimulationStats Simulation::getStats() const {
+	SimulationStats stats;
+	stats.framesSimulated = publishedFrame.load(std::memory_order_relaxed);
+	stats.statesAcquired = statesAcquired;
+	stats.staleFrames = staleFrames;
+	stats.commandsPushed = commandsPushed.load(std::memory_order_relaxed);
+	stats.commandsDrained = commandsDrained;
+	stats.queueFullRetries = queueFullRetries.load(std::memory_order_relaxed);
+	return stats;
+}
+
+void Simulation::printStats(std::ostream& out) const {
+	const SimulationStats stats = getStats();
+	out << "Simulation: " << threadCount << " threads, " << stats.framesSimulated << " frames simulated, "
+		<< stats.statesAcquired << " picked up by the render thread, " << stats.staleFrames << " render frames without a new one, "
+		<< stats.commandsDrained << " of " << stats.commandsPushed << " commands drained, " << stats.queueFullRetries
+		<< " retries on a full queue\n";
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "MpscQueue.h"
+#include "TripleBuffer.h"
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// A discrete change the simulation asks the renderer for. Unlike the positions in SimulationState, every one of them has
+/// to be applied, so they go through the command queue instead of being overwritten by the next frame.
+/// </summary>
+struct RenderCommand {
+	enum class Type : uint32_t {
+		SetMaterial // value is the draw's new material index
+	};
+
+	Type type = Type::SetMaterial;
+	uint32_t draw = 0;
+	uint32_t value = 0;
+};
+
+/// <summary>
+/// Everything the simulation produces in bulk each frame, replaced wholesale by the next one.
+/// </summary>
+struct SimulationState {
+	uint64_t frame = 0; // 0 until the first simulated frame
+	std::vector<glm::vec2> offsets; // Per draw
+};
+
+struct SimulationStats {
+	uint64_t framesSimulated = 0;
+	uint64_t statesAcquired = 0; // Published frames the render thread picked up, the rest were overtaken before it looked
+	uint64_t staleFrames = 0; // Render frames that found no new state and drew the previous one again
+	uint64_t commandsPushed = 0;
+	uint64_t commandsDrained = 0;
+	uint64_t queueFullRetries = 0; // Pushes that found the queue full and had to wait for the render thread
+};
+
+/// <summary>
+/// Game side threads that move the draws and issue render commands without ever taking a lock against the render loop.
+/// The render thread calls beginFrame() once per mainLoop() iteration, which lets the threads simulate the next frame
+/// while it renders the last one they published, so both run a frame apart on their own cores.
+///
+/// The draws are split into one contiguous slice per thread. Each thread writes its slice of positions straight into
+/// the write side of a TripleBuffer and whichever finishes the frame last publishes it; nobody starts the next frame
+/// before that. Material changes go through a lock-free MpscQueue the render thread drains every iteration. The render
+/// thread never waits on the simulation: when a frame isn't ready yet it draws the previous state again.
+/// </summary>
+class Simulation {
+public:
+	static constexpr uint32_t MAX_THREADS = 32;
+	static constexpr uint32_t RECOLOR_INTERVAL = 15; // Frames between material changes from each thread
+	static constexpr uint32_t QUEUE_CAPACITY = 1024; // Commands in flight, far more than a frame pushes
+	static constexpr float FRAME_SECONDS = 1.0f / 60.0f; // Simulated time per frame, whatever the render rate
+
+	/// <summary>
+	/// Start threadCount threads moving the draws at basePositions around, by up to amplitude, and cycling them through
+	/// materialCount materials. Throws if threadCount is 0 or above MAX_THREADS.
+	/// </summary>
+	void start(uint32_t threadCount, const std::vector<glm::vec2>& basePositions, float amplitude, uint32_t materialCount);
+	void stop();
+
+	/// <summary>
+	/// Render thread: ask for one more frame. Never blocks.
+	/// </summary>
+	void beginFrame() {
+		requestedFrame.fetch_add(1, std::memory_order_release);
+	}
+
+	/// <summary>
+	/// Render thread: the newest state the simulation has published, or null when there is nothing newer than what the
+	/// last call returned. Valid until the next call.
+	/// </summary>
+	const SimulationState* acquireState();
+
+	/// <summary>
+	/// Render thread: hand every command pushed so far to function, in push order per thread.
+	/// </summary>
+	template <typename Function>
+	uint32_t drainCommands(Function&& function) {
+		const uint32_t count = commands.drain(function);
+		commandsDrained += count;
+		return count;
+	}
+
+	SimulationStats getStats() const;
+
+	void printStats(std::ostream& out) const;
+
+	~Simulation() {
+		stop();
+	}
+
+private:
+	void run(uint32_t threadIndex);
+	void push(const RenderCommand& command);
+
+	std::vector<std::thread> threads;
+	uint32_t threadCount = 0;
+	std::vector<glm::vec2> basePositions;
+	float amplitude = 0.0f;
+	uint32_t materialCount = 1;
+
+	TripleBuffer<SimulationState> states;
+	MpscQueue<RenderCommand> commands;
+
+	std::atomic<bool> running{ false };
+	alignas(64) std::atomic<uint64_t> requestedFrame{ 0 }; // Written by the render thread
+	alignas(64) std::atomic<uint64_t> publishedFrame{ 0 }; // The last frame every thread finished
+	std::atomic<uint32_t> finishedThreads{ 0 }; // Of the frame being simulated
+
+	std::atomic<uint64_t> commandsPushed{ 0 };
+	std::atomic<uint64_t> queueFullRetries{ 0 };
+
+	// Render thread only
+	uint64_t commandsDrained = 0;
+	uint64_t statesAcquired = 0;
+	uint64_t staleFrames = 0;
+};
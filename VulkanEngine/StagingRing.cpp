@@ -0,0 +1,448 @@
+#include "StagingRing.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <stdexcept>
+
+namespace {
+	VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+void StagingRing::init(VkDevice device, uint32_t apiVersion, DeviceMemoryAllocator& allocator, VkQueue transferQueue, uint32_t transferFamily,
+	uint32_t graphicsFamily, VkDeviceSize size, VkDeviceSize copyAlignment) {
+	this->device = device;
+	this->allocator = &allocator;
+	queue = transferQueue;
+	this->transferFamily = transferFamily;
+	this->graphicsFamily = graphicsFamily;
+	capacity = size;
+	alignment = std::max<VkDeviceSize>(copyAlignment, 16); // 16 covers the texel block size of every format we upload
+
+	// Timeline entry points carry the KHR suffix unless the device was created as 1.2
+	const bool core = apiVersion >= VK_API_VERSION_1_2;
+	getSemaphoreCounterValue = reinterpret_cast<PFN_vkGetSemaphoreCounterValue>(
+		vkGetDeviceProcAddr(device, core ? "vkGetSemaphoreCounterValue" : "vkGetSemaphoreCounterValueKHR"));
+	waitSemaphores = reinterpret_cast<PFN_vkWaitSemaphores>(vkGetDeviceProcAddr(device, core ? "vkWaitSemaphores" : "vkWaitSemaphoresKHR"));
+	if (!getSemaphoreCounterValue || !waitSemaphores) {
+		throw std::runtime_error("Failed to load timeline semaphore functions!");
+	}
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = capacity;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	AllocationCreateInfo allocationInfo{};
+	allocationInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+	allocationInfo.preferredFlags = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	allocationInfo.dedicated = true;
+	buffer = allocator.createBuffer(bufferInfo, allocationInfo, allocation);
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = transferFamily;
+
+	if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create staging command pool!");
+	}
+
+	VkSemaphoreTypeCreateInfo typeInfo{};
+	typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	typeInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreInfo.pNext = &typeInfo;
+
+	if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create staging timeline semaphore!");
+	}
+
+	lastRetired = Clock::now();
+}
+
+void StagingRing::cleanup() {
+	wait(lastSubmitted);
+
+	vkDestroySemaphore(device, semaphore, nullptr);
+	vkDestroyCommandPool(device, commandPool, nullptr); // Frees every command buffer with it
+	allocator->destroyBuffer(buffer, allocation);
+	freeCommandBuffers.clear();
+}
+
+uint64_t StagingRing::uploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// Nothing to batch, so lastSubmitted + 1 might never be submitted; the last value that was is the one to wait on
+	if (size == 0) {
+		return lastSubmitted;
+	}
+
+	const VkDeviceSize maxChunk = capacity / 4;
+	const char* source = static_cast<const char*>(data);
+
+	for (VkDeviceSize done = 0; done < size;) {
+		const VkDeviceSize chunk = std::min(size - done, maxChunk);
+
+		// Reserve before touching the open batch: making room may flush it
+		const VkDeviceSize offset = reserve(chunk);
+		std::memcpy(static_cast<char*>(allocation.mappedData) + offset, source + done, chunk);
+		allocator->flush(allocation, offset, chunk);
+
+		if (!open.commandBuffer) {
+			beginBatch();
+		}
+
+		VkBufferCopy region{};
+		region.srcOffset = offset;
+		region.dstOffset = dstOffset + done;
+		region.size = chunk;
+		vkCmdCopyBuffer(open.commandBuffer, buffer, dst, 1, &region);
+
+		if (transferFamily != graphicsFamily) {
+			VkBufferMemoryBarrier release{};
+			release.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			release.dstAccessMask = 0;
+			release.srcQueueFamilyIndex = transferFamily;
+			release.dstQueueFamilyIndex = graphicsFamily;
+			release.buffer = dst;
+			release.offset = region.dstOffset;
+			release.size = chunk;
+			openReleases.push_back(release);
+		}
+
+		done += chunk;
+	}
+
+	stats.bytesUploaded += size;
+	stats.uploads++;
+	return lastSubmitted + 1;
+}
+
+uint64_t StagingRing::uploadImage(VkImage image, uint32_t mipLevel, VkExtent2D extent, VkExtent2D blockExtent, uint32_t blockBytes,
+	const void* data) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// Like an empty uploadBuffer(), and the chunking below would divide by a zero row size
+	if (extent.width == 0 || extent.height == 0) {
+		return lastSubmitted;
+	}
+
+	const uint32_t blocksWide = (extent.width + blockExtent.width - 1) / blockExtent.width;
+	const uint32_t blocksHigh = (extent.height + blockExtent.height - 1) / blockExtent.height;
+	const VkDeviceSize rowBytes = VkDeviceSize(blocksWide) * blockBytes;
+	const uint32_t rowsPerChunk = static_cast<uint32_t>(std::max<VkDeviceSize>(capacity / 4 / rowBytes, 1));
+	const char* source = static_cast<const char*>(data);
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = mipLevel;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	for (uint32_t row = 0; row < blocksHigh;) {
+		const uint32_t rows = std::min(blocksHigh - row, rowsPerChunk);
+		const VkDeviceSize chunk = rows * rowBytes;
+
+		const VkDeviceSize offset = reserve(chunk);
+		std::memcpy(static_cast<char*>(allocation.mappedData) + offset, source + row * rowBytes, chunk);
+		allocator->flush(allocation, offset, chunk);
+
+		if (!open.commandBuffer) {
+			beginBatch();
+		}
+
+		if (row == 0) {
+			// Barriers reach every later command on the queue, so chunks that spill into the next batch are covered too
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			vkCmdPipelineBarrier(open.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+				0, nullptr, 0, nullptr, 1, &barrier);
+		}
+
+		const uint32_t y = row * blockExtent.height;
+
+		VkBufferImageCopy region{};
+		region.bufferOffset = offset;
+		region.bufferRowLength = 0; // Tightly packed
+		region.bufferImageHeight = 0;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = mipLevel;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+		region.imageOffset = { 0, static_cast<int32_t>(y), 0 };
+		region.imageExtent = { extent.width, std::min(rows * blockExtent.height, extent.height - y), 1 };
+		vkCmdCopyBufferToImage(open.commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+		row += rows;
+	}
+
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = 0;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	if (transferFamily != graphicsFamily) {
+		barrier.srcQueueFamilyIndex = transferFamily;
+		barrier.dstQueueFamilyIndex = graphicsFamily;
+	}
+	openImageReleases.push_back(barrier);
+
+	stats.bytesUploaded += VkDeviceSize(blocksHigh) * rowBytes;
+	stats.uploads++;
+	return lastSubmitted + 1;
+}
+
+uint64_t StagingRing::flush() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return flushLocked();
+}
+
+void StagingRing::update() {
+	std::lock_guard<std::mutex> lock(mutex);
+	retire(false);
+}
+
+bool StagingRing::isComplete(uint64_t value) {
+	std::lock_guard<std::mutex> lock(mutex);
+	return value <= completedValue();
+}
+
+void StagingRing::wait(uint64_t value) {
+	std::unique_lock<std::mutex> lock(mutex);
+	if (value > lastSubmitted) {
+		flushLocked();
+	}
+	if (value == 0 || value <= lastCompleted) {
+		return;
+	}
+
+	// Don't hold up other threads' uploads while the GPU catches up
+	lock.unlock();
+	VkSemaphoreWaitInfo waitInfo{};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &semaphore;
+	waitInfo.pValues = &value;
+	waitSemaphores(device, &waitInfo, UINT64_MAX);
+	lock.lock();
+
+	retire(false);
+}
+
+uint64_t StagingRing::recordAcquires(VkCommandBuffer commandBuffer) {
+	std::lock_guard<std::mutex> lock(mutex);
+	flushLocked();
+
+	if (!pendingAcquires.empty() || !pendingImageAcquires.empty()) {
+		// Same ownership transfers as the releases, seen from the receiving side
+		for (auto& barrier : pendingAcquires) {
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		}
+		for (auto& barrier : pendingImageAcquires) {
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		}
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+			0, nullptr, static_cast<uint32_t>(pendingAcquires.size()), pendingAcquires.data(),
+			static_cast<uint32_t>(pendingImageAcquires.size()), pendingImageAcquires.data());
+		pendingAcquires.clear();
+		pendingImageAcquires.clear();
+	}
+
+	const uint64_t value = pendingWaitValue;
+	pendingWaitValue = 0;
+	return value;
+}
+
+VkDeviceSize StagingRing::getBytesInUse() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return used;
+}
+
+StagingRingStats StagingRing::getStats() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
+
+void StagingRing::printStats(std::ostream& out) const {
+	const StagingRingStats snapshot = getStats();
+	const double megabytes = snapshot.bytesUploaded / (1024.0 * 1024.0);
+	const double throughput = snapshot.busyMilliseconds > 0.0 ? snapshot.bytesUploaded / 1.0e6 / (snapshot.busyMilliseconds / 1000.0) : 0.0;
+
+	out << "Staging ring: " << std::fixed << std::setprecision(2) << megabytes << " MiB in " << snapshot.uploads << " uploads ("
+		<< snapshot.batches << " batches), " << throughput << " MB/s while busy, peak " << 100.0 * snapshot.peakBytesInUse / capacity
+		<< "% of " << capacity / (1024 * 1024) << " MiB in use, " << snapshot.stalls << " stalls\n";
+}
+
+VkDeviceSize StagingRing::reserve(VkDeviceSize size) {
+	if (size > capacity) {
+		throw std::runtime_error("Staging upload larger than the ring!");
+	}
+
+	for (;;) {
+		if (used == 0) {
+			head = 0; // Nothing in flight, so there's no reason to wrap around a tail
+		}
+
+		VkDeviceSize offset = alignUp(head, alignment);
+		VkDeviceSize padding = offset - head;
+		if (offset + size > capacity) {
+			// Skip the end of the buffer; the wasted bytes are held until this batch retires, like the data itself
+			padding = capacity - head;
+			offset = 0;
+		}
+
+		const VkDeviceSize needed = padding + size;
+		if (used + needed <= capacity) {
+			head = offset + size;
+			used += needed;
+			open.bytes += needed;
+			stats.peakBytesInUse = std::max(stats.peakBytesInUse, used);
+			return offset;
+		}
+
+		// Full: get what's queued moving so its space can come back, then wait for the oldest batch
+		if (inFlight.empty()) {
+			flushLocked();
+		}
+		stats.stalls++;
+		retire(true);
+	}
+}
+
+void StagingRing::beginBatch() {
+	if (freeCommandBuffers.empty()) {
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = commandPool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer;
+		if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to allocate staging command buffer!");
+		}
+		freeCommandBuffers.push_back(commandBuffer);
+	}
+
+	open.commandBuffer = freeCommandBuffers.back();
+	freeCommandBuffers.pop_back();
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if (vkBeginCommandBuffer(open.commandBuffer, &beginInfo) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to begin recording staging command buffer!");
+	}
+}
+
+uint64_t StagingRing::flushLocked() {
+	if (!open.commandBuffer) {
+		return lastSubmitted;
+	}
+
+	if (!openReleases.empty() || !openImageReleases.empty()) {
+		vkCmdPipelineBarrier(open.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+			0, nullptr, static_cast<uint32_t>(openReleases.size()), openReleases.data(),
+			static_cast<uint32_t>(openImageReleases.size()), openImageReleases.data());
+	}
+
+	if (vkEndCommandBuffer(open.commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to record staging command buffer!");
+	}
+
+	const uint64_t value = lastSubmitted + 1;
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo{};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = &value;
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &open.commandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &semaphore;
+
+	// The copies run on every device in the group, with one signal for the batch as a whole from device 0
+	const uint32_t signalDeviceIndex = 0;
+	VkDeviceGroupSubmitInfo deviceGroupInfo{};
+	deviceGroupInfo.sType = VK_STRUCTURE_TYPE_DEVICE_GROUP_SUBMIT_INFO;
+	deviceGroupInfo.commandBufferCount = 1;
+	deviceGroupInfo.pCommandBufferDeviceMasks = &deviceMask;
+	deviceGroupInfo.signalSemaphoreCount = 1;
+	deviceGroupInfo.pSignalSemaphoreDeviceIndices = &signalDeviceIndex;
+	if (deviceMask != 0) {
+		timelineInfo.pNext = &deviceGroupInfo;
+	}
+
+	if (vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to submit staging command buffer!");
+	}
+
+	lastSubmitted = value;
+	open.value = value;
+	open.submitted = Clock::now();
+	inFlight.push_back(open);
+	open = Batch{};
+
+	pendingAcquires.insert(pendingAcquires.end(), openReleases.begin(), openReleases.end());
+	openReleases.clear();
+	if (transferFamily != graphicsFamily) {
+		pendingImageAcquires.insert(pendingImageAcquires.end(), openImageReleases.begin(), openImageReleases.end());
+	}
+	openImageReleases.clear();
+	pendingWaitValue = value;
+
+	stats.batches++;
+	return value;
+}
+
+void StagingRing::retire(bool waitForOldest) {
+	if (waitForOldest && !inFlight.empty()) {
+		VkSemaphoreWaitInfo waitInfo{};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &semaphore;
+		waitInfo.pValues = &inFlight.front().value;
+		waitSemaphores(device, &waitInfo, UINT64_MAX);
+	}
+
+	const uint64_t done = completedValue();
+	while (!inFlight.empty() && inFlight.front().value <= done) {
+		const Batch& batch = inFlight.front();
+
+		// Overlapping batches only count once towards the busy time
+		const Clock::time_point now = Clock::now();
+		const Clock::time_point start = std::max(batch.submitted, lastRetired);
+		stats.busyMilliseconds += std::chrono::duration<double, std::milli>(now - start).count();
+		lastRetired = now;
+
+		used -= batch.bytes;
+		freeCommandBuffers.push_back(batch.commandBuffer);
+		inFlight.pop_front();
+	}
+}
+
+uint64_t StagingRing::completedValue() {
+	getSemaphoreCounterValue(device, semaphore, &lastCompleted);
+	return lastCompleted;
+}
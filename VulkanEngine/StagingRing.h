@@ -0,0 +1,151 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "DeviceMemoryAllocator.h"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+struct StagingRingStats {
+	uint64_t bytesUploaded = 0;
+	uint32_t uploads = 0;
+	uint32_t batches = 0;
+	uint32_t stalls = 0; // Uploads that had to wait for the GPU to hand ring space back
+	VkDeviceSize peakBytesInUse = 0;
+	double busyMilliseconds = 0.0; // Time with a batch in flight, measured to when its completion was noticed
+};
+
+/// <summary>
+/// Streams data into device local resources through one persistently mapped staging buffer used as a ring. Copies are
+/// batched into a command buffer on the transfer queue and each flush() signals the next value of a timeline semaphore,
+/// so the CPU never waits on a queue to find out when an upload is done and ring space comes back in submission order.
+///
+/// When the transfer queue is a dedicated family, every upload is released to the graphics family on the transfer side;
+/// recordAcquires() records the matching acquire into a graphics command buffer and returns the timeline value that
+/// submission has to wait on. Needs timeline semaphores (core in Vulkan 1.2, VK_KHR_timeline_semaphore before that).
+///
+/// All functions are thread safe. flush() submits to the transfer queue, which is the graphics queue on devices without a
+/// separate transfer family, so callers on other threads must only flush on devices that have one.
+/// </summary>
+class StagingRing {
+public:
+	static const VkDeviceSize DEFAULT_SIZE = 64ull * 1024 * 1024;
+
+	void init(VkDevice device, uint32_t apiVersion, DeviceMemoryAllocator& allocator, VkQueue transferQueue, uint32_t transferFamily,
+		uint32_t graphicsFamily, VkDeviceSize size, VkDeviceSize copyAlignment);
+	void cleanup();
+
+	/// <summary>
+	/// With a logical device over a device group: every device the uploads have to land on, since each has its own
+	/// instance of the resources. Batches without a mask only run on device 0. Call before the first upload.
+	/// </summary>
+	void setDeviceMask(uint32_t mask) {
+		deviceMask = mask;
+	}
+
+	/// <summary>
+	/// Copy size bytes from data into the ring and queue a copy to dst. Larger uploads are split so they never need more
+	/// than a quarter of the ring at once. Returns the timeline value that signals once the copy has landed, for an empty
+	/// upload one that has already been submitted.
+	/// </summary>
+	uint64_t uploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+
+	/// <summary>
+	/// Copy one mip level of a 2D colour image, tightly packed in blocks of blockExtent texels and blockBytes each, and queue
+	/// its copy. The level is transitioned from UNDEFINED, so whatever it held is discarded, and ends up in
+	/// SHADER_READ_ONLY_OPTIMAL on the graphics family. Levels over a quarter of the ring are split along block rows. An
+	/// empty extent records nothing, not even the transition.
+	/// </summary>
+	uint64_t uploadImage(VkImage image, uint32_t mipLevel, VkExtent2D extent, VkExtent2D blockExtent, uint32_t blockBytes, const void* data);
+
+	/// <summary>
+	/// Submit everything queued since the last flush. Returns the value it will signal, or the last submitted one if
+	/// nothing was queued.
+	/// </summary>
+	uint64_t flush();
+
+	/// <summary>
+	/// Hand back the ring space of every batch that has finished. Cheap, meant to be called once a frame.
+	/// </summary>
+	void update();
+
+	bool isComplete(uint64_t value);
+
+	/// <summary>
+	/// Block until value has signalled, flushing first if it hasn't been submitted yet.
+	/// </summary>
+	void wait(uint64_t value);
+
+	/// <summary>
+	/// Flush, then record the queue family acquires for everything submitted since the last call into commandBuffer.
+	/// Returns the timeline value the submission of commandBuffer must wait on, 0 if it needn't wait at all.
+	/// </summary>
+	uint64_t recordAcquires(VkCommandBuffer commandBuffer);
+
+	VkSemaphore getSemaphore() const {
+		return semaphore;
+	}
+
+	VkDeviceSize getSize() const {
+		return capacity;
+	}
+
+	VkDeviceSize getBytesInUse() const;
+	StagingRingStats getStats() const;
+	void printStats(std::ostream& out) const;
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct Batch {
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		uint64_t value = 0;
+		VkDeviceSize bytes = 0; // Ring space it holds, alignment and wrap padding included
+		Clock::time_point submitted;
+	};
+
+	VkDeviceSize reserve(VkDeviceSize size);
+	void beginBatch();
+	uint64_t flushLocked();
+	void retire(bool waitForOldest);
+	uint64_t completedValue();
+
+	VkDevice device = VK_NULL_HANDLE;
+	DeviceMemoryAllocator* allocator = nullptr;
+	VkQueue queue = VK_NULL_HANDLE;
+	uint32_t deviceMask = 0; // 0 when the logical device isn't over a device group
+	uint32_t transferFamily = 0;
+	uint32_t graphicsFamily = 0;
+	PFN_vkGetSemaphoreCounterValue getSemaphoreCounterValue = nullptr;
+	PFN_vkWaitSemaphores waitSemaphores = nullptr;
+
+	VkBuffer buffer = VK_NULL_HANDLE;
+	Allocation allocation;
+	VkDeviceSize capacity = 0;
+	VkDeviceSize alignment = 1;
+	VkDeviceSize head = 0; // Where the next reservation starts
+	VkDeviceSize used = 0; // Bytes held by the open batch and every batch in flight
+
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	std::vector<VkCommandBuffer> freeCommandBuffers;
+	VkSemaphore semaphore = VK_NULL_HANDLE;
+	uint64_t lastSubmitted = 0;
+	uint64_t lastCompleted = 0;
+
+	Batch open; // Copies recorded but not submitted yet, commandBuffer is null while there are none
+	std::vector<VkBufferMemoryBarrier> openReleases;
+	std::vector<VkImageMemoryBarrier> openImageReleases; // Also the final layout transition when there is no ownership transfer
+	std::deque<Batch> inFlight;
+	std::vector<VkBufferMemoryBarrier> pendingAcquires;
+	std::vector<VkImageMemoryBarrier> pendingImageAcquires;
+	uint64_t pendingWaitValue = 0;
+
+	Clock::time_point lastRetired;
+	mutable std::mutex mutex;
+	StagingRingStats stats;
+};
@@ -0,0 +1,55 @@
+#include "StartupTimeline.h"
+
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <iomanip>
+
+namespace {
+	const int BAR_WIDTH = 40;
+}
+
+void StartupTimeline::record(const std::string& name, Clock::time_point start, Clock::time_point end) {
+	Event event;
+	event.name = name;
+	event.startMilliseconds = std::chrono::duration<double, std::milli>(start - origin).count();
+	event.endMilliseconds = std::chrono::duration<double, std::milli>(end - origin).count();
+	event.threadIndex = JobSystem::getThreadIndex();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	events.push_back(event);
+}
+
+double StartupTimeline::getTotalMilliseconds() const {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	double total = 0.0;
+	for (const auto& event : events) {
+		total = std::max(total, event.endMilliseconds);
+	}
+	return total;
+}
+
+void StartupTimeline::print(std::ostream& out) const {
+	const double total = getTotalMilliseconds();
+
+	std::vector<Event> sorted;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		sorted = events;
+	}
+	std::sort(sorted.begin(), sorted.end(), [](const Event& a, const Event& b) {
+		return a.startMilliseconds < b.startMilliseconds;
+	});
+
+	out << "Startup timeline (" << std::fixed << std::setprecision(2) << total << " ms):\n";
+	for (const auto& event : sorted) {
+		const int barStart = total > 0.0 ? std::min(BAR_WIDTH - 1, static_cast<int>(event.startMilliseconds / total * BAR_WIDTH)) : 0;
+		const int barEnd = total > 0.0 ? static_cast<int>(event.endMilliseconds / total * BAR_WIDTH) : 0;
+		const std::string bar = std::string(barStart, ' ') + std::string(std::max(1, barEnd - barStart), '#');
+
+		out << "  " << std::setw(8) << event.startMilliseconds << " +" << std::setw(8) << (event.endMilliseconds - event.startMilliseconds)
+			<< " ms  thread " << std::setw(2) << event.threadIndex
+			<< "  |" << std::left << std::setw(BAR_WIDTH) << bar << std::right << "|  " << event.name << "\n";
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Records when each startup step ran and on which thread, relative to when the timeline was created. Thread safe,
+/// so steps running concurrently on the job system can all report into the same timeline.
+/// </summary>
+class StartupTimeline {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	StartupTimeline() : origin(Clock::now()) {}
+
+	/// <summary>
+	/// RAII helper: records [construction, destruction) under name.
+	/// </summary>
+	class Scope {
+	public:
+		Scope(StartupTimeline& timeline, const char* name) : timeline(timeline), name(name), start(Clock::now()) {}
+		~Scope() {
+			timeline.record(name, start, Clock::now());
+		}
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		StartupTimeline& timeline;
+		const char* name;
+		Clock::time_point start;
+	};
+
+	void record(const std::string& name, Clock::time_point start, Clock::time_point end);
+
+	/// <summary>
+	/// Wall clock time from creation to the end of the last recorded step.
+	/// </summary>
+	double getTotalMilliseconds() const;
+
+	/// <summary>
+	/// Steps sorted by start time, one per line, with a bar showing where they overlap.
+	/// </summary>
+	void print(std::ostream& out) const;
+
+private:
+	struct Event {
+		std::string name;
+		double startMilliseconds;
+		double endMilliseconds;
+		uint32_t threadIndex;
+	};
+
+	Clock::time_point origin;
+	mutable std::mutex mutex;
+	std::vector<Event> events;
+};
@@ -0,0 +1,458 @@
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+
+void TextureStreamer::init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t apiVersion, DeviceMemoryAllocator& allocator,
+	StagingRing& stagingRing, DeletionQueue& deletionQueue, const std::string& path, uint32_t framesInFlight, VkDeviceSize budget,
+	bool memoryBudgetEnabled) {
+	this->physicalDevice = physicalDevice;
+	this->device = device;
+	this->allocator = &allocator;
+	this->stagingRing = &stagingRing;
+	this->deletionQueue = &deletionQueue;
+	this->framesInFlight = framesInFlight;
+	this->memoryBudgetEnabled = memoryBudgetEnabled && apiVersion >= VK_API_VERSION_1_1; // vkGetPhysicalDeviceMemoryProperties2
+	configuredBudget = budget;
+	stats = TextureStreamerStats{};
+	stats.budgetBytes = budget;
+
+	file.open(path);
+	if (file.getTextureCount() == 0) {
+		throw std::runtime_error("Failed to stream textures, " + path + " has none!");
+	}
+
+	textures.resize(std::min(file.getTextureCount(), MAX_TEXTURES));
+	for (uint32_t i = 0; i < textures.size(); i++) {
+		Texture& texture = textures[i];
+		const AssetTextureEntry& entry = file.getTexture(i);
+		texture.index = i;
+		getTexelBlock(static_cast<VkFormat>(entry.format), texture.block); // Checked by AssetFile::open()
+
+		VkFormatProperties formatProperties;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, static_cast<VkFormat>(entry.format), &formatProperties);
+		if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+			throw std::runtime_error("Failed to stream textures, the device can't sample the format of texture " + std::to_string(i) + "!");
+		}
+
+		// The finest firstMip whose chain still fits the tail, the last level on its own if even that doesn't
+		texture.tailMip = entry.mipCount - 1;
+		while (texture.tailMip > 0 && getChainBytes(texture, texture.tailMip - 1) <= TAIL_BYTES) {
+			texture.tailMip--;
+		}
+		texture.requestedMip = texture.tailMip;
+		texture.plannedMip = texture.tailMip;
+		texture.resident = createImage(texture, texture.tailMip);
+	}
+
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+	heapIndex = memoryProperties.memoryTypes[textures[0].resident.allocation.memoryTypeIndex].heapIndex;
+
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+	if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create texture streaming sampler!");
+	}
+
+	createDescriptors();
+}
+
+void TextureStreamer::cleanup() {
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+	vkDestroySampler(device, sampler, nullptr);
+
+	for (auto& frame : frames) {
+		allocator->destroyBuffer(frame.feedbackBuffer, frame.feedbackAllocation);
+	}
+	frames.clear();
+
+	// Only called once the device is idle and the deletion queue has let go of the replaced images, so nothing is still
+	// uploading into or sampling any of them
+	for (auto& texture : textures) {
+		destroyImage(texture.resident);
+		if (texture.pending.image != VK_NULL_HANDLE) {
+			destroyImage(texture.pending);
+		}
+	}
+	textures.clear();
+
+	file.close();
+}
+
+void TextureStreamer::createDescriptors() {
+	VkDescriptorSetLayoutBinding bindings[2]{};
+	bindings[0].binding = TEXTURE_BINDING;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[0].descriptorCount = MAX_TEXTURES;
+	bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	bindings[1].binding = FEEDBACK_BINDING;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	bindings[1].descriptorCount = 1;
+	bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 2;
+	layoutInfo.pBindings = bindings;
+
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create texture streaming descriptor set layout!");
+	}
+
+	VkDescriptorPoolSize poolSizes[2]{};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[0].descriptorCount = MAX_TEXTURES * framesInFlight;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[1].descriptorCount = framesInFlight;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = framesInFlight;
+	poolInfo.poolSizeCount = 2;
+	poolInfo.pPoolSizes = poolSizes;
+
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create texture streaming descriptor pool!");
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(framesInFlight, setLayout);
+	std::vector<VkDescriptorSet> sets(framesInFlight);
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = framesInFlight;
+	allocInfo.pSetLayouts = layouts.data();
+
+	if (vkAllocateDescriptorSets(device, &allocInfo, sets.data()) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate texture streaming descriptor sets!");
+	}
+
+	frames.resize(framesInFlight);
+	for (uint32_t i = 0; i < framesInFlight; i++) {
+		FrameResources& frame = frames[i];
+		frame.set = sets[i];
+
+		// Coherent, so the host sees the shader's atomics once the fence has signalled without an invalidate
+		VkBufferCreateInfo bufferInfo{};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = sizeof(FeedbackData);
+		bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		AllocationCreateInfo allocationInfo{};
+		allocationInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		frame.feedbackBuffer = allocator->createBuffer(bufferInfo, allocationInfo, frame.feedbackAllocation);
+
+		auto* feedback = static_cast<FeedbackData*>(frame.feedbackAllocation.mappedData);
+		feedback->textureCount = getTextureCount();
+		feedback->padding = 0;
+		for (FeedbackEntry& entry : feedback->textures) {
+			entry = { UINT32_MAX, 0 };
+		}
+
+		VkDescriptorBufferInfo feedbackInfo{};
+		feedbackInfo.buffer = frame.feedbackBuffer;
+		feedbackInfo.offset = 0;
+		feedbackInfo.range = VK_WHOLE_SIZE;
+
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = frame.set;
+		write.dstBinding = FEEDBACK_BINDING;
+		write.descriptorCount = 1;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		write.pBufferInfo = &feedbackInfo;
+		vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+
+		// Every slot has to be valid without partially bound descriptors, the ones past the file's textures included
+		VkDescriptorImageInfo imageInfos[MAX_TEXTURES]{};
+		for (uint32_t slot = 0; slot < MAX_TEXTURES; slot++) {
+			const Texture& texture = textures[slot < textures.size() ? slot : 0];
+			imageInfos[slot].sampler = sampler;
+			imageInfos[slot].imageView = texture.resident.view;
+			imageInfos[slot].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		}
+
+		VkWriteDescriptorSet imageWrite{};
+		imageWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		imageWrite.dstSet = frame.set;
+		imageWrite.dstBinding = TEXTURE_BINDING;
+		imageWrite.descriptorCount = MAX_TEXTURES;
+		imageWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		imageWrite.pImageInfo = imageInfos;
+		vkUpdateDescriptorSets(device, 1, &imageWrite, 0, nullptr);
+
+		frame.generations.assign(textures.size(), 0);
+		frame.firstMips.resize(textures.size());
+		for (uint32_t t = 0; t < textures.size(); t++) {
+			frame.firstMips[t] = textures[t].resident.firstMip;
+		}
+	}
+}
+
+TextureStreamer::TextureImage TextureStreamer::createImage(const Texture& texture, uint32_t firstMip) {
+	const AssetTextureEntry& entry = file.getTexture(texture.index);
+
+	TextureImage result;
+	result.firstMip = firstMip;
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = static_cast<VkFormat>(entry.format);
+	imageInfo.extent = { std::max(entry.width >> firstMip, 1u), std::max(entry.height >> firstMip, 1u), 1 };
+	imageInfo.mipLevels = entry.mipCount - firstMip;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE; // The staging ring hands each level over to the graphics family
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	AllocationCreateInfo allocationInfo{};
+	result.image = allocator->createImage(imageInfo, allocationInfo, result.allocation);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = result.image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = imageInfo.format;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.baseMipLevel = 0;
+	viewInfo.subresourceRange.levelCount = imageInfo.mipLevels;
+	viewInfo.subresourceRange.baseArrayLayer = 0;
+	viewInfo.subresourceRange.layerCount = 1;
+
+	if (vkCreateImageView(device, &viewInfo, nullptr, &result.view) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create streamed texture image view!");
+	}
+
+	// Level l of the whole chain is level l - firstMip of this image
+	for (uint32_t level = firstMip; level < entry.mipCount; level++) {
+		const VkExtent2D extent = { std::max(entry.width >> level, 1u), std::max(entry.height >> level, 1u) };
+		result.uploadValue = stagingRing->uploadImage(result.image, level - firstMip, extent, { texture.block.width, texture.block.height },
+			texture.block.bytes, file.getSectionData(entry.firstSection + level));
+		stats.bytesStreamed += getMipSize(texture.block, entry.width, entry.height, level);
+	}
+
+	stats.residentBytes += result.allocation.size;
+	return result;
+}
+
+void TextureStreamer::destroyImage(TextureImage& image) {
+	stats.residentBytes -= image.allocation.size;
+	vkDestroyImageView(device, image.view, nullptr);
+	allocator->destroyImage(image.image, image.allocation);
+	image = TextureImage{};
+}
+
+VkDeviceSize TextureStreamer::getChainBytes(const Texture& texture, uint32_t firstMip) const {
+	const AssetTextureEntry& entry = file.getTexture(texture.index);
+
+	VkDeviceSize bytes = 0;
+	for (uint32_t level = firstMip; level < entry.mipCount; level++) {
+		bytes += getMipSize(texture.block, entry.width, entry.height, level);
+	}
+	return bytes;
+}
+
+VkDeviceSize TextureStreamer::getBudget() {
+	if (!memoryBudgetEnabled) {
+		return configuredBudget;
+	}
+
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT memoryBudget{};
+	memoryBudget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+	VkPhysicalDeviceMemoryProperties2 memoryProperties{};
+	memoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+	memoryProperties.pNext = &memoryBudget;
+	vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &memoryProperties);
+
+	// The heap's usage already counts the textures, so they may grow into whatever the heap has left on top of them
+	const VkDeviceSize heapBudget = memoryBudget.heapBudget[heapIndex];
+	const VkDeviceSize heapUsage = memoryBudget.heapUsage[heapIndex];
+	const VkDeviceSize available = heapBudget > heapUsage ? heapBudget - heapUsage : 0;
+	return std::min(configuredBudget, stats.residentBytes + available);
+}
+
+void TextureStreamer::readFeedback(FrameResources& frame, uint64_t framesSubmitted) {
+	auto* feedback = static_cast<FeedbackData*>(frame.feedbackAllocation.mappedData);
+
+	for (uint32_t i = 0; i < textures.size(); i++) {
+		FeedbackEntry& entry = feedback->textures[i];
+		Texture& texture = textures[i];
+
+		if (frame.recorded && entry.mip != UINT32_MAX) {
+			const int64_t mip = int64_t(entry.mip) - FEEDBACK_LOD_BIAS + frame.firstMips[i];
+			texture.requestedMip = static_cast<uint32_t>(std::clamp<int64_t>(mip, 0, texture.tailMip));
+			texture.samples = entry.samples;
+			texture.lastSampledFrame = framesSubmitted;
+			texture.sampled = true;
+		}
+
+		// Ready for this frame's fragments to report into again
+		entry = { UINT32_MAX, 0 };
+	}
+}
+
+void TextureStreamer::planResidency(VkDeviceSize budget, uint64_t framesSubmitted) {
+	auto isStale = [framesSubmitted](const Texture& texture) {
+		return !texture.sampled || framesSubmitted - texture.lastSampledFrame > STALE_FRAMES;
+	};
+
+	// Most covered first, the textures nothing has sampled lately after all the rest
+	std::vector<Texture*> order;
+	order.reserve(textures.size());
+	VkDeviceSize planned = 0;
+	for (Texture& texture : textures) {
+		texture.plannedMip = texture.tailMip;
+		planned += getChainBytes(texture, texture.tailMip); // Tails are kept whatever the budget
+		order.push_back(&texture);
+	}
+	std::stable_sort(order.begin(), order.end(), [&](const Texture* a, const Texture* b) {
+		if (isStale(*a) != isStale(*b)) {
+			return !isStale(*a);
+		}
+		return a->samples > b->samples;
+	});
+
+	auto grow = [&](Texture& texture, uint32_t targetMip) {
+		while (texture.plannedMip > targetMip) {
+			const VkDeviceSize growth = getChainBytes(texture, texture.plannedMip - 1) - getChainBytes(texture, texture.plannedMip);
+			if (planned + growth > budget) {
+				break;
+			}
+			planned += growth;
+			texture.plannedMip--;
+		}
+	};
+
+	// What the screen asks for first, then whatever is already resident where there is still room, so a texture only
+	// loses mips it no longer needs once something else needs the memory
+	for (Texture* texture : order) {
+		if (!isStale(*texture)) {
+			grow(*texture, texture->requestedMip);
+		}
+	}
+	for (Texture* texture : order) {
+		grow(*texture, texture->pending.image != VK_NULL_HANDLE ? texture->pending.firstMip : texture->resident.firstMip);
+	}
+
+	uint32_t pending = 0;
+	for (const Texture& texture : textures) {
+		pending += texture.pending.image != VK_NULL_HANDLE ? 1 : 0;
+	}
+
+	// Evictions go first, least covered first, since they make the room the loads were planned into. The memory only
+	// comes back once they land, so for a few frames a load can overlap the eviction making room for it.
+	for (auto it = order.rbegin(); it != order.rend() && pending < MAX_PENDING; ++it) {
+		Texture& texture = **it;
+		if (texture.pending.image == VK_NULL_HANDLE && texture.plannedMip > texture.resident.firstMip) {
+			texture.pending = createImage(texture, texture.plannedMip);
+			stats.evictions++;
+			pending++;
+		}
+	}
+	for (auto it = order.begin(); it != order.end() && pending < MAX_PENDING; ++it) {
+		Texture& texture = **it;
+		if (texture.pending.image == VK_NULL_HANDLE && texture.plannedMip < texture.resident.firstMip) {
+			texture.pending = createImage(texture, texture.plannedMip);
+			stats.loads++;
+			pending++;
+		}
+	}
+	stats.pendingRequests = pending;
+}
+
+void TextureStreamer::writeDescriptors(FrameResources& frame) {
+	VkDescriptorImageInfo imageInfos[MAX_TEXTURES]{};
+	VkDescriptorImageInfo unusedInfos[MAX_TEXTURES]{};
+	VkWriteDescriptorSet writes[MAX_TEXTURES + 1]{};
+	uint32_t writeCount = 0;
+
+	for (uint32_t i = 0; i < textures.size(); i++) {
+		const Texture& texture = textures[i];
+		frame.firstMips[i] = texture.resident.firstMip;
+		if (frame.generations[i] == texture.generation) {
+			continue;
+		}
+		frame.generations[i] = texture.generation;
+
+		imageInfos[i].sampler = sampler;
+		imageInfos[i].imageView = texture.resident.view;
+		imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		VkWriteDescriptorSet& write = writes[writeCount++];
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = frame.set;
+		write.dstBinding = TEXTURE_BINDING;
+		write.dstArrayElement = i;
+		write.descriptorCount = 1;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		write.pImageInfo = &imageInfos[i];
+
+		// The slots past the file's textures repeat texture 0, so they follow it
+		const uint32_t textureCount = getTextureCount();
+		if (i == 0 && textureCount < MAX_TEXTURES) {
+			std::fill(unusedInfos, unusedInfos + MAX_TEXTURES - textureCount, imageInfos[0]);
+
+			VkWriteDescriptorSet& unusedWrite = writes[writeCount++];
+			unusedWrite = write;
+			unusedWrite.dstArrayElement = textureCount;
+			unusedWrite.descriptorCount = MAX_TEXTURES - textureCount;
+			unusedWrite.pImageInfo = unusedInfos;
+		}
+	}
+
+	if (writeCount > 0) {
+		vkUpdateDescriptorSets(device, writeCount, writes, 0, nullptr);
+	}
+}
+
+void TextureStreamer::update(uint32_t frameIndex, uint64_t framesSubmitted) {
+	FrameResources& frame = frames[frameIndex];
+	readFeedback(frame, framesSubmitted);
+
+	// Swap in what has landed. The replaced image may still be sampled by the frames in flight, their sets point at it
+	// until each one's own update, and this frame's set is only rewritten below
+	for (Texture& texture : textures) {
+		if (texture.pending.image != VK_NULL_HANDLE && stagingRing->isComplete(texture.pending.uploadValue)) {
+			TextureImage replaced = texture.resident;
+			deletionQueue->defer([this, replaced]() mutable { destroyImage(replaced); }, replaced.allocation.size);
+			texture.resident = texture.pending;
+			texture.pending = TextureImage{};
+			texture.generation++;
+		}
+	}
+
+	stats.budgetBytes = getBudget();
+	planResidency(stats.budgetBytes, framesSubmitted);
+
+	writeDescriptors(frame);
+	frame.recorded = true;
+}
+
+TextureStreamerStats TextureStreamer::getStats() const {
+	return stats;
+}
+
+void TextureStreamer::printStats(std::ostream& out) const {
+	out << "Texture streaming: " << getTextureCount() << " textures, " << std::fixed << std::setprecision(1)
+		<< stats.residentBytes / (1024.0 * 1024.0) << " MiB resident of a " << stats.budgetBytes / (1024.0 * 1024.0) << " MiB budget, "
+		<< stats.loads << " loads, " << stats.evictions << " evictions, " << stats.pendingRequests << " pending, "
+		<< stats.bytesStreamed / (1024.0 * 1024.0) << " MiB streamed\n";
+}
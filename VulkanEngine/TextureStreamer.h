@@ -0,0 +1,171 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "AssetFile.h"
+#include "DeletionQueue.h"
+#include "DeviceMemoryAllocator.h"
+#include "StagingRing.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct TextureStreamerStats {
+	uint64_t residentBytes = 0; // Device memory of every texture image right now, the ones still loading included
+	uint64_t budgetBytes = 0; // What the last update() planned against, the configured budget capped by the heap's budget
+	uint32_t pendingRequests = 0; // Residency changes whose uploads haven't landed yet
+	uint64_t loads = 0; // Residency changes to a finer mip
+	uint64_t evictions = 0; // Residency changes to a coarser mip, to make room under the budget
+	uint64_t bytesStreamed = 0; // Queued on the staging ring, every level of every image the streamer created
+};
+
+/// <summary>
+/// Keeps the textures of a cooked asset file resident at the detail the screen asks for, under a device memory budget.
+/// The fragment shader reports, per texture, the finest mip it needed and how many fragments sampled it into a per
+/// frame in flight feedback buffer. Once that frame's fence has signalled update() reads it back, plans every texture's
+/// finest resident mip, covering the most sampled textures first, and queues the difference.
+///
+/// Images aren't sparse: changing a texture's residency creates a new image of the mips it keeps and re-uploads them
+/// from the file's mapping through the staging ring. The old image stays bound until the new one has landed and then
+/// goes to the deletion queue, which destroys it once no frame in flight can still be sampling it. Every texture always
+/// keeps its coarsest mips, up to TAIL_BYTES, so there is never a slot without an image. Each frame in flight has its
+/// own descriptor set, rewritten for the textures that changed since that frame last ran, so nothing a pending frame
+/// reads is ever updated.
+///
+/// With VK_EXT_memory_budget the budget is also capped each update by what the heap has left for this process.
+/// Not thread safe; everything runs on the render thread.
+/// </summary>
+class TextureStreamer {
+public:
+	static constexpr uint32_t MAX_TEXTURES = 64; // Must match MAX_STREAMED_TEXTURES in shader.frag
+	static constexpr uint32_t TEXTURE_BINDING = 0;
+	static constexpr uint32_t FEEDBACK_BINDING = 1;
+	static constexpr VkDeviceSize TAIL_BYTES = 64 * 1024;
+	static constexpr uint32_t MAX_PENDING = 8; // Residency changes in flight at once, so one update can't swamp the staging ring
+	static constexpr uint32_t STALE_FRAMES = 120; // A texture nothing sampled for this long only keeps its mips if there's room
+	static constexpr uint32_t FEEDBACK_LOD_BIAS = 16; // Must match shader.frag, lets magnified (negative) levels go through atomicMin
+
+	/// <summary>
+	/// Open the file at path and bring every texture in at its tail. Throws if the file has no textures, or one in a
+	/// format the device can't sample. Past MAX_TEXTURES the rest are ignored. memoryBudgetEnabled is whether the device
+	/// was created with VK_EXT_memory_budget, which also needs apiVersion 1.1.
+	/// </summary>
+	void init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t apiVersion, DeviceMemoryAllocator& allocator,
+		StagingRing& stagingRing, DeletionQueue& deletionQueue, const std::string& path, uint32_t framesInFlight, VkDeviceSize budget,
+		bool memoryBudgetEnabled);
+	void cleanup();
+
+	uint32_t getTextureCount() const {
+		return static_cast<uint32_t>(textures.size());
+	}
+
+	/// <summary>
+	/// Set 1 of the pipelines that sample the streamed textures: MAX_TEXTURES combined image samplers for the fragment
+	/// shader, slots past the file's textures repeating texture 0, and that frame's feedback buffer.
+	/// </summary>
+	VkDescriptorSetLayout getSetLayout() const {
+		return setLayout;
+	}
+
+	VkDescriptorSet getSet(uint32_t frameIndex) const {
+		return frames[frameIndex].set;
+	}
+
+	/// <summary>
+	/// Written by the fragment shader during the frame and read back by update() once its fence has signalled.
+	/// </summary>
+	VkBuffer getFeedbackBuffer(uint32_t frameIndex) const {
+		return frames[frameIndex].feedbackBuffer;
+	}
+
+	/// <summary>
+	/// Once a frame, after frameIndex's fence has signalled and before it's recorded: read its feedback, swap in what has
+	/// landed, plan and queue new residency changes and bring its descriptor set up to date. framesSubmitted is the
+	/// frame's number, for retiring replaced images.
+	/// </summary>
+	void update(uint32_t frameIndex, uint64_t framesSubmitted);
+
+	TextureStreamerStats getStats() const;
+
+	void printStats(std::ostream& out) const;
+
+private:
+	/// <summary>
+	/// Must match FeedbackBuffer in shader.frag. mip is the finest level sampled relative to the image bound that frame,
+	/// plus FEEDBACK_LOD_BIAS, UINT32_MAX when nothing sampled it. One fragment in 16 reports.
+	/// </summary>
+	struct FeedbackEntry {
+		uint32_t mip;
+		uint32_t samples;
+	};
+
+	struct FeedbackData {
+		uint32_t textureCount;
+		uint32_t padding;
+		FeedbackEntry textures[MAX_TEXTURES];
+	};
+
+	/// <summary>
+	/// One image of a texture, holding its mips from firstMip down.
+	/// </summary>
+	struct TextureImage {
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;
+		Allocation allocation;
+		uint32_t firstMip = 0;
+		uint64_t uploadValue = 0; // Staging ring timeline value of its last level
+	};
+
+	struct Texture {
+		uint32_t index = 0; // In the file
+		TexelBlock block{};
+		uint32_t tailMip = 0; // Coarsest firstMip it's ever planned at, whatever the budget
+		TextureImage resident; // What the descriptor sets point at
+		TextureImage pending; // The image replacing it, image is null when there is none
+		uint32_t generation = 0; // Bumped each time resident changes
+		uint32_t requestedMip = 0; // Finest mip the last feedback asked for, in whole chain terms
+		uint32_t samples = 0; // Fragments that reported it last feedback
+		uint64_t lastSampledFrame = 0;
+		bool sampled = false; // Ever reported
+		uint32_t plannedMip = 0; // Scratch for update()
+	};
+
+	struct FrameResources {
+		VkDescriptorSet set = VK_NULL_HANDLE;
+		VkBuffer feedbackBuffer = VK_NULL_HANDLE;
+		Allocation feedbackAllocation;
+		std::vector<uint32_t> generations; // Of each texture when its slot in set was last written
+		std::vector<uint32_t> firstMips; // Of the image each slot points at, to turn the feedback into whole chain mips
+		bool recorded = false; // The set has been used by a submitted frame, so its feedback means something
+	};
+
+	void createDescriptors();
+	TextureImage createImage(const Texture& texture, uint32_t firstMip);
+	void destroyImage(TextureImage& image);
+	VkDeviceSize getChainBytes(const Texture& texture, uint32_t firstMip) const;
+	VkDeviceSize getBudget();
+	void readFeedback(FrameResources& frame, uint64_t framesSubmitted);
+	void planResidency(VkDeviceSize budget, uint64_t framesSubmitted);
+	void writeDescriptors(FrameResources& frame);
+
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	VkDevice device = VK_NULL_HANDLE;
+	DeviceMemoryAllocator* allocator = nullptr;
+	StagingRing* stagingRing = nullptr;
+	DeletionQueue* deletionQueue = nullptr;
+	AssetFile file; // Mapped for the whole run, every residency change copies its levels out of it again
+	uint32_t framesInFlight = 0;
+	VkDeviceSize configuredBudget = 0;
+	bool memoryBudgetEnabled = false;
+	uint32_t heapIndex = 0; // Where the texture images live, for the memory budget query
+
+	std::vector<Texture> textures;
+	std::vector<FrameResources> frames;
+	VkSampler sampler = VK_NULL_HANDLE;
+	VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+
+	TextureStreamerStats stats;
+};
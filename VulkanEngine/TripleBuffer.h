@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/// <summary>
+/// Latest-value handoff from a producer to a consumer without either ever waiting on the other. Of the three buffers
+/// the producer always owns one to write into, the consumer one to read from, and the third is the latest published,
+/// swapped with a single atomic exchange on each side. A producer that publishes faster than the consumer acquires
+/// simply replaces the state the consumer hasn't picked up yet, so the consumer always gets the newest complete one.
+///
+/// The producer side may be several threads as long as something else orders them, e.g. they fill disjoint parts of
+/// getWriteBuffer() and whichever finishes last publishes before letting any of them start on the next one.
+/// </summary>
+template <typename T>
+class TripleBuffer {
+public:
+	/// <summary>
+	/// Every buffer, for setting them up before either side starts.
+	/// </summary>
+	T& getBuffer(uint32_t index) {
+		return buffers[index];
+	}
+
+	/// <summary>
+	/// Producer: the buffer to fill for the next publish(). Nobody else touches it until then.
+	/// </summary>
+	T& getWriteBuffer() {
+		return buffers[backIndex];
+	}
+
+	/// <summary>
+	/// Producer: make the write buffer the latest and take the one it replaces to write into next.
+	/// </summary>
+	void publish() {
+		const uint8_t previous = latest.exchange(static_cast<uint8_t>(backIndex | FRESH_BIT), std::memory_order_acq_rel);
+		backIndex = previous & INDEX_MASK;
+	}
+
+	/// <summary>
+	/// Consumer: swap getReadBuffer() for the latest published buffer. Returns false, keeping the current one, when
+	/// nothing was published since the last acquire().
+	/// </summary>
+	bool acquire() {
+		if (!(latest.load(std::memory_order_relaxed) & FRESH_BIT)) {
+			return false;
+		}
+		const uint8_t previous = latest.exchange(frontIndex, std::memory_order_acq_rel);
+		frontIndex = previous & INDEX_MASK;
+		return true;
+	}
+
+	/// <summary>
+	/// Consumer: what the last successful acquire() got.
+	/// </summary>
+	const T& getReadBuffer() const {
+		return buffers[frontIndex];
+	}
+
+private:
+	static constexpr uint8_t INDEX_MASK = 0x3;
+	static constexpr uint8_t FRESH_BIT = 0x4; // Published since the consumer last took it
+
+	T buffers[3];
+	uint8_t backIndex = 0; // Producer only
+	alignas(64) std::atomic<uint8_t> latest{ 1 };
+	alignas(64) uint8_t frontIndex = 2; // Consumer only
+};
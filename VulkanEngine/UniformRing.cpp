@@ -0,0 +1,171 @@
+#include "UniformRing.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+
+namespace {
+	VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+void UniformRing::init(VkDevice device, DeviceMemoryAllocator& allocator, uint32_t framesInFlight, VkDeviceSize bytesPerFrame,
+	VkDeviceSize minAlignment, VkDeviceSize range, VkShaderStageFlags stages) {
+	this->device = device;
+	this->allocator = &allocator;
+	alignment = std::max<VkDeviceSize>(minAlignment, 1);
+	regionSize = alignUp(std::max(bytesPerFrame, range), alignment);
+
+	if (regionSize * framesInFlight > UINT32_MAX) {
+		throw std::runtime_error("Uniform ring too large for 32 bit dynamic offsets!");
+	}
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = regionSize * framesInFlight;
+	bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	// Device local as well when the device has such a heap (resizable BAR or integrated), so draws don't read over the bus
+	AllocationCreateInfo allocationInfo{};
+	allocationInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+	allocationInfo.preferredFlags = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	allocationInfo.dedicated = true;
+	buffer = allocator.createBuffer(bufferInfo, allocationInfo, allocation);
+
+	VkDescriptorSetLayoutBinding binding{};
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	binding.descriptorCount = 1;
+	binding.stageFlags = stages;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &binding;
+
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create uniform ring descriptor set layout!");
+	}
+
+	VkDescriptorSetLayoutBinding storageBinding = binding;
+	storageBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	layoutInfo.pBindings = &storageBinding;
+
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &storageSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create uniform ring storage descriptor set layout!");
+	}
+
+	VkDescriptorPoolSize poolSizes[2]{};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	poolSizes[0].descriptorCount = 1;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[1].descriptorCount = framesInFlight;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = 1 + framesInFlight;
+	poolInfo.poolSizeCount = 2;
+	poolInfo.pPoolSizes = poolSizes;
+
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create uniform ring descriptor pool!");
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &setLayout;
+
+	if (vkAllocateDescriptorSets(device, &allocInfo, &set) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate uniform ring descriptor set!");
+	}
+
+	// One descriptor for every frame: the dynamic offset picks both the region and the slot within it
+	VkDescriptorBufferInfo descriptorInfo{};
+	descriptorInfo.buffer = buffer;
+	descriptorInfo.offset = 0;
+	descriptorInfo.range = range;
+
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = set;
+	write.dstBinding = 0;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	write.pBufferInfo = &descriptorInfo;
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+
+	// The storage view has no dynamic offset, so each frame gets a set of its own
+	storageSets.resize(framesInFlight);
+	std::vector<VkDescriptorSetLayout> storageLayouts(framesInFlight, storageSetLayout);
+	allocInfo.descriptorSetCount = framesInFlight;
+	allocInfo.pSetLayouts = storageLayouts.data();
+
+	if (vkAllocateDescriptorSets(device, &allocInfo, storageSets.data()) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate uniform ring storage descriptor sets!");
+	}
+
+	for (uint32_t frame = 0; frame < framesInFlight; frame++) {
+		VkDescriptorBufferInfo regionInfo{};
+		regionInfo.buffer = buffer;
+		regionInfo.offset = frame * regionSize;
+		regionInfo.range = regionSize;
+
+		VkWriteDescriptorSet storageWrite = write;
+		storageWrite.dstSet = storageSets[frame];
+		storageWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		storageWrite.pBufferInfo = &regionInfo;
+		vkUpdateDescriptorSets(device, 1, &storageWrite, 0, nullptr);
+	}
+}
+
+void UniformRing::cleanup() {
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr); // Frees the sets with it
+	vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+	vkDestroyDescriptorSetLayout(device, storageSetLayout, nullptr);
+	allocator->destroyBuffer(buffer, allocation);
+}
+
+void UniformRing::beginFrame(uint32_t frameIndex) {
+	this->frameIndex = frameIndex;
+	head.store(0, std::memory_order_relaxed);
+	inFrame = true;
+}
+
+void UniformRing::endFrame() {
+	const VkDeviceSize written = head.load(std::memory_order_relaxed);
+	if (written > 0) {
+		allocator->flush(allocation, frameIndex * regionSize, written); // A no-op on coherent memory
+	}
+
+	stats.lastFrameBytes = written;
+	stats.peakFrameBytes = std::max(stats.peakFrameBytes, written);
+	stats.totalBytes += written;
+	stats.frames++;
+	inFrame = false;
+}
+
+void* UniformRing::allocate(VkDeviceSize stride, uint32_t count, uint32_t& dynamicOffset) {
+	if (!inFrame) {
+		throw std::runtime_error("Uniform ring allocation outside of a frame!");
+	}
+
+	const VkDeviceSize size = stride * count;
+	const VkDeviceSize offset = head.fetch_add(size, std::memory_order_relaxed);
+	if (offset + size > regionSize) {
+		throw std::runtime_error("Uniform ring region for this frame is full!");
+	}
+
+	const VkDeviceSize bufferOffset = frameIndex * regionSize + offset;
+	dynamicOffset = static_cast<uint32_t>(bufferOffset);
+	return static_cast<char*>(allocation.mappedData) + bufferOffset;
+}
+
+void UniformRing::printStats(std::ostream& out) const {
+	const double average = stats.frames > 0 ? static_cast<double>(stats.totalBytes) / stats.frames : 0.0;
+	out << "Uniform ring: " << std::fixed << std::setprecision(1) << average / 1024.0 << " KiB written per frame on average, "
+		<< stats.peakFrameBytes / 1024.0 << " KiB peak, " << regionSize / 1024.0 << " KiB per frame available\n";
+}
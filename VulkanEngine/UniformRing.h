@@ -0,0 +1,136 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "DeviceMemoryAllocator.h"
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+struct UniformRingStats {
+	VkDeviceSize lastFrameBytes = 0;
+	VkDeviceSize peakFrameBytes = 0;
+	uint64_t totalBytes = 0;
+	uint32_t frames = 0;
+};
+
+/// <summary>
+/// Per-draw uniform data without a buffer or a map call per object. One persistently mapped buffer holds a region per
+/// frame in flight, and allocations inside a region are a single atomic add rounded to minUniformBufferOffsetAlignment.
+/// Shaders see the data through one UNIFORM_BUFFER_DYNAMIC descriptor, so a draw only has to pass its offset to
+/// vkCmdBindDescriptorSets; writing 10k transforms is 10k copies into mapped memory.
+///
+/// Each frame's region can also be read as one STORAGE_BUFFER array through getStorageSet(), for instanced draws that
+/// index their data with gl_InstanceIndex instead of binding an offset per draw. getRegionOffset() turns an allocation's
+/// dynamic offset into where it sits in that array. Region starts are aligned to minAlignment, so pass the larger of
+/// the uniform and storage offset alignments.
+///
+/// allocate() may be called from any thread between beginFrame() and endFrame(); the rest belongs to the thread that
+/// drives the frame.
+/// </summary>
+class UniformRing {
+public:
+	/// <summary>
+	/// range is the most one draw reads through the descriptor and bytesPerFrame the size of each frame's region.
+	/// </summary>
+	void init(VkDevice device, DeviceMemoryAllocator& allocator, uint32_t framesInFlight, VkDeviceSize bytesPerFrame,
+		VkDeviceSize minAlignment, VkDeviceSize range, VkShaderStageFlags stages);
+	void cleanup();
+
+	/// <summary>
+	/// Start writing frameIndex's region. Only valid once the GPU is done with what that frame wrote last time.
+	/// </summary>
+	void beginFrame(uint32_t frameIndex);
+
+	/// <summary>
+	/// Make the frame's writes visible to the device. Call before submitting the command buffers that read them.
+	/// </summary>
+	void endFrame();
+
+	/// <summary>
+	/// Reserve count slots of stride bytes each in the current frame's region, stride being a multiple of getAlignment().
+	/// Returns where the first one is mapped; its dynamic offset comes back through dynamicOffset. Throws when the region
+	/// is full.
+	/// </summary>
+	void* allocate(VkDeviceSize stride, uint32_t count, uint32_t& dynamicOffset);
+
+	/// <summary>
+	/// sizeof(T) rounded up to the offset alignment, the stride to pass to allocate() for an array of T.
+	/// </summary>
+	template <typename T>
+	VkDeviceSize getStride() const {
+		return (sizeof(T) + alignment - 1) / alignment * alignment;
+	}
+
+	VkDeviceSize getAlignment() const {
+		return alignment;
+	}
+
+	/// <summary>
+	/// Bytes each frame's region holds, the most allocate() hands out between beginFrame() and endFrame().
+	/// </summary>
+	VkDeviceSize getRegionSize() const {
+		return regionSize;
+	}
+
+	VkDescriptorSetLayout getSetLayout() const {
+		return setLayout;
+	}
+
+	VkDescriptorSet getSet() const {
+		return set;
+	}
+
+	VkDescriptorSetLayout getStorageSetLayout() const {
+		return storageSetLayout;
+	}
+
+	/// <summary>
+	/// The current frame's whole region as a storage buffer.
+	/// </summary>
+	VkDescriptorSet getStorageSet() const {
+		return storageSets[frameIndex];
+	}
+
+	/// <summary>
+	/// Byte offset of an allocation from the start of its frame's region, what the storage set sees it at.
+	/// </summary>
+	VkDeviceSize getRegionOffset(uint32_t dynamicOffset) const {
+		return dynamicOffset % regionSize;
+	}
+
+	/// <summary>
+	/// Bytes handed out in the current frame so far, alignment padding included.
+	/// </summary>
+	VkDeviceSize getBytesWritten() const {
+		return head.load(std::memory_order_relaxed);
+	}
+
+	UniformRingStats getStats() const {
+		return stats;
+	}
+
+	void printStats(std::ostream& out) const;
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	DeviceMemoryAllocator* allocator = nullptr;
+
+	VkBuffer buffer = VK_NULL_HANDLE;
+	Allocation allocation;
+	VkDeviceSize regionSize = 0;
+	VkDeviceSize alignment = 1;
+
+	VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	VkDescriptorSetLayout storageSetLayout = VK_NULL_HANDLE;
+	std::vector<VkDescriptorSet> storageSets; // One per frame in flight, each covering its region
+
+	uint32_t frameIndex = 0;
+	bool inFrame = false;
+	std::atomic<VkDeviceSize> head{ 0 }; // Offset into the current region
+	UniformRingStats stats;
+};
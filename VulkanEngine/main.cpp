@@ -1,101 +1,431 @@
 #define GLFW_INCLUDE_VULKAN // This define is needed for glfw3.h to import vulkan/vulkan.h
 #include <GLFW/glfw3.h>
 
+#include <glm/glm.hpp>
+
+#include "AssetFile.h"
+#include "BenchmarkSuite.h"
+#include "BindlessDescriptors.h"
+#include "BoundingVolumeHierarchy.h"
+#include "CapabilityRegistry.h"
+#include "DebugUtils.h"
+#include "DeletionQueue.h"
+#include "DeviceMemoryAllocator.h"
+#include "DeviceSelector.h"
+#include "DynamicState.h"
+#include "DrawBatcher.h"
+#include "EngineConfig.h"
+#include "FrameArena.h"
+#include "FrameCommandPools.h"
+#include "FrustumCulling.h"
+#include "GpuCulling.h"
+#include "GpuMesh.h"
+#include "JobSystem.h"
+#include "MeshletRenderer.h"
+#include "PipelineCache.h"
+#include "PipelineCompiler.h"
+#include "PipelineLayoutCache.h"
+#include "Profiler.h"
+#include "RenderGraph.h"
+#include "SceneStore.h"
+#include "ShaderReflection.h"
+#include "ShaderWatcher.h"
+#include "Simulation.h"
+#include "StagingRing.h"
+#include "StartupTimeline.h"
+#include "TextureStreamer.h"
+#include "UniformRing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 #include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iomanip>
 #include <inttypes.h>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <set>
 #include <stdexcept>
+#include <string>
+#include <thread>
 #include <vector>
 
-const uint32_t WIDTH = 800;
-const uint32_t HEIGHT = 600;
-
 const std::vector<const char*> validationLayers = {
 	"VK_LAYER_KHRONOS_validation"
 };
 
-#ifdef NDEBUG
-const bool enableValidationLayers = false;
-#else
-const bool enableValidationLayers = true;
-#endif
+const std::vector<const char*> deviceExtensions = {
+	VK_KHR_SWAPCHAIN_EXTENSION_NAME
+};
+
+// Size of the material table. Draw i uses material i % MATERIAL_COUNT, material 0 is plain white.
+const uint32_t MATERIAL_COUNT = 256;
+
+// Distance from the triangle's origin to its farthest vertex, (0.5, 0.5), before scaling
+const float TRIANGLE_BOUNDING_RADIUS = 0.7072f;
+
+// The screen in clip space as inward facing planes, what the GPU driven path culls against until there is a camera
+const glm::vec4 SCREEN_PLANES[4] = {
+	glm::vec4(1.0f, 0.0f, 0.0f, 1.0f),
+	glm::vec4(-1.0f, 0.0f, 0.0f, 1.0f),
+	glm::vec4(0.0f, 1.0f, 0.0f, 1.0f),
+	glm::vec4(0.0f, -1.0f, 0.0f, 1.0f)
+};
+
+// The same as a frustum for the CPU path, with z kept to the clip volume
+const Frustum SCREEN_FRUSTUM = { {
+	SCREEN_PLANES[0],
+	SCREEN_PLANES[1],
+	SCREEN_PLANES[2],
+	SCREEN_PLANES[3],
+	glm::vec4(0.0f, 0.0f, 1.0f, 0.0f),
+	glm::vec4(0.0f, 0.0f, -1.0f, 1.0f)
+} };
+
+// Below this many draws per secondary command buffer, the cost of the extra buffer outweighs recording in parallel
+const uint32_t MIN_DRAWS_PER_SECONDARY = 64;
+
+// Validation comes and goes with the rest of the debug utils plumbing
+const bool enableValidationLayers = DEBUG_UTILS_ENABLED;
 
 /// <summary>
-/// Ensure all validation layers we wish to use are available to use.
+/// Sleep until deadline. The last couple of milliseconds are spun out instead, a plain sleep can overshoot by a whole
+/// scheduler tick, which at a few hundred frames per second is most of a frame.
 /// </summary>
-/// <returns></returns>
-bool checkValidationLayerSupport() {
-	uint32_t layerCount;
-	vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
-
-	std::vector<VkLayerProperties> availableLayers(layerCount);
-	vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
-
-	for (const char* layerName : validationLayers) {
-		bool layerFound = false;
-		for (const auto& layerProperties : availableLayers) {
-			if (strcmp(layerName, layerProperties.layerName)) {
-				layerFound = true;
-				break;
-			}
-		}
+static void sleepUntil(std::chrono::steady_clock::time_point deadline) {
+	const auto spinMargin = std::chrono::milliseconds(2);
+	if (deadline - std::chrono::steady_clock::now() > spinMargin) {
+		std::this_thread::sleep_until(deadline - spinMargin);
+	}
+	while (std::chrono::steady_clock::now() < deadline) {
+		std::this_thread::yield();
+	}
+}
 
-		if (!layerFound) {
-			return false;
-		}
+static const char* presentModeName(VkPresentModeKHR mode) {
+	switch (mode) {
+	case VK_PRESENT_MODE_IMMEDIATE_KHR:
+		return "immediate";
+	case VK_PRESENT_MODE_MAILBOX_KHR:
+		return "mailbox";
+	case VK_PRESENT_MODE_FIFO_KHR:
+		return "fifo";
+	case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+		return "fifo-relaxed";
+	default:
+		return "other";
+	}
+}
+
+/// <summary>
+/// Read a whole binary file (compiled SPIR-V shaders) into memory.
+/// </summary>
+static std::vector<char> readFile(const std::string& filename) {
+	// Start reading at the end so tellg() gives us the file size
+	std::ifstream file(filename, std::ios::ate | std::ios::binary);
+
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open file " + filename + "!");
 	}
 
-	return true;
+	size_t fileSize = static_cast<size_t>(file.tellg());
+	std::vector<char> buffer(fileSize);
+
+	file.seekg(0);
+	file.read(buffer.data(), fileSize);
+
+	return buffer;
 }
 
+/// <summary>
+/// Every SPIR-V binary the engine can load. The order matches SHADER_SOURCES.
+/// </summary>
+enum class ShaderVariant {
+	Vert,
+	VertBindless,
+	VertInstanced,
+	VertInstancedBindless,
+	Frag,
+	IndirectVert,
+	Cull,
+	IndirectMeshVert,
+	MeshletTask,
+	MeshletMesh,
+	FragStreamed
+};
+
+/// <summary>
+/// Where each ShaderVariant comes from. Has to match the shader build step in VulkanEngine.vcxproj (and compile.bat),
+/// since shader hot reload recompiles with exactly these.
+/// </summary>
+static const ShaderSource SHADER_SOURCES[] = {
+	{ "shaders/shader.vert", {}, "shaders/vert.spv" },
+	{ "shaders/shader.vert", { "BINDLESS" }, "shaders/vert_bindless.spv" },
+	{ "shaders/shader.vert", { "INSTANCED" }, "shaders/vert_instanced.spv" },
+	{ "shaders/shader.vert", { "INSTANCED", "BINDLESS" }, "shaders/vert_instanced_bindless.spv" },
+	{ "shaders/shader.frag", {}, "shaders/frag.spv" },
+	{ "shaders/indirect.vert", {}, "shaders/indirect_vert.spv" },
+	{ "shaders/cull.comp", {}, "shaders/cull.spv" },
+	{ "shaders/indirect.vert", { "MESH" }, "shaders/indirect_mesh_vert.spv" },
+	{ "shaders/meshlet.task", {}, "shaders/meshlet_task.spv", "vulkan1.2" }, // SPIR-V 1.4 or later for mesh shaders
+	{ "shaders/meshlet.mesh", {}, "shaders/meshlet_mesh.spv", "vulkan1.2" },
+	{ "shaders/shader.frag", { "STREAMED_TEXTURES" }, "shaders/frag_streamed.spv" }
+};
+
+/// <summary>
+/// What a graphics pipeline draws, which decides its vertex input and which way its front faces wind.
+/// </summary>
+enum class PipelineGeometry {
+	Triangle, // Hardcoded in the vertex shader, clockwise on screen
+	MeshVertices, // AssetVertex at binding 0, counter-clockwise on screen like the cooked meshes seen from +z
+	Meshlets // Task and mesh shaders that fetch the mesh themselves, wound like MeshVertices
+};
+
+/// <summary>
+/// One shader of a graphics pipeline, with its own copy of the SPIR-V for the pipeline compiler's workers.
+/// </summary>
+struct PipelineStage {
+	VkShaderStageFlagBits stage;
+	std::vector<char> code;
+};
+
+/// <summary>
+/// Queue families we need from a physical device. Graphics and present may or may not be the same family.
+/// </summary>
+struct QueueFamilyIndices {
+	std::optional<uint32_t> graphicsFamily;
+	std::optional<uint32_t> presentFamily;
+	std::optional<uint32_t> transferFamily; // Most specialised family that can copy, the graphics family if there is nothing better
+	std::optional<uint32_t> computeFamily; // Compute without graphics, for async compute. Unset when there is none to spare
+	uint32_t computeQueueIndex = 0; // 1 when the compute family is also the transfer family, whose queue 0 carries uploads
+
+	bool isComplete() const {
+		return graphicsFamily.has_value() && presentFamily.has_value();
+	}
+};
+
+/// <summary>
+/// Everything we need to know about a surface to build a swap chain for it.
+/// </summary>
+struct SwapChainSupportDetails {
+	VkSurfaceCapabilitiesKHR capabilities;
+	std::vector<VkSurfaceFormatKHR> formats;
+	std::vector<VkPresentModeKHR> presentModes;
+};
+
+/// <summary>
+/// Per draw data, written into the uniform ring every frame and picked by each draw's dynamic offset. std140 layout, has
+/// to match the ObjectUniforms block in shader.vert.
+/// </summary>
+struct ObjectUniforms {
+	glm::vec2 offset;
+	float scale;
+	uint32_t materialIndex;
+};
+
+/// <summary>
+/// Same for every draw, pushed once per command buffer. Layout has to match the push_constant block in shader.vert.
+/// </summary>
+struct DrawPushConstants {
+	uint32_t materialBufferIndex; // Bindless slot of the material table, 0 on the classic path
+};
+
+/// <summary>
+/// One entry of the material table. Layout has to match the Material struct in shader.vert.
+/// </summary>
+struct MaterialData {
+	glm::vec4 color;
+};
+
+/// <summary>
+/// Resources owned by a single frame in flight. The CPU only touches a frame's resources again once its fence has signalled,
+/// which is what lets frame N+1 be recorded while the GPU is still busy with frame N.
+/// </summary>
+struct FrameData {
+	FrameCommandPools commandPools; // One pool per job system thread, reset together at the start of the frame
+	FrameArena arena; // CPU memory that only has to live until this frame slot comes round again, reset with commandPools
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE; // This frame's primary, re-acquired from commandPools every frame
+	VkSemaphore imageAvailableSemaphore = VK_NULL_HANDLE; // Signalled by the presentation engine once the acquired image can be rendered to
+	VkFence inFlightFence = VK_NULL_HANDLE; // Signalled by the GPU once this frame's submission has finished executing
+	RenderGraph renderGraph; // Rebuilt every frame; its transient images are only reused once this slot's fence has signalled
+
+	// Only with async compute. The graphics submission waits on the compute one, so inFlightFence covers both.
+	FrameCommandPools computeCommandPools;
+	VkCommandBuffer computeCommandBuffer = VK_NULL_HANDLE;
+	VkSemaphore computeFinishedSemaphore = VK_NULL_HANDLE;
+};
+
 class HelloTriangleApplication {
 public:
+	explicit HelloTriangleApplication(const EngineConfig& config = EngineConfig{}) : config(config) {}
+
 private:
-	GLFWwindow* window;
+	EngineConfig config;
+	std::unique_ptr<JobSystem> jobSystem;
+
+	StartupTimeline startupTimeline;
+	std::mutex startupErrorMutex;
+	std::exception_ptr startupError; // First exception thrown by a startup task, rethrown on the main thread
+
+	GLFWwindow* window = nullptr; // Stays null when headless
 	VkInstance instance; // Handles connection between application and vulkan library
+	uint32_t instanceApiVersion = VK_API_VERSION_1_0; // What createInstance() asked for, capped by what the loader has
+	VkSurfaceKHR surface = VK_NULL_HANDLE; // Stays null when headless
+
+	CapabilityRegistry capabilities; // Layers and instance extensions before createInstance(), device extensions during device enumeration
+	DebugUtils debugUtils; // Messenger, object names and labels; compiles to nothing in release builds
+
+	DeviceSelector deviceSelector; // Every physical device and device group, enumerated before the surface exists
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	std::vector<VkPhysicalDevice> deviceGroup; // What the logical device spans: physicalDevice, or its whole group with deviceGroupMode
+	DeviceGroupMode deviceGroupMode = DeviceGroupMode::None; // --device-group, if the device has a group to spread frames over
+	uint32_t frameDeviceMask = 1; // Devices of deviceGroup the frame being recorded runs on, see updateFrameDevices()
+	uint32_t frameDeviceIndex = 0; // The first of them, which takes the frame's semaphore operations
+	uint32_t frameSemaphoreDeviceIndices[4] = {}; // frameDeviceIndex for each, the most waits or signals a submission has
+	VkDevice device;
+	VkQueue graphicsQueue;
+	VkQueue presentQueue;
+	VkQueue transferQueue; // Same as graphicsQueue when the device has no better family for copies
+	VkQueue computeQueue = VK_NULL_HANDLE; // Only with asyncComputeEnabled
+	bool pipelineCreationFeedbackSupported = false;
+	bool bindlessEnabled = false; // --bindless was asked for and the device has the descriptor indexing features it needs
+	bool gpuDrivenEnabled = false; // --gpu-driven (or --mesh-shaders falling back) and the device can draw indirect with a GPU written count
+	bool meshShadersEnabled = false; // --mesh-shaders was asked for and the device has task and mesh shaders
+	bool drawBatchingEnabled = false; // Draw batching wasn't turned off and the CPU recorded path is the one drawing
+	bool pipelineStatisticsEnabled = false; // --pipeline-statistics was asked for and the device has pipelineStatisticsQuery
+	bool inheritedQueriesEnabled = false; // With pipelineStatisticsEnabled, secondaries may run inside the render pass scope's query
+	bool asyncComputeEnabled = false; // Async compute wasn't turned off and the device has a compute-only family for it
+	bool synchronization2Enabled = false; // The device has VK_KHR_synchronization2, so the render graph records vkCmdPipelineBarrier2
+	bool textureStreamingEnabled = false; // --texture-budget, the mesh is drawn on a GPU path and the device can sample and report from fragments
+	bool memoryBudgetEnabled = false; // The device has VK_EXT_memory_budget, only looked for with textureStreamingEnabled
+
+	DeviceMemoryAllocator memoryAllocator; // Every buffer and image gets its memory from here, never from vkAllocateMemory directly
+	StagingRing stagingRing; // Every upload to device local memory goes through here
+	DeletionQueue deletionQueue; // Whatever is released mid run, destroyed once the frames in flight are done with it
+	DynamicState dynamicState; // What --dynamic-rendering got from the device; without the flag everything stays baked
+	UniformRing uniformRing; // Per draw uniforms, a region per frame in flight bound through one dynamic offset set
+	Profiler profiler; // GPU and CPU scopes of every frame, shown in the window title
+
+	VkSwapchainKHR swapChain = VK_NULL_HANDLE; // Stays null when headless, swapChainImages then holds the offscreen target
+	bool framebufferResized = false; // Set by the GLFW callback, the driver doesn't have to report OUT_OF_DATE on resize
+	Allocation offscreenAllocation;
+	std::vector<VkImage> swapChainImages;
+	VkFormat swapChainImageFormat;
+	VkExtent2D swapChainExtent;
+	std::vector<VkImageView> swapChainImageViews;
+	std::vector<VkFramebuffer> swapChainFramebuffers;
+
+	std::vector<char> vertShaderCode;
+	std::vector<char> vertBindlessShaderCode; // Only loaded with --bindless
+	std::vector<char> instancedVertShaderCode; // Only loaded with draw batching
+	std::vector<char> instancedVertBindlessShaderCode; // Only loaded with draw batching and --bindless
+	std::vector<char> fragShaderCode;
+	std::vector<char> indirectVertShaderCode; // Only loaded with --gpu-driven
+	std::vector<char> cullShaderCode;
+	std::vector<char> indirectMeshVertShaderCode; // Only loaded with --mesh, on the paths that can fall back to GPU driven
+	std::vector<char> meshletTaskShaderCode; // Only loaded with --mesh-shaders
+	std::vector<char> meshletMeshShaderCode;
+	std::vector<char> fragStreamedShaderCode; // Only loaded with --texture-budget
+
+	BindlessDescriptors bindlessDescriptors; // Only initialized when bindlessEnabled
+
+	// Classic path: one set holding just the material table, its layout reflected from the vertex shader
+	VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+	VkBuffer materialBuffer = VK_NULL_HANDLE;
+	Allocation materialAllocation;
+	uint32_t materialBufferIndex = 0; // Slot in bindlessDescriptors' storage buffer array
+
+	PipelineCache pipelineCache; // Loaded from disk before any pipeline is built, written back in cleanup()
+	PipelineLayoutCache pipelineLayoutCache; // Owns the classic set layout and every graphics pipeline layout
+	ShaderWatcher shaderWatcher; // Only started with --hot-reload-shaders
+	PipelineCompiler pipelineCompiler; // Owns the graphics pipelines, builds all but the draw pipeline in the background
+	VkRenderPass renderPass = VK_NULL_HANDLE; // Stays null with dynamic rendering
+	VkPipelineLayout pipelineLayout;
+	VkPipeline graphicsPipeline; // The pipelines below are this frame's, from pipelineCompiler, null while they compile
+	uint32_t graphicsPipelineId = PipelineCompiler::INVALID_ID;
+
+	// Draw batching: same shaders reading per instance data through the uniform ring's storage view
+	VkPipelineLayout instancedPipelineLayout = VK_NULL_HANDLE;
+	VkPipeline instancedPipeline = VK_NULL_HANDLE;
+	uint32_t instancedPipelineId = PipelineCompiler::INVALID_ID;
+
+	GpuCulling gpuCulling; // Only initialized when gpuDrivenEnabled
+	VkPipelineLayout indirectPipelineLayout = VK_NULL_HANDLE;
+	VkPipeline indirectPipeline = VK_NULL_HANDLE;
+	uint32_t indirectPipelineId = PipelineCompiler::INVALID_ID;
+
+	GpuMesh gpuMesh; // Only initialized with --mesh on the GPU driven or mesh shader path
+	MeshletRenderer meshletRenderer; // Only initialized when meshShadersEnabled
+	TextureStreamer textureStreamer; // Only initialized when textureStreamingEnabled
+	VkPipelineLayout meshletPipelineLayout = VK_NULL_HANDLE;
+	VkPipeline meshletPipeline = VK_NULL_HANDLE;
+	uint32_t meshletPipelineId = PipelineCompiler::INVALID_ID;
+
+	SceneStore scene; // A root holding the grid, with one child per draw
+	std::vector<ObjectUniforms> draws; // Entity i + 1 of scene
+	BoundingVolumeHierarchy sceneBvh; // Only with CpuCulling::Bvh
+	std::vector<uint32_t> visibleDraws; // What the CPU path records this frame, indices into draws
+	Simulation simulation; // Only started with config.simulationThreads on the CPU recorded path
+	DrawBatcher drawBatcher; // visibleDraws sorted and merged into instanced draws, only with draw batching
+
+	std::vector<FrameData> frames;
+	std::vector<VkSemaphore> renderFinishedSemaphores; // One per swap chain image, since presentation may still be waiting on it when a frame slot is reused
+	std::vector<VkFence> imagesInFlight; // Fence of the frame currently using each swap chain image (or VK_NULL_HANDLE)
+	uint32_t currentFrame = 0;
+	uint64_t framesSubmitted = 0;
+
+	BenchmarkResult benchmarkResult;
 
 public:
 	void run() {
-		initWindow();
-		initVulkan();
+		jobSystem = std::make_unique<JobSystem>(config.threadCount);
+		startup();
 		mainLoop();
 		cleanup();
 	}
 
+	/// <summary>
+	/// Frame times and memory of the run, filled in once mainLoop() is done.
+	/// </summary>
+	const BenchmarkResult& getBenchmarkResult() const {
+		return benchmarkResult;
+	}
+
 private:
 	void initWindow() {
-		glfwInit();
-
 		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API); // Tells GLFW to not create an OpenGL context
-		glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE); // Self explanatory
 
-		window = glfwCreateWindow(WIDTH, HEIGHT, "Vulkan", nullptr, nullptr);
+		window = glfwCreateWindow(static_cast<int>(config.windowWidth), static_cast<int>(config.windowHeight), "Vulkan", nullptr, nullptr);
+		glfwSetWindowUserPointer(window, this);
+		glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+	}
+
+	static void framebufferResizeCallback(GLFWwindow* window, int, int) {
+		static_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(window))->framebufferResized = true;
 	}
 
 	/// <summary>
-	/// Print out which extensions are available, needed, and not found.
+	/// Ensure all validation layers we wish to use are available to use.
 	/// </summary>
-	void hasExensions(const std::vector<VkExtensionProperties> &availableExtensions, const char** neededExtensions, int16_t neededExtensionsCount) {
-		std::cout << "Available extensions:\n";
-		for (const auto& extension : availableExtensions) {
-			std::cout << '\t' << extension.extensionName << '\n';
-		}
-
-		std::cout << "Needed extensions:\n";
-		for (auto i = 0; i < neededExtensionsCount; i++) {
-			const char *neededExtension = neededExtensions[i];
-			bool foundMatch = false;
-			for (const auto& extension : availableExtensions) {
-				if (strcmp(neededExtension, extension.extensionName)) {
-					std::cout << '\t' << neededExtension << " FOUND" << '\n';
-					foundMatch = true;
-					break;
-				}
-			}
-			if (!foundMatch) {
-				std::cout << '\t' << neededExtension << " NOT FOUND" << '\n';
+	bool checkValidationLayerSupport() {
+		for (const char* layerName : validationLayers) {
+			if (!capabilities.hasLayer(layerName)) {
+				return false;
 			}
 		}
+
+		return true;
 	}
 
 	/// <summary>
@@ -104,6 +434,8 @@ private:
 	/// Creating it involves specifying some details about this application to the driver.
 	/// </summary>
 	void createInstance() {
+		capabilities.queryInstance();
+
 		if (enableValidationLayers && !checkValidationLayerSupport()) {
 			throw std::runtime_error("Validation layers requested, but not available!");
 		}
@@ -116,7 +448,10 @@ private:
 		appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 		appInfo.pEngineName = "No Engine";
 		appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-		appInfo.apiVersion = VK_API_VERSION_1_0;
+		// Descriptor indexing needs 1.2 (or 1.1 plus the extension), and --dynamic-rendering is core in 1.3; ask for as much
+		// of that as the loader can give
+		instanceApiVersion = std::min(capabilities.getInstanceVersion(), VK_API_VERSION_1_3);
+		appInfo.apiVersion = instanceApiVersion;
 
 		// Create VKInstanceCreateInfo
 		VkInstanceCreateInfo createInfo{};
@@ -124,12 +459,27 @@ private:
 		createInfo.pApplicationInfo = &appInfo;
 
 		uint32_t glfwExtensionCount = 0;
-		const char** glfwExtensions;
+		const char** glfwExtensions = nullptr;
+
+		// Without a window there is no surface, so no window system extensions either
+		if (!config.headless) {
+			glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+		}
+
+		for (uint32_t i = 0; i < glfwExtensionCount; i++) {
+			if (!capabilities.hasInstanceExtension(glfwExtensions[i])) {
+				throw std::runtime_error(std::string("Missing required instance extension ") + glfwExtensions[i] + "!");
+			}
+		}
 
-		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+		std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+		createInfo.pNext = debugUtils.prepareInstance(capabilities, config, enableValidationLayers, extensions);
+		if (!DEBUG_UTILS_ENABLED && (config.gpuAssistedValidation || config.synchronizationValidation)) {
+			std::cout << "Release build: --gpu-validation and --sync-validation are ignored" << std::endl;
+		}
 
-		createInfo.enabledExtensionCount = glfwExtensionCount;
-		createInfo.ppEnabledExtensionNames = glfwExtensions;
+		createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+		createInfo.ppEnabledExtensionNames = extensions.data();
 		createInfo.enabledLayerCount = 0;
 
 		if (enableValidationLayers) {
@@ -139,44 +489,2856 @@ private:
 			createInfo.enabledLayerCount = 0;
 		}
 
-		// Create VkInstance
-		uint32_t extensionCount = 0;
-		vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
-		std::vector<VkExtensionProperties> extensions(extensionCount);
-		vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
-
-		hasExensions(extensions, glfwExtensions, glfwExtensionCount);
-
 		if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
 			throw std::runtime_error("Failed to create instance!");
 		}
+		debugUtils.init(instance);
 	}
 
-	void initVulkan() {
-		createInstance();
+	/// <summary>
+	/// The surface is the window system integration point; it has to exist before physical device selection
+	/// because presentation support is a property of a (queue family, surface) pair.
+	/// </summary>
+	void createSurface() {
+		if (glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create window surface!");
+		}
 	}
 
-	void mainLoop() {
-		while (!glfwWindowShouldClose(window)) {
-			glfwPollEvents();
+	QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device) {
+		QueueFamilyIndices indices;
+
+		uint32_t queueFamilyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+
+		for (uint32_t i = 0; i < queueFamilyCount; i++) {
+			if (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+				indices.graphicsFamily = i;
+			}
+
+			// Nothing gets presented when headless, so the graphics family stands in
+			VkBool32 presentSupport = false;
+			if (config.headless) {
+				presentSupport = (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+			} else {
+				vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+			}
+			if (presentSupport) {
+				indices.presentFamily = i;
+			}
+
+			if (indices.isComplete()) {
+				break;
+			}
+		}
+
+		// Transfer-only families are backed by the copy engines and run alongside rendering. Failing that, anything
+		// that isn't the graphics family still keeps uploads out of the frame's way.
+		int bestTransferScore = -1;
+		for (uint32_t i = 0; i < queueFamilyCount; i++) {
+			const VkQueueFlags flags = queueFamilies[i].queueFlags;
+			if (!(flags & (VK_QUEUE_TRANSFER_BIT | VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+				continue;
+			}
+
+			const int score = (flags & VK_QUEUE_GRAPHICS_BIT) ? 0 : (flags & VK_QUEUE_COMPUTE_BIT) ? 1 : 2;
+			if (score > bestTransferScore) {
+				bestTransferScore = score;
+				indices.transferFamily = i;
+			}
+		}
+		// An ownership acquire recorded into one device's frame wouldn't cover the other devices' instances of the resources
+		if (bestTransferScore <= 0 || deviceGroupMode != DeviceGroupMode::None) {
+			indices.transferFamily = indices.graphicsFamily;
+		}
+
+		// Compute-only families are the async compute engines. Staging flushes can come from any thread, so sharing the
+		// transfer family only works with a second queue in it.
+		for (uint32_t i = 0; i < queueFamilyCount; i++) {
+			const VkQueueFlags flags = queueFamilies[i].queueFlags;
+			if (!(flags & VK_QUEUE_COMPUTE_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT)) {
+				continue;
+			}
+			if (i != indices.transferFamily) {
+				indices.computeFamily = i;
+				indices.computeQueueIndex = 0;
+				break;
+			}
+			if (queueFamilies[i].queueCount > 1 && !indices.computeFamily.has_value()) {
+				indices.computeFamily = i;
+				indices.computeQueueIndex = 1;
+			}
 		}
+
+		return indices;
 	}
 
-	void cleanup() {
-		vkDestroyInstance(instance, nullptr);
-		glfwDestroyWindow(window);
-		glfwTerminate();
+	/// <summary>
+	/// The swap chain extension is only required when there is something to present to.
+	/// </summary>
+	std::vector<const char*> getRequiredDeviceExtensions() const {
+		return config.headless ? std::vector<const char*>{} : deviceExtensions;
 	}
-};
 
-int main() {
-	HelloTriangleApplication app;
-	try {
-		app.run();
-	} catch (const std::exception &e) {
-		std::cerr << e.what() << std::endl;
-		return EXIT_FAILURE;
+	bool checkDeviceExtensionSupport(VkPhysicalDevice device) {
+		for (const char* extensionName : getRequiredDeviceExtensions()) {
+			if (!capabilities.hasDeviceExtension(device, extensionName)) {
+				return false;
+			}
+		}
+
+		return true;
 	}
 
-	return EXIT_SUCCESS;
-}
\ No newline at end of file
+	SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device) {
+		SwapChainSupportDetails details;
+
+		vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &details.capabilities);
+
+		uint32_t formatCount;
+		vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, nullptr);
+		details.formats.resize(formatCount);
+		vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, details.formats.data());
+
+		uint32_t presentModeCount;
+		vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, nullptr);
+		details.presentModes.resize(presentModeCount);
+		vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, details.presentModes.data());
+
+		return details;
+	}
+
+	/// <summary>
+	/// Why the engine can't run on the device at all, empty if it can.
+	/// </summary>
+	std::string getUnsuitableReason(VkPhysicalDevice device) {
+		for (const char* extensionName : getRequiredDeviceExtensions()) {
+			if (!capabilities.hasDeviceExtension(device, extensionName)) {
+				return std::string("no ") + extensionName;
+			}
+		}
+
+		QueueFamilyIndices indices = findQueueFamilies(device);
+		if (!indices.graphicsFamily.has_value()) {
+			return "no graphics queue family";
+		}
+		if (!indices.presentFamily.has_value()) {
+			return "no queue family that can present to the window";
+		}
+
+		if (!config.headless) {
+			SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
+			if (swapChainSupport.formats.empty() || swapChainSupport.presentModes.empty()) {
+				return "no surface formats or present modes for the window";
+			}
+		}
+
+		// The staging ring tracks upload completion with a timeline semaphore
+		if (!capabilities.getTimelineSemaphoreFeatures(device).timelineSemaphore) {
+			return "no timeline semaphores";
+		}
+
+		return "";
+	}
+
+	/// <summary>
+	/// How many of the optional paths the config turned on the device can run rather than fall back from. Async compute
+	/// isn't counted, the selector already scores the queue families it needs.
+	/// </summary>
+	uint32_t countPreferredFeatures(VkPhysicalDevice device) {
+		uint32_t count = 0;
+		if (config.bindless && isBindlessSupported(device)) {
+			count++;
+		}
+		if (config.gpuDriven && isGpuDrivenSupported(device)) {
+			count++;
+		}
+		if (config.meshShaders && isMeshShaderSupported(device)) {
+			count++;
+		}
+		if (config.pipelineStatistics && capabilities.getDeviceFeatures(device).pipelineStatisticsQuery) {
+			count++;
+		}
+		return count;
+	}
+
+	/// <summary>
+	/// The half of device selection that doesn't need a surface: find every GPU and device group and query what they
+	/// support. Runs on a worker as soon as the instance exists, while the main thread is still creating the window.
+	/// </summary>
+	void enumeratePhysicalDevices() {
+		deviceSelector.init(instance, instanceApiVersion);
+
+		for (const auto& device : deviceSelector.getDevices()) {
+			capabilities.queryDevice(device, instanceApiVersion);
+		}
+	}
+
+	/// <summary>
+	/// Score every GPU against the surface and the config and take the best one, or the one --device asked for. Then decide
+	/// whether frames are spread over the rest of its device group.
+	/// </summary>
+	void pickPhysicalDevice() {
+		for (const auto& device : deviceSelector.getDevices()) {
+			deviceSelector.addCandidate(device, capabilities, getUnsuitableReason(device), countPreferredFeatures(device));
+		}
+		physicalDevice = deviceSelector.select(config.device);
+		if (config.printCapabilities) {
+			deviceSelector.printRanking(std::cout);
+		}
+
+		deviceGroup = { physicalDevice };
+		if (config.deviceGroup == DeviceGroupMode::None) {
+			return;
+		}
+
+		// Devices in a group are normally the same model, but each one gets the same features enabled so check them all
+		const std::vector<VkPhysicalDevice> group = deviceSelector.getGroup(physicalDevice);
+		const bool groupUsable = std::all_of(group.begin(), group.end(), [this](VkPhysicalDevice device) {
+			return deviceSelector.getCandidate(device).rejectReason.empty();
+		});
+		if (group.size() < 2) {
+			std::cout << "Device groups requested, but the device isn't linked to another one; rendering on it alone" << std::endl;
+			return;
+		}
+		if (!groupUsable) {
+			std::cout << "Device groups requested, but a device in the group can't run the engine; rendering on one alone" << std::endl;
+			return;
+		}
+
+		deviceGroup = group;
+		deviceGroupMode = config.deviceGroup;
+
+		// Every device of a split frame would run the GPU cull and add into the one host visible draw count
+		const bool cullsOnGpu = config.gpuDriven || (config.meshShaders && !isMeshShaderSupported(physicalDevice));
+		if (deviceGroupMode == DeviceGroupMode::SplitFrame && cullsOnGpu) {
+			std::cout << "Split frame rendering can't share the GPU driven cull between devices; alternating frames instead" << std::endl;
+			deviceGroupMode = DeviceGroupMode::AlternateFrame;
+		}
+		if (deviceGroupMode == DeviceGroupMode::AlternateFrame && config.framesInFlight < deviceGroup.size()) {
+			std::cout << "Alternate frame rendering over " << deviceGroup.size() << " devices with only " << config.framesInFlight
+				<< " frames in flight leaves some of them idle; raise --frames-in-flight" << std::endl;
+		}
+	}
+
+	/// <summary>
+	/// Which devices of the group run the frame about to be recorded: the next one in turn when alternating frames, every
+	/// one when splitting them. Without a device group the masks aren't chained into anything.
+	/// </summary>
+	void updateFrameDevices() {
+		const uint32_t deviceCount = static_cast<uint32_t>(deviceGroup.size());
+		if (deviceGroupMode == DeviceGroupMode::AlternateFrame) {
+			frameDeviceIndex = static_cast<uint32_t>(framesSubmitted % deviceCount);
+			frameDeviceMask = 1u << frameDeviceIndex;
+		} else {
+			frameDeviceIndex = 0;
+			frameDeviceMask = deviceCount >= 32 ? ~0u : (1u << deviceCount) - 1;
+		}
+		std::fill(std::begin(frameSemaphoreDeviceIndices), std::end(frameSemaphoreDeviceIndices), frameDeviceIndex);
+	}
+
+	/// <summary>
+	/// Chain the device group part of a frame's submission onto submitInfo: its command buffer runs on frameDeviceMask and
+	/// every wait and signal on frameDeviceIndex. groupInfo has to live until the submit.
+	/// </summary>
+	void chainDeviceGroupSubmit(VkSubmitInfo& submitInfo, VkDeviceGroupSubmitInfo& groupInfo) {
+		if (deviceGroupMode == DeviceGroupMode::None) {
+			return;
+		}
+		if (submitInfo.waitSemaphoreCount > 4 || submitInfo.signalSemaphoreCount > 4 || submitInfo.commandBufferCount != 1) {
+			throw std::logic_error("Frame submission with more semaphores or command buffers than the device group masks cover!");
+		}
+
+		groupInfo.sType = VK_STRUCTURE_TYPE_DEVICE_GROUP_SUBMIT_INFO;
+		groupInfo.pNext = submitInfo.pNext;
+		groupInfo.waitSemaphoreCount = submitInfo.waitSemaphoreCount;
+		groupInfo.pWaitSemaphoreDeviceIndices = frameSemaphoreDeviceIndices;
+		groupInfo.commandBufferCount = submitInfo.commandBufferCount;
+		groupInfo.pCommandBufferDeviceMasks = &frameDeviceMask;
+		groupInfo.signalSemaphoreCount = submitInfo.signalSemaphoreCount;
+		groupInfo.pSignalSemaphoreDeviceIndices = frameSemaphoreDeviceIndices;
+		submitInfo.pNext = &groupInfo;
+	}
+
+	/// <summary>
+	/// Whether the device can run the bindless path: update-after-bind, partially bound, runtime sized arrays of textures and
+	/// storage buffers. All zero in the registry when the device has no descriptor indexing at all.
+	/// </summary>
+	bool isBindlessSupported(VkPhysicalDevice device) {
+		const VkPhysicalDeviceFeatures& features = capabilities.getDeviceFeatures(device);
+		const VkPhysicalDeviceDescriptorIndexingFeatures& indexing = capabilities.getDescriptorIndexingFeatures(device);
+
+		return features.shaderSampledImageArrayDynamicIndexing && features.shaderStorageBufferArrayDynamicIndexing &&
+			indexing.runtimeDescriptorArray && indexing.descriptorBindingPartiallyBound &&
+			indexing.descriptorBindingSampledImageUpdateAfterBind && indexing.descriptorBindingStorageBufferUpdateAfterBind &&
+			indexing.shaderSampledImageArrayNonUniformIndexing;
+	}
+
+	/// <summary>
+	/// Whether the device can sample the streamed textures and report the mips it sampled: dynamically and non-uniformly
+	/// indexed sampler arrays, and atomics from the fragment shader.
+	/// </summary>
+	bool isTextureStreamingSupported(VkPhysicalDevice device) {
+		const VkPhysicalDeviceFeatures& features = capabilities.getDeviceFeatures(device);
+		const VkPhysicalDeviceDescriptorIndexingFeatures& indexing = capabilities.getDescriptorIndexingFeatures(device);
+
+		return features.shaderSampledImageArrayDynamicIndexing && features.fragmentStoresAndAtomics &&
+			indexing.shaderSampledImageArrayNonUniformIndexing;
+	}
+
+	/// <summary>
+	/// Whether the device can run the GPU driven path: a GPU written draw count, many draws per indirect call, and
+	/// firstInstance to carry each draw's instance index. The whole scene has to fit in one indirect call.
+	/// </summary>
+	bool isGpuDrivenSupported(VkPhysicalDevice device) {
+		const VkPhysicalDeviceFeatures& features = capabilities.getDeviceFeatures(device);
+
+		return capabilities.hasDeviceExtension(device, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME) &&
+			features.multiDrawIndirect && features.drawIndirectFirstInstance &&
+			capabilities.getDeviceProperties(device).limits.maxDrawIndirectCount >= config.drawCount;
+	}
+
+	/// <summary>
+	/// The mesh shaders are SPIR-V 1.5, so on top of the extension's task and mesh stages the device has to be used at 1.2,
+	/// which takes an instance that asked for 1.2 as well.
+	/// </summary>
+	bool isMeshShaderSupported(VkPhysicalDevice device) {
+		const VkPhysicalDeviceMeshShaderFeaturesEXT& features = capabilities.getMeshShaderFeatures(device);
+
+		return std::min(instanceApiVersion, capabilities.getDeviceProperties(device).apiVersion) >= VK_API_VERSION_1_2 &&
+			features.taskShader && features.meshShader;
+	}
+
+	/// <summary>
+	/// What --dynamic-rendering can use on this device. Extended dynamic state 3 is only worth it for blending as a whole,
+	/// so it counts when all three of its blend features are there.
+	/// </summary>
+	DynamicStateSupport getDynamicStateSupport(VkPhysicalDevice device, uint32_t deviceApiVersion) {
+		const VkPhysicalDeviceExtendedDynamicState3FeaturesEXT& blend = capabilities.getExtendedDynamicState3Features(device);
+
+		DynamicStateSupport support;
+		support.core = deviceApiVersion >= VK_API_VERSION_1_3;
+		support.dynamicRendering = capabilities.getDynamicRenderingFeatures(device).dynamicRendering;
+		support.extendedDynamicState = support.core || capabilities.getExtendedDynamicStateFeatures(device).extendedDynamicState;
+		support.extendedDynamicState2 = support.core || capabilities.getExtendedDynamicState2Features(device).extendedDynamicState2;
+		support.dynamicBlend = blend.extendedDynamicState3ColorBlendEnable && blend.extendedDynamicState3ColorBlendEquation &&
+			blend.extendedDynamicState3ColorWriteMask;
+		return support;
+	}
+
+	/// <summary>
+	/// The logical device is our interface to the physical device. We ask for one queue from each unique family we need.
+	/// </summary>
+	void createLogicalDevice() {
+		QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+
+		asyncComputeEnabled = config.asyncCompute && indices.computeFamily.has_value();
+		if (config.asyncCompute && !asyncComputeEnabled) {
+			std::cout << "The device has no compute-only queue family to spare; async compute passes run on the graphics queue" << std::endl;
+		}
+
+		std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+		std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value(), indices.transferFamily.value() };
+		if (asyncComputeEnabled) {
+			uniqueQueueFamilies.insert(indices.computeFamily.value());
+		}
+
+		const float queuePriorities[] = { 1.0f, 1.0f };
+		for (uint32_t queueFamily : uniqueQueueFamilies) {
+			VkDeviceQueueCreateInfo queueCreateInfo{};
+			queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+			queueCreateInfo.queueFamilyIndex = queueFamily;
+			queueCreateInfo.queueCount = asyncComputeEnabled && queueFamily == indices.computeFamily ? indices.computeQueueIndex + 1 : 1;
+			queueCreateInfo.pQueuePriorities = queuePriorities;
+			queueCreateInfos.push_back(queueCreateInfo);
+		}
+
+		VkPhysicalDeviceFeatures deviceFeatures{};
+
+		// Optional extensions are enabled when present and the matching feature flag remembers whether we got them
+		std::vector<const char*> enabledExtensions = getRequiredDeviceExtensions();
+
+		pipelineCreationFeedbackSupported = capabilities.hasDeviceExtension(physicalDevice, VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+		if (pipelineCreationFeedbackSupported) {
+			enabledExtensions.push_back(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+		}
+
+		// getUnsuitableReason() already made sure these are there
+		VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures{};
+		timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+		timelineSemaphoreFeatures.timelineSemaphore = VK_TRUE;
+
+		const uint32_t deviceApiVersion = std::min(instanceApiVersion, capabilities.getDeviceProperties(physicalDevice).apiVersion);
+		if (deviceApiVersion < VK_API_VERSION_1_2) {
+			enabledExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+		}
+
+		// Only the features BindlessDescriptors and shader.vert rely on get enabled, not everything the device offers
+		VkPhysicalDeviceDescriptorIndexingFeatures descriptorIndexingFeatures{};
+		descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+
+		if (config.bindless) {
+			bindlessEnabled = isBindlessSupported(physicalDevice);
+			if (bindlessEnabled) {
+				descriptorIndexingFeatures.runtimeDescriptorArray = VK_TRUE;
+				descriptorIndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+				descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+				descriptorIndexingFeatures.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+				descriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+				deviceFeatures.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+				deviceFeatures.shaderStorageBufferArrayDynamicIndexing = VK_TRUE;
+
+				if (deviceApiVersion < VK_API_VERSION_1_2) {
+					enabledExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+				}
+			} else {
+				std::cout << "Bindless requested, but the device lacks descriptor indexing; falling back to classic descriptor sets" << std::endl;
+			}
+		}
+
+		VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures{};
+		meshShaderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+
+		if (config.meshShaders) {
+			meshShadersEnabled = isMeshShaderSupported(physicalDevice);
+			if (meshShadersEnabled) {
+				meshShaderFeatures.taskShader = VK_TRUE;
+				meshShaderFeatures.meshShader = VK_TRUE;
+				enabledExtensions.push_back(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+			} else {
+				std::cout << "Mesh shaders requested, but the device lacks VK_EXT_mesh_shader; falling back to the GPU driven path" << std::endl;
+			}
+		}
+
+		if (config.gpuDriven || (config.meshShaders && !meshShadersEnabled)) {
+			gpuDrivenEnabled = isGpuDrivenSupported(physicalDevice);
+			if (gpuDrivenEnabled) {
+				deviceFeatures.multiDrawIndirect = VK_TRUE;
+				deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+				enabledExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+			} else {
+				std::cout << "GPU driven rendering requested, but the device can't draw indirect with a count; falling back to the classic path" << std::endl;
+			}
+		}
+
+		if (config.textureBudget != 0) {
+			textureStreamingEnabled = isMeshDrawn() && isTextureStreamingSupported(physicalDevice);
+			if (textureStreamingEnabled) {
+				deviceFeatures.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+				deviceFeatures.fragmentStoresAndAtomics = VK_TRUE;
+				descriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+				if (deviceApiVersion < VK_API_VERSION_1_2 && !bindlessEnabled) {
+					enabledExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+				}
+
+				// Optional: without it the streamer sticks to the configured budget whatever else is using the heap
+				memoryBudgetEnabled = deviceApiVersion >= VK_API_VERSION_1_1 &&
+					capabilities.hasDeviceExtension(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+				if (memoryBudgetEnabled) {
+					enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+				}
+			} else {
+				std::cout << "Texture streaming requested, but the device can't sample and report textures on the GPU paths; drawing the mesh untextured" << std::endl;
+			}
+		}
+
+		// Instanced draws with a firstInstance are core, there is nothing to check
+		drawBatchingEnabled = config.drawBatching && !gpuDrivenEnabled && !meshShadersEnabled;
+
+		if (config.pipelineStatistics) {
+			pipelineStatisticsEnabled = capabilities.getDeviceFeatures(physicalDevice).pipelineStatisticsQuery;
+			if (pipelineStatisticsEnabled) {
+				deviceFeatures.pipelineStatisticsQuery = VK_TRUE;
+
+				inheritedQueriesEnabled = capabilities.getDeviceFeatures(physicalDevice).inheritedQueries;
+				if (inheritedQueriesEnabled) {
+					deviceFeatures.inheritedQueries = VK_TRUE;
+				} else {
+					std::cout << "Pipeline statistics requested, but the device lacks inheritedQueries; falling back to recording draws into the primary" << std::endl;
+				}
+			} else {
+				std::cout << "Pipeline statistics requested, but the device has no pipeline statistics queries; profiling timestamps only" << std::endl;
+			}
+		}
+
+		// Optional: the render graph falls back to vkCmdPipelineBarrier without it
+		VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2Features{};
+		synchronization2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+		synchronization2Enabled = capabilities.getSynchronization2Features(physicalDevice).synchronization2;
+		if (synchronization2Enabled) {
+			synchronization2Features.synchronization2 = VK_TRUE;
+			enabledExtensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+		}
+
+		// Each part of --dynamic-rendering is enabled on its own, core on 1.3 and from its extension before that
+		VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeatures{};
+		dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
+		VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures{};
+		extendedDynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+		VkPhysicalDeviceExtendedDynamicState2FeaturesEXT extendedDynamicState2Features{};
+		extendedDynamicState2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_2_FEATURES_EXT;
+		VkPhysicalDeviceExtendedDynamicState3FeaturesEXT extendedDynamicState3Features{};
+		extendedDynamicState3Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+
+		DynamicStateSupport dynamicStateSupport;
+		if (config.dynamicRendering) {
+			dynamicStateSupport = getDynamicStateSupport(physicalDevice, deviceApiVersion);
+			if (dynamicStateSupport.dynamicRendering) {
+				dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+				if (!dynamicStateSupport.core) {
+					enabledExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+				}
+			} else {
+				std::cout << "Dynamic rendering requested, but the device lacks VK_KHR_dynamic_rendering; falling back to a render pass and framebuffers" << std::endl;
+			}
+			// Core in 1.3 without a feature bit to turn on
+			if (dynamicStateSupport.extendedDynamicState && !dynamicStateSupport.core) {
+				extendedDynamicStateFeatures.extendedDynamicState = VK_TRUE;
+				enabledExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+			}
+			if (dynamicStateSupport.extendedDynamicState2 && !dynamicStateSupport.core) {
+				extendedDynamicState2Features.extendedDynamicState2 = VK_TRUE;
+				enabledExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME);
+			}
+			if (!dynamicStateSupport.extendedDynamicState || !dynamicStateSupport.extendedDynamicState2) {
+				std::cout << "Dynamic rendering requested, but the device lacks " << (dynamicStateSupport.extendedDynamicState ? "VK_EXT_extended_dynamic_state2" : "VK_EXT_extended_dynamic_state")
+					<< "; falling back to baking that state into the pipelines" << std::endl;
+			}
+			if (dynamicStateSupport.dynamicBlend) {
+				extendedDynamicState3Features.extendedDynamicState3ColorBlendEnable = VK_TRUE;
+				extendedDynamicState3Features.extendedDynamicState3ColorBlendEquation = VK_TRUE;
+				extendedDynamicState3Features.extendedDynamicState3ColorWriteMask = VK_TRUE;
+				enabledExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
+			}
+		}
+
+		VkDeviceCreateInfo createInfo{};
+		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		createInfo.pNext = &timelineSemaphoreFeatures;
+		if (bindlessEnabled || textureStreamingEnabled) {
+			timelineSemaphoreFeatures.pNext = &descriptorIndexingFeatures;
+		}
+		if (synchronization2Enabled) {
+			synchronization2Features.pNext = timelineSemaphoreFeatures.pNext;
+			timelineSemaphoreFeatures.pNext = &synchronization2Features;
+		}
+		if (meshShadersEnabled) {
+			meshShaderFeatures.pNext = timelineSemaphoreFeatures.pNext;
+			timelineSemaphoreFeatures.pNext = &meshShaderFeatures;
+		}
+		if (dynamicStateSupport.dynamicRendering) {
+			dynamicRenderingFeatures.pNext = timelineSemaphoreFeatures.pNext;
+			timelineSemaphoreFeatures.pNext = &dynamicRenderingFeatures;
+		}
+		if (dynamicStateSupport.extendedDynamicState && !dynamicStateSupport.core) {
+			extendedDynamicStateFeatures.pNext = timelineSemaphoreFeatures.pNext;
+			timelineSemaphoreFeatures.pNext = &extendedDynamicStateFeatures;
+		}
+		if (dynamicStateSupport.extendedDynamicState2 && !dynamicStateSupport.core) {
+			extendedDynamicState2Features.pNext = timelineSemaphoreFeatures.pNext;
+			timelineSemaphoreFeatures.pNext = &extendedDynamicState2Features;
+		}
+		if (dynamicStateSupport.dynamicBlend) {
+			extendedDynamicState3Features.pNext = timelineSemaphoreFeatures.pNext;
+			timelineSemaphoreFeatures.pNext = &extendedDynamicState3Features;
+		}
+		createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
+		createInfo.pQueueCreateInfos = queueCreateInfos.data();
+		createInfo.pEnabledFeatures = &deviceFeatures;
+		createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+		createInfo.ppEnabledExtensionNames = enabledExtensions.data();
+
+		// One logical device over the whole group; each device gets its own instance of device local memory
+		VkDeviceGroupDeviceCreateInfo deviceGroupInfo{};
+		deviceGroupInfo.sType = VK_STRUCTURE_TYPE_DEVICE_GROUP_DEVICE_CREATE_INFO;
+		deviceGroupInfo.physicalDeviceCount = static_cast<uint32_t>(deviceGroup.size());
+		deviceGroupInfo.pPhysicalDevices = deviceGroup.data();
+		if (deviceGroupMode != DeviceGroupMode::None) {
+			deviceGroupInfo.pNext = createInfo.pNext;
+			createInfo.pNext = &deviceGroupInfo;
+		}
+
+		// Device layers are deprecated, but older implementations still expect them to match the instance layers
+		if (enableValidationLayers) {
+			createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
+			createInfo.ppEnabledLayerNames = validationLayers.data();
+		} else {
+			createInfo.enabledLayerCount = 0;
+		}
+
+		if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create logical device!");
+		}
+		dynamicState.init(device, dynamicStateSupport);
+
+		vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
+		vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+		vkGetDeviceQueue(device, indices.transferFamily.value(), 0, &transferQueue);
+		if (asyncComputeEnabled) {
+			vkGetDeviceQueue(device, indices.computeFamily.value(), indices.computeQueueIndex, &computeQueue);
+		}
+
+		debugUtils.initDevice(device);
+		debugUtils.setObjectName(graphicsQueue, VK_OBJECT_TYPE_QUEUE, "Graphics queue");
+		if (transferQueue != graphicsQueue) {
+			debugUtils.setObjectName(transferQueue, VK_OBJECT_TYPE_QUEUE, "Transfer queue");
+		}
+		if (asyncComputeEnabled) {
+			debugUtils.setObjectName(computeQueue, VK_OBJECT_TYPE_QUEUE, "Async compute queue");
+		}
+	}
+
+	void initStagingRing() {
+		QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+		const VkPhysicalDeviceProperties& properties = capabilities.getDeviceProperties(physicalDevice);
+
+		stagingRing.init(device, std::min(instanceApiVersion, properties.apiVersion), memoryAllocator, transferQueue,
+			indices.transferFamily.value(), indices.graphicsFamily.value(), config.stagingBufferSize,
+			properties.limits.optimalBufferCopyOffsetAlignment);
+		if (deviceGroupMode != DeviceGroupMode::None) {
+			stagingRing.setDeviceMask(deviceGroup.size() >= 32 ? ~0u : (1u << deviceGroup.size()) - 1);
+		}
+	}
+
+	/// <summary>
+	/// Scopes are recorded on the graphics queue, so that family decides whether timestamps are there at all.
+	/// </summary>
+	void initProfiler() {
+		QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+
+		uint32_t queueFamilyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+		const uint32_t timestampValidBits = queueFamilies[indices.graphicsFamily.value()].timestampValidBits;
+		if (timestampValidBits == 0) {
+			std::cout << "The graphics queue has no timestamps; profiling CPU scopes only" << std::endl;
+		}
+
+		profiler.init(device, capabilities.getDeviceProperties(physicalDevice).limits.timestampPeriod, timestampValidBits,
+			config.framesInFlight, pipelineStatisticsEnabled, !config.tracePath.empty());
+		if (asyncComputeEnabled) {
+			profiler.initComputeQueue(queueFamilies[indices.computeFamily.value()].timestampValidBits);
+		}
+	}
+
+	VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats) {
+		for (const auto& availableFormat : availableFormats) {
+			if (availableFormat.format == VK_FORMAT_B8G8R8A8_SRGB && availableFormat.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
+				return availableFormat;
+			}
+		}
+
+		return availableFormats[0];
+	}
+
+	/// <summary>
+	/// The configured mode, or the closest one the surface has. FIFO is the only mode guaranteed to exist, and it is also
+	/// the one that paces us: vkQueuePresentKHR blocks on vblank, so combined with the frame fences the CPU sleeps instead
+	/// of spinning out frames nobody will see. The others trade that for latency; use --fps-limit to keep the power down.
+	/// </summary>
+	VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
+		std::vector<VkPresentModeKHR> preferred;
+		switch (config.presentMode) {
+		case PresentMode::Immediate:
+			preferred = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR };
+			break;
+		case PresentMode::Mailbox:
+			preferred = { VK_PRESENT_MODE_MAILBOX_KHR };
+			break;
+		case PresentMode::FifoRelaxed:
+			preferred = { VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+			break;
+		case PresentMode::Fifo:
+			break;
+		}
+
+		VkPresentModeKHR chosen = VK_PRESENT_MODE_FIFO_KHR;
+		for (VkPresentModeKHR mode : preferred) {
+			if (std::find(availablePresentModes.begin(), availablePresentModes.end(), mode) != availablePresentModes.end()) {
+				chosen = mode;
+				break;
+			}
+		}
+
+		if (!preferred.empty() && chosen != preferred.front()) {
+			std::cout << "Present mode " << presentModeName(preferred.front()) << " not supported, using " << presentModeName(chosen) << std::endl;
+		}
+		return chosen;
+	}
+
+	VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities) {
+		if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
+			return capabilities.currentExtent;
+		}
+
+		// The window manager lets us pick, so match the framebuffer (in pixels, not screen coordinates) within the allowed bounds
+		int width, height;
+		glfwGetFramebufferSize(window, &width, &height);
+
+		VkExtent2D actualExtent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+		actualExtent.width = std::clamp(actualExtent.width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width);
+		actualExtent.height = std::clamp(actualExtent.height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height);
+
+		return actualExtent;
+	}
+
+	void createSwapChain() {
+		SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
+
+		VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
+		VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+		VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
+
+		// By default one more than the minimum so we never have to wait on the driver to release an image before acquiring
+		// the next. Fewer images means less queued up between input and display, more helps mailbox keep a spare.
+		uint32_t imageCount = config.swapChainImageCount != 0 ? config.swapChainImageCount : swapChainSupport.capabilities.minImageCount + 1;
+		imageCount = std::max(imageCount, swapChainSupport.capabilities.minImageCount);
+		if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
+			imageCount = swapChainSupport.capabilities.maxImageCount;
+		}
+
+		VkSwapchainCreateInfoKHR createInfo{};
+		createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+		createInfo.surface = surface;
+		createInfo.minImageCount = imageCount;
+		createInfo.imageFormat = surfaceFormat.format;
+		createInfo.imageColorSpace = surfaceFormat.colorSpace;
+		createInfo.imageExtent = extent;
+		createInfo.imageArrayLayers = 1;
+		createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+
+		QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+		uint32_t queueFamilyIndices[] = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+
+		if (indices.graphicsFamily != indices.presentFamily) {
+			createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+			createInfo.queueFamilyIndexCount = 2;
+			createInfo.pQueueFamilyIndices = queueFamilyIndices;
+		} else {
+			createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		}
+
+		createInfo.preTransform = swapChainSupport.capabilities.currentTransform;
+		createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+		createInfo.presentMode = presentMode;
+		createInfo.clipped = VK_TRUE;
+		createInfo.oldSwapchain = swapChain; // Null at startup. On a resize it lets the driver reuse what the old one had
+
+		VkSwapchainKHR newSwapChain;
+		if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &newSwapChain) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create swap chain!");
+		}
+		swapChain = newSwapChain;
+
+		vkGetSwapchainImagesKHR(device, swapChain, &imageCount, nullptr);
+		swapChainImages.resize(imageCount);
+		vkGetSwapchainImagesKHR(device, swapChain, &imageCount, swapChainImages.data());
+
+		swapChainImageFormat = surfaceFormat.format;
+		swapChainExtent = extent;
+	}
+
+	/// <summary>
+	/// Headless stand-in for the swap chain: a single color image the size of the window. Every frame in flight renders
+	/// into it. Each frame's render graph imports it as last left by the previous frame's copy out, so the barrier the
+	/// graph emits before the draw waits for that transfer, on the same queue, before overwriting the image.
+	/// </summary>
+	void createOffscreenTarget() {
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = VK_FORMAT_B8G8R8A8_SRGB; // What chooseSwapSurfaceFormat() prefers, so pipelines match the windowed ones
+		imageInfo.extent = { config.windowWidth, config.windowHeight, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		AllocationCreateInfo allocationInfo{};
+		allocationInfo.dedicated = true;
+		swapChainImages = { memoryAllocator.createImage(imageInfo, allocationInfo, offscreenAllocation) };
+		debugUtils.setObjectName(swapChainImages[0], VK_OBJECT_TYPE_IMAGE, "Offscreen target");
+
+		swapChainImageFormat = imageInfo.format;
+		swapChainExtent = { config.windowWidth, config.windowHeight };
+	}
+
+	void createImageViews() {
+		swapChainImageViews.resize(swapChainImages.size());
+
+		for (size_t i = 0; i < swapChainImages.size(); i++) {
+			VkImageViewCreateInfo createInfo{};
+			createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			createInfo.image = swapChainImages[i];
+			createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			createInfo.format = swapChainImageFormat;
+			createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+			createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+			createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+			createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+			createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			createInfo.subresourceRange.baseMipLevel = 0;
+			createInfo.subresourceRange.levelCount = 1;
+			createInfo.subresourceRange.baseArrayLayer = 0;
+			createInfo.subresourceRange.layerCount = 1;
+
+			if (vkCreateImageView(device, &createInfo, nullptr, &swapChainImageViews[i]) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create image views!");
+			}
+		}
+	}
+
+	/// <summary>
+	/// Nothing to create with dynamic rendering, the pipelines, secondaries and the pass itself name the format instead.
+	/// </summary>
+	void createRenderPass() {
+		if (dynamicState.isDynamicRendering()) {
+			return;
+		}
+
+		VkAttachmentDescription colorAttachment{};
+		colorAttachment.format = swapChainImageFormat;
+		colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		// The render graph moves the image into and out of the attachment layout, and waits for the acquire, around the pass
+		colorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+		VkAttachmentReference colorAttachmentRef{};
+		colorAttachmentRef.attachment = 0;
+		colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+		VkSubpassDescription subpass{};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = 1;
+		subpass.pColorAttachments = &colorAttachmentRef;
+
+		VkRenderPassCreateInfo renderPassInfo{};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassInfo.attachmentCount = 1;
+		renderPassInfo.pAttachments = &colorAttachment;
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = &subpass;
+
+		if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create render pass!");
+		}
+		debugUtils.setObjectName(renderPass, VK_OBJECT_TYPE_RENDER_PASS, "Main render pass");
+	}
+
+	VkShaderModule createShaderModule(const std::vector<char>& code) {
+		VkShaderModuleCreateInfo createInfo{};
+		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		createInfo.codeSize = code.size();
+		createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data()); // std::vector's allocator already satisfies uint32_t alignment
+
+		VkShaderModule shaderModule;
+		if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create shader module!");
+		}
+
+		return shaderModule;
+	}
+
+	std::vector<char>& getShaderCode(ShaderVariant variant) {
+		switch (variant) {
+		case ShaderVariant::Vert:
+			return vertShaderCode;
+		case ShaderVariant::VertBindless:
+			return vertBindlessShaderCode;
+		case ShaderVariant::VertInstanced:
+			return instancedVertShaderCode;
+		case ShaderVariant::VertInstancedBindless:
+			return instancedVertBindlessShaderCode;
+		case ShaderVariant::Frag:
+			return fragShaderCode;
+		case ShaderVariant::IndirectVert:
+			return indirectVertShaderCode;
+		case ShaderVariant::Cull:
+			return cullShaderCode;
+		case ShaderVariant::IndirectMeshVert:
+			return indirectMeshVertShaderCode;
+		case ShaderVariant::MeshletTask:
+			return meshletTaskShaderCode;
+		case ShaderVariant::MeshletMesh:
+			return meshletMeshShaderCode;
+		default:
+			return fragStreamedShaderCode;
+		}
+	}
+
+	void loadShader(ShaderVariant variant) {
+		getShaderCode(variant) = readFile(SHADER_SOURCES[static_cast<size_t>(variant)].outputPath);
+	}
+
+	void loadShaders() {
+		loadShader(ShaderVariant::Vert);
+		if (config.bindless) {
+			// The device isn't picked yet, so keep the classic variant around in case it has to fall back
+			loadShader(ShaderVariant::VertBindless);
+		}
+		if (config.drawBatching) {
+			loadShader(ShaderVariant::VertInstanced);
+			if (config.bindless) {
+				loadShader(ShaderVariant::VertInstancedBindless);
+			}
+		}
+		loadShader(ShaderVariant::Frag);
+		if (config.gpuDriven || config.meshShaders) {
+			// Mesh shaders fall back to the GPU driven path, so it has to be ready as well
+			loadShader(getIndirectVertVariant());
+			loadShader(ShaderVariant::Cull);
+		}
+		if (config.meshShaders) {
+			loadShader(ShaderVariant::MeshletTask);
+			loadShader(ShaderVariant::MeshletMesh);
+		}
+		if (config.textureBudget != 0) {
+			loadShader(ShaderVariant::FragStreamed);
+		}
+	}
+
+	/// <summary>
+	/// Only depends on the command line, so it's known before the device is picked.
+	/// </summary>
+	ShaderVariant getIndirectVertVariant() const {
+		return config.meshPath.empty() ? ShaderVariant::IndirectVert : ShaderVariant::IndirectMeshVert;
+	}
+
+	/// <summary>
+	/// --mesh only replaces the triangle on the GPU paths, the CPU recorded one keeps drawing triangles.
+	/// </summary>
+	bool isMeshDrawn() const {
+		return !config.meshPath.empty() && (gpuDrivenEnabled || meshShadersEnabled);
+	}
+
+	/// <summary>
+	/// The fragment shader of the GPU driven and mesh shader paths, which sample the streamed textures when that's on.
+	/// </summary>
+	ShaderVariant getGpuFragVariant() const {
+		return textureStreamingEnabled ? ShaderVariant::FragStreamed : ShaderVariant::Frag;
+	}
+
+	/// <summary>
+	/// Set 1 of the GPU paths' layouts: the streamed textures, or nothing.
+	/// </summary>
+	VkDescriptorSetLayout getTextureSetLayout() const {
+		return textureStreamingEnabled ? textureStreamer.getSetLayout() : VK_NULL_HANDLE;
+	}
+
+	ShaderVariant getDrawVertVariant() const {
+		return bindlessEnabled ? ShaderVariant::VertBindless : ShaderVariant::Vert;
+	}
+
+	ShaderVariant getInstancedVertVariant() const {
+		return bindlessEnabled ? ShaderVariant::VertInstancedBindless : ShaderVariant::VertInstanced;
+	}
+
+	/// <summary>
+	/// Layout of a CPU recorded draw pipeline from what its shaders declare. Set 0 is the bindless set when that is on and
+	/// set 1 is always objectSetLayout, a view of the uniform ring; both carry flags reflection can't see, the rest is built
+	/// from the shaders. Throws if the shaders' push constants no longer match DrawPushConstants.
+	/// </summary>
+	VkPipelineLayout getDrawPipelineLayout(const std::vector<char>& vertCode, VkDescriptorSetLayout objectSetLayout) {
+		const ShaderReflection vert = reflectShader(vertCode);
+		const ShaderReflection frag = reflectShader(fragShaderCode);
+		if (vert.pushConstants.offset != 0 || vert.pushConstants.size != sizeof(DrawPushConstants) || frag.pushConstants.size != 0) {
+			throw std::runtime_error("Failed to create pipeline layout, the shaders' push constants don't match DrawPushConstants!");
+		}
+
+		return pipelineLayoutCache.getPipelineLayout({ &vert, &frag },
+			{ bindlessEnabled ? bindlessDescriptors.getSetLayout() : VK_NULL_HANDLE, objectSetLayout });
+	}
+
+	/// <summary>
+	/// The GPU driven path reads everything per draw from buffers, so its layout is just GpuCulling's set, plus the
+	/// streamed textures with --texture-budget.
+	/// </summary>
+	VkPipelineLayout getIndirectPipelineLayout() {
+		const ShaderReflection vert = reflectShader(getShaderCode(getIndirectVertVariant()));
+		const ShaderReflection frag = reflectShader(getShaderCode(getGpuFragVariant()));
+		return pipelineLayoutCache.getPipelineLayout({ &vert, &frag }, { gpuCulling.getSetLayout(), getTextureSetLayout() });
+	}
+
+	/// <summary>
+	/// Same for the mesh shader path with MeshletRenderer's set, plus the task shader's push constants.
+	/// </summary>
+	VkPipelineLayout getMeshletPipelineLayout() {
+		const ShaderReflection task = reflectShader(meshletTaskShaderCode);
+		const ShaderReflection mesh = reflectShader(meshletMeshShaderCode);
+		const ShaderReflection frag = reflectShader(getShaderCode(getGpuFragVariant()));
+		return pipelineLayoutCache.getPipelineLayout({ &task, &mesh, &frag }, { meshletRenderer.getSetLayout(), getTextureSetLayout() });
+	}
+
+	/// <summary>
+	/// The fixed function state each geometry is drawn with: baked into its pipeline, or set on the command buffer after
+	/// binding it where extended dynamic state allows.
+	/// </summary>
+	static RasterState getRasterState(PipelineGeometry geometry) {
+		RasterState state;
+		state.cullMode = VK_CULL_MODE_BACK_BIT;
+		state.frontFace = geometry == PipelineGeometry::Triangle ? VK_FRONT_FACE_CLOCKWISE : VK_FRONT_FACE_COUNTER_CLOCKWISE;
+		return state;
+	}
+
+	/// <summary>
+	/// Everything but the shaders, layout and geometry is shared between the render paths. Runs on pipeline compiler
+	/// workers, so it reads nothing that changes after startup besides what it's passed.
+	/// </summary>
+	VkPipeline buildGraphicsPipeline(const std::vector<PipelineStage>& stages, VkPipelineLayout layout, PipelineGeometry geometry) {
+		std::vector<VkPipelineShaderStageCreateInfo> shaderStages(stages.size());
+		for (size_t i = 0; i < stages.size(); i++) {
+			shaderStages[i].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+			shaderStages[i].stage = stages[i].stage;
+			shaderStages[i].module = createShaderModule(stages[i].code);
+			shaderStages[i].pName = "main";
+		}
+
+		// The triangle is hardcoded in the vertex shader, so only the mesh has vertex input to describe
+		VkVertexInputBindingDescription vertexBinding{};
+		vertexBinding.binding = 0;
+		vertexBinding.stride = sizeof(AssetVertex);
+		vertexBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		VkVertexInputAttributeDescription vertexAttributes[3]{};
+		vertexAttributes[0].location = 0;
+		vertexAttributes[0].binding = 0;
+		vertexAttributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+		vertexAttributes[0].offset = offsetof(AssetVertex, position);
+		vertexAttributes[1].location = 1;
+		vertexAttributes[1].binding = 0;
+		vertexAttributes[1].format = VK_FORMAT_A2B10G10R10_SNORM_PACK32;
+		vertexAttributes[1].offset = offsetof(AssetVertex, normal);
+		vertexAttributes[2].location = 2;
+		vertexAttributes[2].binding = 0;
+		vertexAttributes[2].format = VK_FORMAT_R16G16_SFLOAT;
+		vertexAttributes[2].offset = offsetof(AssetVertex, uv);
+
+		VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		if (geometry == PipelineGeometry::MeshVertices) {
+			vertexInputInfo.vertexBindingDescriptionCount = 1;
+			vertexInputInfo.pVertexBindingDescriptions = &vertexBinding;
+			vertexInputInfo.vertexAttributeDescriptionCount = 3;
+			vertexInputInfo.pVertexAttributeDescriptions = vertexAttributes;
+		}
+
+		VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+		inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+		inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+		// Viewport and scissor are dynamic so the pipeline doesn't need rebuilding when the swap chain changes size
+		VkPipelineViewportStateCreateInfo viewportState{};
+		viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+		viewportState.viewportCount = 1;
+		viewportState.scissorCount = 1;
+
+		VkPipelineRasterizationStateCreateInfo rasterizer{};
+		rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+		rasterizer.depthClampEnable = VK_FALSE;
+		rasterizer.rasterizerDiscardEnable = VK_FALSE;
+		rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+		rasterizer.lineWidth = 1.0f;
+
+		VkPipelineMultisampleStateCreateInfo multisampling{};
+		multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+		multisampling.sampleShadingEnable = VK_FALSE;
+		multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+		// Whatever of this extended dynamic state covers is ignored, recordDraws() and friends set it after binding instead
+		VkPipelineDepthStencilStateCreateInfo depthStencil{};
+		VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+		DynamicState::bakePipelineState(getRasterState(geometry), rasterizer, depthStencil, colorBlendAttachment);
+
+		VkPipelineColorBlendStateCreateInfo colorBlending{};
+		colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+		colorBlending.logicOpEnable = VK_FALSE;
+		colorBlending.attachmentCount = 1;
+		colorBlending.pAttachments = &colorBlendAttachment;
+
+		std::vector<VkDynamicState> dynamicStates = {
+			VK_DYNAMIC_STATE_VIEWPORT,
+			VK_DYNAMIC_STATE_SCISSOR
+		};
+		dynamicState.addDynamicStates(dynamicStates);
+
+		VkPipelineDynamicStateCreateInfo dynamicStateInfo{};
+		dynamicStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+		dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+		dynamicStateInfo.pDynamicStates = dynamicStates.data();
+
+		// With dynamic rendering there is no render pass to be compatible with, only the attachment formats
+		VkPipelineRenderingCreateInfo renderingInfo{};
+		renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+		renderingInfo.colorAttachmentCount = 1;
+		renderingInfo.pColorAttachmentFormats = &swapChainImageFormat;
+
+		VkGraphicsPipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		pipelineInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
+		pipelineInfo.pStages = shaderStages.data();
+		// Mesh shader pipelines have no vertex stage for these to feed
+		if (geometry != PipelineGeometry::Meshlets) {
+			pipelineInfo.pVertexInputState = &vertexInputInfo;
+			pipelineInfo.pInputAssemblyState = &inputAssembly;
+		}
+		pipelineInfo.pViewportState = &viewportState;
+		pipelineInfo.pRasterizationState = &rasterizer;
+		pipelineInfo.pMultisampleState = &multisampling;
+		pipelineInfo.pDepthStencilState = &depthStencil;
+		pipelineInfo.pColorBlendState = &colorBlending;
+		pipelineInfo.pDynamicState = &dynamicStateInfo;
+		pipelineInfo.layout = layout;
+		pipelineInfo.renderPass = renderPass;
+		pipelineInfo.subpass = 0;
+		if (dynamicState.isDynamicRendering()) {
+			pipelineInfo.pNext = &renderingInfo;
+		}
+
+		PipelineFeedback feedback;
+		if (pipelineCache.isFeedbackSupported()) {
+			pipelineInfo.pNext = feedback.chain(pipelineInfo.pNext);
+		}
+
+		VkPipeline pipeline;
+		auto start = std::chrono::steady_clock::now();
+		const VkResult result = vkCreateGraphicsPipelines(device, pipelineCache.get(), 1, &pipelineInfo, nullptr, &pipeline);
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+		// Shader modules are only needed while the pipeline is being built
+		for (const VkPipelineShaderStageCreateInfo& stage : shaderStages) {
+			vkDestroyShaderModule(device, stage.module, nullptr);
+		}
+		if (result != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create graphics pipeline!");
+		}
+		pipelineCache.record(pipelineCache.isFeedbackSupported() ? &feedback : nullptr, elapsed.count());
+
+		return pipeline;
+	}
+
+	/// <summary>
+	/// A create function for the pipeline compiler. It owns copies of the SPIR-V, hot reload may replace the originals
+	/// while it runs on a worker. The name doubles as the pipeline's key in the compiler's warm list.
+	/// </summary>
+	PipelineCompiler::CreateFunction graphicsPipelineBuilder(std::vector<PipelineStage> stages, VkPipelineLayout layout,
+		PipelineGeometry geometry, const char* name) {
+		return [this, stages = std::move(stages), layout, geometry, name] {
+			VkPipeline pipeline = buildGraphicsPipeline(stages, layout, geometry);
+			debugUtils.setObjectName(pipeline, VK_OBJECT_TYPE_PIPELINE, name);
+			return pipeline;
+		};
+	}
+
+	/// <summary>
+	/// The vertex pipelines' stages: vertCode with the one fragment shader every path shares.
+	/// </summary>
+	PipelineCompiler::CreateFunction graphicsPipelineBuilder(const std::vector<char>& vertCode, VkPipelineLayout layout, const char* name,
+		PipelineGeometry geometry = PipelineGeometry::Triangle) {
+		return graphicsPipelineBuilder({ { VK_SHADER_STAGE_VERTEX_BIT, vertCode }, { VK_SHADER_STAGE_FRAGMENT_BIT, fragShaderCode } },
+			layout, geometry, name);
+	}
+
+	PipelineCompiler::CreateFunction indirectPipelineBuilder() {
+		return graphicsPipelineBuilder({ { VK_SHADER_STAGE_VERTEX_BIT, getShaderCode(getIndirectVertVariant()) },
+			{ VK_SHADER_STAGE_FRAGMENT_BIT, getShaderCode(getGpuFragVariant()) } }, indirectPipelineLayout,
+			isMeshDrawn() ? PipelineGeometry::MeshVertices : PipelineGeometry::Triangle, getIndirectPipelineName());
+	}
+
+	PipelineCompiler::CreateFunction meshletPipelineBuilder() {
+		return graphicsPipelineBuilder({ { VK_SHADER_STAGE_TASK_BIT_EXT, meshletTaskShaderCode }, { VK_SHADER_STAGE_MESH_BIT_EXT, meshletMeshShaderCode },
+			{ VK_SHADER_STAGE_FRAGMENT_BIT, getShaderCode(getGpuFragVariant()) } }, meshletPipelineLayout, PipelineGeometry::Meshlets,
+			"Mesh shader pipeline");
+	}
+
+	const char* getIndirectPipelineName() const {
+		return isMeshDrawn() ? "Indirect mesh draw pipeline" : "Indirect draw pipeline";
+	}
+
+	const char* getDrawPipelineName() const {
+		return bindlessEnabled ? "Draw pipeline (bindless)" : "Draw pipeline";
+	}
+
+	const char* getInstancedPipelineName() const {
+		return bindlessEnabled ? "Instanced draw pipeline (bindless)" : "Instanced draw pipeline";
+	}
+
+	void createGraphicsPipeline() {
+		// Set 0 holds the materials and is bound once per command buffer, set 1 is rebound with a new offset for every draw
+		pipelineLayout = getDrawPipelineLayout(getShaderCode(getDrawVertVariant()), uniformRing.getSetLayout());
+		graphicsPipelineId = pipelineCompiler.add(getDrawPipelineName(),
+			graphicsPipelineBuilder(getShaderCode(getDrawVertVariant()), pipelineLayout, getDrawPipelineName()));
+		// The CPU path's fallback while the instanced pipeline compiles, so it's the one pipeline built before the first frame
+		graphicsPipeline = pipelineCompiler.compileNow(graphicsPipelineId);
+
+		if (drawBatchingEnabled) {
+			// Same as above but set 1 is the uniform ring's storage view, bound once per frame instead of once per draw
+			instancedPipelineLayout = getDrawPipelineLayout(getShaderCode(getInstancedVertVariant()), uniformRing.getStorageSetLayout());
+			instancedPipelineId = pipelineCompiler.add(getInstancedPipelineName(),
+				graphicsPipelineBuilder(getShaderCode(getInstancedVertVariant()), instancedPipelineLayout, getInstancedPipelineName()));
+		}
+
+		if (gpuDrivenEnabled) {
+			indirectPipelineLayout = getIndirectPipelineLayout();
+			indirectPipelineId = pipelineCompiler.add(getIndirectPipelineName(), indirectPipelineBuilder());
+		}
+
+		if (meshShadersEnabled) {
+			meshletPipelineLayout = getMeshletPipelineLayout();
+			meshletPipelineId = pipelineCompiler.add("Mesh shader pipeline", meshletPipelineBuilder());
+		}
+
+		pipelineCompiler.prewarm();
+	}
+
+	/// <summary>
+	/// This frame's pipelines, once per frame after the compiler's beginFrame. Only the paths this run draws with ask, so
+	/// only those count towards hitches and the warm list.
+	/// </summary>
+	void acquirePipelines() {
+		if (meshShadersEnabled) {
+			meshletPipeline = pipelineCompiler.get(meshletPipelineId);
+			return;
+		}
+		if (gpuDrivenEnabled) {
+			indirectPipeline = pipelineCompiler.get(indirectPipelineId);
+			return;
+		}
+		graphicsPipeline = pipelineCompiler.get(graphicsPipelineId);
+		if (drawBatchingEnabled) {
+			instancedPipeline = pipelineCompiler.get(instancedPipelineId);
+		}
+	}
+
+	/// <summary>
+	/// Recompile pipeline id from reloaded shaders in the background. Sets already allocated and bound against layout
+	/// wouldn't fit a different one, so shaders that change their descriptors or push constants are refused until a
+	/// restart; so is anything that fails to build, and the old pipeline keeps drawing either way.
+	/// </summary>
+	void reloadGraphicsPipeline(uint32_t id, VkPipelineLayout layout, const std::function<VkPipelineLayout()>& reflectLayout,
+		const std::function<PipelineCompiler::CreateFunction()>& builder, const char* name) {
+		try {
+			if (reflectLayout() != layout) {
+				std::cerr << "Not reloading " << name << ", its shaders changed the pipeline layout and that needs a restart\n";
+				return;
+			}
+			pipelineCompiler.recompile(id, builder());
+		} catch (const std::exception& e) {
+			std::cerr << "Failed to reload " << name << ": " << e.what() << "\n";
+		}
+	}
+
+	/// <summary>
+	/// Development only: pick up whatever the shader watcher recompiled and rebuild the pipelines that use it. Graphics
+	/// pipelines go through the pipeline compiler, which keeps drawing with the old ones until the new ones are in. Runs
+	/// between frames.
+	/// </summary>
+	void reloadShaders() {
+		const std::vector<size_t> rebuilt = shaderWatcher.takeRebuilt();
+		if (rebuilt.empty()) {
+			return;
+		}
+
+		std::set<ShaderVariant> changed;
+		for (size_t index : rebuilt) {
+			const ShaderVariant variant = static_cast<ShaderVariant>(index);
+			if (getShaderCode(variant).empty()) {
+				continue; // Not a variant this run draws with
+			}
+			try {
+				loadShader(variant);
+				changed.insert(variant);
+			} catch (const std::exception& e) {
+				std::cerr << e.what() << "\n";
+			}
+		}
+		if (changed.empty()) {
+			return;
+		}
+
+		const bool fragChanged = changed.count(ShaderVariant::Frag) != 0;
+		const bool gpuFragChanged = changed.count(getGpuFragVariant()) != 0;
+		if (fragChanged || changed.count(getDrawVertVariant()) != 0) {
+			reloadGraphicsPipeline(graphicsPipelineId, pipelineLayout,
+				[this] { return getDrawPipelineLayout(getShaderCode(getDrawVertVariant()), uniformRing.getSetLayout()); },
+				[this] { return graphicsPipelineBuilder(getShaderCode(getDrawVertVariant()), pipelineLayout, getDrawPipelineName()); },
+				getDrawPipelineName());
+		}
+		if (drawBatchingEnabled && (fragChanged || changed.count(getInstancedVertVariant()) != 0)) {
+			reloadGraphicsPipeline(instancedPipelineId, instancedPipelineLayout,
+				[this] { return getDrawPipelineLayout(getShaderCode(getInstancedVertVariant()), uniformRing.getStorageSetLayout()); },
+				[this] { return graphicsPipelineBuilder(getShaderCode(getInstancedVertVariant()), instancedPipelineLayout, getInstancedPipelineName()); },
+				getInstancedPipelineName());
+		}
+		if (gpuDrivenEnabled && (gpuFragChanged || changed.count(getIndirectVertVariant()) != 0)) {
+			reloadGraphicsPipeline(indirectPipelineId, indirectPipelineLayout, [this] { return getIndirectPipelineLayout(); },
+				[this] { return indirectPipelineBuilder(); }, getIndirectPipelineName());
+		}
+		if (meshShadersEnabled && (gpuFragChanged || changed.count(ShaderVariant::MeshletTask) != 0 || changed.count(ShaderVariant::MeshletMesh) != 0)) {
+			reloadGraphicsPipeline(meshletPipelineId, meshletPipelineLayout, [this] { return getMeshletPipelineLayout(); },
+				[this] { return meshletPipelineBuilder(); }, "Mesh shader pipeline");
+		}
+		if (gpuDrivenEnabled && changed.count(ShaderVariant::Cull) != 0) {
+			// Rebuilt right here rather than in the background, the frames still culling with the old one keep it
+			gpuCulling.reloadPipeline(pipelineCache, cullShaderCode, deletionQueue);
+			std::cout << "Reloaded culling pipeline\n";
+		}
+	}
+
+	void createFramebuffers() {
+		if (dynamicState.isDynamicRendering()) {
+			return; // Dynamic rendering begins on the image views themselves
+		}
+
+		swapChainFramebuffers.resize(swapChainImageViews.size());
+
+		for (size_t i = 0; i < swapChainImageViews.size(); i++) {
+			VkImageView attachments[] = { swapChainImageViews[i] };
+
+			VkFramebufferCreateInfo framebufferInfo{};
+			framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+			framebufferInfo.renderPass = renderPass;
+			framebufferInfo.attachmentCount = 1;
+			framebufferInfo.pAttachments = attachments;
+			framebufferInfo.width = swapChainExtent.width;
+			framebufferInfo.height = swapChainExtent.height;
+			framebufferInfo.layers = 1;
+
+			if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &swapChainFramebuffers[i]) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create framebuffer!");
+			}
+		}
+	}
+
+	/// <summary>
+	/// Every frame in flight gets a pool per job system thread, so any thread can record into the current frame without locking
+	/// and without touching a pool the GPU may still be reading from.
+	/// </summary>
+	void createCommandPools() {
+		QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+
+		for (auto& frame : frames) {
+			frame.commandPools.init(device, queueFamilyIndices.graphicsFamily.value(), jobSystem->getThreadCount());
+			if (asyncComputeEnabled) {
+				frame.computeCommandPools.init(device, queueFamilyIndices.computeFamily.value(), 1); // Only the main thread records compute
+			}
+		}
+	}
+
+	/// <summary>
+	/// The bindless path gets one set for every resource, sized to what the device allows. The classic path gets a set
+	/// layout with just the material table, which is all the shaders read today.
+	/// </summary>
+	void createDescriptors() {
+		if (bindlessEnabled) {
+			const VkPhysicalDeviceDescriptorIndexingProperties& limits = capabilities.getDescriptorIndexingProperties(physicalDevice);
+
+			// The set is visible to every stage, so the per stage limits are the ones that bind
+			const uint32_t maxStorageBuffers = std::min({ BindlessDescriptors::DEFAULT_MAX_STORAGE_BUFFERS,
+				limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers, limits.maxDescriptorSetUpdateAfterBindStorageBuffers });
+			const uint32_t resourcesLeft = limits.maxPerStageUpdateAfterBindResources > maxStorageBuffers ? limits.maxPerStageUpdateAfterBindResources - maxStorageBuffers : 0;
+			const uint32_t maxTextures = std::min({ BindlessDescriptors::DEFAULT_MAX_TEXTURES,
+				limits.maxPerStageDescriptorUpdateAfterBindSampledImages, limits.maxPerStageDescriptorUpdateAfterBindSamplers,
+				limits.maxDescriptorSetUpdateAfterBindSampledImages, limits.maxDescriptorSetUpdateAfterBindSamplers, resourcesLeft });
+
+			bindlessDescriptors.init(device, maxTextures, maxStorageBuffers);
+			return;
+		}
+
+		// The same handle the pipeline layouts get for set 0 later, since the layout cache hands out one per distinct set
+		const ShaderReflection vert = reflectShader(vertShaderCode);
+		const ShaderReflection frag = reflectShader(fragShaderCode);
+		descriptorSetLayout = pipelineLayoutCache.getSetLayout(PipelineLayoutCache::getSetBindings({ &vert, &frag }, 0));
+
+		VkDescriptorPoolSize poolSize{};
+		poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		poolSize.descriptorCount = 1;
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.maxSets = 1;
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+
+		if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create descriptor pool!");
+		}
+
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = descriptorPool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &descriptorSetLayout;
+
+		if (vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to allocate descriptor set!");
+		}
+	}
+
+	/// <summary>
+	/// Fill the material table and hook it up to the shaders, by bindless slot or through the classic set.
+	/// The upload lands before the first frame reads it, that frame's submission waits on the staging ring.
+	/// </summary>
+	void createMaterials() {
+		VkBufferCreateInfo bufferInfo{};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = sizeof(MaterialData) * MATERIAL_COUNT;
+		bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		AllocationCreateInfo allocationInfo{};
+		materialBuffer = memoryAllocator.createBuffer(bufferInfo, allocationInfo, materialAllocation);
+		debugUtils.setObjectName(materialBuffer, VK_OBJECT_TYPE_BUFFER, "Material table");
+
+		// Same tint gradient the draw grid used to compute per draw, now shared through the table
+		std::vector<MaterialData> materials(MATERIAL_COUNT);
+		for (uint32_t i = 0; i < MATERIAL_COUNT; i++) {
+			const uint32_t column = i % 16;
+			const uint32_t row = i / 16;
+			materials[i].color = glm::vec4(1.0f - 0.5f * column / 16, 1.0f - 0.5f * row / 16, 1.0f, 1.0f);
+		}
+		stagingRing.uploadBuffer(materialBuffer, 0, materials.data(), sizeof(MaterialData) * MATERIAL_COUNT);
+
+		if (bindlessEnabled) {
+			materialBufferIndex = bindlessDescriptors.addStorageBuffer(materialBuffer);
+			return;
+		}
+
+		VkDescriptorBufferInfo descriptorBufferInfo{};
+		descriptorBufferInfo.buffer = materialBuffer;
+		descriptorBufferInfo.offset = 0;
+		descriptorBufferInfo.range = VK_WHOLE_SIZE;
+
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = descriptorSet;
+		write.dstBinding = 0;
+		write.descriptorCount = 1;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		write.pBufferInfo = &descriptorBufferInfo;
+		vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+	}
+
+	/// <summary>
+	/// Lay drawCount copies of the triangle out on a square grid covering sceneScale times the screen, as children of one
+	/// scene root, and take the draw list from their world positions. A single draw at scale 1 is the original full size
+	/// triangle.
+	/// </summary>
+	void buildDrawList() {
+		const uint32_t columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(config.drawCount))));
+		const float extent = config.sceneScale;
+		const float cellSize = 2.0f * extent / columns;
+
+		scene.clear();
+		scene.reserve(config.drawCount + 1);
+		const SceneStore::EntityId root = scene.createEntity(SceneStore::NO_PARENT, SceneTransform{}, glm::vec3(0.0f), glm::vec3(0.0f));
+
+		for (uint32_t i = 0; i < config.drawCount; i++) {
+			const uint32_t column = i % columns;
+			const uint32_t row = i / columns;
+
+			SceneTransform transform;
+			transform.position = glm::vec3(-extent + (column + 0.5f) * cellSize, -extent + (row + 0.5f) * cellSize, 0.0f);
+			transform.scale = glm::vec3(extent / columns);
+			scene.createEntity(root, transform, glm::vec3(0.0f), glm::vec3(TRIANGLE_BOUNDING_RADIUS, TRIANGLE_BOUNDING_RADIUS, 0.0f));
+		}
+		scene.update(jobSystem.get());
+
+		draws.resize(config.drawCount);
+		drawBatcher.reserve(config.drawCount);
+		for (uint32_t i = 0; i < config.drawCount; i++) {
+			const glm::vec3 position = scene.getWorldPosition(i + 1);
+
+			ObjectUniforms& draw = draws[i];
+			draw.offset = glm::vec2(position.x, position.y);
+			draw.scale = extent / columns;
+			draw.materialIndex = i % MATERIAL_COUNT;
+		}
+	}
+
+	/// <summary>
+	/// Whether simulation threads move the draws. The GPU driven paths upload their instances once, so only the CPU
+	/// recorded path can show the motion.
+	/// </summary>
+	bool isSimulated() const {
+		return config.simulationThreads != 0 && !gpuDrivenEnabled && !meshShadersEnabled;
+	}
+
+	/// <summary>
+	/// Hand the grid to the simulation threads, which circle every draw around its cell by a quarter of the cell.
+	/// </summary>
+	void startSimulation() {
+		std::vector<glm::vec2> basePositions(draws.size());
+		for (size_t i = 0; i < draws.size(); i++) {
+			basePositions[i] = draws[i].offset;
+		}
+		// A draw's scale is half its cell
+		simulation.start(config.simulationThreads, basePositions, draws.empty() ? 0.0f : 0.5f * draws[0].scale, MATERIAL_COUNT);
+	}
+
+	/// <summary>
+	/// Once per mainLoop() iteration: take the newest frame the simulation published, if there is one, and every command
+	/// it pushed since the last call, then let it start on the next frame while this one renders. Never waits on the
+	/// simulation threads.
+	/// </summary>
+	void applySimulation() {
+		if (const SimulationState* state = simulation.acquireState()) {
+			for (size_t i = 0; i < draws.size(); i++) {
+				draws[i].offset = state->offsets[i];
+
+				SceneTransform transform;
+				transform.position = glm::vec3(state->offsets[i], 0.0f);
+				transform.scale = glm::vec3(draws[i].scale);
+				scene.setLocalTransform(static_cast<SceneStore::EntityId>(i + 1), transform);
+			}
+		}
+
+		simulation.drainCommands([this](const RenderCommand& command) {
+			switch (command.type) {
+			case RenderCommand::Type::SetMaterial:
+				draws[command.draw].materialIndex = command.value;
+				break;
+			}
+		});
+
+		simulation.beginFrame();
+	}
+
+	/// <summary>
+	/// Size each frame's uniform region for the configured amount or the whole draw list, whichever is bigger, so the
+	/// classic path can never run out mid frame. Batched draws pack their data at sizeof(ObjectUniforms) apart rather
+	/// than one aligned slot each.
+	/// </summary>
+	void initUniformRing() {
+		// The storage view's regions start at multiples of this too, and instanced draws index them by whole ObjectUniforms
+		const VkPhysicalDeviceLimits& limits = capabilities.getDeviceProperties(physicalDevice).limits;
+		const VkDeviceSize minAlignment = std::max({ limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment,
+			static_cast<VkDeviceSize>(sizeof(ObjectUniforms)) });
+		const VkDeviceSize stride = drawBatchingEnabled ? sizeof(ObjectUniforms) : (sizeof(ObjectUniforms) + minAlignment - 1) / minAlignment * minAlignment;
+		const VkDeviceSize bytesPerFrame = std::max<VkDeviceSize>(config.uniformRingSize, stride * draws.size());
+
+		if (drawBatchingEnabled && bytesPerFrame > limits.maxStorageBufferRange) {
+			throw std::runtime_error("Uniform ring region too large for the device's storage buffer range!");
+		}
+
+		uniformRing.init(device, memoryAllocator, config.framesInFlight, bytesPerFrame, minAlignment, sizeof(ObjectUniforms),
+			VK_SHADER_STAGE_VERTEX_BIT);
+	}
+
+	/// <summary>
+	/// The first mesh of --mesh, for the GPU paths to draw in place of the triangle. The payloads are copied into the
+	/// staging ring, so the file can go once they're queued.
+	/// </summary>
+	void loadMesh() {
+		AssetFile file;
+		file.open(config.meshPath);
+		if (file.getMeshCount() == 0) {
+			throw std::runtime_error(config.meshPath + " has no mesh to draw!");
+		}
+		gpuMesh.init(memoryAllocator, stagingRing, file, 0);
+	}
+
+	/// <summary>
+	/// The draw list as GPU instances with bounds. A mesh is fitted to the triangle's place: centred on the draw's offset
+	/// and scaled so its bounding sphere is as wide as the triangle.
+	/// </summary>
+	std::vector<GpuInstance> buildGpuInstances() const {
+		const glm::vec4 meshBounds = isMeshDrawn() ? gpuMesh.getBounds() : glm::vec4(0.0f);
+		const float meshScale = isMeshDrawn() && meshBounds.w > 0.0f ? 0.5f / meshBounds.w : 1.0f;
+
+		std::vector<GpuInstance> instances(draws.size());
+		for (size_t i = 0; i < draws.size(); i++) {
+			instances[i].materialIndex = draws[i].materialIndex;
+			if (isMeshDrawn()) {
+				// The shaders place vertices at xy * (1, -1) * scale + offset, so this puts the mesh's centre on the draw's offset
+				instances[i].scale = draws[i].scale * meshScale;
+				instances[i].offset = draws[i].offset - glm::vec2(meshBounds.x, -meshBounds.y) * instances[i].scale;
+				instances[i].bounds = glm::vec4(draws[i].offset, draws[i].scale * 0.5f, 0.0f);
+			} else {
+				instances[i].scale = draws[i].scale;
+				instances[i].offset = draws[i].offset;
+				instances[i].bounds = glm::vec4(draws[i].offset, draws[i].scale * TRIANGLE_BOUNDING_RADIUS, 0.0f);
+			}
+		}
+		return instances;
+	}
+
+	/// <summary>
+	/// Hand the draw list to the GPU driven path as instances with bounds, once and for all.
+	/// </summary>
+	void initGpuCulling() {
+		const std::vector<GpuInstance> instances = buildGpuInstances();
+
+		// The cull runs on the async compute queue, its inputs arrive on the transfer queue and its results feed the graphics queue
+		std::vector<uint32_t> sharedFamilies;
+		if (asyncComputeEnabled) {
+			const QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+			const std::set<uint32_t> families = { indices.graphicsFamily.value(), indices.transferFamily.value(), indices.computeFamily.value() };
+			sharedFamilies.assign(families.begin(), families.end());
+		}
+
+		gpuCulling.init(device, memoryAllocator, stagingRing, pipelineCache, cullShaderCode, config.framesInFlight, instances, materialBuffer,
+			sharedFamilies);
+		if (isMeshDrawn()) {
+			gpuCulling.setMesh(gpuMesh.getVertexBuffer(), gpuMesh.getIndexBuffer(), gpuMesh.getIndexCount());
+		}
+	}
+
+	/// <summary>
+	/// The textures come from the same cooked file as the mesh, which the streamer keeps mapped to load mips from.
+	/// </summary>
+	void initTextureStreamer() {
+		textureStreamer.init(physicalDevice, device, std::min(instanceApiVersion, capabilities.getDeviceProperties(physicalDevice).apiVersion),
+			memoryAllocator, stagingRing, deletionQueue, config.meshPath, config.framesInFlight, config.textureBudget, memoryBudgetEnabled);
+	}
+
+	void initMeshletRenderer() {
+		meshletRenderer.init(device, memoryAllocator, stagingRing, gpuMesh, buildGpuInstances(), materialBuffer,
+			capabilities.getMeshShaderProperties(physicalDevice));
+	}
+
+	/// <summary>
+	/// Fences start signalled so the very first wait in drawFrame() doesn't block forever.
+	/// </summary>
+	void createSyncObjects() {
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+		for (size_t i = 0; i < frames.size(); i++) {
+			FrameData& frame = frames[i];
+			if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &frame.imageAvailableSemaphore) != VK_SUCCESS ||
+				vkCreateFence(device, &fenceInfo, nullptr, &frame.inFlightFence) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create synchronization objects for a frame!");
+			}
+			debugUtils.setObjectName(frame.imageAvailableSemaphore, VK_OBJECT_TYPE_SEMAPHORE, "Frame %zu image available", i);
+			debugUtils.setObjectName(frame.inFlightFence, VK_OBJECT_TYPE_FENCE, "Frame %zu in flight", i);
+
+			if (asyncComputeEnabled) {
+				if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &frame.computeFinishedSemaphore) != VK_SUCCESS) {
+					throw std::runtime_error("Failed to create synchronization objects for a frame!");
+				}
+				debugUtils.setObjectName(frame.computeFinishedSemaphore, VK_OBJECT_TYPE_SEMAPHORE, "Frame %zu compute finished", i);
+			}
+		}
+
+		createSwapChainSyncObjects();
+	}
+
+	/// <summary>
+	/// Per swap chain image sync state. Split out from createSyncObjects() because it has to follow the image count on recreation.
+	/// </summary>
+	void createSwapChainSyncObjects() {
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+		renderFinishedSemaphores.resize(swapChainImages.size());
+		for (size_t i = 0; i < renderFinishedSemaphores.size(); i++) {
+			if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create synchronization objects for a swap chain image!");
+			}
+			debugUtils.setObjectName(renderFinishedSemaphores[i], VK_OBJECT_TYPE_SEMAPHORE, "Image %zu render finished", i);
+		}
+
+		imagesInFlight.assign(swapChainImages.size(), VK_NULL_HANDLE);
+	}
+
+	/// <summary>
+	/// Time a startup step that runs on the main thread.
+	/// </summary>
+	void startupStep(const char* name, const std::function<void()>& step) {
+		StartupTimeline::Scope scope(startupTimeline, name);
+		step();
+	}
+
+	/// <summary>
+	/// Run a startup step on the job system, optionally only once dependency has finished. Exceptions are kept for
+	/// joinStartupTasks() to rethrow on the main thread, and once one step has failed the ones that haven't started are skipped.
+	/// </summary>
+	void startupTask(const char* name, JobCounter& counter, std::function<void()> step, JobCounter* dependency = nullptr) {
+		auto task = [this, name, step = std::move(step)] {
+			{
+				std::lock_guard<std::mutex> lock(startupErrorMutex);
+				if (startupError) {
+					return;
+				}
+			}
+
+			try {
+				StartupTimeline::Scope scope(startupTimeline, name);
+				step();
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(startupErrorMutex);
+				if (!startupError) {
+					startupError = std::current_exception();
+				}
+			}
+		};
+
+		if (dependency) {
+			jobSystem->scheduleAfter(*dependency, std::move(task), &counter);
+		} else {
+			jobSystem->schedule(std::move(task), &counter);
+		}
+	}
+
+	/// <summary>
+	/// Wait for counter's tasks and rethrow the first startup failure, if any.
+	/// </summary>
+	void joinStartupTasks(JobCounter& counter) {
+		jobSystem->wait(counter);
+
+		std::lock_guard<std::mutex> lock(startupErrorMutex);
+		if (startupError) {
+			std::rethrow_exception(startupError);
+		}
+	}
+
+	/// <summary>
+	/// Bring up the window and Vulkan. Everything that doesn't need the previous step is handed to the job system first,
+	/// so the instance, device enumeration, shaders and the pipeline cache file are all being worked on while the main
+	/// thread creates the window. Steps only wait for what they actually consume.
+	/// </summary>
+	void startup() {
+		frames.resize(config.framesInFlight);
+		for (auto& frame : frames) {
+			frame.arena.init(static_cast<size_t>(config.frameArenaSize));
+		}
+
+		// GLFW has to be initialized before anything else touches it, including glfwGetRequiredInstanceExtensions in createInstance()
+		if (!config.headless) {
+			startupStep("glfwInit", [] { glfwInit(); });
+		}
+
+		JobCounter instanceCreated;
+		JobCounter devicesEnumerated;
+		JobCounter filesLoaded;
+		startupTask("createInstance", instanceCreated, [this] { createInstance(); });
+		startupTask("enumeratePhysicalDevices", devicesEnumerated, [this] { enumeratePhysicalDevices(); }, &instanceCreated);
+		startupTask("loadShaders", filesLoaded, [this] { loadShaders(); });
+		startupTask("preloadPipelineCache", filesLoaded, [this] { pipelineCache.preload(config.pipelineCachePath); });
+
+		try {
+			// GLFW windows can only be created on the main thread
+			if (!config.headless) {
+				startupStep("initWindow", [this] { initWindow(); });
+			}
+
+			joinStartupTasks(devicesEnumerated);
+			if (config.printCapabilities) {
+				capabilities.print(std::cout);
+			}
+
+			if (!config.headless) {
+				startupStep("createSurface", [this] { createSurface(); });
+			}
+			startupStep("pickPhysicalDevice", [this] { pickPhysicalDevice(); });
+			startupStep("createLogicalDevice", [this] { createLogicalDevice(); });
+			startupStep("initMemoryAllocator", [this] {
+				memoryAllocator.init(physicalDevice, device, config.memoryBlockSize);
+				deletionQueue.init(config.framesInFlight);
+			});
+			startupStep("initStagingRing", [this] { initStagingRing(); });
+			startupStep("initProfiler", [this] { initProfiler(); });
+			startupStep("createSwapChain", [this] {
+				if (config.headless) {
+					createOffscreenTarget();
+				} else {
+					createSwapChain();
+				}
+				createImageViews();
+			});
+		} catch (...) {
+			// The file loading tasks write into this object, so they have to be done before the exception unwinds it
+			jobSystem->wait(filesLoaded);
+			throw;
+		}
+
+		joinStartupTasks(filesLoaded);
+		startupStep("initPipelineCache", [this] {
+			pipelineCache.init(physicalDevice, device, config.pipelineCachePath, pipelineCreationFeedbackSupported);
+			pipelineLayoutCache.init(device);
+			pipelineCompiler.init(device, *jobSystem, deletionQueue,
+				config.pipelineCachePath.empty() ? "" : config.pipelineCachePath + ".pipelines");
+		});
+		startupStep("createDescriptors", [this] { createDescriptors(); createMaterials(); });
+		startupStep("buildScene", [this] {
+			buildDrawList();
+			initUniformRing();
+			if (isMeshDrawn()) {
+				loadMesh();
+			}
+			if (gpuDrivenEnabled) {
+				initGpuCulling();
+			}
+			if (meshShadersEnabled) {
+				initMeshletRenderer();
+			}
+			if (textureStreamingEnabled) {
+				initTextureStreamer();
+			}
+			if (isSimulated()) {
+				startSimulation();
+			}
+		});
+		startupStep("createGraphicsPipeline", [this] { createRenderPass(); createGraphicsPipeline(); });
+		startupStep("createFrameResources", [this] {
+			createFramebuffers();
+			createCommandPools();
+			createSyncObjects();
+			const QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+			const uint32_t computeFamily = asyncComputeEnabled ? indices.computeFamily.value() : VK_QUEUE_FAMILY_IGNORED;
+			for (auto& frame : frames) {
+				frame.renderGraph.init(device, memoryAllocator, synchronization2Enabled, indices.graphicsFamily.value(), computeFamily);
+			}
+		});
+		if (config.shaderHotReload) {
+			shaderWatcher.start(std::vector<ShaderSource>(std::begin(SHADER_SOURCES), std::end(SHADER_SOURCES)));
+		}
+
+		startupTimeline.print(std::cout);
+	}
+
+	/// <summary>
+	/// Fill visibleDraws for the CPU path with config.cpuCulling. The scene and the tree over it are only touched again
+	/// when something moved.
+	/// </summary>
+	void cullDrawList() {
+		const bool moved = scene.update(jobSystem.get());
+
+		visibleDraws.clear();
+		switch (config.cpuCulling) {
+		case CpuCulling::None:
+			visibleDraws.resize(draws.size());
+			std::iota(visibleDraws.begin(), visibleDraws.end(), 1u); // As entities, like the culling paths hand them back
+			break;
+		case CpuCulling::BruteForce:
+			cullBruteForce(scene.getWorldBoundsColumns(), SCREEN_FRUSTUM, visibleDraws);
+			break;
+		case CpuCulling::Simd:
+			cullSimd(scene.getWorldBoundsColumns(), SCREEN_FRUSTUM, visibleDraws);
+			break;
+		case CpuCulling::Bvh:
+			if (moved || sceneBvh.getStats().builds == 0) {
+				sceneBvh.update(scene);
+			}
+			sceneBvh.cull(SCREEN_FRUSTUM, visibleDraws);
+			break;
+		}
+
+		// Entities to draw indices, dropping the root. Culling order is kept, whatever it is.
+		size_t count = 0;
+		for (uint32_t entity : visibleDraws) {
+			if (entity != 0) {
+				visibleDraws[count++] = entity - 1;
+			}
+		}
+		visibleDraws.resize(count);
+	}
+
+	/// <summary>
+	/// Sort visibleDraws by state and merge the runs that share it into drawBatcher's batches. There is one pipeline and
+	/// one mesh so far, so the material is what tells batches apart; the shaders read it per instance, but the split is
+	/// where binding a real material's textures would go.
+	/// </summary>
+	void batchDrawList() {
+		drawBatcher.clear();
+		for (uint32_t draw : visibleDraws) {
+			const float depth = scene.getWorldPosition(draw + 1).z; // Clip space z, the scene has no camera yet
+			drawBatcher.add(DrawBatcher::makeKey(0, draws[draw].materialIndex, 0, depth), draw);
+		}
+		drawBatcher.build();
+	}
+
+	/// <summary>
+	/// Record visibleDraws [begin, end) into a command buffer that is already inside the render pass. Secondaries inherit no state
+	/// from the primary, so the pipeline, descriptor sets and dynamic state are bound every time. Safe to call from several
+	/// threads at once, each call takes its own slice of the uniform ring.
+	/// </summary>
+	void recordDraws(VkCommandBuffer commandBuffer, uint32_t begin, uint32_t end) {
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+
+		// One bind covers every draw: materials are picked by the index in each draw's uniforms
+		VkDescriptorSet set = bindlessEnabled ? bindlessDescriptors.getSet() : descriptorSet;
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &set, 0, nullptr);
+
+		DrawPushConstants constants{ materialBufferIndex };
+		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawPushConstants), &constants);
+
+		setDynamicState(commandBuffer, PipelineGeometry::Triangle);
+
+		const VkDeviceSize stride = uniformRing.getStride<ObjectUniforms>();
+		uint32_t firstOffset = 0;
+		char* mapped = static_cast<char*>(uniformRing.allocate(stride, end - begin, firstOffset));
+
+		VkDescriptorSet uniformSet = uniformRing.getSet();
+		for (uint32_t i = begin; i < end; i++) {
+			const VkDeviceSize slot = (i - begin) * stride;
+			std::memcpy(mapped + slot, &draws[visibleDraws[i]], sizeof(ObjectUniforms));
+
+			const uint32_t dynamicOffset = firstOffset + static_cast<uint32_t>(slot);
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &uniformSet, 1, &dynamicOffset);
+			vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+		}
+	}
+
+	/// <summary>
+	/// Record drawBatcher's batches into a command buffer that is already inside the render pass, one instanced draw each.
+	/// The instances' data goes into the uniform ring back to back in sort order, so a batch's firstInstance is where its
+	/// run starts in the frame's storage view and nothing is rebound between batches.
+	/// </summary>
+	void recordBatchedDraws(VkCommandBuffer commandBuffer) {
+		const std::vector<uint32_t>& sortedDraws = drawBatcher.getSortedDraws();
+		if (sortedDraws.empty()) {
+			return;
+		}
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, instancedPipeline);
+
+		VkDescriptorSet sets[] = { bindlessEnabled ? bindlessDescriptors.getSet() : descriptorSet, uniformRing.getStorageSet() };
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, instancedPipelineLayout, 0, 2, sets, 0, nullptr);
+
+		DrawPushConstants constants{ materialBufferIndex };
+		vkCmdPushConstants(commandBuffer, instancedPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawPushConstants), &constants);
+
+		setDynamicState(commandBuffer, PipelineGeometry::Triangle);
+
+		// In whole slots of the ring's alignment, which is a multiple of sizeof(ObjectUniforms)
+		const VkDeviceSize alignment = uniformRing.getAlignment();
+		const VkDeviceSize bytes = sizeof(ObjectUniforms) * sortedDraws.size();
+		uint32_t dynamicOffset = 0;
+		ObjectUniforms* instances = static_cast<ObjectUniforms*>(
+			uniformRing.allocate(alignment, static_cast<uint32_t>((bytes + alignment - 1) / alignment), dynamicOffset));
+		for (size_t i = 0; i < sortedDraws.size(); i++) {
+			instances[i] = draws[sortedDraws[i]];
+		}
+
+		const uint32_t firstInstance = static_cast<uint32_t>(uniformRing.getRegionOffset(dynamicOffset) / sizeof(ObjectUniforms));
+		for (const DrawBatch& batch : drawBatcher.getBatches()) {
+			vkCmdDraw(commandBuffer, 3, batch.drawCount, 0, firstInstance + batch.firstDraw);
+		}
+	}
+
+	/// <summary>
+	/// The GPU driven path's whole render pass: one indirect call draws every instance the cull pass kept.
+	/// </summary>
+	void recordIndirectDraws(VkCommandBuffer commandBuffer) {
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, indirectPipeline);
+		setDynamicState(commandBuffer, isMeshDrawn() ? PipelineGeometry::MeshVertices : PipelineGeometry::Triangle);
+		bindStreamedTextures(commandBuffer, indirectPipelineLayout);
+		gpuCulling.recordDraw(commandBuffer, currentFrame, indirectPipelineLayout);
+	}
+
+	/// <summary>
+	/// The mesh shader path's whole render pass: the task shaders cull and the mesh shaders draw, so there is nothing before it.
+	/// </summary>
+	void recordMeshletDraws(VkCommandBuffer commandBuffer) {
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, meshletPipeline);
+		setDynamicState(commandBuffer, PipelineGeometry::Meshlets);
+		bindStreamedTextures(commandBuffer, meshletPipelineLayout);
+		meshletRenderer.recordDraw(commandBuffer, meshletPipelineLayout, SCREEN_PLANES);
+	}
+
+	/// <summary>
+	/// Set 1 of the GPU paths, with this frame's feedback buffer. Nothing to bind without texture streaming.
+	/// </summary>
+	void bindStreamedTextures(VkCommandBuffer commandBuffer, VkPipelineLayout layout) {
+		if (!textureStreamingEnabled) {
+			return;
+		}
+		const VkDescriptorSet set = textureStreamer.getSet(currentFrame);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 1, 1, &set, 0, nullptr);
+	}
+
+	/// <summary>
+	/// Everything the bound pipeline left dynamic: viewport and scissor always, the raster state of its geometry when the
+	/// device has extended dynamic state.
+	/// </summary>
+	void setDynamicState(VkCommandBuffer commandBuffer, PipelineGeometry geometry) {
+		VkViewport viewport{};
+		viewport.x = 0.0f;
+		viewport.y = 0.0f;
+		viewport.width = static_cast<float>(swapChainExtent.width);
+		viewport.height = static_cast<float>(swapChainExtent.height);
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+		VkRect2D scissor{};
+		scissor.offset = { 0, 0 };
+		scissor.extent = swapChainExtent;
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+		dynamicState.setRasterState(commandBuffer, getRasterState(geometry));
+	}
+
+	/// <summary>
+	/// Begin the main pass on swap chain image imageIndex, cleared to black: vkCmdBeginRenderPass with its framebuffer,
+	/// or dynamic rendering straight to the image view. next goes on the begin info, the split frame device group info
+	/// fits either. With secondaryContents only vkCmdExecuteCommands may follow until endMainPass().
+	/// </summary>
+	void beginMainPass(VkCommandBuffer commandBuffer, uint32_t imageIndex, const void* next, bool secondaryContents) {
+		VkClearValue clearColor = { {{0.0f, 0.0f, 0.0f, 1.0f}} };
+		VkRect2D renderArea{};
+		renderArea.offset = { 0, 0 };
+		renderArea.extent = swapChainExtent;
+
+		if (dynamicState.isDynamicRendering()) {
+			// The render graph has already moved the image into the attachment layout, as with the render pass
+			VkRenderingAttachmentInfo colorAttachment{};
+			colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+			colorAttachment.imageView = swapChainImageViews[imageIndex];
+			colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			colorAttachment.clearValue = clearColor;
+
+			VkRenderingInfo renderingInfo{};
+			renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+			renderingInfo.pNext = next;
+			renderingInfo.flags = secondaryContents ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT : 0;
+			renderingInfo.renderArea = renderArea;
+			renderingInfo.layerCount = 1;
+			renderingInfo.colorAttachmentCount = 1;
+			renderingInfo.pColorAttachments = &colorAttachment;
+			dynamicState.beginRendering(commandBuffer, renderingInfo);
+			return;
+		}
+
+		VkRenderPassBeginInfo renderPassInfo{};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.pNext = next;
+		renderPassInfo.renderPass = renderPass;
+		renderPassInfo.framebuffer = swapChainFramebuffers[imageIndex];
+		renderPassInfo.renderArea = renderArea;
+		renderPassInfo.clearValueCount = 1;
+		renderPassInfo.pClearValues = &clearColor;
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, secondaryContents ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+	}
+
+	void endMainPass(VkCommandBuffer commandBuffer) {
+		if (dynamicState.isDynamicRendering()) {
+			dynamicState.endRendering(commandBuffer);
+		} else {
+			vkCmdEndRenderPass(commandBuffer);
+		}
+	}
+
+	/// <summary>
+	/// Record one secondary per job system batch, all inheriting the render pass the primary is about to begin.
+	/// Batches map to secondaries by index rather than by recording thread, so execution order is draw order no matter who recorded what.
+	/// </summary>
+	ArenaVector<VkCommandBuffer> recordSecondaries(FrameData& frame, uint32_t imageIndex) {
+		const uint32_t drawCount = static_cast<uint32_t>(visibleDraws.size());
+		const uint32_t threadCount = jobSystem->getThreadCount();
+		const uint32_t batchSize = std::max(MIN_DRAWS_PER_SECONDARY, (drawCount + threadCount - 1) / threadCount);
+
+		// Sized up front on this thread, the workers only write their own slot
+		ArenaVector<VkCommandBuffer> secondaries((drawCount + batchSize - 1) / batchSize, VK_NULL_HANDLE, ArenaAllocator<VkCommandBuffer>(frame.arena));
+
+		VkCommandBufferInheritanceInfo inheritanceInfo{};
+		inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritanceInfo.renderPass = renderPass;
+		inheritanceInfo.subpass = 0;
+		inheritanceInfo.pipelineStatistics = profiler.getStatisticsFlags(); // They run inside the render pass scope's query
+
+		// Dynamic rendering has no render pass to inherit, the secondaries are told the attachment formats instead
+		VkCommandBufferInheritanceRenderingInfo inheritanceRenderingInfo{};
+		inheritanceRenderingInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+		inheritanceRenderingInfo.colorAttachmentCount = 1;
+		inheritanceRenderingInfo.pColorAttachmentFormats = &swapChainImageFormat;
+		inheritanceRenderingInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+		if (dynamicState.isDynamicRendering()) {
+			inheritanceInfo.pNext = &inheritanceRenderingInfo;
+		} else {
+			inheritanceInfo.framebuffer = swapChainFramebuffers[imageIndex]; // Optional, but lets some drivers skip work at execute time
+		}
+
+		jobSystem->parallelFor(drawCount, batchSize, [&](uint32_t begin, uint32_t end) {
+			VkCommandBuffer secondary = frame.commandPools.acquire(JobSystem::getThreadIndex(), VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+
+			VkCommandBufferBeginInfo beginInfo{};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+			if (vkBeginCommandBuffer(secondary, &beginInfo) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to begin recording secondary command buffer!");
+			}
+
+			recordDraws(secondary, begin, end);
+
+			if (vkEndCommandBuffer(secondary) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to record secondary command buffer!");
+			}
+
+			secondaries[begin / batchSize] = secondary;
+		});
+
+		return secondaries;
+	}
+
+	/// <summary>
+	/// Returns the staging ring value the submission has to wait on before touching freshly uploaded data, 0 for none.
+	/// </summary>
+	uint64_t recordCommandBuffer(FrameData& frame, uint32_t imageIndex) {
+		VkCommandBuffer commandBuffer = frame.commandBuffer;
+
+		// While the instanced pipeline compiles, batching falls back to a draw per object through the draw pipeline, as long
+		// as the ring, sized for packed instances, has room for a slot per draw. What has no pipeline yet just isn't drawn,
+		// the render pass still clears.
+		const bool batched = drawBatchingEnabled && instancedPipeline != VK_NULL_HANDLE;
+		const bool skipDraws = meshShadersEnabled ? meshletPipeline == VK_NULL_HANDLE
+			: gpuDrivenEnabled ? indirectPipeline == VK_NULL_HANDLE
+			: !batched && uniformRing.getStride<ObjectUniforms>() * visibleDraws.size() > uniformRing.getRegionSize();
+
+		// Small draw lists aren't worth waking the workers for, record them straight into the primary.
+		// The GPU paths record a fixed handful of commands and batching leaves a draw per batch, so there is nothing to spread out.
+		// Secondaries can only run inside the render pass scope's statistics query with inheritedQueries.
+		const bool parallel = !gpuDrivenEnabled && !meshShadersEnabled && !batched && !skipDraws && jobSystem->getThreadCount() > 1
+			&& visibleDraws.size() >= 2 * MIN_DRAWS_PER_SECONDARY && (!pipelineStatisticsEnabled || inheritedQueriesEnabled);
+
+		// Secondaries are recorded before the primary is begun, they only need to know which render pass they'll land in
+		ArenaVector<VkCommandBuffer> secondaries{ ArenaAllocator<VkCommandBuffer>(frame.arena) };
+		if (parallel) {
+			Profiler::Scope scope(profiler, "recordSecondaries");
+			secondaries = recordSecondaries(frame, imageIndex);
+		}
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		// Secondaries keep the default mask of every device, which covers whichever ones the primary runs on
+		VkDeviceGroupCommandBufferBeginInfo deviceGroupBeginInfo{};
+		deviceGroupBeginInfo.sType = VK_STRUCTURE_TYPE_DEVICE_GROUP_COMMAND_BUFFER_BEGIN_INFO;
+		deviceGroupBeginInfo.deviceMask = frameDeviceMask;
+		if (deviceGroupMode != DeviceGroupMode::None) {
+			beginInfo.pNext = &deviceGroupBeginInfo;
+		}
+
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to begin recording command buffer!");
+		}
+
+		profiler.recordReset(commandBuffer);
+		const uint64_t uploadWaitValue = stagingRing.recordAcquires(commandBuffer);
+
+		RenderGraph& graph = frame.renderGraph;
+		graph.reset();
+
+		// Windowed, the image can't be touched before the acquire semaphore's wait at the color output stage. Headless, the
+		// last frame left the one offscreen image ready to be copied out, and this frame overwrites it.
+		const RenderGraph::ResourceId backbuffer = config.headless
+			? graph.importImage("offscreen", swapChainImages[imageIndex], VK_IMAGE_ASPECT_COLOR_BIT,
+				{ VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED }, RenderGraphUsage::TransferSource)
+			: graph.importImage("backbuffer", swapChainImages[imageIndex], VK_IMAGE_ASPECT_COLOR_BIT,
+				{ VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED }, RenderGraphUsage::Present);
+
+		RenderGraph::ResourceId indirectCommands = 0;
+		RenderGraph::ResourceId drawCount = 0;
+		if (gpuDrivenEnabled) {
+			// Last time's indirect reads of these were fenced, so they start out with nothing to wait for. The count is also
+			// read back by the host for the stats once the fence has signalled.
+			indirectCommands = graph.importBuffer("indirectCommands", gpuCulling.getIndirectBuffer(currentFrame), RenderGraphState{}, RenderGraphUsage::None);
+			drawCount = graph.importBuffer("drawCount", gpuCulling.getCountBuffer(currentFrame), RenderGraphState{}, RenderGraphUsage::HostRead);
+
+			graph.addPass("cull", [this](VkCommandBuffer commandBuffer) {
+				DebugUtils::Label label(debugUtils, commandBuffer, "cull");
+				const uint32_t cullScope = profiler.beginGpuScope(commandBuffer, "cull");
+				gpuCulling.recordCull(commandBuffer, currentFrame, SCREEN_PLANES);
+				profiler.endGpuScope(commandBuffer, cullScope);
+			})
+				.write(indirectCommands, RenderGraphUsage::StorageWriteCompute)
+				.write(drawCount, RenderGraphUsage::StorageWriteCompute)
+				.asyncCompute();
+		}
+
+		RenderGraph::ResourceId textureFeedback = 0;
+		if (textureStreamingEnabled) {
+			// Reset by the host before the submission, which makes that visible, and read back once the fence has signalled
+			textureFeedback = graph.importBuffer("textureFeedback", textureStreamer.getFeedbackBuffer(currentFrame), RenderGraphState{},
+				RenderGraphUsage::HostRead);
+		}
+
+		RenderGraph::PassBuilder drawPass = graph.addPass("renderPass", [this, &secondaries, batched, skipDraws, parallel, imageIndex](VkCommandBuffer commandBuffer) {
+			// Split frame: each device of the group rasterizes its own band of rows, the last one takes the remainder
+			VkRect2D deviceRenderAreas[VK_MAX_DEVICE_GROUP_SIZE];
+			VkDeviceGroupRenderPassBeginInfo deviceGroupInfo{};
+			if (deviceGroupMode == DeviceGroupMode::SplitFrame) {
+				const uint32_t deviceCount = static_cast<uint32_t>(deviceGroup.size());
+				const uint32_t bandHeight = swapChainExtent.height / deviceCount;
+				for (uint32_t i = 0; i < deviceCount; i++) {
+					deviceRenderAreas[i].offset = { 0, static_cast<int32_t>(i * bandHeight) };
+					deviceRenderAreas[i].extent = { swapChainExtent.width, i + 1 < deviceCount ? bandHeight : swapChainExtent.height - i * bandHeight };
+				}
+				deviceGroupInfo.sType = VK_STRUCTURE_TYPE_DEVICE_GROUP_RENDER_PASS_BEGIN_INFO;
+				deviceGroupInfo.deviceMask = frameDeviceMask;
+				deviceGroupInfo.deviceRenderAreaCount = deviceCount;
+				deviceGroupInfo.pDeviceRenderAreas = deviceRenderAreas;
+			}
+			const void* next = deviceGroupMode == DeviceGroupMode::SplitFrame ? &deviceGroupInfo : nullptr;
+			const bool secondaryContents = parallel && !skipDraws && !meshShadersEnabled && !gpuDrivenEnabled;
+
+			DebugUtils::Label label(debugUtils, commandBuffer, "renderPass");
+			const uint32_t renderPassScope = profiler.beginGpuScope(commandBuffer, "renderPass");
+			beginMainPass(commandBuffer, imageIndex, next, secondaryContents);
+			if (skipDraws) {
+				// Only the clear
+			} else if (meshShadersEnabled) {
+				recordMeshletDraws(commandBuffer);
+			} else if (gpuDrivenEnabled) {
+				recordIndirectDraws(commandBuffer);
+			} else if (parallel) {
+				vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+			} else if (batched) {
+				recordBatchedDraws(commandBuffer);
+			} else {
+				recordDraws(commandBuffer, 0, static_cast<uint32_t>(visibleDraws.size()));
+			}
+			endMainPass(commandBuffer);
+			profiler.endGpuScope(commandBuffer, renderPassScope);
+		});
+		drawPass.write(backbuffer, RenderGraphUsage::ColorAttachment);
+		if (gpuDrivenEnabled) {
+			drawPass.read(indirectCommands, RenderGraphUsage::IndirectRead).read(drawCount, RenderGraphUsage::IndirectRead);
+		}
+		if (textureStreamingEnabled) {
+			drawPass.write(textureFeedback, RenderGraphUsage::StorageWriteFragment);
+		}
+
+		graph.compile();
+		if (config.printRenderGraph && framesSubmitted == 0) {
+			graph.dump(std::cout);
+		}
+
+		if (graph.hasComputeWork()) {
+			if (vkBeginCommandBuffer(frame.computeCommandBuffer, &beginInfo) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to begin recording compute command buffer!");
+			}
+			profiler.recordComputeReset(frame.computeCommandBuffer);
+		}
+		graph.execute(commandBuffer, frame.computeCommandBuffer);
+		if (graph.hasComputeWork() && vkEndCommandBuffer(frame.computeCommandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to record compute command buffer!");
+		}
+
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to record command buffer!");
+		}
+
+		return uploadWaitValue;
+	}
+
+	/// <summary>
+	/// Submit the frame's async compute work, signalling computeFinishedSemaphore for the graphics submission. It reads the
+	/// scene the staging ring uploads, so it waits for those too; later compute submissions are ordered after this one.
+	/// </summary>
+	void submitCompute(FrameData& frame, uint64_t uploadWaitValue) {
+		VkSemaphore waitSemaphore = stagingRing.getSemaphore();
+		VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+		VkTimelineSemaphoreSubmitInfo timelineInfo{};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.waitSemaphoreValueCount = uploadWaitValue != 0 ? 1 : 0;
+		timelineInfo.pWaitSemaphoreValues = &uploadWaitValue;
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = &timelineInfo;
+		submitInfo.waitSemaphoreCount = uploadWaitValue != 0 ? 1 : 0;
+		submitInfo.pWaitSemaphores = &waitSemaphore;
+		submitInfo.pWaitDstStageMask = &waitStage;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &frame.computeCommandBuffer;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &frame.computeFinishedSemaphore;
+
+		VkDeviceGroupSubmitInfo deviceGroupInfo{};
+		chainDeviceGroupSubmit(submitInfo, deviceGroupInfo);
+
+		if (vkQueueSubmit(computeQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to submit compute command buffer!");
+		}
+	}
+
+	/// <summary>
+	/// One acquire -> record -> submit -> present cycle. The only CPU wait is on the fence of the frame slot we're about to reuse,
+	/// which was submitted framesInFlight frames ago, so the CPU records ahead while the GPU works through the earlier frames.
+	/// </summary>
+	void drawFrame() {
+		FrameData& frame = frames[currentFrame];
+
+		{
+			Profiler::Scope scope(profiler, "waitForFrame");
+			vkWaitForFences(device, 1, &frame.inFlightFence, VK_TRUE, UINT64_MAX);
+		}
+		// Before anything this frame defers a deletion, so it lands in this frame's batch
+		deletionQueue.beginFrame(framesSubmitted);
+
+		// Headless frames all go to the one offscreen image, there is nothing to acquire
+		uint32_t imageIndex = 0;
+		if (!config.headless) {
+			VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, frame.imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+
+			if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+				recreateSwapChain();
+				return;
+			} else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+				throw std::runtime_error("Failed to acquire swap chain image!");
+			}
+
+			// The image may have been handed out ahead of order and still be in use by an older frame slot
+			if (imagesInFlight[imageIndex] != VK_NULL_HANDLE && imagesInFlight[imageIndex] != frame.inFlightFence) {
+				vkWaitForFences(device, 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+			}
+			imagesInFlight[imageIndex] = frame.inFlightFence;
+		}
+
+		// Only reset the fence once we know we'll submit work that signals it, otherwise an early return would deadlock the next wait
+		vkResetFences(device, 1, &frame.inFlightFence);
+
+		// The fence wait above means the GPU is done with everything this frame recorded last time round
+		updateFrameDevices();
+		pipelineCompiler.beginFrame();
+		acquirePipelines();
+		if (gpuDrivenEnabled) {
+			gpuCulling.collectStats(currentFrame);
+		}
+		stagingRing.update();
+		frame.commandPools.reset();
+		frame.arena.reset();
+		uniformRing.beginFrame(currentFrame);
+		profiler.beginFrame(currentFrame);
+		if (textureStreamingEnabled) {
+			Profiler::Scope scope(profiler, "textureStreaming");
+			textureStreamer.update(currentFrame, framesSubmitted);
+		}
+		frame.commandBuffer = frame.commandPools.acquire(JobSystem::getThreadIndex(), VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+		debugUtils.setObjectName(frame.commandBuffer, VK_OBJECT_TYPE_COMMAND_BUFFER, "Frame %u primary", currentFrame); // Pooled, so the name has to follow it
+		if (asyncComputeEnabled) {
+			frame.computeCommandPools.reset();
+			frame.computeCommandBuffer = frame.computeCommandPools.acquire(0, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+			debugUtils.setObjectName(frame.computeCommandBuffer, VK_OBJECT_TYPE_COMMAND_BUFFER, "Frame %u compute", currentFrame);
+		}
+
+		if (!gpuDrivenEnabled && !meshShadersEnabled) {
+			Profiler::Scope scope(profiler, "cull");
+			cullDrawList();
+		}
+		if (drawBatchingEnabled && instancedPipeline != VK_NULL_HANDLE) {
+			Profiler::Scope scope(profiler, "batch");
+			batchDrawList();
+		}
+
+		uint64_t uploadWaitValue;
+		{
+			Profiler::Scope scope(profiler, "record");
+			uploadWaitValue = recordCommandBuffer(frame, imageIndex);
+		}
+		uniformRing.endFrame();
+
+		// Async compute goes first: a binary semaphore has to be signalled by an earlier submission than the one waiting on it
+		const bool computeSubmitted = frame.renderGraph.hasComputeWork();
+		if (computeSubmitted) {
+			submitCompute(frame, uploadWaitValue);
+		}
+
+		// Headless skips the acquire semaphore. Uploads can be consumed by any stage, and that wait only exists on frames
+		// right after new data was flushed. The compute wait is what lets the graphics passes before the first consumer of
+		// compute results overlap the compute work.
+		VkSemaphore waitSemaphores[3];
+		VkPipelineStageFlags waitStages[3];
+		uint64_t waitValues[3];
+		uint32_t waitCount = 0;
+		auto addWait = [&](VkSemaphore semaphore, VkPipelineStageFlags stages, uint64_t value) {
+			waitSemaphores[waitCount] = semaphore;
+			waitStages[waitCount] = stages;
+			waitValues[waitCount] = value; // Binary semaphores ignore their value
+			waitCount++;
+		};
+		if (!config.headless) {
+			addWait(frame.imageAvailableSemaphore, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0);
+		}
+		if (uploadWaitValue != 0) {
+			addWait(stagingRing.getSemaphore(), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, uploadWaitValue);
+		}
+		if (computeSubmitted) {
+			addWait(frame.computeFinishedSemaphore, frame.renderGraph.getComputeWaitStages(), 0);
+		}
+		VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[imageIndex] };
+
+		VkTimelineSemaphoreSubmitInfo timelineInfo{};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.waitSemaphoreValueCount = waitCount;
+		timelineInfo.pWaitSemaphoreValues = waitValues;
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = &timelineInfo;
+		submitInfo.waitSemaphoreCount = waitCount;
+		submitInfo.pWaitSemaphores = waitSemaphores;
+		submitInfo.pWaitDstStageMask = waitStages;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &frame.commandBuffer;
+		submitInfo.signalSemaphoreCount = config.headless ? 0 : 1; // Without a present there is nobody to signal
+		submitInfo.pSignalSemaphores = signalSemaphores;
+
+		VkDeviceGroupSubmitInfo deviceGroupInfo{};
+		chainDeviceGroupSubmit(submitInfo, deviceGroupInfo);
+
+		profiler.endFrame();
+		if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, frame.inFlightFence) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to submit draw command buffer!");
+		}
+		framesSubmitted++;
+
+		if (config.headless) {
+			currentFrame = (currentFrame + 1) % config.framesInFlight;
+			return;
+		}
+
+		VkPresentInfoKHR presentInfo{};
+		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+		presentInfo.waitSemaphoreCount = 1;
+		presentInfo.pWaitSemaphores = signalSemaphores;
+		presentInfo.swapchainCount = 1;
+		presentInfo.pSwapchains = &swapChain;
+		presentInfo.pImageIndices = &imageIndex;
+
+		VkResult result = vkQueuePresentKHR(presentQueue, &presentInfo);
+
+		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
+			recreateSwapChain();
+		} else if (result != VK_SUCCESS) {
+			throw std::runtime_error("Failed to present swap chain image!");
+		}
+
+		currentFrame = (currentFrame + 1) % config.framesInFlight;
+	}
+
+	/// <summary>
+	/// Minimized windows have a zero sized framebuffer; there is nothing to render into until they come back.
+	/// </summary>
+	bool isMinimized() {
+		int width = 0, height = 0;
+		glfwGetFramebufferSize(window, &width, &height);
+		return glfwGetWindowAttrib(window, GLFW_ICONIFIED) || width == 0 || height == 0;
+	}
+
+	/// <summary>
+	/// Runs until the window is closed, or for warmupFrames plus frameCount frames when a count is given (always when
+	/// headless). Every frame after the warm up goes into the benchmark numbers.
+	/// </summary>
+	void mainLoop() {
+		const uint32_t measuredFrames = config.frameCount != 0 ? config.frameCount : config.headless ? EngineConfig::DEFAULT_HEADLESS_FRAMES : 0;
+		const uint64_t frameLimit = measuredFrames != 0 ? uint64_t(config.warmupFrames) + measuredFrames : 0;
+
+		std::vector<double> cpuFrameTimes;
+		std::vector<double> gpuFrameTimes;
+		cpuFrameTimes.reserve(measuredFrames);
+		gpuFrameTimes.reserve(measuredFrames);
+
+		uint64_t framesDrawn = 0;
+		uint64_t gpuFramesSeen = 0;
+		std::optional<std::chrono::steady_clock::time_point> previousFrameStart;
+
+		const auto framePeriod = config.frameRateLimit > 0.0
+			? std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / config.frameRateLimit))
+			: std::chrono::steady_clock::duration::zero();
+		auto nextFrameTime = std::chrono::steady_clock::now();
+
+		while (frameLimit == 0 || framesDrawn < frameLimit) {
+			if (!config.headless) {
+				if (glfwWindowShouldClose(window)) {
+					break;
+				}
+
+				if (isMinimized()) {
+					// Sleep until something happens instead of spinning, we'll recheck at least every idleWaitTimeout seconds
+					glfwWaitEventsTimeout(config.idleWaitTimeout);
+					previousFrameStart.reset(); // The nap isn't frame time
+					continue;
+				}
+
+				// Wait out the frame rate cap before polling rather than after drawing, so the frame about to be built
+				// sees input that is at most this loop's own overhead old
+				if (framePeriod != std::chrono::steady_clock::duration::zero()) {
+					sleepUntil(nextFrameTime);
+					const auto now = std::chrono::steady_clock::now();
+					// A frame that ran long restarts the schedule instead of racing through the next few to catch up
+					nextFrameTime = now - nextFrameTime > framePeriod ? now + framePeriod : nextFrameTime + framePeriod;
+				}
+
+				if (!glfwGetWindowAttrib(window, GLFW_FOCUSED)) {
+					// Nobody is interacting with us, throttle down to roughly one frame per idleWaitTimeout
+					glfwWaitEventsTimeout(config.idleWaitTimeout);
+				} else {
+					glfwPollEvents();
+				}
+			}
+
+			// Start to start, so every wait the frame loop does counts
+			const auto frameStart = std::chrono::steady_clock::now();
+			if (previousFrameStart && framesDrawn > config.warmupFrames) {
+				cpuFrameTimes.push_back(std::chrono::duration<double, std::milli>(frameStart - *previousFrameStart).count());
+			}
+			previousFrameStart = frameStart;
+
+			if (config.shaderHotReload) {
+				reloadShaders();
+			}
+			if (isSimulated()) {
+				applySimulation();
+			}
+
+			{
+				Profiler::Scope scope(profiler, "frame");
+				drawFrame();
+			}
+			framesDrawn++;
+
+			// GPU times come back framesInFlight frames late, skip the ones that still belong to the warm up
+			if (profiler.getGpuFramesCollected() != gpuFramesSeen) {
+				gpuFramesSeen = profiler.getGpuFramesCollected();
+				if (framesDrawn > uint64_t(config.warmupFrames) + config.framesInFlight) {
+					gpuFrameTimes.push_back(profiler.getLastGpuFrameMilliseconds());
+				}
+			}
+
+			// No text rendering yet, so the overlay lives in the title bar
+			std::string overlay;
+			if (!config.headless && profiler.getOverlayText(overlay)) {
+				if (drawBatchingEnabled) {
+					overlay += " | " + std::to_string(drawBatcher.getStats().lastDrawCalls) + " draw calls, "
+						+ std::to_string(drawBatcher.getStats().lastStateChanges) + " state changes";
+				}
+				glfwSetWindowTitle(window, ("Vulkan | " + overlay).c_str());
+			}
+		}
+
+		// Let the GPU finish with every frame in flight before cleanup() starts destroying what they reference
+		vkDeviceWaitIdle(device);
+
+		finishBenchmark(cpuFrameTimes, gpuFrameTimes);
+	}
+
+	/// <summary>
+	/// Fill in benchmarkResult, print it in short and write it out as JSON if asked to. Memory is sampled before cleanup()
+	/// starts freeing things.
+	/// </summary>
+	void finishBenchmark(std::vector<double>& cpuFrameTimes, std::vector<double>& gpuFrameTimes) {
+		benchmarkResult.scene = config.benchmarkScene.empty() ? "custom" : config.benchmarkScene;
+		benchmarkResult.deviceName = capabilities.getDeviceProperties(physicalDevice).deviceName;
+		benchmarkResult.devices = static_cast<uint32_t>(deviceGroup.size());
+		benchmarkResult.frames = static_cast<uint32_t>(cpuFrameTimes.size());
+		benchmarkResult.threads = jobSystem->getThreadCount();
+		benchmarkResult.bindless = bindlessEnabled;
+		benchmarkResult.gpuDriven = gpuDrivenEnabled;
+		benchmarkResult.drawBatching = drawBatchingEnabled;
+		benchmarkResult.meshShaders = meshShadersEnabled;
+		if (meshShadersEnabled || gpuDrivenEnabled) {
+			benchmarkResult.drawCalls = 1; // However many draws the indirect count or the task shaders turn it into on the GPU
+			benchmarkResult.triangles = uint64_t(draws.size()) * (isMeshDrawn() ? gpuMesh.getIndexCount() / 3 : 1);
+		} else if (drawBatchingEnabled) {
+			benchmarkResult.drawCalls = drawBatcher.getStats().lastDrawCalls;
+			benchmarkResult.stateChanges = drawBatcher.getStats().lastStateChanges;
+			benchmarkResult.triangles = visibleDraws.size();
+		} else {
+			benchmarkResult.drawCalls = static_cast<uint32_t>(visibleDraws.size());
+			benchmarkResult.triangles = visibleDraws.size();
+		}
+		const PipelineCompilerStats pipelineStats = pipelineCompiler.getStats();
+		benchmarkResult.pipelineHitchFrames = pipelineStats.hitchFrames;
+		benchmarkResult.pipelineCompileHistogram.assign(std::begin(pipelineStats.histogram), std::end(pipelineStats.histogram));
+		benchmarkResult.cpu = summarizeFrameTimes(cpuFrameTimes);
+		benchmarkResult.gpu = summarizeFrameTimes(gpuFrameTimes);
+
+		const DeviceMemoryStats memoryStats = memoryAllocator.getStats();
+		benchmarkResult.deviceMemoryBytes = memoryStats.dedicatedBytes;
+		benchmarkResult.deviceMemoryReserved = memoryStats.dedicatedBytes;
+		for (const auto& pool : memoryStats.pools) {
+			benchmarkResult.deviceMemoryBytes += pool.totals.bytesUsed;
+			benchmarkResult.deviceMemoryReserved += pool.totals.capacity;
+		}
+		benchmarkResult.deviceMemoryAllocations = memoryStats.deviceMemoryAllocationCount;
+
+		if (benchmarkResult.frames > 0) {
+			const auto flags = std::cout.flags();
+			const auto precision = std::cout.precision();
+			std::cout << std::fixed << std::setprecision(3) << "Benchmark " << benchmarkResult.scene << ": " << benchmarkResult.frames
+				<< " frames, CPU p50/p95/p99 " << benchmarkResult.cpu.p50 << "/" << benchmarkResult.cpu.p95 << "/" << benchmarkResult.cpu.p99
+				<< " ms, GPU p50/p95/p99 " << benchmarkResult.gpu.p50 << "/" << benchmarkResult.gpu.p95 << "/" << benchmarkResult.gpu.p99
+				<< " ms, " << benchmarkResult.deviceMemoryBytes / (1024.0 * 1024.0) << " MiB device memory";
+			if (benchmarkResult.gpu.p50 > 0.0) {
+				std::cout << ", " << benchmarkResult.triangles / (benchmarkResult.gpu.p50 * 1000.0) << " Mtris/s at GPU p50";
+			}
+			std::cout << std::endl;
+			std::cout.flags(flags);
+			std::cout.precision(precision);
+		}
+
+		if (!config.benchmarkOutputPath.empty()) {
+			std::ofstream file(config.benchmarkOutputPath);
+			writeBenchmarkJson(file, { benchmarkResult });
+			if (!file) {
+				throw std::runtime_error("Failed to write benchmark results to " + config.benchmarkOutputPath + "!");
+			}
+		}
+	}
+
+	void destroySwapChainResources(std::vector<VkImageView>& imageViews, std::vector<VkFramebuffer>& framebuffers, std::vector<VkSemaphore>& semaphores) {
+		for (auto framebuffer : framebuffers) {
+			vkDestroyFramebuffer(device, framebuffer, nullptr);
+		}
+
+		for (auto imageView : imageViews) {
+			vkDestroyImageView(device, imageView, nullptr);
+		}
+
+		for (auto semaphore : semaphores) {
+			vkDestroySemaphore(device, semaphore, nullptr);
+		}
+	}
+
+	/// <summary>
+	/// Only safe once the GPU is idle, see mainLoop().
+	/// </summary>
+	void cleanupSwapChain() {
+		destroySwapChainResources(swapChainImageViews, swapChainFramebuffers, renderFinishedSemaphores);
+
+		if (config.headless) {
+			memoryAllocator.destroyImage(swapChainImages[0], offscreenAllocation);
+		} else {
+			vkDestroySwapchainKHR(device, swapChain, nullptr);
+		}
+	}
+
+	/// <summary>
+	/// Build a swap chain for the new window size without draining the GPU: frames still in flight keep rendering to and
+	/// presenting from the old one, which is handed to the new one as oldSwapchain and destroyed a few frames later by
+	/// the deletion queue. Presentation is not covered by any fence, but by then the presentation engine has long stopped
+	/// waiting on the old render finished semaphores. The render pass and pipelines don't depend on the size, viewport
+	/// and scissor are dynamic.
+	/// </summary>
+	void recreateSwapChain() {
+		framebufferResized = false;
+
+		// Nothing to present to while minimized
+		while (isMinimized()) {
+			glfwWaitEvents();
+		}
+
+		deletionQueue.defer([this, oldSwapChain = swapChain, imageViews = std::move(swapChainImageViews),
+				framebuffers = std::move(swapChainFramebuffers), semaphores = std::move(renderFinishedSemaphores)]() mutable {
+			destroySwapChainResources(imageViews, framebuffers, semaphores);
+			vkDestroySwapchainKHR(device, oldSwapChain, nullptr);
+		});
+		swapChainImageViews.clear();
+		swapChainFramebuffers.clear();
+		renderFinishedSemaphores.clear();
+
+		createSwapChain();
+		createImageViews();
+		createFramebuffers();
+		createSwapChainSyncObjects();
+	}
+
+	void cleanup() {
+		if (config.shaderHotReload) {
+			shaderWatcher.stop();
+			shaderWatcher.printStats(std::cout);
+		}
+		if (isSimulated()) {
+			simulation.stop();
+			simulation.printStats(std::cout);
+		}
+
+		if (config.dynamicRendering) {
+			dynamicState.print(std::cout);
+		}
+
+		// Before anything its deletions may still reference is gone
+		deletionQueue.printStats(std::cout);
+		deletionQueue.cleanup();
+
+		cleanupSwapChain();
+
+		for (size_t i = 0; i < frames.size(); i++) {
+			FrameData& frame = frames[i];
+			vkDestroySemaphore(device, frame.imageAvailableSemaphore, nullptr);
+			vkDestroyFence(device, frame.inFlightFence, nullptr);
+			frame.commandPools.cleanup();
+			frame.renderGraph.cleanup();
+			if (asyncComputeEnabled) {
+				vkDestroySemaphore(device, frame.computeFinishedSemaphore, nullptr);
+				frame.computeCommandPools.cleanup();
+			}
+
+			std::cout << "Frame arena " << i << ": ";
+			frame.arena.printStats(std::cout);
+			std::cout << "\n";
+			frame.arena.cleanup();
+		}
+
+		if (gpuDrivenEnabled) {
+			gpuCulling.printStats(std::cout);
+			gpuCulling.cleanup();
+		}
+		if (meshShadersEnabled) {
+			meshletRenderer.printStats(std::cout);
+			meshletRenderer.cleanup();
+		}
+		gpuMesh.cleanup();
+		if (textureStreamingEnabled) {
+			textureStreamer.printStats(std::cout);
+			textureStreamer.cleanup();
+		}
+
+		if (drawBatchingEnabled) {
+			std::cout << "Draw batching: ";
+			drawBatcher.printStats(std::cout);
+			std::cout << "\n";
+		}
+
+		// Waits out any compile still running, which reads the render pass, before destroying every graphics pipeline
+		pipelineCompiler.printStats(std::cout);
+		pipelineCompiler.cleanup();
+		vkDestroyRenderPass(device, renderPass, nullptr);
+
+		// Every graphics pipeline layout and the classic set layout came from here
+		pipelineLayoutCache.printStats(std::cout);
+		pipelineLayoutCache.cleanup();
+
+		if (bindlessEnabled) {
+			bindlessDescriptors.cleanup();
+		} else {
+			vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+		}
+		memoryAllocator.destroyBuffer(materialBuffer, materialAllocation);
+
+		pipelineCache.printStats(std::cout);
+		pipelineCache.cleanup();
+
+		uniformRing.printStats(std::cout);
+		uniformRing.cleanup();
+
+		std::cout << "Scene: ";
+		scene.printStats(std::cout);
+		std::cout << "\n";
+		if (!gpuDrivenEnabled && !meshShadersEnabled) {
+			std::cout << "CPU culling: " << visibleDraws.size() << " of " << draws.size() << " draws visible in the last frame\n";
+		}
+		if (sceneBvh.getStats().builds != 0) {
+			std::cout << "Scene BVH: ";
+			sceneBvh.printStats(std::cout);
+			std::cout << "\n";
+		}
+
+		profiler.printStats(std::cout);
+		if (!config.tracePath.empty()) {
+			profiler.writeTrace(config.tracePath);
+			std::cout << "Wrote trace to " << config.tracePath << std::endl;
+		}
+		profiler.cleanup();
+
+		stagingRing.printStats(std::cout);
+		stagingRing.cleanup();
+
+		if (config.printMemoryStats) {
+			memoryAllocator.printStats(std::cout);
+		}
+		memoryAllocator.cleanup();
+
+		vkDestroyDevice(device, nullptr);
+		if (surface != VK_NULL_HANDLE) {
+			vkDestroySurfaceKHR(instance, surface, nullptr); // The surface extension isn't even enabled when headless
+		}
+		debugUtils.cleanup();
+		vkDestroyInstance(instance, nullptr);
+		if (window != nullptr) {
+			glfwDestroyWindow(window);
+		}
+		glfwTerminate();
+	}
+};
+
+#ifdef ENGINE_BENCHMARK_SUITE
+/// <summary>
+/// Entry point of the HeadlessBenchmark target: every scene of getBenchmarkScenes() (or just --scene NAME) in turn,
+/// each in a fresh application so nothing carries over, with every result in one JSON file at the end
+/// (--benchmark-output PATH, benchmark_results.json by default).
+/// </summary>
+int main(int argc, char** argv) {
+	try {
+		const EngineConfig baseConfig = parseCommandLine(argc, argv);
+		const std::string outputPath = baseConfig.benchmarkOutputPath.empty() ? "benchmark_results.json" : baseConfig.benchmarkOutputPath;
+
+		std::vector<BenchmarkResult> results;
+		for (const BenchmarkScene& scene : getBenchmarkScenes()) {
+			if (!baseConfig.benchmarkScene.empty() && baseConfig.benchmarkScene != scene.name) {
+				continue;
+			}
+			if (scene.mesh && baseConfig.meshPath.empty()) {
+				if (!baseConfig.benchmarkScene.empty()) {
+					throw std::runtime_error(std::string("Scene ") + scene.name + " draws a mesh, pass one with --mesh PATH!");
+				}
+				std::cout << "Skipping scene " << scene.name << ", it needs --mesh PATH" << std::endl;
+				continue;
+			}
+
+			EngineConfig config = baseConfig;
+			applyBenchmarkScene(scene, config);
+			config.benchmarkScene = scene.name;
+			config.benchmarkOutputPath.clear();
+
+			std::cout << "Scene " << scene.name << ": " << scene.description << std::endl;
+			HelloTriangleApplication app(config);
+			app.run();
+			results.push_back(app.getBenchmarkResult());
+		}
+
+		if (results.empty()) {
+			throw std::runtime_error("No benchmark scene called " + baseConfig.benchmarkScene + "!");
+		}
+
+		std::ofstream file(outputPath);
+		writeBenchmarkJson(file, results);
+		if (!file) {
+			throw std::runtime_error("Failed to write benchmark results to " + outputPath + "!");
+		}
+		std::cout << "Wrote " << results.size() << " results to " << outputPath << std::endl;
+	} catch (const std::exception &e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+#else
+int main(int argc, char** argv) {
+	try {
+		HelloTriangleApplication app(parseCommandLine(argc, argv));
+		app.run();
+	} catch (const std::exception &e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+#endif
@@ -0,0 +1,12 @@
+C:/VulkanSDK/1.3.236.0/Bin/glslc.exe shader.vert -o vert.spv
+C:/VulkanSDK/1.3.236.0/Bin/glslc.exe -DBINDLESS shader.vert -o vert_bindless.spv
+C:/VulkanSDK/1.3.236.0/Bin/glslc.exe -DINSTANCED shader.vert -o vert_instanced.spv
+C:/VulkanSDK/1.3.236.0/Bin/glslc.exe -DINSTANCED -DBINDLESS shader.vert -o vert_instanced_bindless.spv
+C:/VulkanSDK/1.3.236.0/Bin/glslc.exe shader.frag -o frag.spv
+C:/VulkanSDK/1.3.236.0/Bin/glslc.exe -DSTREAMED_TEXTURES shader.frag -o frag_streamed.spv
+C:/VulkanSDK/1.3.236.0/Bin/glslc.exe indirect.vert -o indirect_vert.spv
+C:/VulkanSDK/1.3.236.0/Bin/glslc.exe -DMESH indirect.vert -o indirect_mesh_vert.spv
+C:/VulkanSDK/1.3.236.0/Bin/glslc.exe cull.comp -o cull.spv
+C:/VulkanSDK/1.3.236.0/Bin/glslc.exe --target-env=vulkan1.2 meshlet.task -o meshlet_task.spv
+C:/VulkanSDK/1.3.236.0/Bin/glslc.exe --target-env=vulkan1.2 meshlet.mesh -o meshlet_mesh.spv
+pause
@@ -0,0 +1,64 @@
+#version 450
+
+#ifdef MESH
+// AssetVertex from a cooked mesh; the normal is 10:10:10:2 snorm, unpacked by the vertex fetch
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec4 inNormal;
+layout(location = 2) in vec2 inUv;
+#else
+// Hardcoded triangle until we have vertex buffers, indexed 0, 1, 2 by the GPU driven path
+vec2 positions[3] = vec2[](
+	vec2(0.0, -0.5),
+	vec2(0.5, 0.5),
+	vec2(-0.5, 0.5)
+);
+
+vec3 colors[3] = vec3[](
+	vec3(1.0, 0.0, 0.0),
+	vec3(0.0, 1.0, 0.0),
+	vec3(0.0, 0.0, 1.0)
+);
+#endif
+
+// Must match GpuInstance in GpuCulling.h
+struct Instance {
+	vec4 bounds;
+	vec2 offset;
+	float scale;
+	uint materialIndex;
+};
+
+// Must match MaterialData in main.cpp
+struct Material {
+	vec4 color;
+};
+
+layout(set = 0, binding = 0) readonly buffer InstanceBuffer {
+	Instance instances[];
+};
+
+layout(set = 0, binding = 1) readonly buffer MaterialBuffer {
+	Material materials[];
+};
+
+layout(location = 0) out vec3 fragColor;
+#ifdef MESH
+// Only read by shader.frag's STREAMED_TEXTURES variant
+layout(location = 1) out vec2 fragUv;
+layout(location = 2) flat out uint fragMaterial;
+#endif
+
+void main() {
+	// cull.comp writes each surviving instance's index into its draw's firstInstance
+	Instance instance = instances[gl_InstanceIndex];
+#ifdef MESH
+	// Flattened onto the view like the triangle; y flips so the mesh's up is up on screen. Must match meshlet.mesh
+	gl_Position = vec4(inPosition.xy * vec2(1.0, -1.0) * instance.scale + instance.offset, 0.0, 1.0);
+	fragColor = (0.5 + 0.5 * inNormal.z) * materials[instance.materialIndex].color.rgb;
+	fragUv = inUv;
+	fragMaterial = instance.materialIndex;
+#else
+	gl_Position = vec4(positions[gl_VertexIndex] * instance.scale + instance.offset, 0.0, 1.0);
+	fragColor = colors[gl_VertexIndex] * materials[instance.materialIndex].color.rgb;
+#endif
+}
@@ -0,0 +1,55 @@
+#version 450
+
+#ifdef STREAMED_TEXTURES
+#extension GL_EXT_nonuniform_qualifier : require
+#endif
+
+layout(location = 0) in vec3 fragColor;
+
+#ifdef STREAMED_TEXTURES
+// Must match TextureStreamer::MAX_TEXTURES and FEEDBACK_LOD_BIAS
+#define MAX_STREAMED_TEXTURES 64
+#define FEEDBACK_LOD_BIAS 16
+
+layout(location = 1) in vec2 fragUv;
+layout(location = 2) flat in uint fragMaterial;
+
+// Must match TextureStreamer::FeedbackEntry
+struct Feedback {
+	uint mip; // Finest level sampled plus FEEDBACK_LOD_BIAS, relative to the image bound this frame
+	uint samples;
+};
+
+layout(set = 1, binding = 0) uniform sampler2D textures[MAX_STREAMED_TEXTURES];
+
+// Reset by TextureStreamer::update() before every frame that uses it
+layout(set = 1, binding = 1) buffer FeedbackBuffer {
+	uint textureCount;
+	uint padding;
+	Feedback feedback[];
+};
+#endif
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+#ifdef STREAMED_TEXTURES
+	// A triangle's fragments share a material, but a quad can straddle two triangles
+	uint textureIndex = fragMaterial % textureCount;
+	vec4 texel = texture(textures[nonuniformEXT(textureIndex)], fragUv);
+	// Unclamped, so a texture bound at a coarse mip still asks for the finer ones it's missing. Queried outside the
+	// branch below, the implicit derivatives need the whole quad
+	float lod = textureQueryLod(textures[nonuniformEXT(textureIndex)], fragUv).y;
+
+	// One fragment in 16 is plenty to tell which mips are wanted, and keeps the atomics off the hot path
+	uvec2 pixel = uvec2(gl_FragCoord.xy);
+	if ((pixel.x & 3) == 0 && (pixel.y & 3) == 0) {
+		atomicMin(feedback[textureIndex].mip, uint(clamp(floor(lod) + FEEDBACK_LOD_BIAS, 0.0, 31.0)));
+		atomicAdd(feedback[textureIndex].samples, 1u);
+	}
+
+	outColor = vec4(fragColor * texel.rgb, 1.0);
+#else
+	outColor = vec4(fragColor, 1.0);
+#endif
+}
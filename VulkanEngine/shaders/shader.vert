@@ -0,0 +1,76 @@
+#version 450
+
+#ifdef BINDLESS
+#extension GL_EXT_nonuniform_qualifier : require // Runtime sized descriptor arrays
+#endif
+
+// Hardcoded triangle until we have vertex buffers
+vec2 positions[3] = vec2[](
+	vec2(0.0, -0.5),
+	vec2(0.5, 0.5),
+	vec2(-0.5, 0.5)
+);
+
+vec3 colors[3] = vec3[](
+	vec3(1.0, 0.0, 0.0),
+	vec3(0.0, 1.0, 0.0),
+	vec3(0.0, 0.0, 1.0)
+);
+
+#ifdef INSTANCED
+// Must match ObjectUniforms in main.cpp
+struct Object {
+	vec2 offset;
+	float scale;
+	uint materialIndex;
+};
+
+// Per instance placement, the frame's region of the uniform ring as one array. Each batch's firstInstance points at its run.
+layout(set = 1, binding = 0) readonly buffer ObjectBuffer {
+	Object objects[];
+};
+#else
+// Per draw placement from the uniform ring, the dynamic offset picks the draw. Must match ObjectUniforms in main.cpp
+layout(set = 1, binding = 0) uniform ObjectUniforms {
+	vec2 offset;
+	float scale;
+	uint materialIndex;
+} draw;
+#endif
+
+// Same for every draw, must match DrawPushConstants in main.cpp
+layout(push_constant) uniform DrawConstants {
+	uint materialBufferIndex; // Slot of the material table in the bindless buffer array, unused by the classic path
+} constants;
+
+// Must match MaterialData in main.cpp
+struct Material {
+	vec4 color;
+};
+
+#ifdef BINDLESS
+// Every storage buffer the engine registered, see BindlessDescriptors
+layout(set = 0, binding = 1) readonly buffer MaterialBuffer {
+	Material materials[];
+} buffers[];
+#else
+layout(set = 0, binding = 0) readonly buffer MaterialBuffer {
+	Material materials[];
+} materialBuffer;
+#endif
+
+layout(location = 0) out vec3 fragColor;
+
+void main() {
+#ifdef INSTANCED
+	Object draw = objects[gl_InstanceIndex];
+#endif
+	gl_Position = vec4(positions[gl_VertexIndex] * draw.scale + draw.offset, 0.0, 1.0);
+#ifdef BINDLESS
+	// A push constant is the same for the whole draw, so plain dynamic indexing is enough here
+	vec4 color = buffers[constants.materialBufferIndex].materials[draw.materialIndex].color;
+#else
+	vec4 color = materialBuffer.materials[draw.materialIndex].color;
+#endif
+	fragColor = colors[gl_VertexIndex] * color.rgb;
+}